@@ -20,8 +20,17 @@ along with Kangaroo. If not, see <http://www.gnu.org/licenses/>.
 #include "formbooksettings.h"
 
 #include <QAction>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QDir>
+#include <QFileDialog>
+#include <QFontDatabase>
 #include <QMenu>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QVBoxLayout>
 
+#include <KangarooLib/controller/io.h>
 #include <KangarooLib/ui/core.h>
 #include <KangarooLib/ui/mainwindow.h>
 #include <KangarooLib/ui/actionmanager/actionmanager.h>
@@ -30,7 +39,8 @@ along with Kangaroo. If not, see <http://www.gnu.org/licenses/>.
 
 using namespace KLib;
 
-BookSettingsPlugin::BookSettingsPlugin()
+BookSettingsPlugin::BookSettingsPlugin() :
+    m_lastTracePath(QDir::homePath())
 {
 }
 
@@ -44,9 +54,21 @@ bool BookSettingsPlugin::initialize(QString& p_errorMessage)
     mnuBookSettings = new QAction(Core::icon("modify"), tr("Boo&k Settings"), mnuFile->menu());
     mnuFile->menu()->insertAction(bef ? bef->action() : nullptr, mnuBookSettings);
 
+    mnuIOProfile = new QAction(Core::icon("chart-line"), tr("I/O &Profile"), mnuFile->menu());
+    mnuIOProfile->setToolTip(tr("Shows the time spent loading and saving each part of the book."));
+    mnuFile->menu()->insertAction(bef ? bef->action() : nullptr, mnuIOProfile);
+
+    mnuSaveTrace = new QAction(Core::icon("document-export"), tr("Save I/O &Trace"), mnuFile->menu());
+    mnuSaveTrace->setToolTip(tr("Saves the last load and save profiles as traces (Trace Event Format)."));
+    mnuFile->menu()->insertAction(bef ? bef->action() : nullptr, mnuSaveTrace);
+
     connect(mnuBookSettings, &QAction::triggered, this, &BookSettingsPlugin::editBookSettings);
+    connect(mnuIOProfile, &QAction::triggered, this, &BookSettingsPlugin::showIOProfile);
+    connect(mnuSaveTrace, &QAction::triggered, this, &BookSettingsPlugin::saveIOTrace);
 
     mnuBookSettings->setEnabled(false);
+    mnuIOProfile->setEnabled(false);
+    mnuSaveTrace->setEnabled(false);
 
     return true;
 }
@@ -58,6 +80,67 @@ void BookSettingsPlugin::editBookSettings()
     delete form;
 }
 
+void BookSettingsPlugin::showIOProfile()
+{
+    QString result = IO::instance()->lastLoadProfile().toText();
+
+    if (!IO::instance()->lastSaveProfile().operation().isEmpty())
+    {
+        result += "\n" + IO::instance()->lastSaveProfile().toText();
+    }
+
+    QDialog dialog(Core::instance()->mainWindow());
+    dialog.setWindowTitle(tr("I/O Profile"));
+
+    QPlainTextEdit* txtProfile = new QPlainTextEdit(result);
+    txtProfile->setReadOnly(true);
+    txtProfile->setLineWrapMode(QPlainTextEdit::NoWrap);
+    txtProfile->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    layout->addWidget(txtProfile);
+    layout->addWidget(buttons);
+
+    dialog.resize(700, 500);
+    dialog.exec();
+}
+
+void BookSettingsPlugin::saveIOTrace()
+{
+    //Get the path
+    QString jsonFile = tr("Trace File") + " (*.json)";
+    QString path = QFileDialog::getSaveFileName(Core::instance()->mainWindow(), tr("Save I/O Trace As"),
+                                                m_lastTracePath, jsonFile);
+
+    if (path.isEmpty())
+        return;
+
+    if (path.endsWith(".json"))
+        path.chop(5);
+
+    m_lastTracePath = path;
+
+    //The load and save profiles go in separate files: path-load.json and path-save.json
+    try
+    {
+        IO::instance()->lastLoadProfile().saveTrace(path + "-load.json");
+
+        if (!IO::instance()->lastSaveProfile().operation().isEmpty())
+        {
+            IO::instance()->lastSaveProfile().saveTrace(path + "-save.json");
+        }
+    }
+    catch (IOException e)
+    {
+        QMessageBox::warning(Core::instance()->mainWindow(),
+                             tr("Save I/O Trace As"),
+                             tr("An error has occured while saving the trace :\n%1").arg(e.description()));
+    }
+}
+
 void BookSettingsPlugin::checkSettings(QSettings& settings) const
 {
     Q_UNUSED(settings)
@@ -66,11 +149,15 @@ void BookSettingsPlugin::checkSettings(QSettings& settings) const
 void BookSettingsPlugin::onLoad()
 {
     mnuBookSettings->setEnabled(true);
+    mnuIOProfile->setEnabled(true);
+    mnuSaveTrace->setEnabled(true);
 }
 
 void BookSettingsPlugin::onUnload()
 {
     mnuBookSettings->setEnabled(false);
+    mnuIOProfile->setEnabled(false);
+    mnuSaveTrace->setEnabled(false);
 }
 
 QString BookSettingsPlugin::name() const
@@ -21,6 +21,7 @@ along with Kangaroo. If not, see <http://www.gnu.org/licenses/>.
 
 #include <KangarooLib/iplugin.h>
 #include <QObject>
+#include <QString>
 
 class QAction;
 
@@ -51,9 +52,15 @@ class BookSettingsPlugin : public QObject, public KLib::IPlugin
 
     public slots:
         void editBookSettings();
+        void showIOProfile();
+        void saveIOTrace();
 
     private:
         QAction* mnuBookSettings;
+        QAction* mnuIOProfile;
+        QAction* mnuSaveTrace;
+
+        QString m_lastTracePath;
 
 };
 
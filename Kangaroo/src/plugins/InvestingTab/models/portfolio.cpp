@@ -140,7 +140,9 @@ Portfolio::Portfolio(Account* _account, QObject* _parent) :
     connect(LedgerManager::instance(), &LedgerManager::splitAdded, this, &Portfolio::onSplitChanged);
     connect(LedgerManager::instance(), &LedgerManager::splitAmountChanged, this, &Portfolio::onSplitChanged);
     connect(LedgerManager::instance(), &LedgerManager::splitRemoved, this, &Portfolio::onSplitChanged);
+    connect(LedgerManager::instance(), &LedgerManager::transactionsAdded, this, &Portfolio::onTransactionsAdded);
     connect(LedgerManager::instance(), &LedgerManager::transactionDateChanged, this, &Portfolio::onTransactionDateChanged);
+    connect(LedgerManager::instance(), &LedgerManager::changesCommitted, this, &Portfolio::onChangesCommitted);
 
     connect(Account::getTopLevel(), &Account::accountAdded, this, &Portfolio::onAccountAdded);
     connect(Account::getTopLevel(), &Account::accountRemoved, this, &Portfolio::onAccountRemoved);
@@ -356,6 +358,36 @@ void Portfolio::onSplitChanged(const Transaction::Split& _split, Transaction*)
     }
 }
 
+void Portfolio::onTransactionsAdded(const QList<Transaction*>&, const QSet<int>& _idAccounts)
+{
+    updatePositions(_idAccounts);
+}
+
+void Portfolio::onChangesCommitted(const ModelDelta& _delta)
+{
+    updatePositions(_delta.accounts);
+}
+
+void Portfolio::updatePositions(const QSet<int>& _idAccounts)
+{
+    //Notify each position once
+    QSet<int> positions;
+
+    for (int id : _idAccounts)
+    {
+        if (m_accountIndex.contains(id))
+        {
+            m_positions[m_accountIndex[id]].update(id);
+            positions.insert(m_accountIndex[id]);
+        }
+    }
+
+    for (int i : positions)
+    {
+        emit positionDataChanged(m_positions[i].security);
+    }
+}
+
 void Portfolio::onTransactionDateChanged(Transaction* _tr, const QDate& _old)
 {
     //Only update if went to/from future.
@@ -3,7 +3,9 @@
 
 #include <KangarooLib/amount.h>
 #include <KangarooLib/model/transaction.h>
+#include <KangarooLib/model/ledger.h>
 #include <QColor>
+#include <QSet>
 
 using KLib::Amount;
 
@@ -119,6 +121,8 @@ class Portfolio : public QObject
         void onSecurityModified(KLib::Security* _sec);
         void onTransactionDateChanged(KLib::Transaction* _tr, const QDate& _old);
         void onSplitChanged(const KLib::Transaction::Split& _split, KLib::Transaction*);
+        void onTransactionsAdded(const QList<KLib::Transaction*>&, const QSet<int>& _idAccounts);
+        void onChangesCommitted(const KLib::ModelDelta& _delta);
 
         void onLastRateModified(KLib::ExchangePair* _p);
 
@@ -126,6 +130,11 @@ class Portfolio : public QObject
         void rebuildIndexes();
         void updateCalculations();
 
+        /**
+         * @brief Updates the positions of the accounts, and notifies each position once.
+         */
+        void updatePositions(const QSet<int>& _idAccounts);
+
         void addAccount(KLib::Account* _account);
         void removeAccount(KLib::Account* _account);
 
@@ -740,6 +740,10 @@ void KMyMoneyImport::insertTransactions(ErrorList& _errors)
         return Account::getTopLevel()->account(idAccount)->mainCurrency();
     };
 
+    //The transactions are added at once, after they are all built.
+    QList<Transaction*> transactions;
+    QList<QPair<QString, QDate> > descriptions; ///< Memo and date of each transaction
+
     try
     {
         for (KMMTransaction t : m_kmmTransactions)
@@ -878,7 +882,8 @@ void KMyMoneyImport::insertTransactions(ErrorList& _errors)
                     trans->setMemo(t.memo);
                     trans->setSplits(splits);
 
-                    LedgerManager::instance()->addTransaction(trans);
+                    transactions << trans;
+                    descriptions << qMakePair(t.memo, t.date);
                 }
                 else
                 {
@@ -935,7 +940,8 @@ void KMyMoneyImport::insertTransactions(ErrorList& _errors)
                         break;
                     }
 
-                    LedgerManager::instance()->addTransaction(tr);
+                    transactions << tr;
+                    descriptions << qMakePair(t.memo, t.date);
                 }
             }
             catch (ModelException e)
@@ -946,6 +952,17 @@ void KMyMoneyImport::insertTransactions(ErrorList& _errors)
                                  .arg(e.description()));
             }
         }
+
+        QHash<int, QString> errors;
+        LedgerManager::instance()->addTransactions(transactions, &errors);
+
+        for (auto i = errors.begin(); i != errors.end(); ++i)
+        {
+            _errors << Error(Warning, QObject::tr("Unable to add transaction %1 on %2: %3")
+                             .arg(descriptions[i.key()].first)
+                             .arg(descriptions[i.key()].second.toString())
+                             .arg(i.value()));
+        }
     }
     catch (ModelException)
     {
@@ -126,7 +126,7 @@ bool AccountActions::reassignAllTransactions(KLib::Account* _account) {
   std::vector<int> all_transactions;
   for (auto it = _account->ledger()->transactions()->begin();
        it != _account->ledger()->transactions()->end(); ++it) {
-    all_transactions.push_back(it.value()->id());
+    all_transactions.push_back(it.value().id());
   }
 
   QStringList errors;
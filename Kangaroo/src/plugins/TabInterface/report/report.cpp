@@ -9,6 +9,7 @@
 #include <KangarooLib/model/payee.h>
 #include <KangarooLib/model/institution.h>
 #include <KangarooLib/controller/reportgenerator.h>
+#include <KangarooLib/controller/reportjob.h>
 #include <QMessageBox>
 #include <QDate>
 #include <QDebug>
@@ -372,7 +373,7 @@ void Report::setSettingsToDefault(QList<ReportSetting>& _settings)
     }
 }
 
-QString Report::generateHtml(const ReportSettings& _settings) const
+QString Report::settingsStatement(const ReportSettings& _settings)
 {
     QString settingStatement = "var Settings = {";
 
@@ -385,13 +386,17 @@ QString Report::generateHtml(const ReportSettings& _settings) const
     }
 
     settingStatement += "\n}\n";
+    return settingStatement;
+}
 
+QString Report::generateHtml(const ReportSettings& _settings) const
+{
     //Generate the HTML
     QString html;
 
     try
     {
-        html = ReportGenerator::generateHtml(path, settingStatement);
+        html = ReportGenerator::generateHtml(path, settingsStatement(_settings));
     }
     catch (IOException e)
     {
@@ -404,6 +409,11 @@ QString Report::generateHtml(const ReportSettings& _settings) const
     return html;
 }
 
+ReportJob* Report::generateHtmlAsync(const ReportSettings& _settings, QObject* _parent) const
+{
+    return ReportJob::start(path, settingsStatement(_settings), _parent);
+}
+
 
 
 
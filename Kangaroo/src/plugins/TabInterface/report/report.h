@@ -5,6 +5,13 @@
 #include <QVariant>
 #include <QList>
 
+class QObject;
+
+namespace KLib
+{
+    class ReportJob;
+}
+
 namespace SettingType
 {
     enum Type
@@ -65,6 +72,12 @@ class Report
 
         QString generateHtml(const ReportSettings& _settings) const;
 
+        /**
+         * @brief Generates the report on worker threads, from a snapshot of the model (see
+         * KLib::ReportJob). The caller owns the job.
+         */
+        KLib::ReportJob* generateHtmlAsync(const ReportSettings& _settings, QObject* _parent = nullptr) const;
+
         QString name;
         QString author;
         QString version;
@@ -74,6 +87,9 @@ class Report
 
         QList<ReportSetting> settings;
 
+    private:
+        static QString settingsStatement(const ReportSettings& _settings);
+
 };
 
 #endif // REPORT_H
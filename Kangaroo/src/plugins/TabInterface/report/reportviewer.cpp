@@ -9,6 +9,7 @@
 #include <QMessageBox>
 #include <QPushButton>
 #include <KangarooLib/ui/core.h>
+#include <KangarooLib/controller/reportjob.h>
 #include <QLabel>
 
 using namespace KLib;
@@ -28,7 +29,8 @@ QString ReportViewer::m_lastPath = QString();
 ReportViewer::ReportViewer(Report* _report, const ReportSettings& _settings, QWidget *parent) :
     QWidget(parent),
     m_report(_report),
-    m_settings(_settings)
+    m_settings(_settings),
+    m_job(nullptr)
 {
     QPushButton* btnPrint = new QPushButton(Core::icon("print"), "", this);
     QPushButton* btnSaveAs = new QPushButton(Core::icon("save-as"), "", this);
@@ -38,10 +40,15 @@ ReportViewer::ReportViewer(Report* _report, const ReportSettings& _settings, QWi
     btnSaveAs->setFlat(true);
     btnReload->setFlat(true);
 
+    m_btnCancel = new QPushButton(Core::icon("process-stop"), tr("Cancel"), this);
+    m_btnCancel->setFlat(true);
+    m_btnCancel->hide();
+
 //    m_view = new QWebView(this);
 //    m_view->settings()->setUserStyleSheetUrl(QUrl::fromLocalFile(Core::path(Path_Themes) + "report_style.css"));
 
     QHBoxLayout* buttonLayout = new QHBoxLayout();
+    buttonLayout->addWidget(m_btnCancel);
     buttonLayout->addStretch(2);
     buttonLayout->addWidget(btnPrint);
     buttonLayout->addWidget(btnSaveAs);
@@ -54,6 +61,16 @@ ReportViewer::ReportViewer(Report* _report, const ReportSettings& _settings, QWi
     connect(btnPrint,  &QPushButton::clicked, this, &ReportViewer::print);
     connect(btnSaveAs, &QPushButton::clicked, this, &ReportViewer::saveAs);
     connect(btnReload, &QPushButton::clicked, this, &ReportViewer::reload);
+    connect(m_btnCancel, &QPushButton::clicked, this, &ReportViewer::cancel);
+}
+
+ReportViewer::~ReportViewer()
+{
+    if (m_job)
+    {
+        disconnect(m_job, nullptr, this, nullptr);
+        delete m_job;
+    }
 }
 
 void ReportViewer::setContent(const QString& _htmlContent)
@@ -64,14 +81,65 @@ void ReportViewer::setContent(const QString& _htmlContent)
 
 void ReportViewer::reload()
 {
-    QString newHtml = m_report->generateHtml(m_settings);
+    //The report reads a snapshot of the model: the GUI stays responsive while it is generated.
+    dropJob();
+
+    m_job = m_report->generateHtmlAsync(m_settings, this);
+    connect(m_job, &ReportJob::finished,  this, &ReportViewer::onJobFinished);
+    connect(m_job, &ReportJob::failed,    this, &ReportViewer::onJobFailed);
+    connect(m_job, &ReportJob::cancelled, this, &ReportViewer::onJobCancelled);
+
+    m_btnCancel->show();
+}
+
+void ReportViewer::cancel()
+{
+    if (m_job)
+    {
+        m_job->cancel();
+    }
+}
+
+void ReportViewer::onJobFinished(const QStringList& _outputs)
+{
+    dropJob();
 
-    if (!newHtml.isEmpty())
+    if (!_outputs.isEmpty() && !_outputs.first().isEmpty())
     {
-        setContent(newHtml);
+        setContent(_outputs.first());
     }
 }
 
+void ReportViewer::onJobFailed(const QString& _error)
+{
+    dropJob();
+
+    QMessageBox::information(this,
+                             tr("Open Report"),
+                             tr("An error has occured while compiling the report file:\n\n%1").arg(_error));
+}
+
+void ReportViewer::onJobCancelled()
+{
+    dropJob();
+}
+
+void ReportViewer::dropJob()
+{
+    if (!m_job)
+    {
+        return;
+    }
+
+    //Deleting the job waits for its workers, which stop at their next output once cancelled.
+    disconnect(m_job, nullptr, this, nullptr);
+    m_job->cancel();
+    m_job->deleteLater();
+    m_job = nullptr;
+
+    m_btnCancel->hide();
+}
+
 void ReportViewer::print()
 {
     QPrintDialog p(m_printer, this);
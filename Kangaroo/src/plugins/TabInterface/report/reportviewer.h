@@ -6,6 +6,12 @@
 #include "report.h"
 
 class QWebView;
+class QPushButton;
+
+namespace KLib
+{
+    class ReportJob;
+}
 
 class ReportViewer : public QWidget
 {
@@ -13,20 +19,47 @@ class ReportViewer : public QWidget
     public:
         explicit ReportViewer(Report* _report, const ReportSettings& _settings, QWidget *parent = 0);
 
+        /**
+         * @brief Cancels the report being generated, if any, and waits for its workers to stop.
+         */
+        ~ReportViewer();
+
         void setContent(const QString& _htmlContent);
 
     public slots:
         void print();
         void saveAs();
+        /**
+         * @brief Generates the report again, on worker threads. The content is set when it is done. A
+         * report still being generated is cancelled.
+         */
         void reload();
 
+        /**
+         * @brief Cancels the report being generated. The current content is kept.
+         */
+        void cancel();
+
+    private slots:
+        void onJobFinished(const QStringList& _outputs);
+        void onJobFailed(const QString& _error);
+        void onJobCancelled();
+
     private:
+        /**
+         * @brief Cancels and drops the current job, if any. Its signals are not received anymore.
+         */
+        void dropJob();
+
 //        QWebView* m_view;
         QString m_html;
 
         Report* m_report;
         ReportSettings m_settings;
 
+        KLib::ReportJob* m_job;
+        QPushButton* m_btnCancel;
+
         static QString  m_lastPath;
         static QPrinter* m_printer;
 
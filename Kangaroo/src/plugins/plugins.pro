@@ -1,4 +1,7 @@
 TEMPLATE = subdirs
+
+# The Console plugin was removed: it depended on a ScriptEngine that KangarooLib does not have.
+# Scripts run in the report engines (KLib::ReportTemplate), which register the model objects.
 SUBDIRS += TabInterface \
            #HomeTab \
            #AccountTreeWidget \
@@ -11,7 +14,6 @@ SUBDIRS += TabInterface \
            # YahooQuotes \
            UpdatePrices \
            Schedules \
-           # Console \
            FrequentAccounts \
            InvestmentCalculator \
            CreateBook \
@@ -19,7 +19,7 @@ MOC_DIR = build/moc
 UI_DIR = build/ui
 
 DEFINES += KANGAROOLIB_LIBRARY
-QT += gui widgets script printsupport
+QT += gui widgets script printsupport concurrent
 
 INCLUDEPATH += /usr/local/include /include
 
@@ -85,6 +85,12 @@ SOURCES += \
     controller/currencycontroller.cpp \
     controller/securitycontroller.cpp \
     model/pricemanager.cpp \
+    model/accountvaluation.cpp \
+    model/aggregationquery.cpp \
+    model/modelsnapshot.cpp \
+    model/snapshotobjects.cpp \
+    model/transactionindex.cpp \
+    model/transactionsearch.cpp \
     ui/dialogs/spliteditor.cpp \
     ui/widgets/splitswidget.cpp \
     controller/pricecontroller.cpp \
@@ -92,11 +98,16 @@ SOURCES += \
     ui/dialogs/formcurrencyexchange.cpp \
     controller/ledger/investmentledgercontroller.cpp \
     controller/reportgenerator.cpp \
+    controller/reportjob.cpp \
+    controller/reporttemplate.cpp \
     ui/widgets/chart.cpp \
     ui/widgets/calculator.cpp \
     ui/dockwidgetmanager.cpp \
     ui/widgets/calculatordock.cpp \
     controller/archive.cpp \
+    controller/columnarformat.cpp \
+    controller/journal.cpp \
+    controller/ioprofile.cpp \
     model/picturemanager.cpp \
     controller/picturecontroller.cpp \
     ui/dialogs/formpicturemanager.cpp \
@@ -118,6 +129,7 @@ SOURCES += \
     ui/dialogs/formgainlosswizard.cpp \
     ui/widgets/splitfractionwidget.cpp \
     util/balances.cpp \
+    util/priceseries.cpp \
     ui/dialogs/optionsdialog.cpp \
     ui/dialogs/formeditschedule.cpp \
     controller/ledger/ledgertransactioncache.cpp \
@@ -202,6 +214,12 @@ HEADERS += \
     controller/currencycontroller.h \
     controller/securitycontroller.h \
     model/pricemanager.h \
+    model/accountvaluation.h \
+    model/aggregationquery.h \
+    model/modelsnapshot.h \
+    model/snapshotobjects.h \
+    model/transactionindex.h \
+    model/transactionsearch.h \
     ui/dialogs/spliteditor.h \
     ui/widgets/splitswidget.h \
     interfaces/iquote.h \
@@ -211,12 +229,17 @@ HEADERS += \
     interfaces/scriptable.h \
     controller/ledger/investmentledgercontroller.h \
     controller/reportgenerator.h \
+    controller/reportjob.h \
+    controller/reporttemplate.h \
     ui/widgets/chart.h \
     ui/widgets/calculator.h \
     ui/dockwidgetmanager.h \
     ui/widgets/calculatordock.h \
     interfaces/ifilemanager.h \
     controller/archive.h \
+    controller/columnarformat.h \
+    controller/journal.h \
+    controller/ioprofile.h \
     model/picturemanager.h \
     controller/picturecontroller.h \
     ui/dialogs/formpicturemanager.h \
@@ -238,8 +261,13 @@ HEADERS += \
     ui/widgets/splitfractionwidget.h \
     util/augmentedtreapmap.h \
     util/fragmentedtreapmap.h \
+    util/treappool.h \
+    util/persistenttreap.h \
+    util/checkpointedstream.h \
+    util/runningsumtree.h \
     util/treaputil.h \
     util/balances.h \
+    util/priceseries.h \
     ui/dialogs/optionsdialog.h \
     ui/dialogs/formeditschedule.h \
     controller/ledger/ledgertransactioncache.h\
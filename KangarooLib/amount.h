@@ -89,6 +89,7 @@ namespace KLib {
             Q_INVOKABLE double  toDouble() const;
             Q_INVOKABLE qint64  roundToInt() const;
             Q_INVOKABLE int     precision() const;
+                        qint64  baseAmount() const { return m_baseAmount; }
             Q_INVOKABLE Amount  toPrecision(int _prec) const;
 
             QVariant    toQVariant() const;
@@ -97,6 +98,7 @@ namespace KLib {
             static Amount fromStoreable(const QString& _str);
             static Amount fromStoreable2(const QString& _str, int _numDigits=2);
             static Amount fromUserLocale(const QString& _str, int _numDigits=2);
+            static Amount fromBaseAmount(qint64 _base, int _precision);
 
             static const int MAX_PRECISION = 6;
 
@@ -360,6 +360,14 @@ namespace KLib {
         return Amount(locale.toDouble(_str), _numDigits);
     }
 
+    inline Amount Amount::fromBaseAmount(qint64 _base, int _precision)
+    {
+        Amount a;
+        a.m_baseAmount = _base;
+        a.m_precision = _precision;
+        return a;
+    }
+
     inline int Amount::precision() const
     {
         return m_precision;
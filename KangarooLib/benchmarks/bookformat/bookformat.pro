@@ -0,0 +1,14 @@
+# Benchmark of the book formats of KangarooLib (controller/io.h): XML and
+# columnar save and load. Links to KangarooLib (build it first).
+
+QMAKE_CXXFLAGS += -std=c++20
+CONFIG += console release
+CONFIG -= app_bundle
+QT += gui widgets script printsupport concurrent
+TEMPLATE = app
+TARGET = bookformatbenchmark
+INCLUDEPATH += ../../
+unix:LIBS += -L$$PWD/../../../Kangaroo/lib -lkangaroo
+SOURCES += bookformatbenchmark.cpp
+
+OBJECTS_DIR = build/obj
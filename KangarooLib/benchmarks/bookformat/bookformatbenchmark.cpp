@@ -0,0 +1,206 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+/*
+ * Times the saving and loading of a book in the XML format (everything in
+ * main.xml, IO::XML_FILE_VERSION) and in the columnar format (binary columns
+ * for the transactions and prices, IO::COLUMNAR_FILE_VERSION).
+ *
+ * The book is synthetic: a few accounts and payees, transactions with two or
+ * three splits spread over the years, and a daily exchange rate. Each format
+ * is saved and loaded a few times; the columnar book is also loaded lazily
+ * (see TransactionManager::setLazyLoading()).
+ *
+ * Usage: bookformatbenchmark [transaction count] [runs]
+ */
+
+#include <QCoreApplication>
+#include <QDate>
+#include <QDir>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "amount.h"
+#include "controller/io.h"
+#include "klib.h"
+#include "model/account.h"
+#include "model/ledger.h"
+#include "model/payee.h"
+#include "model/pricemanager.h"
+#include "model/transaction.h"
+#include "model/transactionmanager.h"
+
+using namespace KLib;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msecsSince(const Clock::time_point& _start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - _start)
+      .count();
+}
+
+void makeBook(int _transactionCount) {
+  IO::instance()->loadNew();
+
+  const QString cur = Constants::DEFAULT_CURRENCY_CODE;
+  Account* top = Account::getTopLevel();
+  Account* assets = top->addChild("Assets", AccountType::ASSET, cur,
+                                  Constants::NO_ID, true);
+  Account* expenses = top->addChild("Expenses", AccountType::EXPENSE, cur,
+                                    Constants::NO_ID, true);
+  Account* income =
+      top->addChild("Income", AccountType::INCOME, cur, Constants::NO_ID);
+
+  QList<int> banks, categories, payees;
+  for (int i = 0; i < 4; ++i) {
+    banks << assets->addChild(QString("Bank %1").arg(i), AccountType::CHECKING,
+                              cur, Constants::NO_ID)->id();
+  }
+  for (int i = 0; i < 40; ++i) {
+    categories << expenses->addChild(QString("Category %1").arg(i),
+                                     AccountType::EXPENSE, cur,
+                                     Constants::NO_ID)->id();
+  }
+  for (int i = 0; i < 500; ++i) {
+    payees << PayeeManager::instance()->add(QString("Payee %1").arg(i))->id();
+  }
+
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> pick(0, 1 << 20);
+  const QDate first(2000, 1, 1);
+  const int days = 365 * 15;
+
+  QList<Transaction*> transactions;
+  transactions.reserve(_transactionCount);
+
+  for (int i = 0; i < _transactionCount; ++i) {
+    Transaction* t = new Transaction();
+    t->setDate(first.addDays(pick(gen) % days));
+    t->setIdPayee(payees[pick(gen) % payees.size()]);
+    t->setMemo(QString("Memo %1").arg(pick(gen) % 1000));
+
+    const Amount amount(double(pick(gen) % 100000) / 100);
+    const int bank = banks[pick(gen) % banks.size()];
+    QList<Transaction::Split> splits;
+
+    if (i % 10 == 0) {
+      splits << Transaction::Split(amount, bank, cur)
+             << Transaction::Split(-amount, income->id(), cur, "Pay");
+    } else if (i % 10 == 1) {
+      const Amount half(amount.toDouble() / 2);
+      splits << Transaction::Split(-amount, bank, cur)
+             << Transaction::Split(half, categories[pick(gen) % 40], cur)
+             << Transaction::Split(amount - half, categories[pick(gen) % 40],
+                                   cur, "Split memo");
+    } else {
+      splits << Transaction::Split(-amount, bank, cur)
+             << Transaction::Split(amount, categories[pick(gen) % 40], cur);
+    }
+
+    t->setSplits(splits);
+    transactions << t;
+  }
+
+  LedgerManager::instance()->addTransactions(transactions);
+
+  ExchangePair* pair = PriceManager::instance()->getOrAdd("CAD", cur);
+  for (int d = 0; d < days; ++d) {
+    pair->set(first.addDays(d), 0.7 + double(pick(gen) % 3000) / 10000);
+  }
+}
+
+struct Timing {
+  double save = 0;
+  double load = 0;
+  qint64 size = 0;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  QCoreApplication app(argc, argv);
+
+  int transactionCount = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int runs = argc > 2 ? std::atoi(argv[2]) : 3;
+
+  QTemporaryDir dir;
+  if (!dir.isValid()) {
+    std::fprintf(stderr, "Unable to create a temporary directory\n");
+    return 1;
+  }
+
+  IO::instance()->setJournalEnabled(false);
+
+  Clock::time_point start = Clock::now();
+  makeBook(transactionCount);
+  double build = msecsSince(start);
+
+  const int formats[] = {IO::XML_FILE_VERSION, IO::COLUMNAR_FILE_VERSION};
+  const char* names[] = {"xml", "columnar", "columnar (lazy)"};
+  Timing timings[3];
+  bool same = true;
+
+  for (int f = 0; f < 2; ++f) {
+    const QString path =
+        dir.filePath(QString("book%1.kangaroo").arg(formats[f]));
+    IO::instance()->setSaveFileVersion(formats[f]);
+
+    for (int r = 0; r < runs; ++r) {
+      start = Clock::now();
+      IO::instance()->save(path);
+      timings[f].save += msecsSince(start);
+    }
+    timings[f].size = QFileInfo(path).size();
+
+    // The columnar book is loaded eagerly, then lazily.
+    for (int lazy = 0; lazy <= (f == 1 ? 1 : 0); ++lazy) {
+      Timing& t = timings[f + lazy];
+      TransactionManager::setLazyLoading(lazy);
+
+      for (int r = 0; r < runs; ++r) {
+        start = Clock::now();
+        IO::instance()->load(path);
+        t.load += msecsSince(start);
+
+        same = same &&
+               TransactionManager::instance()->count() == transactionCount;
+      }
+    }
+    TransactionManager::setLazyLoading(false);
+  }
+
+  std::printf("%d transactions, built in %.2f ms\n", transactionCount, build);
+  std::printf("%d runs of each (ms per run, %s)\n", runs,
+              same ? "same transaction count" : "DIFFERENT TRANSACTION COUNT");
+  std::printf("  %-16s %12s %12s %12s\n", "", "save", "load", "file (KiB)");
+  for (int i = 0; i < 3; ++i) {
+    std::printf("  %-16s %12.1f %12.1f %12lld\n", names[i],
+                i == 2 ? 0.0 : timings[i].save / runs, timings[i].load / runs,
+                (i == 2 ? timings[1].size : timings[i].size) / 1024);
+  }
+
+  IO::instance()->unload();
+  return same ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+# Benchmark of the lot availability streams of KangarooLib (util/checkpointedstream.h).
+# Header-only: does not link to KangarooLib nor Qt.
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += console release
+CONFIG -= qt app_bundle
+TEMPLATE = app
+TARGET = lotsbenchmark
+INCLUDEPATH += ../../
+SOURCES += lotsbenchmark.cpp
+
+OBJECTS_DIR = build/obj
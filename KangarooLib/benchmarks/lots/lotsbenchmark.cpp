@@ -0,0 +1,270 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+/*
+ * Times the lot availability queries of an investment account with a long
+ * history (InvestmentLotsManager keeps a CheckpointedStream per account): a
+ * synthetic history of daily reinvested dividends, with a sale every few lots
+ * and a few stock splits, queried by replaying the whole history and from the
+ * checkpoints.
+ *
+ * The queries are the ones of the lots manager: the lots available at the last
+ * date (entering a sale), at a random date excluding the transaction on that
+ * date (editing a sale), and at the last date after a new lot is added.
+ *
+ * Usage: lotsbenchmark [lot count] [query count]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "util/checkpointedstream.h"
+
+using namespace KLib;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msecsSince(const Clock::time_point& _start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - _start)
+      .count();
+}
+
+typedef std::unordered_map<int, long long> Lots;
+typedef std::pair<int, int> PriorityDate;  // Day, priority
+
+// Same kinds and priorities as the events of InvestmentLotsManager
+struct Event {
+  enum Kind { Split = -1, Lot = 0, Usage = 1 };
+
+  int idTransaction;
+  Kind kind;
+  int idLot;  // Lot
+  long long amount;  // Lot
+  std::vector<std::pair<int, long long>> lots;  // Usage
+  int numerator, denominator;  // Split
+
+  PriorityDate key(int _day) const { return PriorityDate(_day, int(kind)); }
+};
+
+void apply(Lots& _lots, const Event* const& _e) {
+  switch (_e->kind) {
+    case Event::Lot:
+      _lots[_e->idLot] += _e->amount;
+      break;
+    case Event::Usage:
+      for (const auto& l : _e->lots) {
+        _lots[l.first] -= l.second;
+      }
+      break;
+    case Event::Split:
+      for (auto& l : _lots) {
+        l.second = l.second * _e->numerator / _e->denominator;
+      }
+      break;
+  }
+}
+
+void compact(Lots& _lots) {
+  for (auto i = _lots.begin(); i != _lots.end();) {
+    i = i->second ? std::next(i) : _lots.erase(i);
+  }
+}
+
+typedef CheckpointedStream<PriorityDate, const Event*, Lots> Stream;
+
+struct History {
+  std::vector<Event> events;
+  std::vector<int> days;  // Day of each event
+  int lastDay;
+};
+
+// One reinvested dividend per day, a FIFO sale of 1 to 40 lots every 8 lots,
+// and a 2:1 split every 25000 lots.
+History makeHistory(int _lotCount) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> shares(1, 1000);
+  std::uniform_int_distribution<int> sold(1, 40);
+
+  History h;
+  h.events.reserve(_lotCount + _lotCount / 4);
+  std::vector<std::pair<int, long long>> open;  // FIFO of available lots
+  std::size_t first = 0;
+  int day = 0;
+
+  for (int i = 0; i < _lotCount; ++i, ++day) {
+    Event lot{int(h.events.size()), Event::Lot, i, shares(gen), {}, 1, 1};
+    h.events.push_back(lot);
+    h.days.push_back(day);
+    open.push_back(std::make_pair(i, lot.amount));
+
+    if (i % 8 == 7) {
+      Event usage{int(h.events.size()), Event::Usage, 0, 0, {}, 1, 1};
+
+      for (int n = sold(gen); n > 0 && first < open.size(); --n) {
+        usage.lots.push_back(open[first++]);
+      }
+
+      h.events.push_back(usage);
+      h.days.push_back(day);
+    }
+
+    if (i % 25000 == 24999) {
+      h.events.push_back(
+          Event{int(h.events.size()), Event::Split, 0, 0, {}, 2, 1});
+      h.days.push_back(day);
+
+      for (std::size_t o = first; o < open.size(); ++o) {
+        open[o].second *= 2;
+      }
+    }
+  }
+
+  h.lastDay = day;
+  return h;
+}
+
+Lots replay(const Stream& _stream, const PriorityDate& _through,
+            const Event* _excluded) {
+  Lots lots;
+
+  for (auto i = _stream.begin();
+       i != _stream.end() && !(_through < i->first); ++i) {
+    if (i->second != _excluded) {
+      apply(lots, i->second);
+    }
+  }
+
+  compact(lots);
+  return lots;
+}
+
+Lots fromCheckpoints(const Stream& _stream, const PriorityDate& _through,
+                     const Event* _excluded, const PriorityDate& _key) {
+  Lots lots = _stream.stateThrough(
+      _through, _excluded ? &_key : nullptr,
+      [_excluded](const Event* _e) { return _e == _excluded; });
+  compact(lots);
+  return lots;
+}
+
+PriorityDate endOf(int _day) {
+  return PriorityDate(_day, std::numeric_limits<int>::max());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int lotCount = argc > 1 ? std::atoi(argv[1]) : 100000;
+  int queryCount = argc > 2 ? std::atoi(argv[2]) : 200;
+
+  History h = makeHistory(lotCount);
+  Stream stream(&apply, &compact);
+
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < h.events.size(); ++i) {
+    stream.insert(h.events[i].key(h.days[i]), &h.events[i]);
+  }
+  double load = msecsSince(start);
+
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> pick(0, int(h.events.size()) - 1);
+  std::vector<int> edited(queryCount);
+  for (int& e : edited) {
+    e = pick(gen);
+  }
+
+  long long check = 0;
+  bool same = true;
+
+  // Entering a sale: availability at the last date
+  double lastReplay = 0, lastCheckpoints = 0;
+  for (int q = 0; q < queryCount; ++q) {
+    start = Clock::now();
+    Lots a = replay(stream, endOf(h.lastDay), nullptr);
+    lastReplay += msecsSince(start);
+
+    start = Clock::now();
+    Lots b = fromCheckpoints(stream, endOf(h.lastDay), nullptr, PriorityDate());
+    lastCheckpoints += msecsSince(start);
+
+    same = same && a == b;
+    check += a.size();
+  }
+
+  // Editing a transaction: availability on its date, without it
+  double editReplay = 0, editCheckpoints = 0;
+  for (int e : edited) {
+    const Event* ev = &h.events[e];
+    const PriorityDate key = ev->key(h.days[e]);
+
+    start = Clock::now();
+    Lots a = replay(stream, endOf(h.days[e]), ev);
+    editReplay += msecsSince(start);
+
+    start = Clock::now();
+    Lots b = fromCheckpoints(stream, endOf(h.days[e]), ev, key);
+    editCheckpoints += msecsSince(start);
+
+    same = same && a == b;
+    check += a.size();
+  }
+
+  // Adding a lot, then entering a sale
+  std::vector<Event> added(queryCount);
+  double appendReplay = 0, appendCheckpoints = 0;
+  for (int q = 0; q < queryCount; ++q) {
+    added[q] = Event{int(h.events.size()) + q, Event::Lot, lotCount + q, 10,
+                     {}, 1, 1};
+    stream.insert(added[q].key(h.lastDay + q), &added[q]);
+
+    start = Clock::now();
+    Lots a = replay(stream, endOf(h.lastDay + q), nullptr);
+    appendReplay += msecsSince(start);
+
+    start = Clock::now();
+    Lots b = fromCheckpoints(stream, endOf(h.lastDay + q), nullptr,
+                             PriorityDate());
+    appendCheckpoints += msecsSince(start);
+
+    same = same && a == b;
+    check += a.size();
+  }
+
+  std::printf("%d lots, %d events, %d checkpoints, loaded in %.2f ms\n",
+              lotCount, int(h.events.size()), stream.checkpointCount(), load);
+  std::printf("%d queries of each kind (ms per query, check %lld, %s)\n",
+              queryCount, check, same ? "same results" : "DIFFERENT RESULTS");
+  std::printf("  %-16s %12s %12s\n", "", "replay", "checkpoints");
+  std::printf("  %-16s %12.3f %12.3f\n", "last date", lastReplay / queryCount,
+              lastCheckpoints / queryCount);
+  std::printf("  %-16s %12.3f %12.3f\n", "edit", editReplay / queryCount,
+              editCheckpoints / queryCount);
+  std::printf("  %-16s %12.3f %12.3f\n", "append", appendReplay / queryCount,
+              appendCheckpoints / queryCount);
+
+  return same ? 0 : 1;
+}
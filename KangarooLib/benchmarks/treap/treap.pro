@@ -0,0 +1,12 @@
+# Benchmark of the treap maps of KangarooLib (util/), with and without TreapPool.
+# Header-only: does not link to KangarooLib nor Qt.
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG += console release
+CONFIG -= qt app_bundle
+TEMPLATE = app
+TARGET = treapbenchmark
+INCLUDEPATH += ../../
+SOURCES += treapbenchmark.cpp
+
+OBJECTS_DIR = build/obj
@@ -0,0 +1,186 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+/*
+ * Times the operations of the ledger treap (LedgerMap is a
+ * FragmentedTreapMap1): insert, iteration, sumTo and destruction, with heap
+ * allocated nodes and with nodes allocated in a TreapPool, then the load of a
+ * ledger from date-sorted transactions, by insert() and by insertSorted().
+ *
+ * Usage: treapbenchmark [count] [repetitions]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "util/fragmentedtreapmap.h"
+
+using namespace KLib;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msecsSince(const Clock::time_point& _start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - _start)
+      .count();
+}
+
+struct Timings {
+  Timings() : insert(0), iterate(0), sumTo(0), destroy(0) {}
+
+  double insert;
+  double iterate;
+  double sumTo;
+  double destroy;
+};
+
+// Keys are days, with several transactions per day, like in a ledger.
+std::vector<int> makeKeys(int _count) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> day(0, _count / 4 + 1);
+  std::vector<int> keys(_count);
+
+  for (int& k : keys) {
+    k = day(gen);
+  }
+
+  return keys;
+}
+
+template <class Map>
+Timings run(const std::vector<int>& _keys, bool _pooled, long long& _check) {
+  Timings t;
+  Map* map = new Map(_pooled);
+
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < _keys.size(); ++i) {
+    map->insert(_keys[i], int(i), 1);
+  }
+  t.insert = msecsSince(start);
+
+  start = Clock::now();
+  for (auto i = map->begin(); i != map->end(); ++i) {
+    _check += *i;
+  }
+  t.iterate = msecsSince(start);
+
+  start = Clock::now();
+  for (int k : _keys) {
+    _check += map->sumTo(k);
+  }
+  t.sumTo = msecsSince(start);
+
+  start = Clock::now();
+  delete map;
+  t.destroy = msecsSince(start);
+
+  return t;
+}
+
+template <class Map>
+void compare(const char* _name, const std::vector<int>& _keys,
+             int _repetitions) {
+  Timings heap, pool;
+  long long check = 0;
+
+  for (int r = 0; r < _repetitions; ++r) {
+    Timings h = run<Map>(_keys, false, check);
+    Timings p = run<Map>(_keys, true, check);
+
+    heap.insert += h.insert / _repetitions;
+    heap.iterate += h.iterate / _repetitions;
+    heap.sumTo += h.sumTo / _repetitions;
+    heap.destroy += h.destroy / _repetitions;
+
+    pool.insert += p.insert / _repetitions;
+    pool.iterate += p.iterate / _repetitions;
+    pool.sumTo += p.sumTo / _repetitions;
+    pool.destroy += p.destroy / _repetitions;
+  }
+
+  std::printf("%s, %d elements (ms, mean of %d, check %lld)\n", _name,
+              int(_keys.size()), _repetitions, check);
+  std::printf("  %-8s %10s %10s %10s %10s\n", "", "insert", "iterate", "sumTo",
+              "destroy");
+  std::printf("  %-8s %10.2f %10.2f %10.2f %10.2f\n", "heap", heap.insert,
+              heap.iterate, heap.sumTo, heap.destroy);
+  std::printf("  %-8s %10.2f %10.2f %10.2f %10.2f\n", "pool", pool.insert,
+              pool.iterate, pool.sumTo, pool.destroy);
+}
+
+template <class Map>
+void compareBuild(const char* _name, const std::vector<int>& _keys,
+                  int _repetitions) {
+  typedef typename Map::element_type Element;
+
+  std::vector<Element> elements;
+  for (std::size_t i = 0; i < _keys.size(); ++i) {
+    elements.push_back(Element{_keys[i], int(i), 1});
+  }
+
+  std::stable_sort(elements.begin(), elements.end(),
+                   [](const Element& _a, const Element& _b) {
+                     return _a.key < _b.key;
+                   });
+
+  double insert = 0, build = 0;
+  long long check = 0;
+
+  for (int r = 0; r < _repetitions; ++r) {
+    Map byInsert(true), byBuild(true);
+
+    Clock::time_point start = Clock::now();
+    for (const Element& e : elements) {
+      byInsert.insert(e.key, e.value, e.weight);
+    }
+    insert += msecsSince(start) / _repetitions;
+
+    start = Clock::now();
+    byBuild.insertSorted(elements.begin(), elements.end());
+    build += msecsSince(start) / _repetitions;
+
+    check += byInsert.sum() + byBuild.sum();
+  }
+
+  std::printf("%s, %d sorted elements (ms, mean of %d, check %lld)\n", _name,
+              int(_keys.size()), _repetitions, check);
+  std::printf("  %-14s %10.2f\n", "insert", insert);
+  std::printf("  %-14s %10.2f\n", "insertSorted", build);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int count = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+  std::vector<int> keys = makeKeys(count);
+
+  compare<FragmentedTreapMap1<int, int, int, long long>>("FragmentedTreapMap",
+                                                         keys, repetitions);
+  compareBuild<FragmentedTreapMap1<int, int, int, long long>>(
+      "FragmentedTreapMap", keys, repetitions);
+
+  return 0;
+}
@@ -30,7 +30,11 @@
 namespace KLib {
 const QString Archive::MAIN_FILE_NAME = "main.xml";
 
-Archive::Archive() : m_file(nullptr), m_mainFile(nullptr) {}
+Archive::Archive()
+    : m_file(nullptr),
+      m_mainFile(nullptr),
+      m_bytesWritten(0),
+      m_filesWritten(0) {}
 
 Archive::~Archive() { closeArchive(); }
 
@@ -48,9 +52,32 @@ void Archive::writeFile(const QString& _name,
   }
 
   _writer(&newFile);
+  m_bytesWritten += newFile.pos();
+  ++m_filesWritten;
   newFile.close();
 }
 
+QByteArray Archive::readFile(const QString& _name) {
+  checkIfArchiveOpened();
+  checkIfDirectorySet();
+
+  if (!m_file->setCurrentFile(m_currentDir + "/" + _name)) {
+    throw IOException(
+        QObject::tr("The file %1 does not exist in the archive.").arg(_name));
+  }
+
+  QuaZipFile file(m_file);
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    throw IOException(
+        QObject::tr("Unable to open file %1 in archive.").arg(_name));
+  }
+
+  QByteArray data = file.readAll();
+  file.close();
+  return data;
+}
+
 bool Archive::fileExists(const QString& _name) const {
   checkIfArchiveOpened();
 
@@ -109,6 +136,31 @@ void Archive::loadFiles(IFileManager* _manager) {
   }
 }
 
+QList<QPair<QString, QByteArray>> Archive::readFiles() {
+  checkIfArchiveOpened();
+  checkIfDirectorySet();
+
+  QList<QPair<QString, QByteArray>> files;
+
+  for (QString filename : m_file->getFileNameList()) {
+    if (filename.startsWith(m_currentDir + "/")) {
+      m_file->setCurrentFile(filename);
+      QuaZipFile file(m_file);
+
+      if (file.open(QIODevice::ReadOnly)) {
+        QByteArray data = file.readAll();
+        file.close();
+        files << qMakePair(filename.remove(0, m_currentDir.size() + 1), data);
+      } else {
+        qDebug()
+            << QObject::tr("Unable to open file %1 in archive.").arg(filename);
+      }
+    }
+  }
+
+  return files;
+}
+
 QIODevice* Archive::openMainFile(bool _writeMode) {
   checkIfArchiveOpened();
   m_currentDir.clear();
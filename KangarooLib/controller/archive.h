@@ -20,6 +20,9 @@
 #ifndef ARCHIVE_H
 #define ARCHIVE_H
 
+#include <QByteArray>
+#include <QList>
+#include <QPair>
 #include <QString>
 #include <functional>
 
@@ -40,6 +43,13 @@ namespace KLib
 
             void writeFile(const QString& _name, std::function<void(QIODevice*)> _writer);
 
+            /**
+             * @brief Reads the whole file _name in currentDirectory() in a single read.
+             *
+             * Throws an IOException if the file does not exist or cannot be read.
+             */
+            QByteArray readFile(const QString& _name);
+
             /**
              * @brief fileExists
              * @param _name The name of the file
@@ -69,6 +79,12 @@ namespace KLib
              */
             void loadFiles(IFileManager* _manager);
 
+            /**
+             * @brief Reads all the files of the current directory. A directory MUST be set.
+             * @return The name (relative to the directory) and content of each file.
+             */
+            QList<QPair<QString, QByteArray>> readFiles();
+
             /**
              * @brief mainFile
              * @return The main XML file of the archive
@@ -93,6 +109,9 @@ namespace KLib
 
             QuaZipFile* m_mainFile;
 
+            qint64 m_bytesWritten;  ///< Uncompressed size of the files written by writeFile()
+            int m_filesWritten;
+
             friend class IO;
     };
 
@@ -0,0 +1,215 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "columnarformat.h"
+
+#include <QObject>
+#include <cstring>
+
+#include "io.h"
+
+namespace KLib {
+
+const char ColumnReader::MAGIC[4] = {'K', 'C', 'O', 'L'};
+const quint32 ColumnReader::FORMAT_VERSION = 1;
+
+namespace {
+const quint32 BYTE_ORDER_MARK = 0x01020304;
+const int ALIGNMENT = 8;
+
+int alignedSize(int _size) {
+  return (_size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+template <class T>
+void appendValue(QByteArray& _array, T _value) {
+  _array.append(reinterpret_cast<const char*>(&_value), sizeof(T));
+}
+
+template <class T>
+T readValue(const QByteArray& _array, int& _pos) {
+  if (_pos + int(sizeof(T)) > _array.size()) {
+    throw IOException(QObject::tr("The columnar file is truncated."));
+  }
+
+  T value;
+  std::memcpy(&value, _array.constData() + _pos, sizeof(T));
+  _pos += sizeof(T);
+  return value;
+}
+}  // namespace
+
+void ColumnWriter::addRawColumn(const QByteArray& _name, quint32 _elementSize,
+                                quint32 _count, const char* _data) {
+  Column c;
+  c.name = _name;
+  c.elementSize = _elementSize;
+  c.count = _count;
+  c.data = QByteArray(_data, _elementSize * _count);
+  m_columns << c;
+}
+
+void ColumnWriter::addStringColumn(const QByteArray& _name,
+                                   const QVector<QString>& _values) {
+  QVector<ColumnStringRef> refs(_values.size());
+  QVector<QChar> heap;
+
+  int totalLength = 0;
+  for (const QString& s : _values) {
+    totalLength += s.size();
+  }
+  heap.reserve(totalLength);
+
+  for (int i = 0; i < _values.size(); ++i) {
+    refs[i].offset = heap.size();
+    refs[i].length = _values[i].size();
+
+    for (const QChar& c : _values[i]) {
+      heap.append(c);
+    }
+  }
+
+  addColumn(_name, refs);
+  addColumn(_name + ".heap", heap);
+}
+
+QByteArray ColumnWriter::data() const {
+  QByteArray header;
+  header.append(ColumnReader::MAGIC, sizeof(ColumnReader::MAGIC));
+  appendValue<quint32>(header, BYTE_ORDER_MARK);
+  appendValue<quint32>(header, ColumnReader::FORMAT_VERSION);
+  appendValue<quint32>(header, m_columns.size());
+
+  int headerSize = header.size();
+  for (const Column& c : m_columns) {
+    headerSize += sizeof(quint32) + c.name.size() + 2 * sizeof(quint32) +
+                  sizeof(quint64);
+  }
+
+  // Compute the offsets of each column
+  quint64 offset = alignedSize(headerSize);
+
+  for (const Column& c : m_columns) {
+    appendValue<quint32>(header, c.name.size());
+    header.append(c.name);
+    appendValue<quint32>(header, c.elementSize);
+    appendValue<quint32>(header, c.count);
+    appendValue<quint64>(header, offset);
+    offset += alignedSize(c.data.size());
+  }
+
+  QByteArray file;
+  file.reserve(offset);
+  file.append(header);
+
+  for (const Column& c : m_columns) {
+    file.append(QByteArray(alignedSize(file.size()) - file.size(), '\0'));
+    file.append(c.data);
+  }
+
+  return file;
+}
+
+ColumnReader::ColumnReader(const QByteArray& _data) : m_data(_data) {
+  if (m_data.size() < int(sizeof(MAGIC)) ||
+      std::memcmp(m_data.constData(), MAGIC, sizeof(MAGIC)) != 0) {
+    throw IOException(QObject::tr("The columnar file is invalid."));
+  }
+
+  int pos = sizeof(MAGIC);
+
+  if (readValue<quint32>(m_data, pos) != BYTE_ORDER_MARK) {
+    throw IOException(
+        QObject::tr("The columnar file was written on a platform with a "
+                    "different byte order."));
+  }
+
+  if (readValue<quint32>(m_data, pos) > FORMAT_VERSION) {
+    throw IOException(
+        QObject::tr("The version of the columnar file is unsupported."));
+  }
+
+  quint32 numColumns = readValue<quint32>(m_data, pos);
+
+  for (quint32 i = 0; i < numColumns; ++i) {
+    quint32 nameLength = readValue<quint32>(m_data, pos);
+
+    if (pos + int(nameLength) > m_data.size()) {
+      throw IOException(QObject::tr("The columnar file is truncated."));
+    }
+
+    QByteArray name = m_data.mid(pos, nameLength);
+    pos += nameLength;
+
+    Column c;
+    c.elementSize = readValue<quint32>(m_data, pos);
+    c.count = readValue<quint32>(m_data, pos);
+    c.offset = readValue<quint64>(m_data, pos);
+
+    if (c.offset + quint64(c.elementSize) * c.count > quint64(m_data.size())) {
+      throw IOException(
+          QObject::tr("The column %1 is truncated.").arg(QString(name)));
+    }
+
+    m_columns.insert(name, c);
+  }
+}
+
+const char* ColumnReader::rawColumn(const QByteArray& _name,
+                                    quint32 _elementSize,
+                                    int _expectedCount) const {
+  auto i = m_columns.find(_name);
+
+  if (i == m_columns.end()) {
+    throw IOException(
+        QObject::tr("The column %1 is missing.").arg(QString(_name)));
+  } else if (i->elementSize != _elementSize ||
+             int(i->count) != _expectedCount) {
+    throw IOException(QObject::tr("The column %1 has an invalid size.")
+                          .arg(QString(_name)));
+  }
+
+  // QByteArray data is 8-bytes aligned, and so are the column offsets.
+  return m_data.constData() + i->offset;
+}
+
+ColumnReader::StringColumn ColumnReader::strings(const QByteArray& _name,
+                                                 int _expectedCount) const {
+  StringColumn col;
+  QByteArray heapName = _name + ".heap";
+
+  col.m_refs = column<ColumnStringRef>(_name, _expectedCount);
+  col.m_heap = column<QChar>(heapName, count(heapName));
+  col.m_count = _expectedCount;
+
+  // Validate the references once, so that at() does not need to.
+  int heapSize = count(heapName);
+
+  for (int i = 0; i < _expectedCount; ++i) {
+    if (col.m_refs[i].offset < 0 || col.m_refs[i].length < 0 ||
+        col.m_refs[i].offset + col.m_refs[i].length > heapSize) {
+      throw IOException(QObject::tr("The column %1 has an invalid string.")
+                            .arg(QString(_name)));
+    }
+  }
+
+  return col;
+}
+
+}  // namespace KLib
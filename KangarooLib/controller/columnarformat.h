@@ -0,0 +1,191 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef COLUMNARFORMAT_H
+#define COLUMNARFORMAT_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <type_traits>
+
+#include "../amount.h"
+
+namespace KLib {
+
+/**
+ * @brief Fixed-width representation of an Amount inside a binary column.
+ */
+struct ColumnAmount {
+  qint64 base;
+  qint32 precision;
+  qint32 reserved;
+
+  static ColumnAmount fromAmount(const Amount& _a) {
+    return ColumnAmount{_a.baseAmount(), _a.precision(), 0};
+  }
+
+  Amount toAmount() const { return Amount::fromBaseAmount(base, precision); }
+};
+
+/**
+ * @brief Reference to a string in the UTF-16 heap of a string column.
+ */
+struct ColumnStringRef {
+  qint32 offset;
+  qint32 length;
+};
+
+/**
+ * @brief Builds a binary columnar file.
+ *
+ * The file is made of a small header describing each named column (element
+ * size, element count and offset), followed by the raw column data. Each
+ * column is 8-bytes aligned, so that a reader can use the values in place
+ * without copying them.
+ *
+ * String columns are stored as a column of ColumnStringRef and a UTF-16 heap
+ * column named <name>.heap.
+ */
+class ColumnWriter {
+ public:
+  template <class T>
+  void addColumn(const QByteArray& _name, const QVector<T>& _values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Columns can only contain trivially copyable values");
+    addRawColumn(_name, sizeof(T), _values.size(),
+                 reinterpret_cast<const char*>(_values.constData()));
+  }
+
+  void addStringColumn(const QByteArray& _name,
+                       const QVector<QString>& _values);
+
+  /**
+   * @brief Serializes all the columns added so far.
+   */
+  QByteArray data() const;
+
+ private:
+  struct Column {
+    QByteArray name;
+    quint32 elementSize;
+    quint32 count;
+    QByteArray data;
+  };
+
+  void addRawColumn(const QByteArray& _name, quint32 _elementSize,
+                    quint32 _count, const char* _data);
+
+  QList<Column> m_columns;
+};
+
+/**
+ * @brief Reads a binary columnar file built by ColumnWriter.
+ *
+ * The whole file is kept in memory (implicitly shared with the array passed to
+ * the constructor) and column values are returned as pointers in this buffer:
+ * reading a column does not allocate.
+ */
+class ColumnReader {
+ public:
+  /**
+   * @brief View on a string column
+   */
+  class StringColumn {
+   public:
+    StringColumn() : m_refs(nullptr), m_heap(nullptr), m_count(0) {}
+
+    int count() const { return m_count; }
+
+    /**
+     * @brief Returns the string at _row. Empty strings do not allocate.
+     */
+    QString at(int _row) const {
+      const ColumnStringRef& r = m_refs[_row];
+      return r.length ? QString(m_heap + r.offset, r.length) : QString();
+    }
+
+   private:
+    const ColumnStringRef* m_refs;
+    const QChar* m_heap;
+    int m_count;
+
+    friend class ColumnReader;
+  };
+
+  /**
+   * @brief Parses the header of _data. Throws an IOException if the data is
+   * not a valid columnar file.
+   */
+  explicit ColumnReader(const QByteArray& _data);
+
+  bool contains(const QByteArray& _name) const {
+    return m_columns.contains(_name);
+  }
+
+  /**
+   * @brief Number of elements in the column _name, 0 if it does not exist.
+   */
+  int count(const QByteArray& _name) const {
+    return m_columns.value(_name).count;
+  }
+
+  /**
+   * @brief Returns the values of column _name.
+   *
+   * Throws an IOException if the column does not exist, if its element size is
+   * not sizeof(T) or if it does not contain exactly _expectedCount elements.
+   */
+  template <class T>
+  const T* column(const QByteArray& _name, int _expectedCount) const {
+    return reinterpret_cast<const T*>(
+        rawColumn(_name, sizeof(T), _expectedCount));
+  }
+
+  StringColumn strings(const QByteArray& _name, int _expectedCount) const;
+
+  /**
+   * @brief The whole columnar file.
+   */
+  const QByteArray& data() const { return m_data; }
+
+  static const char MAGIC[4];
+  static const quint32 FORMAT_VERSION;
+
+ private:
+  struct Column {
+    Column() : elementSize(0), count(0), offset(0) {}
+
+    quint32 elementSize;
+    quint32 count;
+    quint64 offset;
+  };
+
+  const char* rawColumn(const QByteArray& _name, quint32 _elementSize,
+                        int _expectedCount) const;
+
+  QByteArray m_data;
+  QHash<QByteArray, Column> m_columns;
+};
+
+}  // namespace KLib
+
+#endif  // COLUMNARFORMAT_H
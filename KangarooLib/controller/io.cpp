@@ -19,11 +19,20 @@
 
 #include "io.h"
 
+#include <QDataStream>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QRegExp>
+#include <QThread>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
+#include <QtConcurrent>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include "../interfaces/ifilemanager.h"
 #include "../model/account.h"
@@ -38,12 +47,18 @@
 #include "../model/security.h"
 #include "../model/transactionmanager.h"
 #include "archive.h"
+#include "columnarformat.h"
+#include "ioprofile.h"
 
 namespace KLib {
 
 IO* IO::m_instance = nullptr;
 
-const int IO::LATEST_FILE_VERSION = 1;
+const int IO::XML_FILE_VERSION = 1;
+const int IO::COLUMNAR_FILE_VERSION = 2;
+const int IO::LATEST_FILE_VERSION = 2;
+
+const QString IO::COLUMNS_DIRECTORY = "columns";
 
 const char* StdTags::ROOT = "kangaroo_file";
 const char* StdTags::ACCOUNT = "account";
@@ -78,8 +93,15 @@ const char* StdTags::DOCUMENT_MGR = "documents";
 const char* StdTags::SCHEDULE = "schedule";
 const char* StdTags::SCHEDULE_REC = "recurrence";
 const char* StdTags::SCHEDULE_MGR = "schedules";
-
-IO::IO() : m_fileVersion(LATEST_FILE_VERSION) {
+const char* StdTags::REMOVED = "removed";
+
+IO::IO()
+    : m_fileVersion(XML_FILE_VERSION),
+      m_saveFileVersion(XML_FILE_VERSION),
+      m_journal(nullptr),
+      m_journalEnabled(true),
+      m_journalNeedsCompaction(false),
+      m_rateJournaled(false) {
   // Register default storeables
 
   registerStored(StdTags::ACCOUNT, Account::getTopLevel());
@@ -98,6 +120,23 @@ IO::IO() : m_fileVersion(LATEST_FILE_VERSION) {
   registerFileManager(StdTags::DOCUMENT_MGR, StdTags::DOCUMENT_MGR,
                       DocumentManager::instance());
 
+  // Changes to transactions and prices are journaled one by one. The other
+  // stored objects are journaled once per turn of the event loop: object by
+  // object if they support it (see IStored::journalsObjects()), otherwise as
+  // a whole (see gotModifiedSignal()).
+  connect(TransactionManager::instance(), &TransactionManager::transactionAdded,
+          this, &IO::onTransactionStored);
+  connect(TransactionManager::instance(),
+          &TransactionManager::transactionModified, this,
+          &IO::onTransactionStored);
+  connect(TransactionManager::instance(),
+          &TransactionManager::transactionRemoved, this,
+          &IO::onTransactionRemoved);
+  connect(PriceManager::instance(), &PriceManager::rateSet, this,
+          &IO::onRateSet);
+  connect(PriceManager::instance(), &PriceManager::rateRemoved, this,
+          &IO::onRateRemoved);
+
   m_isDirty = false;
 }
 
@@ -108,6 +147,8 @@ IO* IO::instance() {
 }
 
 void IO::loadNew() {
+  closeJournal();
+
   for (IStored* s : m_registered) {
     s->loadNew();
   }
@@ -117,10 +158,72 @@ void IO::loadNew() {
 
   m_path = "";
   m_name = "";
-  m_fileVersion = LATEST_FILE_VERSION;
+  m_fileVersion = XML_FILE_VERSION;
+  m_saveFileVersion = XML_FILE_VERSION;
   m_isDirty = false;
 }
 
+namespace {
+/**
+ * @brief A phase of the loading of a section, running on a worker thread.
+ */
+struct ConcurrentLoad {
+  IOProfile::Entry entry;
+  Qt::HANDLE thread;
+  QFuture<void> future;
+  std::exception_ptr error;
+};
+
+/**
+ * @brief Runs _load on a worker thread. Objects created by _stored are then
+ * moved to _mainThread.
+ */
+std::unique_ptr<ConcurrentLoad> startConcurrentLoad(
+    const QString& _key, const QString& _phase, qint64 _size,
+    IStored* _stored, QThread* _mainThread, const IOProfile& _profile,
+    std::function<void()> _load) {
+  std::unique_ptr<ConcurrentLoad> job(new ConcurrentLoad());
+  job->entry = IOProfile::Entry{_key, _phase, 0, 0, -1, _size, 0};
+
+  ConcurrentLoad* j = job.get();
+  job->future =
+      QtConcurrent::run([j, _stored, _mainThread, &_profile, _load]() {
+        j->thread = QThread::currentThreadId();
+        j->entry.start = _profile.elapsed();
+
+        try {
+          _load();
+        } catch (...) {
+          j->error = std::current_exception();
+        }
+
+        j->entry.count = IOProfile::countOf(_stored);
+        _stored->moveLoadedObjects(_mainThread);
+        j->entry.nsecs = _profile.elapsed() - j->entry.start;
+      });
+
+  return job;
+}
+
+/**
+ * @brief Returns the position of the start tag of _key, which ends before
+ * _offset.
+ */
+int startTagPosition(const QString& _text, const QString& _key, int _offset) {
+  const QString tag = "<" + _key;
+  int pos = _text.lastIndexOf(tag, _offset);
+
+  // Skip the tags that only begin with _key
+  while (pos > 0 && pos + tag.size() < _text.size() &&
+         !_text[pos + tag.size()].isSpace() &&
+         _text[pos + tag.size()] != '>' && _text[pos + tag.size()] != '/') {
+    pos = _text.lastIndexOf(tag, pos - 1);
+  }
+
+  return pos;
+}
+}  // namespace
+
 void IO::load(const QString& _path) {
   //        QFile* file = new QFile(_path);
 
@@ -130,80 +233,294 @@ void IO::load(const QString& _path) {
   //           throw IOException(tr("Unable to open file."));
   //        }
 
+  closeJournal();
+  m_loadProfile.start("load", _path);
+
   Archive archive;
   archive.openArchive(_path);
 
-  //--------------------------LOAD MAIN XML FILE--------------------------
-  QXmlStreamReader xml(archive.openMainFile());
-
-  /* We'll parse the XML until we reach end of it.*/
-  while (!xml.atEnd() && !xml.hasError()) {
-    /* Read next element.*/
-    QXmlStreamReader::TokenType token = xml.readNext();
-    /* If token is just StartDocument, we'll go to next.*/
-    if (token == QXmlStreamReader::StartDocument) {
-      continue;
-    } else if (xml.name() == StdTags::ROOT) {
-      if (token == QXmlStreamReader::StartElement) {
-        QXmlStreamAttributes att = xml.attributes();
-        m_name = getOptAttribute("name", att);
-        m_fileVersion = getAttribute("version", att).toInt();
+  // The archive can only be read by this thread: read it all, then load the
+  // sections that support it on worker threads (see
+  // IStored::loadsConcurrently()). The other sections are loaded here, in the
+  // meantime.
+  QThread* mainThread = thread();
+  std::vector<std::unique_ptr<ConcurrentLoad>> jobs;
+  QHash<QString, QByteArray> columns;
+  qint64 start;
+
+  //--------------------------DECODE FILE MANAGERS-------------------------
+  QHash<QString, QFuture<QVariant>> decodedFiles;
+  QHash<QString, QStringList> fileNames;
+  QHash<QString, qint64> fileSizes;
+  QHash<QString, qint64> decodeStarts;
 
-        if (m_fileVersion > LATEST_FILE_VERSION) {
-          throw IOException(
-              tr("The version of this file unsupported by this version. "
-                 "Please update your software."));
-        }
-      }
+  for (auto i = m_fileManagers.begin(); i != m_fileManagers.end(); ++i) {
+    archive.setCurrentDirectory(i.key());
 
-      continue;
+    const IFileManager* manager = i.value();
+    QList<QPair<QString, QByteArray>> files = archive.readFiles();
+
+    for (const auto& f : files) {
+      fileNames[i.key()] << f.first;
+      fileSizes[i.key()] += f.second.size();
     }
 
-    /* If token is StartElement, we'll see if we can read it.*/
-    if (token == QXmlStreamReader::StartElement) {
-      for (QString key : m_registered.keys()) {
-        if (xml.name() == key) {
-          m_registered[key]->load(xml);
+    std::function<QVariant(const QPair<QString, QByteArray>&)> decode =
+        [manager](const QPair<QString, QByteArray>& _file) {
+          return manager->decodeFile(_file.first, _file.second);
+        };
+
+    decodeStarts[i.key()] = m_loadProfile.elapsed();
+    decodedFiles[i.key()] = QtConcurrent::mapped(files, decode);
+  }
+
+  try {
+    //--------------------------LOAD MAIN XML FILE--------------------------
+    const QString text = QString::fromUtf8(archive.openMainFile()->readAll());
+    archive.closeMainFile();
+
+    QXmlStreamReader xml(text);
+
+    /* We'll parse the XML until we reach end of it.*/
+    while (!xml.atEnd() && !xml.hasError()) {
+      /* Read next element.*/
+      QXmlStreamReader::TokenType token = xml.readNext();
+      /* If token is just StartDocument, we'll go to next.*/
+      if (token == QXmlStreamReader::StartDocument) {
+        continue;
+      } else if (xml.name() == StdTags::ROOT) {
+        if (token == QXmlStreamReader::StartElement) {
+          QXmlStreamAttributes att = xml.attributes();
+          m_name = getOptAttribute("name", att);
+          m_fileVersion = getAttribute("version", att).toInt();
+
+          if (m_fileVersion > LATEST_FILE_VERSION) {
+            throw IOException(
+                tr("The version of this file unsupported by this version. "
+                   "Please update your software."));
+          }
+
+          //-----------------------------LOAD COLUMNS-----------------------------
+          if (m_fileVersion >= COLUMNAR_FILE_VERSION) {
+            archive.setCurrentDirectory(COLUMNS_DIRECTORY);
+
+            for (QString key : m_registered.keys()) {
+              IStored* s = m_registered[key];
+
+              if (!s->hasColumns()) {
+                continue;
+              } else if (!s->loadsConcurrently()) {
+                columns[key] = archive.readFile(key);
+                continue;
+              }
+
+              QByteArray data = archive.readFile(key);
+              s->unload();
+              jobs.push_back(startConcurrentLoad(
+                  key, "columns", data.size(), s, mainThread, m_loadProfile,
+                  [s, data]() {
+                    ColumnReader reader(data);
+                    s->loadColumns(reader);
+                  }));
+            }
+          }
         }
+
+        continue;
       }
+
+      /* If token is StartElement, we'll see if we can read it.*/
+      if (token == QXmlStreamReader::StartElement) {
+        for (QString key : m_registered.keys()) {
+          if (xml.name() != key) {
+            continue;
+          }
+
+          IStored* s = m_registered[key];
+          int begin = startTagPosition(text, key, xml.characterOffset());
+
+          if (s->loadsConcurrently()) {
+            // Give the section its own reader
+            xml.skipCurrentElement();
+            QString section = text.mid(begin, xml.characterOffset() - begin);
+
+            s->unload();
+            jobs.push_back(startConcurrentLoad(
+                key, "xml", section.size(), s, mainThread, m_loadProfile,
+                [s, section]() {
+                  QXmlStreamReader reader(section);
+
+                  while (!reader.atEnd() &&
+                         reader.readNext() != QXmlStreamReader::StartElement) {
+                  }
+
+                  s->load(reader);
+
+                  if (reader.hasError()) {
+                    throw IOException(
+                        QString("Parsing error: %1").arg(reader.errorString()));
+                  }
+                }));
+          } else {
+            start = m_loadProfile.elapsed();
+            s->load(xml);
+            m_loadProfile.add(key, "xml", start, IOProfile::countOf(s),
+                              xml.characterOffset() - begin);
+          }
+        }
+      }
+    }
+    /* Error handling. */
+    QString error;
+    if (xml.hasError()) {
+      error == xml.errorString();
+    }
+
+    xml.clear();
+
+    if (!error.isEmpty()) {
+      throw IOException(QString("Parsing error: %1").arg(xml.errorString()));
+    }
+
+    // Close the archive
+    archive.closeArchive();
+
+    for (auto i = columns.begin(); i != columns.end(); ++i) {
+      start = m_loadProfile.elapsed();
+      ColumnReader reader(i.value());
+      m_registered[i.key()]->loadColumns(reader);
+      m_loadProfile.add(i.key(), "columns", start,
+                        IOProfile::countOf(m_registered[i.key()]),
+                        i.value().size());
     }
+    columns.clear();
+  } catch (...) {
+    for (auto& job : jobs) {
+      job->future.waitForFinished();
+    }
+    for (QFuture<QVariant>& f : decodedFiles) {
+      f.waitForFinished();
+    }
+    throw;
   }
-  /* Error handling. */
-  QString error;
-  if (xml.hasError()) {
-    error == xml.errorString();
+
+  //-----------------------------MERGE SECTIONS---------------------------
+  // Errors are reported in the order of the keys, so that loading a book
+  // always fails the same way.
+  for (auto& job : jobs) {
+    job->future.waitForFinished();
   }
 
-  xml.clear();
-  archive.closeMainFile();
+  std::sort(jobs.begin(), jobs.end(),
+            [](const std::unique_ptr<ConcurrentLoad>& _a,
+               const std::unique_ptr<ConcurrentLoad>& _b) {
+              return _a->entry.key < _b->entry.key;
+            });
+
+  QList<Qt::HANDLE> workers;
+
+  for (auto& job : jobs) {
+    if (!workers.contains(job->thread)) {
+      workers << job->thread;
+    }
 
-  if (!error.isEmpty()) {
-    throw IOException(QString("Parsing error: %1").arg(xml.errorString()));
+    job->entry.thread = workers.indexOf(job->thread) + 1;
+    m_loadProfile.add(job->entry);
   }
 
-  //--------------------------LOAD FILE MANAGERS--------------------------
+  for (auto& job : jobs) {
+    if (job->error) {
+      for (QFuture<QVariant>& f : decodedFiles) {
+        f.waitForFinished();
+      }
+      std::rethrow_exception(job->error);
+    }
+  }
 
+  //--------------------------LOAD FILE MANAGERS--------------------------
   for (auto i = m_fileManagers.begin(); i != m_fileManagers.end(); ++i) {
-    archive.setCurrentDirectory(i.key());
-    archive.loadFiles(i.value());
+    QFuture<QVariant>& decoded = decodedFiles[i.key()];
+    decoded.waitForFinished();
+
+    const QStringList& names = fileNames[i.key()];
+
+    for (int j = 0; j < names.size(); ++j) {
+      i.value()->loadDecodedFile(names[j], decoded.resultAt(j));
+    }
+
+    // Decoding ran on the workers, from decodeStarts until now.
+    m_loadProfile.add(i.key(), "files", decodeStarts[i.key()], names.size(),
+                      fileSizes[i.key()]);
   }
 
-  //------------------------------AFTER LOAD------------------------------
+  //----------------------------REPLAY JOURNAL----------------------------
 
-  // Close the archive
-  archive.closeArchive();
+  // Committed records are part of the book: replay them even if journaling is
+  // disabled. Uncommitted ones are changes that were not saved.
+  start = m_loadProfile.elapsed();
+  std::unique_ptr<Journal> journal(new Journal(_path));
+  replayJournal(*journal);
+  m_loadProfile.add("journal", "journal", start, journal->records().size(),
+                    journal->size());
 
-  // Call AfterLoad
-  for (IStored* s : m_registered) {
-    s->afterLoad();
+  //------------------------------AFTER LOAD------------------------------
+  for (auto i = m_registered.begin(); i != m_registered.end(); ++i) {
+    start = m_loadProfile.elapsed();
+    i.value()->afterLoad();
+    m_loadProfile.add(i.key(), "afterLoad", start,
+                      IOProfile::countOf(i.value()));
   }
 
+  m_loadProfile.finish();
+
+  // Saved in its own format, so that the versions that read it still do.
+  m_saveFileVersion = std::max(m_fileVersion, XML_FILE_VERSION);
   m_path = _path;
-  m_isDirty = false;
+  m_isDirty = journal->hasUncommittedRecords();
+  m_journalNeedsCompaction = false;
+
+  if (m_journalEnabled) {
+    m_journal = journal.release();
+  }
 }
 
 void IO::save(const QString& _as) {
+  //----------------------------COMMIT JOURNAL----------------------------
+
+  // If all the changes since the last save are in the journal, they are
+  // already on disk: mark them as saved.
+  flushSections();
+
+  if (m_journal && _as == m_path && m_saveFileVersion == m_fileVersion &&
+      !m_journalNeedsCompaction && !m_journal->needsCompaction()) {
+    try {
+      m_saveProfile.start("commit", _as);
+
+      if (m_journal->hasUncommittedRecords()) {
+        m_journal->commit();
+      }
+
+      m_saveProfile.add("journal", "commit", 0, -1, m_journal->size());
+      m_saveProfile.finish();
+
+      m_isDirty = false;
+      emit isCleanNow();
+      return;
+    } catch (IOException&) {
+      // Save the whole book instead.
+    }
+  }
+
+  if (m_journal && _as != m_path) {
+    // The changes are saved in the other book, not in this one.
+    discardChanges();
+  }
+
+  closeJournal();
+
   m_path = _as;
+  m_saveProfile.start("save", m_path);
+  qint64 start;
 
   //        QFile* file = new QFile(_as);
 
@@ -218,20 +535,32 @@ void IO::save(const QString& _as) {
 
   //--------------------------SAVE MAIN XML FILE--------------------------
 
-  QXmlStreamWriter xml(archive.openMainFile(true));
+  QIODevice* mainFile = archive.openMainFile(true);
+  QXmlStreamWriter xml(mainFile);
   xml.setAutoFormatting(true);
   xml.writeStartDocument();
 
+  const bool columnar = m_saveFileVersion >= COLUMNAR_FILE_VERSION;
+
   // Root tag
   xml.writeStartElement(StdTags::ROOT);
   xml.writeAttribute("name", m_name);
-  xml.writeAttribute("version", QString::number(LATEST_FILE_VERSION));
+  xml.writeAttribute("version", QString::number(m_saveFileVersion));
 
   // Write each registered Stored
   for (QString key : m_registered.keys()) {
+    if (columnar && m_registered[key]->hasColumns()) continue;
+
+    start = m_saveProfile.elapsed();
+    qint64 pos = mainFile->pos();
+
     xml.writeStartElement(key);
     m_registered[key]->save(xml);
     xml.writeEndElement();
+
+    m_saveProfile.add(key, "save", start,
+                      IOProfile::countOf(m_registered[key]),
+                      mainFile->pos() - pos);
   }
 
   xml.writeEndElement();
@@ -241,21 +570,95 @@ void IO::save(const QString& _as) {
   //        file->close();
   //        delete file;
 
+  //-----------------------------SAVE COLUMNS-----------------------------
+  if (columnar) {
+    archive.setCurrentDirectory(COLUMNS_DIRECTORY);
+
+    for (QString key : m_registered.keys()) {
+      if (m_registered[key]->hasColumns()) {
+        start = m_saveProfile.elapsed();
+        qint64 size = archive.m_bytesWritten;
+
+        ColumnWriter writer;
+        m_registered[key]->saveColumns(writer);
+        archive.writeFile(key, [&writer](QIODevice* _device) {
+          _device->write(writer.data());
+        });
+
+        m_saveProfile.add(key, "saveColumns", start,
+                          IOProfile::countOf(m_registered[key]),
+                          archive.m_bytesWritten - size);
+      }
+    }
+  }
+
   //--------------------------SAVE FILE MANAGERS--------------------------
   for (auto i = m_fileManagers.begin(); i != m_fileManagers.end(); ++i) {
     archive.setCurrentDirectory(i.key());
+
+    start = m_saveProfile.elapsed();
+    qint64 size = archive.m_bytesWritten;
+    int count = archive.m_filesWritten;
+
     i.value()->saveFiles(archive);
+
+    m_saveProfile.add(i.key(), "saveFiles", start,
+                      archive.m_filesWritten - count,
+                      archive.m_bytesWritten - size);
   }
 
   //------------------------------AFTER SAVE------------------------------
   archive.closeArchive();
+  m_saveProfile.finish();
+
+  // The journal is now part of the book.
+  m_journal = new Journal(m_path);
+  m_journal->clear();
+  m_journalNeedsCompaction = false;
+
+  if (!m_journalEnabled) {
+    closeJournal();
+  }
 
   m_isDirty = false;
-  m_fileVersion = LATEST_FILE_VERSION;
+  m_fileVersion = m_saveFileVersion;
 
   emit isCleanNow();
 }
 
+void IO::convert(const QString& _path, const QString& _destPath,
+                 int _fileVersion) {
+  // The book is converted through the model, which holds the open book.
+  if (!isNew() || isDirty()) {
+    throw IOException(tr("Close the current book before converting a file."));
+  } else if (_fileVersion < XML_FILE_VERSION ||
+             _fileVersion > LATEST_FILE_VERSION) {
+    throw IOException(tr("Invalid file version: %1.").arg(_fileVersion));
+  }
+
+  try {
+    load(_path);
+
+    // Leave the journal of _path untouched.
+    closeJournal();
+    m_saveFileVersion = _fileVersion;
+    save(_destPath);
+  } catch (...) {
+    loadNew();
+    throw;
+  }
+
+  loadNew();
+}
+
+void IO::setSaveFileVersion(int _version) {
+  if (_version < XML_FILE_VERSION || _version > LATEST_FILE_VERSION) {
+    throw IOException(tr("Invalid file version: %1.").arg(_version));
+  }
+
+  m_saveFileVersion = _version;
+}
+
 QString IO::xmlFileContents() const {
   QString ret;
   QXmlStreamWriter xml(&ret);
@@ -265,7 +668,7 @@ QString IO::xmlFileContents() const {
   // Root tag
   xml.writeStartElement(StdTags::ROOT);
   xml.writeAttribute("name", m_name);
-  xml.writeAttribute("version", QString::number(LATEST_FILE_VERSION));
+  xml.writeAttribute("version", QString::number(XML_FILE_VERSION));
 
   // Write each registered Stored
   for (QString key : m_registered.keys()) {
@@ -280,6 +683,8 @@ QString IO::xmlFileContents() const {
 }
 
 void IO::unload() {
+  closeJournal();
+
   for (IStored* s : m_registered) {
     s->unload();
   }
@@ -327,6 +732,7 @@ void IO::registerStored(const QString& _xmlKey, IStored* _st) {
   m_registered.insert(_xmlKey, _st);
 
   connect(_st, &IStored::modified, this, &IO::gotModifiedSignal);
+  connect(_st, &IStored::objectModified, this, &IO::onObjectModified);
 }
 
 void IO::registerFileManager(const QString& _xmlKey,
@@ -353,7 +759,296 @@ void IO::registerFileManager(const QString& _xmlKey,
   connect(_manager, &IFileManager::modified, this, &IO::gotModifiedSignal);
 }
 
+void IO::setJournalEnabled(bool _enabled) {
+  m_journalEnabled = _enabled;
+
+  if (!_enabled) {
+    // The next save will save the whole book.
+    closeJournal();
+  }
+}
+
+void IO::discardChanges() {
+  m_pendingSections.clear();
+  m_pendingObjects.clear();
+
+  if (m_journal) {
+    try {
+      m_journal->discardUncommitted();
+    } catch (IOException&) {
+      closeJournal();
+    }
+  }
+}
+
+void IO::closeJournal() {
+  m_pendingSections.clear();
+  m_pendingObjects.clear();
+  delete m_journal;
+  m_journal = nullptr;
+  m_rateJournaled = false;
+}
+
+bool IO::appendToJournal(Journal::RecordType _type,
+                         const QByteArray& _payload) {
+  // Keep the records in the order of the changes
+  if (_type != Journal::RecordType::Section &&
+      _type != Journal::RecordType::Objects) {
+    flushSections();
+
+    if (!m_journal) {
+      return false;
+    }
+  }
+
+  try {
+    m_journal->append(_type, _payload);
+    return true;
+  } catch (IOException&) {
+    // Stop journaling, the next save will save the whole book.
+    closeJournal();
+    return false;
+  }
+}
+
+void IO::flushSections() {
+  const QSet<QString> keys = m_pendingSections;
+  const QHash<QString, QSet<int>> objects = m_pendingObjects;
+  m_pendingSections.clear();
+  m_pendingObjects.clear();
+
+  for (const QString& key : keys) {
+    if (!m_journal) {
+      return;
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << key << sectionXml(key);
+
+    appendToJournal(Journal::RecordType::Section, data);
+  }
+
+  // Only the objects that changed, in their current state
+  for (auto i = objects.begin(); i != objects.end(); ++i) {
+    if (!m_journal) {
+      return;
+    }
+
+    QByteArray xmlData;
+    QXmlStreamWriter xml(&xmlData);
+    xml.writeStartElement(i.key());
+    m_registered[i.key()]->saveObjects(i.value().values(), xml);
+    xml.writeEndElement();
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << i.key() << xmlData;
+
+    appendToJournal(Journal::RecordType::Objects, data);
+  }
+}
+
+QByteArray IO::sectionXml(const QString& _key) const {
+  QByteArray data;
+  QXmlStreamWriter xml(&data);
+  xml.writeStartElement(_key);
+  m_registered[_key]->save(xml);
+  xml.writeEndElement();
+  return data;
+}
+
+void IO::replayJournal(const Journal& _journal) {
+  for (const Journal::Record& r : _journal.records()) {
+    QDataStream stream(r.payload);
+
+    switch (r.type) {
+      case Journal::RecordType::TransactionSet: {
+        QXmlStreamReader xml(r.payload);
+        TransactionManager::instance()->restore(xml);
+
+        if (xml.hasError()) {
+          throw IOException(
+              tr("Invalid transaction in the journal: %1").arg(xml.errorString()));
+        }
+        break;
+      }
+      case Journal::RecordType::TransactionRemoved: {
+        qint32 id;
+        stream >> id;
+        TransactionManager::instance()->restoreRemoved(id);
+        break;
+      }
+      case Journal::RecordType::RateSet: {
+        QString from, to;
+        qint32 date;
+        double rate;
+        stream >> from >> to >> date >> rate;
+        PriceManager::instance()->getOrAdd(from, to)->set(
+            QDate::fromJulianDay(date), rate);
+        break;
+      }
+      case Journal::RecordType::RateRemoved: {
+        QString from, to;
+        qint32 date;
+        stream >> from >> to >> date;
+        PriceManager::instance()->getOrAdd(from, to)->remove(
+            QDate::fromJulianDay(date));
+        break;
+      }
+      case Journal::RecordType::Section: {
+        QString key;
+        QByteArray data;
+        stream >> key >> data;
+
+        if (!m_registered.contains(key)) {
+          throw IOException(tr("Invalid section in the journal: %1").arg(key));
+        }
+
+        QXmlStreamReader xml(data);
+        while (!xml.atEnd() && !xml.isStartElement()) {
+          xml.readNext();
+        }
+
+        m_registered[key]->load(xml);
+
+        if (xml.hasError()) {
+          throw IOException(tr("Invalid section in the journal: %1")
+                                .arg(xml.errorString()));
+        }
+        break;
+      }
+      case Journal::RecordType::Objects: {
+        QString key;
+        QByteArray data;
+        stream >> key >> data;
+
+        if (!m_registered.contains(key) ||
+            !m_registered[key]->journalsObjects()) {
+          throw IOException(tr("Invalid section in the journal: %1").arg(key));
+        }
+
+        QXmlStreamReader xml(data);
+        while (!xml.atEnd() && !xml.isStartElement()) {
+          xml.readNext();
+        }
+
+        m_registered[key]->restoreObjects(xml);
+
+        if (xml.hasError()) {
+          throw IOException(tr("Invalid section in the journal: %1")
+                                .arg(xml.errorString()));
+        }
+        break;
+      }
+      case Journal::RecordType::Commit:
+        break;
+    }
+  }
+}
+
+void IO::onTransactionStored(Transaction* _tr) {
+  if (!m_journal) {
+    return;
+  }
+
+  QByteArray data;
+  QXmlStreamWriter xml(&data);
+  static_cast<const IStored*>(_tr)->save(xml);  // IO is a friend of IStored
+
+  appendToJournal(Journal::RecordType::TransactionSet, data);
+}
+
+void IO::onTransactionRemoved(int _id) {
+  if (!m_journal) {
+    return;
+  }
+
+  QByteArray data;
+  QDataStream stream(&data, QIODevice::WriteOnly);
+  stream << qint32(_id);
+
+  appendToJournal(Journal::RecordType::TransactionRemoved, data);
+}
+
+void IO::onRateSet(ExchangePair* _pair, const QDate& _date) {
+  if (!m_journal) {
+    return;
+  }
+
+  QByteArray data;
+  QDataStream stream(&data, QIODevice::WriteOnly);
+  stream << _pair->from() << _pair->to() << qint32(_date.toJulianDay())
+         << _pair->on(_date);
+
+  m_rateJournaled = appendToJournal(Journal::RecordType::RateSet, data);
+}
+
+void IO::onRateRemoved(ExchangePair* _pair, const QDate& _date) {
+  if (!m_journal) {
+    return;
+  }
+
+  QByteArray data;
+  QDataStream stream(&data, QIODevice::WriteOnly);
+  stream << _pair->from() << _pair->to() << qint32(_date.toJulianDay());
+
+  m_rateJournaled = appendToJournal(Journal::RecordType::RateRemoved, data);
+}
+
+void IO::onObjectModified(int _id) {
+  if (!m_journal) {
+    return;
+  }
+
+  const QString key = m_registered.key(static_cast<IStored*>(sender()));
+
+  if (m_pendingSections.isEmpty() && m_pendingObjects.isEmpty()) {
+    QMetaObject::invokeMethod(this, "flushSections", Qt::QueuedConnection);
+  }
+
+  m_pendingObjects[key].insert(_id);
+}
+
 void IO::gotModifiedSignal() {
+  if (m_journal) {
+    QObject* stored = sender();
+
+    if (stored == TransactionManager::instance()) {
+      // Journaled by onTransactionStored() and onTransactionRemoved().
+    } else if (stored == PriceManager::instance()) {
+      // Rates are journaled by onRateSet() and onRateRemoved(), which are
+      // called just before. Other changes to the exchange pairs are not.
+      if (!m_rateJournaled) {
+        m_journalNeedsCompaction = true;
+      }
+
+      m_rateJournaled = false;
+    } else {
+      QString key = m_registered.key(static_cast<IStored*>(stored));
+      bool isFileManager = false;
+
+      for (IFileManager* m : m_fileManagers) {
+        isFileManager = isFileManager || m == stored;
+      }
+
+      if (key.isEmpty() || isFileManager) {
+        m_journalNeedsCompaction = true;
+      } else if (m_registered[key]->journalsObjects()) {
+        // Journaled by onObjectModified(), which is called just before.
+      } else {
+        // A section is saved as a whole, so its changes are coalesced: it is
+        // journaled once, when control returns to the event loop.
+        if (m_pendingSections.isEmpty() && m_pendingObjects.isEmpty()) {
+          QMetaObject::invokeMethod(this, "flushSections",
+                                    Qt::QueuedConnection);
+        }
+
+        m_pendingSections.insert(key);
+      }
+    }
+  }
+
   if (!m_isDirty) {
     m_isDirty = true;
     emit isDirtyNow();
@@ -20,16 +20,23 @@
 #ifndef IO_H
 #define IO_H
 
+#include <QDate>
 #include <QHash>
+#include <QSet>
 #include <QString>
 #include <QVariant>
 
+#include "ioprofile.h"
+#include "journal.h"
+
 class QXmlStreamAttributes;
 
 namespace KLib {
 
 class IStored;
 class IFileManager;
+class Transaction;
+class ExchangePair;
 
 struct StdTags {
   static const char* ROOT;
@@ -65,6 +72,7 @@ struct StdTags {
   static const char* SCHEDULE;
   static const char* SCHEDULE_REC;
   static const char* SCHEDULE_MGR;
+  static const char* REMOVED;
 };
 
 class IOException : public std::exception {
@@ -97,12 +105,66 @@ class IO : public QObject {
   QString xmlFileContents() const;
   void unload();
 
+  /**
+   * @brief Loads the book at _path and saves it to _destPath using the format
+   * of _fileVersion. The conversion is lossless in both directions.
+   *
+   * The conversion goes through the model: it is refused while a book is open
+   * (see isNew() and isDirty()), and leaves a new book loaded.
+   */
+  void convert(const QString& _path, const QString& _destPath,
+               int _fileVersion);
+
   QString currentName() const { return m_name; }
   QString currentPath() const { return m_path; }
   int fileVersion() const { return m_fileVersion; }
 
+  /**
+   * @brief Version (and thus format) used by the next calls to save().
+   *
+   * Defaults to the version of the loaded book, and to XML_FILE_VERSION for a
+   * new book: older versions of Kangaroo cannot read the columnar format, so
+   * it is only used when it is set here or by convert().
+   */
+  int saveFileVersion() const { return m_saveFileVersion; }
+  void setSaveFileVersion(int _version);
+
   void setName(const QString& _name);
 
+  /**
+   * @brief If the changes to a loaded book are journaled (the default).
+   *
+   * The journal (see Journal) records the changes to transactions, prices and
+   * to the other stored objects as they happen. When only journaled changes
+   * were made, save() commits the journal instead of rewriting the whole
+   * book. The journal is replayed when the book is loaded, and compacted in
+   * the book when it becomes too large.
+   */
+  bool journalEnabled() const { return m_journalEnabled; }
+  void setJournalEnabled(bool _enabled);
+
+  /**
+   * @brief Drops the changes that were made since the last save from the
+   * journal. Call this when a book is closed without saving it.
+   */
+  void discardChanges();
+
+  /**
+   * @brief Time spent in each registered stored object and file manager by
+   * the last call to load().
+   *
+   * Stored objects that support it (see IStored::loadsConcurrently()) are
+   * loaded on worker threads, as well as the files of the file managers (see
+   * IFileManager::decodeFile()).
+   */
+  const IOProfile& lastLoadProfile() const { return m_loadProfile; }
+
+  /**
+   * @brief Time spent in each registered stored object and file manager by
+   * the last call to save().
+   */
+  const IOProfile& lastSaveProfile() const { return m_saveProfile; }
+
   bool isNew() const { return m_path.isEmpty(); }
   bool isDirty() const { return m_isDirty; }
 
@@ -119,6 +181,11 @@ class IO : public QObject {
 
   static const int LATEST_FILE_VERSION;
 
+  static const int XML_FILE_VERSION;  ///< Everything in main.xml
+  static const int COLUMNAR_FILE_VERSION;  ///< Binary columns, see hasColumns()
+
+  static const QString COLUMNS_DIRECTORY;
+
  signals:
   void nameChanged();
 
@@ -128,16 +195,46 @@ class IO : public QObject {
  private slots:
   void gotModifiedSignal();
 
+  void onTransactionStored(KLib::Transaction* _tr);
+  void onTransactionRemoved(int _id);
+  void onRateSet(KLib::ExchangePair* _pair, const QDate& _date);
+  void onRateRemoved(KLib::ExchangePair* _pair, const QDate& _date);
+
+  void onObjectModified(int _id);
+
+  /**
+   * @brief Journals the sections and objects that were modified since their
+   * last record.
+   */
+  void flushSections();
+
  private:
+  void replayJournal(const Journal& _journal);
+  bool appendToJournal(Journal::RecordType _type, const QByteArray& _payload);
+  void closeJournal();
+
+  QByteArray sectionXml(const QString& _key) const;
+
   QString m_path;
   QString m_name;
   int m_fileVersion;
+  int m_saveFileVersion;
 
   QHash<QString, IStored*> m_registered;
   QHash<QString, IFileManager*> m_fileManagers;
 
   bool m_isDirty;
 
+  Journal* m_journal;
+  bool m_journalEnabled;
+  bool m_journalNeedsCompaction;  ///< A change could not be journaled
+  bool m_rateJournaled;           ///< The next PriceManager change is journaled
+  QSet<QString> m_pendingSections;  ///< Modified, not journaled yet
+  QHash<QString, QSet<int>> m_pendingObjects;  ///< Same, by section
+
+  IOProfile m_loadProfile;
+  IOProfile m_saveProfile;
+
   static IO* m_instance;
 };
 }
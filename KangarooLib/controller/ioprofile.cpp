@@ -0,0 +1,141 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "ioprofile.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QVariant>
+#include <algorithm>
+
+#include "../model/stored.h"
+#include "io.h"
+
+namespace KLib {
+
+namespace {
+double toMsecs(qint64 _nsecs) { return _nsecs / 1e6; }
+
+double toUsecs(qint64 _nsecs) { return _nsecs / 1e3; }
+}  // namespace
+
+void IOProfile::start(const QString& _operation, const QString& _path) {
+  m_operation = _operation;
+  m_path = _path;
+  m_totalNsecs = 0;
+  m_entries.clear();
+  m_timer.start();
+}
+
+void IOProfile::add(const QString& _key, const QString& _phase, qint64 _start,
+                    int _count, qint64 _size) {
+  m_entries << Entry{_key,  _phase, _start, elapsed() - _start,
+                     _count, _size, 0};
+}
+
+void IOProfile::finish() {
+  m_totalNsecs = elapsed();
+
+  std::stable_sort(m_entries.begin(), m_entries.end(),
+                   [](const Entry& _a, const Entry& _b) {
+                     return _a.start < _b.start;
+                   });
+}
+
+QString IOProfile::toText() const {
+  QString text = QObject::tr("%1 %2: %3 ms\n")
+                     .arg(m_operation, m_path)
+                     .arg(toMsecs(m_totalNsecs), 0, 'f', 3);
+
+  text += QString("%1 %2 %3 %4 %5 %6\n")
+              .arg(QObject::tr("Phase"), -12)
+              .arg(QObject::tr("Key"), -16)
+              .arg(QObject::tr("Start (ms)"), 12)
+              .arg(QObject::tr("Time (ms)"), 12)
+              .arg(QObject::tr("Count"), 8)
+              .arg(QObject::tr("Size"), 12);
+
+  for (const Entry& e : m_entries) {
+    text += QString("%1 %2 %3 %4 %5 %6%7\n")
+                .arg(e.phase, -12)
+                .arg(e.key, -16)
+                .arg(toMsecs(e.start), 12, 'f', 3)
+                .arg(toMsecs(e.nsecs), 12, 'f', 3)
+                .arg(e.count == -1 ? QString("-") : QString::number(e.count),
+                     8)
+                .arg(e.size == -1 ? QString("-") : QString::number(e.size), 12)
+                .arg(e.thread ? QObject::tr(" (worker %1)").arg(e.thread)
+                              : QString());
+  }
+
+  return text;
+}
+
+QByteArray IOProfile::toTrace() const {
+  QJsonArray events;
+
+  for (const Entry& e : m_entries) {
+    QJsonObject args;
+    args["count"] = e.count;
+    args["size"] = double(e.size);
+
+    QJsonObject event;
+    event["name"] = e.key;
+    event["cat"] = e.phase;
+    event["ph"] = QString("X");
+    event["ts"] = toUsecs(e.start);
+    event["dur"] = toUsecs(e.nsecs);
+    event["pid"] = 1;
+    event["tid"] = e.thread;
+    event["args"] = args;
+    events.append(event);
+  }
+
+  QJsonObject other;
+  other["operation"] = m_operation;
+  other["path"] = m_path;
+  other["totalNsecs"] = double(m_totalNsecs);
+
+  QJsonObject trace;
+  trace["traceEvents"] = events;
+  trace["displayTimeUnit"] = QString("ms");
+  trace["otherData"] = other;
+
+  return QJsonDocument(trace).toJson();
+}
+
+void IOProfile::saveTrace(const QString& _path) const {
+  QFile file(_path);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+      file.write(toTrace()) == -1) {
+    throw IOException(QObject::tr("Unable to write the trace to %1: %2")
+                          .arg(_path, file.errorString()));
+  }
+}
+
+int IOProfile::countOf(const IStored* _stored) {
+  QVariant count = _stored->property("count");
+  return count.isValid() ? count.toInt() : -1;
+}
+
+}  // namespace KLib
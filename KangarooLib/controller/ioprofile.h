@@ -0,0 +1,121 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef IOPROFILE_H
+#define IOPROFILE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+namespace KLib {
+
+class IStored;
+
+/**
+ * @brief Breakdown of the time spent by IO::load() or IO::save() in each
+ * registered stored object and file manager.
+ *
+ * Each phase of each key (IStored::load(), IStored::afterLoad(),
+ * IStored::save(), IFileManager::loadFile(), IFileManager::saveFiles(), ...)
+ * is an entry, with its wall time, the number of elements of the object and
+ * the amount of data that was processed.
+ *
+ * The profile can be exported as a trace in the Trace Event Format (the JSON
+ * format of chrome://tracing and Perfetto), to track regressions.
+ */
+class IOProfile {
+ public:
+  struct Entry {
+    QString key;    ///< Key of the stored object or directory of the files
+    QString phase;  ///< "xml", "columns", "files", "journal", "afterLoad",
+                    ///< "save", "saveColumns", "saveFiles" or "commit"
+    qint64 start;   ///< Nanoseconds since the beginning of the operation
+    qint64 nsecs;
+    int count;    ///< Elements in the object after the phase, -1 if unknown
+    qint64 size;  ///< Bytes of columns and files, characters of XML
+    int thread;   ///< 0 for the main thread, then one number per worker
+  };
+
+  IOProfile() : m_totalNsecs(0) {}
+
+  /**
+   * @brief Clears the profile and starts timing _operation on the book at
+   * _path.
+   */
+  void start(const QString& _operation, const QString& _path);
+
+  /**
+   * @brief Nanoseconds since start().
+   */
+  qint64 elapsed() const { return m_timer.nsecsElapsed(); }
+
+  /**
+   * @brief Adds an entry that started at _start (see elapsed()) and ends now,
+   * on the main thread.
+   */
+  void add(const QString& _key, const QString& _phase, qint64 _start,
+           int _count = -1, qint64 _size = -1);
+
+  void add(const Entry& _entry) { m_entries << _entry; }
+
+  /**
+   * @brief Records the total time and orders the entries by start time.
+   */
+  void finish();
+
+  QString operation() const { return m_operation; }
+  QString path() const { return m_path; }
+  qint64 totalNsecs() const { return m_totalNsecs; }
+
+  const QList<Entry>& entries() const { return m_entries; }
+
+  /**
+   * @brief Human readable table of the entries.
+   */
+  QString toText() const;
+
+  /**
+   * @brief The profile in the Trace Event Format.
+   */
+  QByteArray toTrace() const;
+
+  /**
+   * @brief Writes toTrace() to _path. Throws an IOException on failure.
+   */
+  void saveTrace(const QString& _path) const;
+
+  /**
+   * @brief Number of elements of _stored: its "count" property, or -1 if it
+   * does not have one.
+   */
+  static int countOf(const IStored* _stored);
+
+ private:
+  QString m_operation;
+  QString m_path;
+  qint64 m_totalNsecs;
+  QElapsedTimer m_timer;
+  QList<Entry> m_entries;
+};
+
+}  // namespace KLib
+
+#endif  // IOPROFILE_H
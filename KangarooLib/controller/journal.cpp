@@ -0,0 +1,203 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "journal.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QObject>
+#include <algorithm>
+#include <cstring>
+
+#include "io.h"
+
+namespace KLib {
+
+const char Journal::MAGIC[4] = {'K', 'J', 'N', 'L'};
+const quint32 Journal::FORMAT_VERSION = 1;
+const qint64 Journal::COMPACTION_MIN_SIZE = 4 * 1024 * 1024;
+
+namespace {
+// Header: magic, format version, size and modification time of the book.
+const int HEADER_SIZE = 4 + sizeof(quint32) + 2 * sizeof(qint64);
+
+// Record header: payload size, checksum of the payload and type.
+const int RECORD_HEADER_SIZE = sizeof(quint32) + sizeof(quint16) + 1;
+
+template <class T>
+void appendValue(QByteArray& _array, T _value) {
+  _array.append(reinterpret_cast<const char*>(&_value), sizeof(T));
+}
+
+template <class T>
+T valueAt(const QByteArray& _array, int _pos) {
+  T value;
+  std::memcpy(&value, _array.constData() + _pos, sizeof(T));
+  return value;
+}
+}  // namespace
+
+Journal::Journal(const QString& _bookPath)
+    : m_bookPath(_bookPath),
+      m_file(path(_bookPath)),
+      m_size(0),
+      m_committedSize(0) {
+  QFileInfo info(_bookPath);
+  m_bookSize = info.size();
+  m_bookModified = info.lastModified().toMSecsSinceEpoch();
+
+  read();
+}
+
+void Journal::read() {
+  QFile file(path(m_bookPath));
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QByteArray data = file.readAll();
+
+  if (data.size() < HEADER_SIZE ||
+      std::memcmp(data.constData(), MAGIC, sizeof(MAGIC)) != 0 ||
+      valueAt<quint32>(data, 4) != FORMAT_VERSION ||
+      valueAt<qint64>(data, 8) != m_bookSize ||
+      valueAt<qint64>(data, 16) != m_bookModified) {
+    // Not a journal of this version of the book: it will be replaced.
+    return;
+  }
+
+  int pos = HEADER_SIZE;
+  int committed = pos;
+
+  // Stop at the first incomplete or corrupted record, which can only be the
+  // last one if the application crashed while writing it.
+  while (pos + RECORD_HEADER_SIZE <= data.size()) {
+    quint32 size = valueAt<quint32>(data, pos);
+    quint16 checksum = valueAt<quint16>(data, pos + sizeof(quint32));
+    quint8 type = valueAt<quint8>(data, pos + sizeof(quint32) + sizeof(quint16));
+
+    if (size > quint32(data.size() - pos - RECORD_HEADER_SIZE) ||
+        type > quint8(RecordType::Objects)) {
+      break;
+    }
+
+    QByteArray payload = data.mid(pos + RECORD_HEADER_SIZE, size);
+
+    if (qChecksum(payload.constData(), payload.size()) != checksum) {
+      break;
+    }
+
+    pos += RECORD_HEADER_SIZE + size;
+
+    if (RecordType(type) == RecordType::Commit) {
+      committed = pos;
+    } else {
+      m_records << Record{RecordType(type), payload};
+    }
+  }
+
+  m_size = pos;
+  m_committedSize = committed;
+}
+
+void Journal::openForAppend() {
+  if (m_file.isOpen()) {
+    return;
+  }
+
+  if (!m_file.open(QIODevice::ReadWrite)) {
+    throw IOException(QObject::tr("Unable to open the journal %1: %2")
+                          .arg(m_file.fileName())
+                          .arg(m_file.errorString()));
+  }
+
+  if (m_size == 0) {
+    // New journal, or one of another version of the book.
+    QByteArray header;
+    header.append(MAGIC, sizeof(MAGIC));
+    appendValue<quint32>(header, FORMAT_VERSION);
+    appendValue<qint64>(header, m_bookSize);
+    appendValue<qint64>(header, m_bookModified);
+
+    if (!m_file.resize(0) || m_file.write(header) != header.size()) {
+      m_file.close();
+      throw IOException(QObject::tr("Unable to write the journal %1.")
+                            .arg(m_file.fileName()));
+    }
+
+    m_size = m_committedSize = HEADER_SIZE;
+  } else {
+    // Drop an incomplete record at the end, if any.
+    m_file.resize(m_size);
+    m_file.seek(m_size);
+  }
+}
+
+void Journal::append(RecordType _type, const QByteArray& _payload) {
+  openForAppend();
+
+  QByteArray record;
+  record.reserve(RECORD_HEADER_SIZE + _payload.size());
+  appendValue<quint32>(record, _payload.size());
+  appendValue<quint16>(record, qChecksum(_payload.constData(), _payload.size()));
+  appendValue<quint8>(record, quint8(_type));
+  record.append(_payload);
+
+  if (m_file.write(record) != record.size() || !m_file.flush()) {
+    throw IOException(QObject::tr("Unable to write the journal %1.")
+                          .arg(m_file.fileName()));
+  }
+
+  m_size += record.size();
+
+  if (_type == RecordType::Commit) {
+    m_committedSize = m_size;
+  }
+}
+
+void Journal::discardUncommitted() {
+  if (!hasUncommittedRecords()) {
+    return;
+  }
+
+  openForAppend();
+
+  if (!m_file.resize(m_committedSize)) {
+    throw IOException(QObject::tr("Unable to write the journal %1.")
+                          .arg(m_file.fileName()));
+  }
+
+  m_file.seek(m_committedSize);
+  m_size = m_committedSize;
+}
+
+void Journal::clear() {
+  m_file.close();
+  QFile::remove(m_file.fileName());
+
+  m_size = m_committedSize = 0;
+  m_records.clear();
+}
+
+bool Journal::needsCompaction() const {
+  return m_size > std::max(COMPACTION_MIN_SIZE, m_bookSize);
+}
+
+}  // namespace KLib
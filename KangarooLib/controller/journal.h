@@ -0,0 +1,129 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+namespace KLib {
+
+/**
+ * @brief Append-only journal of the mutations of a book, stored next to it.
+ *
+ * Each record is flushed to disk as soon as it is appended. Commit records
+ * mark the saves: records after the last commit are changes that were not
+ * saved (for example, if the application crashed).
+ *
+ * The journal is bound to the version of the book file on which it applies
+ * (its size and modification time). If the book is rewritten, the journal is
+ * ignored.
+ */
+class Journal {
+ public:
+  enum class RecordType : quint8 {
+    Commit = 0,
+    TransactionSet = 1,      ///< XML of an added or modified transaction
+    TransactionRemoved = 2,  ///< Id of a removed transaction
+    RateSet = 3,             ///< From, to, date and rate
+    RateRemoved = 4,         ///< From, to and date
+    Section = 5,             ///< Key and XML of a whole IStored
+    Objects = 6              ///< Key and XML of objects of an IStored (see IStored::saveObjects())
+  };
+
+  struct Record {
+    RecordType type;
+    QByteArray payload;
+  };
+
+  /**
+   * @brief Opens the journal of the book at _bookPath and reads its records,
+   * if it exists and applies on the current book file.
+   *
+   * The journal file is only created when the first record is appended.
+   */
+  explicit Journal(const QString& _bookPath);
+
+  /**
+   * @brief The valid records that were read when the journal was opened.
+   */
+  const QList<Record>& records() const { return m_records; }
+
+  /**
+   * @brief If there are records after the last commit.
+   */
+  bool hasUncommittedRecords() const { return m_size > m_committedSize; }
+
+  /**
+   * @brief Size of the journal file, 0 if there is none.
+   */
+  qint64 size() const { return m_size; }
+
+  /**
+   * @brief Appends a record and flushes it. Throws an IOException on error.
+   */
+  void append(RecordType _type, const QByteArray& _payload);
+
+  void commit() { append(RecordType::Commit, QByteArray()); }
+
+  /**
+   * @brief Removes the records after the last commit.
+   */
+  void discardUncommitted();
+
+  /**
+   * @brief Removes the journal file, once its content is saved in the book.
+   */
+  void clear();
+
+  /**
+   * @brief If the journal is large enough that the book should be saved
+   * completely instead.
+   */
+  bool needsCompaction() const;
+
+  static QString path(const QString& _bookPath) {
+    return _bookPath + ".journal";
+  }
+
+  static const char MAGIC[4];
+  static const quint32 FORMAT_VERSION;
+  static const qint64 COMPACTION_MIN_SIZE;
+
+ private:
+  void read();
+  void openForAppend();
+
+  QString m_bookPath;
+  qint64 m_bookSize;
+  qint64 m_bookModified;
+
+  QFile m_file;
+  qint64 m_size;           ///< 0 if there is no valid journal file
+  qint64 m_committedSize;  ///< Size up to the last commit
+
+  QList<Record> m_records;
+};
+
+}  // namespace KLib
+
+#endif  // JOURNAL_H
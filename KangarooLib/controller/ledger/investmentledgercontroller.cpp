@@ -174,6 +174,13 @@ Balances InvestmentLedgerController::cacheBalance(int _cacheRow) const {
   }
 }
 
+bool InvestmentLedgerController::cacheBalanceIsRelative(int _cacheRow) const {
+  const InvestmentTransaction* trans =
+      qobject_cast<const InvestmentTransaction*>(transactionAtRow(_cacheRow));
+
+  return trans && trans->action() == InvestmentAction::StockSplit;
+}
+
 QVariant InvestmentLedgerController::cacheData(int _column, int _cacheRow,
                                                int _row, bool _editRole) const {
   const InvestmentTransaction* trans =
@@ -176,6 +176,8 @@ namespace KLib
             QVariant    cacheData(int _column, int _cacheRow, int _row, bool _editRole) const override;
             int         subRowCount(const Transaction* _tr) const override;
             Balances    cacheBalance(int _cacheRow) const override;
+            bool        cacheBalanceIsRelative(int _cacheRow) const override;
+            bool        supportsWindowedCache() const override { return false; }
 
             InvestmentLedgerBuffer* m_invBuffer; ///< Simply a casted version of m_buffer
 
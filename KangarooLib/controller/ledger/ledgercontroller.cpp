@@ -931,6 +931,10 @@ bool LedgerController::canRemoveSplitAt(const QModelIndex& _index) {
          _index.parent().isValid();
 }
 
+void LedgerController::prefetchRows(int _first, int _last) {
+  m_cache.prefetch(_first, _last);
+}
+
 void LedgerController::removeSplitAt(const QModelIndex& _index) {
   if (canRemoveSplitAt(_index)) {
     m_buffer->removeRowAt(_index.parent().isValid() ? _index.row() + 1 : 0);
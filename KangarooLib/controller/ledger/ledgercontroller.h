@@ -320,6 +320,12 @@ class LedgerController : public QAbstractItemModel {
 
   virtual bool canRemoveSplitAt(const QModelIndex& _index);
 
+  /**
+   * @brief Materializes the rows from _first to _last, the rows shown by the
+   * view, before they are displayed. Only has an effect on large ledgers.
+   */
+  void prefetchRows(int _first, int _last);
+
   static const QString SPLIT_TEXT;
 
  public slots:
@@ -411,6 +417,19 @@ class LedgerController : public QAbstractItemModel {
    */
   virtual Balances cacheBalance(int _cacheRow) const;
 
+  /**
+   * @brief If cacheBalance() of _cacheRow depends on the balance before it,
+   * like a stock split does.
+   */
+  virtual bool cacheBalanceIsRelative(int) const { return false; }
+
+  /**
+   * @brief If large ledgers can be cached without materializing their
+   * transactions until they are displayed (see LedgerTransactionCache).
+   * cacheBalance() must then be the weight of the transaction in the ledger.
+   */
+  virtual bool supportsWindowedCache() const { return true; }
+
   /**
    * @brief Checks if the transaction at row _row can be edited by this ledger.
    * Ex: investment transactions cannot be edited by GenericLedgerController.
@@ -5,12 +5,20 @@
 #include "../../ui/settingsmanager.h"
 #include "ledgercontroller.h"
 
+#include <algorithm>
+
 namespace KLib {
+const int LedgerTransactionCache::WINDOWED_MIN_COUNT = 5000;
+const int LedgerTransactionCache::PREFETCH_MARGIN = 200;
+const int LedgerTransactionCache::RELOAD_AFTER_ADDED = 100;
+
 LedgerTransactionCache::LedgerTransactionCache(LedgerController* _controller)
     : QObject(_controller),
       m_controller(_controller),
       m_filterIsApplied(false),
       m_filterFunction([](const_reference) { return false; }),
+      m_windowed(false),
+      m_pendingCount(0),
       m_displayPolicy(ScheduleDisplayPolicy::FixedNumber),
       m_displayPolicyCount(15) {
   // Connect signals and slots
@@ -22,6 +30,10 @@ LedgerTransactionCache::LedgerTransactionCache(LedgerController* _controller)
           &LedgerTransactionCache::onSplitAmountChanged);
   connect(LedgerManager::instance(), &LedgerManager::transactionDateChanged,
           this, &LedgerTransactionCache::onTransactionDateChanged);
+  connect(LedgerManager::instance(), &LedgerManager::transactionsAdded, this,
+          &LedgerTransactionCache::onTransactionsAdded);
+  connect(LedgerManager::instance(), &LedgerManager::changesCommitted, this,
+          &LedgerTransactionCache::onChangesCommitted);
 
   connect(ScheduleManager::instance(), &ScheduleManager::scheduleAdded, this,
           &LedgerTransactionCache::onScheduleAdded);
@@ -38,6 +50,9 @@ LedgerTransactionCache::LedgerTransactionCache(LedgerController* _controller)
 }
 
 void LedgerTransactionCache::setFilter(fn_filter _keep) {
+  // The filter is evaluated on every row, in order
+  prefetch(0, m_cache.count() - 1);
+
   m_filteredSortedCache.clear();
 
   m_controller->beginResetModel();
@@ -123,6 +138,10 @@ void LedgerTransactionCache::reloadData() {
   m_filteredSortedCache.clear();
   m_cacheToFilteredMap.clear();
   m_filterIsApplied = false;
+  m_transactionIndex.clear();
+  m_scheduleIndex.clear();
+  m_relativeNodes.clear();
+  m_balances.clear();
 
   // Load...
   int i = 0;
@@ -154,17 +173,39 @@ void LedgerTransactionCache::reloadData() {
   auto is = futureInstances.begin();
   auto transactions = m_controller->ledger()->transactions();
 
+  // In windowed mode, the transactions are not materialized: the rows are
+  // built from the dates and weights of the ledger.
+  m_windowed = m_controller->supportsWindowedCache() &&
+               transactions->count() >= WINDOWED_MIN_COUNT &&
+               transactions->fragmentCount() <= 1;
+  m_pendingCount = 0;
+
+  QVector<Balances> ledgerWeights;
+
   for (auto it = transactions->begin(); it != transactions->end(); ++it, ++i) {
+    const QDate date = m_windowed ? it.key() : (*it)->date();
+
     // Add all the schedules with a date < this schedule.
-    while (is != futureInstances.end() && is->first < (*it)->date()) {
+    while (is != futureInstances.end() && is->first < date) {
       m_cache.append(
           CacheItem(is->second, is->first,
                     m_controller->subRowCount(is->second->transaction())));
 
+      if (m_windowed) {
+        ledgerWeights.append(Balances());
+      }
+
       ++is;
     }
 
     // Now add the next transaction.
+    if (m_windowed) {
+      m_cache.append(CacheItem(it.value(), date));
+      ledgerWeights.append(it.weight());
+      ++m_pendingCount;
+      continue;
+    }
+
     m_cache.append(CacheItem(*it, m_controller->subRowCount(*it)));
     //    bool before =
     //    Transaction::totalForAccount(m_controller->account()->id(),
@@ -184,10 +225,13 @@ void LedgerTransactionCache::reloadData() {
     //    }
   }
 
-  std::sort(m_cache.begin(), m_cache.end(),
-            [this](const_reference a, const_reference b) {
-              return this->compareItems(a, b);
-            });
+  // In windowed mode, each date is sorted when it is materialized
+  if (!m_windowed) {
+    std::sort(m_cache.begin(), m_cache.end(),
+              [this](const_reference a, const_reference b) {
+                return this->compareItems(a, b);
+              });
+  }
 
   // Add all the remaining schedules
   while (is != futureInstances.end()) {
@@ -199,36 +243,168 @@ void LedgerTransactionCache::reloadData() {
   }
 
   // Build the index and the running balances
-  reloadBalanceAndIndexFrom(0);
+  const bool negate = Account::negativeDebits(m_controller->account()->type());
 
-  // We're done!
-  m_controller->endResetModel();
-}
+  for (int i = 0; i < m_cache.size(); ++i) {
+    if (m_cache[i].pending) {
+      // Same as cacheBalance(), which is the weight in the ledger
+      Balances weight;
 
-// not fixed yet
-void LedgerTransactionCache::reloadBalanceAndIndexFrom(int _from) {
-  for (int i = std::max(0, _from); i < m_cache.size(); ++i) {
-    // Update the balance
-    m_cache[i].runningBalance =
-        i > 0 ? m_cache[i - 1].runningBalance
-              : Balances();  // Balance before the current row
-
-    if (i != m_controller->newTransactionRow() &&
-        (!m_cache[i].schedule || m_cache[i].date() > QDate::currentDate())) {
-      if (Account::negativeDebits(m_controller->account()->type())) {
-        m_cache[i].runningBalance -= m_controller->cacheBalance(i);
+      if (negate) {
+        weight -= ledgerWeights[i];
       } else {
-        m_cache[i].runningBalance += m_controller->cacheBalance(i);
+        weight += ledgerWeights[i];
       }
+
+      m_cache[i].balanceNode = m_balances.insert(i, weight);
+      addToIndex(i);
+    } else {
+      m_cache[i].balanceNode = m_balances.insert(i, Balances());
+      addToIndex(i);
+      setRowWeight(i);
     }
+  }
+
+  // We're done!
+  m_controller->endResetModel();
+}
 
-    // Update the index
-    if (!m_cache[i].schedule) {
-      m_transactionIndex[m_cache[i].transaction()->id()] = i;
+void LedgerTransactionCache::setRowWeight(int _row) {
+  const CacheItem& item = m_cache[_row];
+  Balances weight;
+
+  if (!item.schedule || item.date() > QDate::currentDate()) {
+    if (Account::negativeDebits(m_controller->account()->type())) {
+      weight -= m_controller->cacheBalance(_row);
     } else {
-      m_scheduleIndex[m_cache[i].schedule->id()][m_cache[i].dueDate] = i;
+      weight += m_controller->cacheBalance(_row);
     }
   }
+
+  m_balances.setWeight(item.balanceNode, weight);
+
+  if (m_controller->cacheBalanceIsRelative(_row)) {
+    m_relativeNodes.insert(item.balanceNode);
+  } else {
+    m_relativeNodes.remove(item.balanceNode);
+  }
+}
+
+void LedgerTransactionCache::updateBalance(int _row) {
+  setRowWeight(_row);
+  updateRelativeRowsFrom(_row + 1);
+}
+
+void LedgerTransactionCache::updateRelativeRowsFrom(int _row) {
+  if (m_relativeNodes.isEmpty()) {
+    return;
+  }
+
+  QList<int> rows;
+
+  for (const BalanceTree::Node* n : m_relativeNodes) {
+    int row = rowOf(n);
+
+    if (row >= _row) {
+      rows << row;
+    }
+  }
+
+  // In order, as each one depends on the balance before it
+  std::sort(rows.begin(), rows.end());
+
+  for (int row : rows) {
+    setRowWeight(row);
+  }
+}
+
+void LedgerTransactionCache::addToIndex(int _row) {
+  const CacheItem& item = m_cache[_row];
+
+  if (!item.schedule) {
+    m_transactionIndex[item.transactionId()] = item.balanceNode;
+  } else {
+    m_scheduleIndex[item.schedule->id()][item.dueDate] = item.balanceNode;
+  }
+}
+
+int LedgerTransactionCache::transactionRow(int _idTransaction) {
+  const BalanceTree::Node* n = m_transactionIndex.value(_idTransaction);
+
+  if (!n) {
+    return -1;
+  } else if (m_cache[rowOf(n)].pending) {
+    materializeDate(rowOf(n));
+    n = m_transactionIndex.value(_idTransaction);  // May have been sorted
+  }
+
+  return rowOf(n);
+}
+
+void LedgerTransactionCache::prefetch(int _first, int _last) {
+  // With a filter, all the rows are materialized.
+  if (!m_pendingCount || m_filterIsApplied) {
+    return;
+  }
+
+  _first = std::max(0, _first - PREFETCH_MARGIN);
+  _last = std::min(m_cache.count() - 1, _last + PREFETCH_MARGIN);
+
+  for (int row = _first; row <= _last && m_pendingCount; ++row) {
+    if (m_cache[row].pending) {
+      row = materializeDate(row);
+    }
+  }
+}
+
+int LedgerTransactionCache::materializeDate(int _row) {
+  using namespace std::placeholders;
+
+  const QDate date = m_cache[_row].date();
+  int first = _row;
+  int last = _row;
+
+  while (first > 0 && m_cache[first - 1].date() == date) {
+    --first;
+  }
+
+  while (last < m_cache.count() - 1 && m_cache[last + 1].date() == date) {
+    ++last;
+  }
+
+  // The nodes stay at their rows and take the weight of the item sorted there.
+  QVector<BalanceTree::Node*> nodes;
+  for (int i = first; i <= last; ++i) {
+    nodes << m_cache[i].balanceNode;
+  }
+
+  std::stable_sort(m_cache.begin() + first, m_cache.begin() + last + 1,
+                   std::bind(&LedgerTransactionCache::compareItems, this, _1,
+                             _2, nullptr, QDate()));
+
+  QVector<Balances> weights;
+  for (int i = first; i <= last; ++i) {
+    weights << m_cache[i].balanceNode->weight();
+  }
+
+  for (int i = first; i <= last; ++i) {
+    CacheItem& item = m_cache[i];
+    item.balanceNode = nodes[i - first];
+    m_balances.setWeight(item.balanceNode, weights[i - first]);
+    addToIndex(i);
+
+    if (item.pending) {
+      item.pending = false;
+      --m_pendingCount;
+      updateRow(i);  // Inserts the sub-rows
+    }
+  }
+
+  emit m_controller->dataChanged(
+      m_controller->index(first, 0),
+      m_controller->index(last, m_controller->columnCount() - 1));
+
+  return last;
 }
 
 /////////////////////////////////////// ROW HELPERS
@@ -238,7 +414,7 @@ int LedgerTransactionCache::cachedSubRowCount(int _cacheRow) const {
   return currentList()[_cacheRow].cachedSubRowCount;
 }
 
-int LedgerTransactionCache::addItem(const CacheItem& _item, bool _reloadIndex) {
+int LedgerTransactionCache::addItem(const CacheItem& _item) {
   // First, insert it in the regular cache
   using namespace std::placeholders;
 
@@ -248,32 +424,31 @@ int LedgerTransactionCache::addItem(const CacheItem& _item, bool _reloadIndex) {
 
   int row = i - m_cache.begin();
 
-  if (!m_filterIsApplied) {
-    emit m_controller->beginInsertRows(QModelIndex(), row, row);
+  auto insertItem = [&]() {
     m_cache.insert(i, _item);
+    m_cache[row].balanceNode = m_balances.insert(row, Balances());
+    addToIndex(row);
+    updateBalance(row);
+  };
 
-    if (_reloadIndex) {
-      reloadBalanceAndIndexFrom(row);
-    }
-
+  if (!m_filterIsApplied) {
+    emit m_controller->beginInsertRows(QModelIndex(), row, row);
+    insertItem();
     emit m_controller->endInsertRows();
   } else {
-    m_cache.insert(i, _item);
-
-    if (_reloadIndex) {
-      reloadBalanceAndIndexFrom(row);
-    }
+    insertItem();
 
     if (m_filterFunction(_item)) {
-      i = std::upper_bound(m_filteredSortedCache.begin(),
-                           m_filteredSortedCache.end(), _item,
-                           std::bind(&LedgerTransactionCache::compareItems,
-                                     this, _1, _2, nullptr, QDate()));
+      auto j = std::upper_bound(
+          m_filteredSortedCache.begin(), m_filteredSortedCache.end(), _item,
+          std::bind(&LedgerTransactionCache::compareItems, this, _1, _2,
+                    nullptr, QDate()));
 
-      int row = i - m_filteredSortedCache.begin();
+      int filteredRow = j - m_filteredSortedCache.begin();
 
-      emit m_controller->beginInsertRows(QModelIndex(), row, row);
-      m_filteredSortedCache.insert(i, _item);
+      emit m_controller->beginInsertRows(QModelIndex(), filteredRow,
+                                         filteredRow);
+      m_filteredSortedCache.insert(j, m_cache[row]);
       emit m_controller->endInsertRows();
     }
   }
@@ -299,16 +474,21 @@ int LedgerTransactionCache::addItem(const CacheItem& _item, bool _reloadIndex) {
   //        return row;
 }
 
-void LedgerTransactionCache::removeRow(int _row, bool _reloadIndex) {
+void LedgerTransactionCache::removeRow(int _row) {
   int cacheRow = _row;
 
   // See if the row is also in the filter, in which case we remove it there
-  // instead
-  if (m_filterIsApplied && m_cacheToFilteredMap.contains(_row)) {
-    _row = m_cacheToFilteredMap[_row];
-  } else if (m_filterIsApplied)  // No need to emit a signal
-  {
-    _row = -1;
+  // instead. The copy in the filter shares the balance node of the row.
+  if (m_filterIsApplied) {
+    const BalanceTree::Node* node = m_cache[cacheRow].balanceNode;
+    _row = -1;  // No need to emit a signal if it is not there
+
+    for (int i = 0; i < m_filteredSortedCache.count(); ++i) {
+      if (m_filteredSortedCache[i].balanceNode == node) {
+        _row = i;
+        break;
+      }
+    }
   }
 
   if (_row != -1) {
@@ -317,6 +497,10 @@ void LedgerTransactionCache::removeRow(int _row, bool _reloadIndex) {
 
   CacheItem item = m_cache.takeAt(cacheRow);
 
+  if (m_filterIsApplied && _row != -1) {
+    m_filteredSortedCache.removeAt(_row);
+  }
+
   if (item.schedule && m_scheduleIndex.contains(item.schedule->id())) {
     m_scheduleIndex[item.schedule->id()].remove(item.dueDate);
 
@@ -324,21 +508,24 @@ void LedgerTransactionCache::removeRow(int _row, bool _reloadIndex) {
       m_scheduleIndex.remove(item.schedule->id());
     }
   } else if (!item.schedule) {
-    m_transactionIndex.remove(item.transaction()->id());
+    m_transactionIndex.remove(item.transactionId());
   }
 
-  if (_reloadIndex) {
-    reloadBalanceAndIndexFrom(cacheRow);
+  if (item.pending) {
+    --m_pendingCount;
   }
 
+  m_relativeNodes.remove(item.balanceNode);
+  m_balances.remove(item.balanceNode);
+  updateRelativeRowsFrom(cacheRow);
+
   if (_row != -1) {
     emit m_controller->endRemoveRows();
   }
 }
 
 // filtering: did up to here...
-void LedgerTransactionCache::replaceItemAt(int _row, const QDate& _oldDate,
-                                           bool _reloadIndex) {
+void LedgerTransactionCache::replaceItemAt(int _row, const QDate& _oldDate) {
   using namespace std::placeholders;
 
   // Check if we need to move it or not.
@@ -376,15 +563,15 @@ void LedgerTransactionCache::replaceItemAt(int _row, const QDate& _oldDate,
     m_controller->beginMoveRows(/* src  */ QModelIndex(), _row, _row,
                                 /* dest */ QModelIndex(), newRow);
 
-    m_cache.move(
-        _row, _row < newRow
-                  ? newRow - 1
-                  : newRow);  // When inserting back, does as if the "removed"
-                              // row does not exists and everything was shifted.
+    // When inserting back, does as if the "removed" row does not exists and
+    // everything was shifted.
+    const int dest = _row < newRow ? newRow - 1 : newRow;
 
-    if (_reloadIndex) {
-      reloadBalanceAndIndexFrom(reloadFrom);
-    }
+    m_balances.move(m_cache[_row].balanceNode, dest);
+    m_cache.move(_row, dest);
+
+    setRowWeight(dest);
+    updateRelativeRowsFrom(reloadFrom);
 
     m_controller->endMoveRows();
 
@@ -395,10 +582,7 @@ void LedgerTransactionCache::replaceItemAt(int _row, const QDate& _oldDate,
                             m_controller->col_balance()));
   } else {
     updateRow(_row);
-
-    if (_reloadIndex) {
-      reloadBalanceAndIndexFrom(_row);
-    }
+    updateBalance(_row);
   }
 }
 
@@ -457,9 +641,19 @@ QList<QDate> LedgerTransactionCache::nextOccurrences(
     case ScheduleDisplayPolicy::FixedNumber:
       return _schedule->nextOccurrencesDates(m_displayPolicyCount, QDate());
 
-    case ScheduleDisplayPolicy::DaysInFuture:
-      return _schedule->nextOccurrencesDates(
-          -1, QDate::currentDate().addDays(m_displayPolicyCount));
+    case ScheduleDisplayPolicy::DaysInFuture: {
+      const QDate last = QDate::currentDate().addDays(m_displayPolicyCount);
+      const QDate next =
+          ScheduleManager::instance()->nextOccurrence(_schedule->id());
+
+      // Most schedules have no occurrence in the window: skip computing their
+      // recurrence.
+      if (!next.isValid() || next > last) {
+        return {};
+      }
+
+      return _schedule->nextOccurrencesDates(-1, last);
+    }
 
     default:
       return {};
@@ -472,42 +666,81 @@ QList<QDate> LedgerTransactionCache::nextOccurrences(
 void LedgerTransactionCache::onSplitAdded(const Transaction::Split& _split,
                                           Transaction* _tr) {
   if (_tr->relatedTo(m_controller->account()->id())) {
-    if (!m_transactionIndex.contains(_tr->id())) {
+    int row = transactionRow(_tr->id());
+
+    if (row == -1) {
       addItem(CacheItem(_tr, m_controller->subRowCount(_tr)));
     } else {
-      updateRow(m_transactionIndex[_tr->id()]);
+      updateRow(row);
 
       if (_split.idAccount == m_controller->account()->id()) {
-        reloadBalanceAndIndexFrom(m_transactionIndex[_tr->id()]);
+        updateBalance(row);
       }
     }
   }
 }
 
+void LedgerTransactionCache::onTransactionsAdded(
+    const QList<Transaction*>& _transactions, const QSet<int>& _idAccounts) {
+  const int idAccount = m_controller->account()->id();
+
+  if (!_idAccounts.contains(idAccount)) {
+    return;
+  }
+
+  QList<Transaction*> related;
+
+  for (Transaction* tr : _transactions) {
+    if (tr->relatedTo(idAccount)) {
+      related << tr;
+    }
+  }
+
+  if (related.size() >= RELOAD_AFTER_ADDED) {
+    reloadData();
+  } else {
+    for (Transaction* tr : related) {
+      addItem(CacheItem(tr, m_controller->subRowCount(tr)));
+    }
+  }
+}
+
+void LedgerTransactionCache::onChangesCommitted(const ModelDelta& _delta) {
+  // The rows and the running balances after the first modified date may all
+  // have changed: reload once instead of updating them for each change.
+  if (_delta.accounts.contains(m_controller->account()->id())) {
+    reloadData();
+  }
+}
+
 void LedgerTransactionCache::onSplitRemoved(const Transaction::Split& _split,
                                             Transaction* _tr) {
-  if (m_transactionIndex.contains(_tr->id())) {
+  int row = transactionRow(_tr->id());
+
+  if (row != -1) {
     if (_tr->relatedTo(m_controller->account()->id())) {
-      updateRow(m_transactionIndex[_tr->id()]);
+      updateRow(row);
 
       if (_split.idAccount == m_controller->account()->id()) {
-        reloadBalanceAndIndexFrom(m_transactionIndex[_tr->id()]);
+        updateBalance(row);
       }
     } else  // Nothing to do with this anymore...
     {
-      removeRow(m_transactionIndex[_tr->id()]);
+      removeRow(row);
     }
   }
 }
 
 void LedgerTransactionCache::onSplitAmountChanged(
     const Transaction::Split& _split, Transaction* _tr) {
-  if (m_transactionIndex.contains(_tr->id())) {
+  int row = transactionRow(_tr->id());
+
+  if (row != -1) {
     if (_split.idAccount == m_controller->account()->id()) {
-      replaceItemAt(m_transactionIndex[_tr->id()]);
+      replaceItemAt(row);
     } else {
       // Simply reload it
-      updateRow(m_transactionIndex[_tr->id()]);
+      updateRow(row);
     }
   } else if (_split.idAccount == m_controller->account()->id()) {
     onSplitAdded(_split, _tr);
@@ -516,8 +749,10 @@ void LedgerTransactionCache::onSplitAmountChanged(
 
 void LedgerTransactionCache::onTransactionDateChanged(Transaction* _tr,
                                                       const QDate& _old) {
-  if (m_transactionIndex.contains(_tr->id())) {
-    replaceItemAt(m_transactionIndex[_tr->id()], _old);
+  int row = transactionRow(_tr->id());
+
+  if (row != -1) {
+    replaceItemAt(row, _old);
   } else if (_tr->relatedTo(m_controller->account()->id())) {
     onSplitAdded(_tr->splits().first(), _tr);
   }
@@ -531,17 +766,10 @@ void LedgerTransactionCache::onScheduleAdded(Schedule* s) {
   {
     // Add the schedule
     QList<QDate> next = nextOccurrences(s);
-    int min_row = m_cache.count();
 
     for (const QDate& d : next) {
-      min_row = std::min(
-          min_row,
-          addItem(CacheItem(s, d, m_controller->subRowCount(s->transaction())),
-                  false));
+      addItem(CacheItem(s, d, m_controller->subRowCount(s->transaction())));
     }
-
-    // Reconstruct the balances and index
-    reloadBalanceAndIndexFrom(min_row);
   }
 }
 
@@ -550,22 +778,13 @@ void LedgerTransactionCache::onScheduleRemoved(Schedule* s) {
   auto schedule_iter = m_scheduleIndex.find(s->id());
 
   if (schedule_iter != m_scheduleIndex.end()) {
-    if (schedule_iter->count()) {
-      // Remove all occurences of the schedule, starting at the last one.
-      for (auto i = schedule_iter->end() - 1;; --i) {
-        // Reload balance and cache only if smallest row, otherwise waste of
-        // time The index entry will be removed by removeRow once it removes the
-        // last occurrence of the schedule.
-        bool isLast =
-            i ==
-            schedule_iter->begin();  // Compute this before, as the iterator
-                                     // will become invalid if it's the last
-                                     // (whole QMap will be deleted)
-
-        removeRow(i.value(), isLast);
-
-        if (isLast) break;
-      }
+    // Copy the nodes, as removeRow() removes them from the index (and removes
+    // the whole QMap with the last one).
+    const QList<BalanceTree::Node*> nodes = schedule_iter->values();
+
+    // Remove all occurences of the schedule, starting at the last one.
+    for (int i = nodes.count() - 1; i >= 0; --i) {
+      removeRow(rowOf(nodes[i]));
     }
   }
 }
@@ -587,7 +806,7 @@ void LedgerTransactionCache::onScheduleModified(Schedule* s) {
     // Check if list of occurences have changed, remove or add in consequence.
     QList<QDate> next = nextOccurrences(s);
     QList<QDate> add;
-    QList<int> remove;
+    QList<BalanceTree::Node*> remove;
 
     // Find new occurrences and occurrences that are not valid anymore
     auto i_cur = next.begin();
@@ -601,7 +820,7 @@ void LedgerTransactionCache::onScheduleModified(Schedule* s) {
         ++i_cur;
       } else if (i_cur == next.end() || *i_cur > i_prev.key())  // Old, remove
       {
-        remove << *i_prev;
+        remove << i_prev.value();
         ++i_prev;
       } else {
         ++i_cur;
@@ -609,24 +828,15 @@ void LedgerTransactionCache::onScheduleModified(Schedule* s) {
       }
     }
 
-    int min_row = m_cache.count();
-
     // First remove
     for (int i = remove.count() - 1; i >= 0; --i) {
-      min_row = std::min(min_row, remove[i]);
-      removeRow(remove[i], add.isEmpty() && i == 0);
+      removeRow(rowOf(remove[i]));
     }
 
     // Then add
     for (const QDate& d : add) {
-      min_row = std::min(
-          min_row,
-          addItem(CacheItem(s, d, m_controller->subRowCount(s->transaction())),
-                  false));
+      addItem(CacheItem(s, d, m_controller->subRowCount(s->transaction())));
     }
-
-    reloadBalanceAndIndexFrom(
-        min_row);  // Nothing will happen if we did not move rows around.
   }
 }
 
@@ -635,18 +845,14 @@ void LedgerTransactionCache::onScheduleOccurrenceEnteredOrCanceled(
   // Check if we have it somewhere
   if (m_scheduleIndex.contains(s->id()) &&
       m_scheduleIndex[s->id()].contains(_instanceDate)) {
-    // Remove it...
-    removeRow(m_scheduleIndex[s->id()].take(_instanceDate));
+    // Remove it... This also removes it from the index.
+    removeRow(rowOf(m_scheduleIndex[s->id()].value(_instanceDate)));
 
     // Check if the display policy is the number of instances, in which case we
     // may need to show more instances.
     if (m_displayPolicy == ScheduleDisplayPolicy::FixedNumber) {
       onScheduleModified(s);
     }
-
-    if (m_scheduleIndex[s->id()].isEmpty()) {
-      m_scheduleIndex.remove(s->id());
-    }
   }
 }
 }  // namespace KLib
@@ -4,41 +4,80 @@
 #include <QDate>
 #include <QHash>
 #include <QList>
+#include <QSet>
 #include <functional>
 #include "../../amount.h"
 #include "../../model/transaction.h"
 #include "../../model/schedule.h"
+#include "../../model/ledger.h"
+#include "../../util/balances.h"
+#include "../../util/runningsumtree.h"
 
 namespace KLib
 {
     class LedgerController;
 
+    typedef RunningSumTree<Balances> BalanceTree;
+
     struct CacheItem
     {
         CacheItem(Transaction* _tr, int _cachedSubRowCount) :
             schedule(nullptr),
+            balanceNode(nullptr),
             cachedSubRowCount(_cachedSubRowCount),
+            pending(false),
             m_transaction(_tr) {}
 
         CacheItem(Schedule* _schedule, const QDate& _date, int _cachedSubRowCount) :
             schedule(_schedule),
             dueDate(_date),
+            balanceNode(nullptr),
             cachedSubRowCount(_cachedSubRowCount),
+            pending(false),
             m_transaction(nullptr) {}
 
-        const Transaction* transaction() const { return schedule ? schedule->transaction() : m_transaction; }
-        const QDate& date() const { return schedule ? dueDate : m_transaction->date(); }
-
-        Transaction* editableTransaction() { return m_transaction; }
+        /**
+         * @brief Item of a windowed cache, for a transaction that may not be materialized yet.
+         *
+         * Its sub-row count is unknown and it is not sorted in its date until it is materialized
+         * (see LedgerTransactionCache::prefetch()).
+         */
+        CacheItem(const TransactionRef& _tr, const QDate& _date) :
+            schedule(nullptr),
+            balanceNode(nullptr),
+            cachedSubRowCount(0),
+            pending(true),
+            m_transaction(_tr),
+            m_date(_date) {}
+
+        const Transaction* transaction() const { return schedule ? schedule->transaction() : m_transaction.get(); }
+
+        /**
+         * @brief For a transaction that is not materialized, the date it has in the ledger.
+         */
+        QDate date() const
+        {
+            return schedule ? dueDate
+                            : m_transaction.isMaterialized() ? m_transaction->date() : m_date;
+        }
+
+        Transaction* editableTransaction() { return m_transaction.get(); }
+
+        /**
+         * @brief Id of the transaction of a non-schedule item, without materializing it
+         */
+        int transactionId() const { return m_transaction.id(); }
 
         Schedule* schedule;
         QDate dueDate;
-        Balances runningBalance;
+        BalanceTree::Node* balanceNode; ///< Weight of the item in the running balance, and handle of its row
 
         int cachedSubRowCount;
+        bool pending;   ///< In a windowed cache, if the item has not been materialized yet
 
     private:
-        Transaction* m_transaction;
+        TransactionRef m_transaction;
+        QDate m_date;
 
     };
 
@@ -61,6 +100,14 @@ namespace KLib
      *
      * We want O(1) index access. Other things may be slower, but should still be efficient. Keep in mind that
      * most changes occur at the end of the list.
+     *
+     * The weights of the rows are kept in a BalanceTree, in the order of the rows: adding, removing or moving a
+     * row is O(log n), and the running balance of a row is computed in O(log n) when it is displayed. The
+     * indexes of transactions and schedules keep the tree nodes, whose rows are found with positionOf().
+     *
+     * Large ledgers are cached in windowed mode: reloadData() builds the rows from the ledger's dates,
+     * references and weights, without materializing the transactions. The rows of a date are sorted, and
+     * their sub-rows counted, when the view reaches them (see prefetch()) or when they are modified.
      */
     class LedgerTransactionCache : public QObject
     {
@@ -83,7 +130,7 @@ namespace KLib
             const_reference operator[](int _index) const { return currentList()[_index]; }
             reference       operator[](int _index)       { return currentList()[_index]; }
 
-            const Balances& balanceAt(int _index) const { return currentList()[_index].runningBalance; }
+            Balances balanceAt(int _index) const { return m_balances.sumTo(currentList()[_index].balanceNode); }
 
             bool    isEmpty() const { return currentList().isEmpty(); }
             int     count() const   { return currentList().count(); }
@@ -103,12 +150,34 @@ namespace KLib
 
             void reloadData();
 
+            /**
+             * @brief In windowed mode, materializes the rows from _first to _last, and PREFETCH_MARGIN rows
+             * around them.
+             */
+            void prefetch(int _first, int _last);
+
+            bool isWindowed() const { return m_windowed; }
+
+            /**
+             * @brief Ledgers with at least this number of transactions are cached in windowed mode.
+             */
+            static const int WINDOWED_MIN_COUNT;
+            static const int PREFETCH_MARGIN;
+
+            /**
+             * @brief Number of transactions added at once (see LedgerManager::addTransactions()) after which the
+             * cache is reloaded instead of inserting them one by one.
+             */
+            static const int RELOAD_AFTER_ADDED;
+
         private slots:
             //Transaction signals
             void onSplitAdded(const Transaction::Split& _split, Transaction* _tr);
             void onSplitRemoved(const Transaction::Split& _split, Transaction* _tr);
             void onSplitAmountChanged(const Transaction::Split& _split, Transaction* _tr);
             void onTransactionDateChanged(Transaction* _tr, const QDate& _old);
+            void onTransactionsAdded(const QList<KLib::Transaction*>& _transactions, const QSet<int>& _idAccounts);
+            void onChangesCommitted(const KLib::ModelDelta& _delta);
 
             //Schedule signals
             void onScheduleAdded(Schedule* s);
@@ -118,23 +187,46 @@ namespace KLib
             void onScheduleOccurrenceEnteredOrCanceled(Schedule* s, const QDate& _instanceDate);
 
         private:
-            void reloadBalanceAndIndexFrom(int _from);
+            /**
+             * @brief Recomputes the weight of the item at _row in the running balance.
+             */
+            void setRowWeight(int _row);
+
+            /**
+             * @brief setRowWeight() of _row, then of the rows after it whose weight depends on the balance before
+             * them (see LedgerController::cacheBalanceIsRelative()).
+             */
+            void updateBalance(int _row);
+            void updateRelativeRowsFrom(int _row);
+
+            void addToIndex(int _row);
+
+            /**
+             * @brief Row of _idTransaction, materialized, or -1 if it is not in the cache
+             */
+            int transactionRow(int _idTransaction);
+
+            /**
+             * @brief Sorts the rows of the date of _row and materializes them. Returns the last row of the date.
+             */
+            int materializeDate(int _row);
+            int rowOf(const BalanceTree::Node* _node) const { return m_balances.positionOf(_node); }
 
             int cachedSubRowCount(int _cacheRow) const;
 
             /**
              * @brief Adds an item and returns the row of the inserted item.
              */
-            int addItem(const CacheItem& _item, bool _reloadIndex = true);
+            int addItem(const CacheItem& _item);
 
             /// @todo: Remove and modify should also work on the filters...
-            void removeRow(int _row, bool _reloadIndex = true);
+            void removeRow(int _row);
 
             /**
              * @brief Checks if the item at _row is at the correct location, if not, replaces it correctly.
              * @param _row
              */
-            void replaceItemAt(int _row, const QDate& _oldDate = QDate(), bool _reloadIndex = true);
+            void replaceItemAt(int _row, const QDate& _oldDate = QDate());
 
 
             void updateRow(int _row);
@@ -147,8 +239,11 @@ namespace KLib
 
             LedgerController* m_controller;
 
-            QHash<int, int>                m_transactionIndex;  ///< Transaction ID, Row
-            QHash<int, QMap<QDate, int> >  m_scheduleIndex;     ///< Schedule ID, (Date, Row)
+            QHash<int, BalanceTree::Node*>                m_transactionIndex;  ///< Transaction ID, Row
+            QHash<int, QMap<QDate, BalanceTree::Node*> >  m_scheduleIndex;     ///< Schedule ID, (Date, Row)
+
+            BalanceTree m_balances;
+            QSet<BalanceTree::Node*> m_relativeNodes; ///< Rows whose weight depends on the balance before them
 
             QHash<int, int> m_cacheToFilteredMap; ///< index in cache, index in filtered cache
 
@@ -159,6 +254,9 @@ namespace KLib
             bool m_filterIsApplied;
             fn_filter m_filterFunction;
 
+            bool m_windowed;
+            int m_pendingCount;             ///< Number of items not materialized yet
+
             ScheduleDisplayPolicy m_displayPolicy;
             int m_displayPolicyCount;     ///< Either num of days in future or number
                                           ///< of fixed occurences depending on policy
@@ -252,11 +252,13 @@ namespace KLib
                 pi->addToParent(cur);
             }
 
-            for (ExchangePair::Rate r : p->rates())
+            PriceSeries::View rates = p->series().all();
+
+            for (int i = 0; i < rates.size(); ++i)
             {
                 PriceItem* ri = new PriceItem(PriceItem::Rate);
-                ri->date = r.first;
-                ri->value = r.second;
+                ri->date = rates.dateAt(i);
+                ri->value = rates.valueAt(i);
 
                 ri->addToParent(pi);
             }
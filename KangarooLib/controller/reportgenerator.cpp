@@ -1,9 +1,7 @@
 #include "reportgenerator.h"
-#include "io.h"
+#include "reporttemplate.h"
 
 #include <QDir>
-#include <QFile>
-#include <QTextStream>
 
 namespace KLib
 {
@@ -13,104 +11,12 @@ namespace KLib
 
     QString ReportGenerator::generateHtml(const QString& _inFile, const QString& _additionalStatement)
     {
-        QString fullCode;
-        QString currentStatement;
-        bool inCode = false;
-        QString buffer;
-        int lineNo = 1;
-
-        QFile file(_inFile);
-
-        if (!file.open(QIODevice::ReadOnly))
-        {
-            throw IOException(QObject::tr("Unable to open the report file: %1").arg(file.errorString()));
-        }
-
-        QTextStream stream(&file);
-
-        //Parse the text and transform all blocks not in code tags into print statements.
-        while (!stream.atEnd())
-        {
-            buffer += stream.read(1);
-
-            if (buffer.length() == 1)
-                continue;   //Wait to read at least 2 characters
-
-            if (buffer == TAG_BEGIN_CODE)
-            {
-                if (inCode)
-                {
-                    throw IOException(QObject::tr("Parse error: Unexpected begin tag at line %1.").arg(lineNo));
-                }
-
-                currentStatement.replace("\\", "\\\\");
-                currentStatement.replace("\"", "\\\"");
-                currentStatement.replace("\n", "\\n\" + \n \"");   //Replace end of lines with " + \n "
-                fullCode += "print(\"" + currentStatement + "\");\n";
-                currentStatement.clear();
-                inCode = true;
-                buffer.clear();
-            }
-            else if (buffer == TAG_END_CODE)
-            {
-                if (!inCode)
-                {
-                    throw IOException(QObject::tr("Parse error: Unexpected end tag at line %1.").arg(lineNo));
-                }
-
-                fullCode += currentStatement + "\n";
-                currentStatement.clear();
-                inCode = false;
-                buffer.clear();
-            }
-            else    //Add the previous character to the statement, keep the second in the buffer.
-            {
-                if (buffer[0] == '\n') ++lineNo;
-
-                currentStatement += buffer[0];
-                buffer = buffer[1];
-            }
-        }
-
-        currentStatement += buffer; //Add the last statement to the buffer.
-
-        //Add the last statement to the code
-        if (inCode)
-        {
-            fullCode += currentStatement + "\n";
-        }
-        else
-        {
-            currentStatement.replace("\\", "\\\\");
-            currentStatement.replace("\"", "\\\"");
-            currentStatement.replace("\n", "\\n\" + \n \"");   //Replace end of lines with " + \n "
-            fullCode += "print(\"" + currentStatement + "\");\n";
-        }
-
-        file.close();
-
-        //qDebug() << fullCode;
-
-        //Generate the HTML code
-        QString output;
-
-//        if (!ScriptEngine::instance()->execute(_additionalStatement + fullCode, output))
-//        {
-//            throw IOException(QObject::tr("An error has occured while executing the script:\n%1").arg(output));
-//        }
-
-        //Return the HTML code
-        return output;
-
-//        file.setFileName(_outFile);
-
-//        if (!file.open(QIODevice::WriteOnly))
-//        {
-//            throw IOException(QObject::tr("Unable to open the output file: %1").arg(file.errorString()));
-//        }
+        return ReportTemplate::compile(_inFile)->generate(QVariantMap(), _additionalStatement);
+    }
 
-//        stream << output;
-//        file.close();
+    QString ReportGenerator::generateHtml(const QString& _inFile, const QVariantMap& _parameters)
+    {
+        return ReportTemplate::compile(_inFile)->generate(_parameters);
     }
 
 //    bool ReportGenerator::generatePDF(const QString& _inFile, const QString& _dir)
@@ -21,14 +21,27 @@
 #define REPORTGENERATOR_H
 
 #include <QString>
+#include <QVariantMap>
 
 namespace KLib {
 
 class ReportGenerator {
  public:
+  /**
+   * @brief Generates the report _inFile, compiled once and cached (see
+   * ReportTemplate).
+   * @param _additionalStatement Code evaluated before the report, such as the
+   * declaration of its settings.
+   */
   static QString generateHtml(const QString& _inFile,
                               const QString& _additionalStatement = QString());
 
+  /**
+   * @brief Same as above, each key of _parameters is a variable of the report.
+   */
+  static QString generateHtml(const QString& _inFile,
+                              const QVariantMap& _parameters);
+
   /**
    * @brief generatePDF Generates a PDF file in the same directory as _inFile,
    * with the same name but .pdf extension.
@@ -0,0 +1,129 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "reportjob.h"
+
+#include <QtConcurrent>
+#include <functional>
+
+#include "../model/ledger.h"
+#include "../model/modelexception.h"
+#include "../model/modelsnapshot.h"
+#include "../model/transactionsearch.h"
+#include "io.h"
+#include "reporttemplate.h"
+
+namespace KLib {
+
+ReportJob::ReportJob(QObject* _parent)
+    : QObject(_parent), m_cancel(0), m_done(false) {
+  connect(&m_watcher, &QFutureWatcher<QString>::finished, this,
+          &ReportJob::onWorkersFinished);
+}
+
+ReportJob::~ReportJob() {
+  m_cancel.store(1);
+  m_watcher.waitForFinished();
+}
+
+ReportJob* ReportJob::start(const QString& _file,
+                            const QList<QVariantMap>& _parameters,
+                            const QString& _prelude, QObject* _parent) {
+  LedgerManager::instance()->prepareConcurrentReads();
+  TransactionSearch::instance()->prepare();
+
+  ReportJob* job = new ReportJob(_parent);
+  job->m_snapshot = ModelSnapshot::take();
+
+  std::function<QString(const QVariantMap&)> run =
+      [job, _file, _prelude](const QVariantMap& _params) {
+        return job->run(_file, _params, _prelude);
+      };
+
+  job->m_watcher.setFuture(QtConcurrent::mapped(_parameters, run));
+  return job;
+}
+
+ReportJob* ReportJob::start(const QString& _file, const QString& _prelude,
+                            QObject* _parent) {
+  return start(_file, QList<QVariantMap>() << QVariantMap(), _prelude,
+               _parent);
+}
+
+void ReportJob::cancel() {
+  if (m_watcher.isRunning()) {
+    m_cancel.store(1);
+  }
+}
+
+void ReportJob::waitForFinished() {
+  m_watcher.waitForFinished();
+  onWorkersFinished();
+}
+
+QString ReportJob::run(const QString& _file, const QVariantMap& _parameters,
+                       const QString& _prelude) {
+  if (m_cancel.load()) {
+    return QString();
+  }
+
+  QString error;
+  ModelSnapshot::setCurrent(m_snapshot);
+
+  try {
+    QString output = ReportTemplate::compile(_file)->generate(
+        _parameters, _prelude, &m_cancel);
+    ModelSnapshot::setCurrent(ModelSnapshot());
+    return output;
+  } catch (const IOException& e) {
+    error = e.description();
+  } catch (const ModelException& e) {
+    error = e.description();
+  }
+
+  ModelSnapshot::setCurrent(ModelSnapshot());
+  QMutexLocker locker(&m_errorMutex);
+
+  if (m_error.isEmpty()) {
+    m_error = error;
+    m_cancel.store(1);
+  }
+
+  return QString();
+}
+
+void ReportJob::onWorkersFinished() {
+  // Also called by waitForFinished(), before the watcher notifies
+  if (m_done) {
+    return;
+  }
+
+  m_done = true;
+
+  if (!m_error.isEmpty()) {
+    emit failed(m_error);
+  } else if (m_cancel.load()) {
+    emit cancelled();
+  } else {
+    m_outputs = m_watcher.future().results();
+    emit finished(m_outputs);
+  }
+}
+
+}  // namespace KLib
@@ -0,0 +1,130 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef REPORTJOB_H
+#define REPORTJOB_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+#include "../model/modelsnapshot.h"
+
+namespace KLib {
+
+/**
+ * @brief Generates a report on worker threads, and delivers the result to the
+ * thread that started it.
+ *
+ * A job generates the same template once per set of parameters (for example,
+ * once per period), concurrently, on the global thread pool. Each worker
+ * thread has its own script engine (see ReportTemplate). Several jobs can run
+ * at the same time.
+ *
+ * start() takes a snapshot of the model (see ModelSnapshot), which the runs
+ * read: the accounts, ledgers, rates and payees of the scripts (see
+ * ReportTemplate), the aggregation queries and the valuations are those of the
+ * model as it was when the job started. The model can be modified while the
+ * job runs. Transaction searches (see TransactionSearch) read their own
+ * indexes, which start() builds, and see the model as it is when they run.
+ *
+ * Exactly one of finished(), failed() or cancelled() is emitted.
+ */
+class ReportJob : public QObject {
+  Q_OBJECT
+
+ public:
+  /**
+   * @brief Starts generating _file once for each of _parameters. Must be
+   * called from the thread of the model.
+   * @param _prelude Code evaluated before the template, for all the runs.
+   */
+  static ReportJob* start(const QString& _file,
+                          const QList<QVariantMap>& _parameters,
+                          const QString& _prelude = QString(),
+                          QObject* _parent = nullptr);
+
+  /**
+   * @brief Starts generating _file once, see above.
+   */
+  static ReportJob* start(const QString& _file, const QString& _prelude,
+                          QObject* _parent = nullptr);
+
+  /**
+   * @brief Cancels the job and waits for the workers to stop.
+   */
+  ~ReportJob();
+
+  /**
+   * @brief Aborts the runs at their next output. cancelled() is emitted when
+   * they have stopped. Does nothing if the job is done.
+   */
+  void cancel();
+
+  bool isCancelled() const { return m_cancel.load(); }
+  bool isRunning() const { return m_watcher.isRunning(); }
+
+  /**
+   * @brief Blocks until the workers are done, and emits finished(), failed()
+   * or cancelled() before returning.
+   */
+  void waitForFinished();
+
+  /**
+   * @brief Output of each set of parameters, once finished() is emitted
+   */
+  const QStringList& outputs() const { return m_outputs; }
+  const QString& error() const { return m_error; }
+
+ signals:
+  void finished(const QStringList& _outputs);
+  void failed(const QString& _error);
+  void cancelled();
+
+ private slots:
+  void onWorkersFinished();
+
+ private:
+  explicit ReportJob(QObject* _parent);
+
+  /**
+   * @brief Generates one run, on a worker thread. The first error cancels the
+   * other runs.
+   */
+  QString run(const QString& _file, const QVariantMap& _parameters,
+              const QString& _prelude);
+
+  ModelSnapshot m_snapshot;
+  QAtomicInt m_cancel;
+  QFutureWatcher<QString> m_watcher;
+  bool m_done;  ///< If the result signal was emitted
+
+  QMutex m_errorMutex;
+  QString m_error;
+
+  QStringList m_outputs;
+};
+
+}  // namespace KLib
+
+#endif  // REPORTJOB_H
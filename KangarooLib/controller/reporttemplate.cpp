@@ -0,0 +1,459 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "reporttemplate.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QScriptEngine>
+#include <QScriptProgram>
+#include <QTextStream>
+#include <QThreadStorage>
+
+#include "../amount.h"
+#include "../model/account.h"
+#include "../model/accountvaluation.h"
+#include "../model/aggregationquery.h"
+#include "../model/ledger.h"
+#include "../model/modelsnapshot.h"
+#include "../model/payee.h"
+#include "../model/pricemanager.h"
+#include "../model/snapshotobjects.h"
+#include "../model/transaction.h"
+#include "../model/transactionsearch.h"
+#include "io.h"
+#include "reportgenerator.h"
+
+namespace KLib {
+
+namespace {
+struct Output {
+  const QStringList* texts;
+  const QAtomicInt* cancel;
+  QString buffer;
+
+  /**
+   * Aborts the evaluation if the generation is cancelled
+   */
+  bool cancelled(QScriptEngine* _engine) const {
+    if (cancel && cancel->load()) {
+      _engine->abortEvaluation();
+      return true;
+    }
+
+    return false;
+  }
+};
+
+/**
+ * Script engine of a thread, with the programs it has compiled by path
+ */
+struct ThreadEngine {
+  QScriptEngine engine;
+  QHash<QString, QPair<QDateTime, QScriptProgram>> programs;
+};
+
+QThreadStorage<ThreadEngine*> threadEngines;
+
+// Cancel flag of the generation running on each thread
+thread_local const QAtomicInt* currentCancel = nullptr;
+
+/*
+ * Objects of the model that reports use, as the .kreport files of Kangaroo
+ * expect them: "new Account()" is the top level account, "new PriceManager()"
+ * and "new PayeeManager()" are the managers, amounts are numbers, and
+ * Locale.toNum() formats a number. When a snapshot is current (in a ReportJob),
+ * the accounts and managers are those of the snapshot (see snapshotobjects.h),
+ * so the scripts never read the live model from their thread.
+ */
+
+template <class T>
+QScriptValue qobjectToScript(QScriptEngine* _engine, T* const& _object) {
+  return _engine->newQObject(_object);
+}
+
+template <class T>
+void qobjectFromScript(const QScriptValue& _value, T*& _object) {
+  _object = qobject_cast<T*>(_value.toQObject());
+}
+
+QScriptValue amountToScript(QScriptEngine*, const Amount& _amount) {
+  return QScriptValue(_amount.toDouble());
+}
+
+void amountFromScript(const QScriptValue& _value, Amount& _amount) {
+  _amount = Amount(_value.toNumber());
+}
+
+QScriptValue accountChildren(QScriptContext* _context,
+                             QScriptEngine* _engine) {
+  Account* a = qobject_cast<Account*>(_context->thisObject().toQObject());
+
+  if (!a) {
+    return _context->throwError(QScriptContext::TypeError,
+                                "getChildren() of a non account");
+  }
+
+  const std::vector<Account*>& children = a->getChildren();
+  QScriptValue array = _engine->newArray(children.size());
+
+  for (std::size_t i = 0; i < children.size(); ++i) {
+    array.setProperty(i, _engine->toScriptValue(children[i]));
+  }
+
+  return array;
+}
+
+QScriptValue accountToScript(QScriptEngine* _engine, Account* const& _account) {
+  if (!_account) {
+    return QScriptValue(QScriptValue::NullValue);
+  }
+
+  QScriptValue object = _engine->newQObject(_account);
+  object.setProperty("getChildren", _engine->newFunction(&accountChildren));
+  return object;
+}
+
+QScriptValue constructTopLevel(QScriptContext*, QScriptEngine* _engine) {
+  const ModelSnapshot snapshot = ModelSnapshot::current();
+
+  if (!snapshot.isNull()) {
+    return SnapshotAccount::toScript(_engine, snapshot, snapshot.topLevelId());
+  }
+
+  return _engine->toScriptValue(Account::getTopLevel());
+}
+
+QScriptValue constructPriceManager(QScriptContext*, QScriptEngine* _engine) {
+  const ModelSnapshot snapshot = ModelSnapshot::current();
+
+  if (!snapshot.isNull()) {
+    return _engine->newQObject(new SnapshotPriceManager(snapshot),
+                               QScriptEngine::ScriptOwnership);
+  }
+
+  return _engine->newQObject(PriceManager::instance());
+}
+
+QScriptValue constructPayeeManager(QScriptContext*, QScriptEngine* _engine) {
+  const ModelSnapshot snapshot = ModelSnapshot::current();
+
+  if (!snapshot.isNull()) {
+    return _engine->newQObject(new SnapshotPayeeManager(snapshot),
+                               QScriptEngine::ScriptOwnership);
+  }
+
+  return _engine->newQObject(PayeeManager::instance());
+}
+
+QScriptValue localeToNum(QScriptContext* _context, QScriptEngine*) {
+  const int decimals =
+      _context->argumentCount() > 1 ? _context->argument(1).toInt32() : 2;
+  return QLocale().toString(_context->argument(0).toNumber(), 'f', decimals);
+}
+
+void addModelToEngine(QScriptEngine* _engine) {
+  qScriptRegisterMetaType<Amount>(_engine, &amountToScript, &amountFromScript);
+  qScriptRegisterMetaType<Account*>(_engine, &accountToScript,
+                                    &qobjectFromScript<Account>);
+  qScriptRegisterMetaType<Ledger*>(_engine, &qobjectToScript<Ledger>,
+                                   &qobjectFromScript<Ledger>);
+  qScriptRegisterMetaType<Payee*>(_engine, &qobjectToScript<Payee>,
+                                  &qobjectFromScript<Payee>);
+  qScriptRegisterMetaType<Transaction*>(_engine, &qobjectToScript<Transaction>,
+                                        &qobjectFromScript<Transaction>);
+
+  QScriptValue global = _engine->globalObject();
+  global.setProperty("Account", _engine->newFunction(&constructTopLevel));
+  global.setProperty("PriceManager",
+                     _engine->newFunction(&constructPriceManager));
+  global.setProperty("PayeeManager",
+                     _engine->newFunction(&constructPayeeManager));
+
+  QScriptValue locale = _engine->newObject();
+  locale.setProperty("toNum", _engine->newFunction(&localeToNum));
+  global.setProperty("Locale", locale);
+}
+}  // namespace
+
+const QString ReportTemplate::FUNCTION_TEXT = "__kreport_text";
+
+QHash<QString, QSharedPointer<const ReportTemplate>> ReportTemplate::m_cache;
+QMutex ReportTemplate::m_cacheMutex;
+ReportTemplate::fn_initializer ReportTemplate::m_initializer;
+
+ReportTemplate::ReportTemplate(const QString& _path,
+                               const QDateTime& _lastModified)
+    : m_path(_path), m_lastModified(_lastModified), m_sizeHint(0) {}
+
+QSharedPointer<const ReportTemplate> ReportTemplate::compile(
+    const QString& _file) {
+  QFileInfo info(_file);
+  const QString path = info.absoluteFilePath();
+  const QDateTime lastModified = info.lastModified();
+
+  {
+    QMutexLocker locker(&m_cacheMutex);
+    QSharedPointer<const ReportTemplate> cached = m_cache.value(path);
+
+    if (cached && cached->m_lastModified == lastModified) {
+      return cached;
+    }
+  }
+
+  QFile file(path);
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    throw IOException(QObject::tr("Unable to open the report file: %1")
+                          .arg(file.errorString()));
+  }
+
+  QTextStream stream(&file);
+  QSharedPointer<ReportTemplate> compiled(
+      new ReportTemplate(path, lastModified));
+  compiled->parse(stream.readAll());
+
+  QMutexLocker locker(&m_cacheMutex);
+  m_cache[path] = compiled;
+  return compiled;
+}
+
+void ReportTemplate::clearCache() {
+  QMutexLocker locker(&m_cacheMutex);
+  m_cache.clear();
+}
+
+void ReportTemplate::setEngineInitializer(fn_initializer _initializer) {
+  QMutexLocker locker(&m_cacheMutex);
+  m_initializer = _initializer;
+}
+
+void ReportTemplate::parse(const QString& _source) {
+  const QString& beginTag = ReportGenerator::TAG_BEGIN_CODE;
+  const QString& endTag = ReportGenerator::TAG_END_CODE;
+
+  auto lineAt = [&_source](int _pos) {
+    return _source.leftRef(_pos).count('\n') + 1;
+  };
+
+  QString program;
+  int pos = 0;
+  int line = 1;  // Line of the template at pos
+  bool inCode = false;
+
+  m_lineMap = {line};
+
+  for (;;) {
+    // The next tag must close the current block
+    const QString& expected = inCode ? endTag : beginTag;
+    const QString& unexpected = inCode ? beginTag : endTag;
+
+    int next = _source.indexOf(expected, pos);
+    const int stray = _source.indexOf(unexpected, pos);
+
+    if (stray != -1 && (next == -1 || stray < next)) {
+      throw IOException(
+          inCode
+              ? QObject::tr("Parse error: Unexpected begin tag at line %1.")
+                    .arg(lineAt(stray))
+              : QObject::tr("Parse error: Unexpected end tag at line %1.")
+                    .arg(lineAt(stray)));
+    }
+
+    if (next == -1) {
+      next = _source.size();
+    }
+
+    const QStringRef block = _source.midRef(pos, next - pos);
+
+    if (inCode) {
+      for (QChar c : block) {
+        program += c;
+
+        if (c == '\n') {
+          m_lineMap << ++line;
+        }
+      }
+
+      program += '\n';
+      m_lineMap << line;
+    } else if (!block.isEmpty()) {
+      program += QString("%1(%2);").arg(FUNCTION_TEXT).arg(m_texts.size());
+      m_texts << block.toString();
+
+      // Keep the code that follows on its own line, for the line numbers
+      if (const int lines = block.count('\n')) {
+        line += lines;
+        program += '\n';
+        m_lineMap << line;
+      }
+    }
+
+    if (next == _source.size()) {
+      break;
+    }
+
+    pos = next + expected.size();
+    inCode = !inCode;
+  }
+
+  const QScriptSyntaxCheckResult result = QScriptEngine::checkSyntax(program);
+
+  if (result.state() != QScriptSyntaxCheckResult::Valid) {
+    throw IOException(QObject::tr("Parse error: %1 at line %2.")
+                          .arg(result.errorMessage())
+                          .arg(templateLine(result.errorLineNumber())));
+  }
+
+  m_program = program;
+}
+
+int ReportTemplate::templateLine(int _scriptLine) const {
+  return _scriptLine >= 1 && _scriptLine <= m_lineMap.size()
+             ? m_lineMap[_scriptLine - 1]
+             : _scriptLine;
+}
+
+QString ReportTemplate::generate(const QVariantMap& _parameters,
+                                 const QString& _prelude,
+                                 const QAtomicInt* _cancel) const {
+  if (!threadEngines.hasLocalData()) {
+    ThreadEngine* threadEngine = new ThreadEngine();
+    addModelToEngine(&threadEngine->engine);
+    AggregationQuery::addToEngine(&threadEngine->engine);
+    AccountValuation::addToEngine(&threadEngine->engine);
+    TransactionSearch::addToEngine(&threadEngine->engine);
+
+    fn_initializer initializer;
+
+    {
+      QMutexLocker locker(&m_cacheMutex);
+      initializer = m_initializer;
+    }
+
+    if (initializer) {
+      initializer(&threadEngine->engine);
+    }
+
+    threadEngines.setLocalData(threadEngine);
+  }
+
+  ThreadEngine* threadEngine = threadEngines.localData();
+  QScriptEngine& engine = threadEngine->engine;
+
+  // Compiled by the engine the first time it is evaluated.
+  QPair<QDateTime, QScriptProgram>& program = threadEngine->programs[m_path];
+
+  if (program.second.isNull() || program.first != m_lastModified) {
+    program = qMakePair(m_lastModified, QScriptProgram(m_program, m_path));
+  }
+
+  Output output = {&m_texts, _cancel, QString()};
+  output.buffer.reserve(m_sizeHint.load());
+
+  // The parameters and the output functions are local to this generation
+  QScriptValue locals = engine.pushContext()->activationObject();
+  locals.setProperty("print",
+                     engine.newFunction(&ReportTemplate::print, &output));
+  locals.setProperty(FUNCTION_TEXT,
+                     engine.newFunction(&ReportTemplate::printText, &output));
+
+  for (auto i = _parameters.begin(); i != _parameters.end(); ++i) {
+    locals.setProperty(i.key(), engine.toScriptValue(i.value()));
+  }
+
+  QString error;
+  const QAtomicInt* previousCancel = currentCancel;
+  currentCancel = _cancel;
+
+  if (!_prelude.isEmpty()) {
+    engine.evaluate(_prelude);
+
+    if (engine.hasUncaughtException()) {
+      error =
+          QObject::tr("An error has occured while executing the script:\n%1")
+              .arg(engine.uncaughtException().toString());
+    }
+  }
+
+  if (error.isEmpty()) {
+    engine.evaluate(program.second);
+
+    if (engine.hasUncaughtException()) {
+      error =
+          QObject::tr(
+              "An error has occured while executing the script at line "
+              "%1:\n%2")
+              .arg(templateLine(engine.uncaughtExceptionLineNumber()))
+              .arg(engine.uncaughtException().toString());
+    }
+  }
+
+  engine.popContext();
+  currentCancel = previousCancel;
+
+  if (!error.isEmpty()) {
+    engine.clearExceptions();
+    throw IOException(error);
+  } else if (_cancel && _cancel->load()) {
+    return QString();
+  }
+
+  if (output.buffer.size() > m_sizeHint.load()) {
+    m_sizeHint.store(output.buffer.size());
+  }
+
+  return output.buffer;
+}
+
+const QAtomicInt* ReportTemplate::cancelFlag() { return currentCancel; }
+
+QScriptValue ReportTemplate::print(QScriptContext* _context,
+                                   QScriptEngine* _engine, void* _output) {
+  Output* output = static_cast<Output*>(_output);
+  QString& buffer = output->buffer;
+
+  if (output->cancelled(_engine)) {
+    return QScriptValue();
+  }
+
+  for (int i = 0; i < _context->argumentCount(); ++i) {
+    if (i > 0) {
+      buffer += ' ';
+    }
+
+    buffer += _context->argument(i).toString();
+  }
+
+  return QScriptValue();
+}
+
+QScriptValue ReportTemplate::printText(QScriptContext* _context,
+                                       QScriptEngine* _engine, void* _output) {
+  Output* output = static_cast<Output*>(_output);
+
+  if (output->cancelled(_engine)) {
+    return QScriptValue();
+  }
+
+  output->buffer += output->texts->at(_context->argument(0).toInt32());
+  return QScriptValue();
+}
+}  // namespace KLib
@@ -0,0 +1,155 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef REPORTTEMPLATE_H
+#define REPORTTEMPLATE_H
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+#include <functional>
+
+class QScriptContext;
+class QScriptEngine;
+class QScriptValue;
+
+namespace KLib {
+
+/**
+ * @brief A .kreport template, tokenized and compiled once.
+ *
+ * The blocks of text outside of the code tags are kept as they are, and the
+ * program only refers to them by index: running the template appends them to
+ * the output buffer, without escaping or concatenating strings in the script.
+ * print() also appends to the output buffer, which is preallocated to the size
+ * of the largest output of the template so far.
+ *
+ * Compiled templates are cached by file, and recompiled when the file is
+ * modified. A template is immutable once compiled: it can be generated any
+ * number of times, with different parameters, and from several threads. Each
+ * thread has its own script engine, which keeps the programs it has compiled.
+ * A generation runs in its own context: the variables declared with var do
+ * not outlive it.
+ *
+ * The engines have these globals: Account (its constructor returns the top
+ * level account, and accounts have getChildren()), PriceManager and
+ * PayeeManager (their constructors return the managers), Locale.toNum(number,
+ * decimals = 2), AggregationQuery, AccountValuation and TransactionSearch.
+ * Amounts are numbers. When a ModelSnapshot is current on the thread, as in a
+ * ReportJob, the accounts, ledgers and managers are read from the snapshot.
+ */
+class ReportTemplate {
+ public:
+  typedef std::function<void(QScriptEngine*)> fn_initializer;
+
+  /**
+   * @brief Returns the compiled template of _file, from the cache if _file has
+   * not been modified since it was compiled.
+   *
+   * @throws IOException if the file cannot be read or has a parse or syntax
+   * error.
+   */
+  static QSharedPointer<const ReportTemplate> compile(const QString& _file);
+
+  /**
+   * @brief Removes all the compiled templates from the cache
+   */
+  static void clearCache();
+
+  /**
+   * @brief Sets a function that adds more objects to the script engine of
+   * each thread, after the ones that are always added (see the class
+   * documentation). Must be set before the first generation.
+   */
+  static void setEngineInitializer(fn_initializer _initializer);
+
+  /**
+   * @brief Runs the template and returns its output.
+   * @param _parameters Each key is added as a global variable of the script,
+   * with its value. Ex: {"Settings": {"year": 2015}}.
+   * @param _prelude Code that is evaluated before the template, for parameters
+   * that are built as code.
+   * @param _cancel If *_cancel becomes non-zero, the script is aborted at its
+   * next output and a null string is returned. May be set from any thread.
+   *
+   * @throws IOException if an error occurs while executing the script.
+   */
+  QString generate(const QVariantMap& _parameters = QVariantMap(),
+                   const QString& _prelude = QString(),
+                   const QAtomicInt* _cancel = nullptr) const;
+
+  /**
+   * @brief Cancel flag of the generation running on this thread, nullptr if
+   * none. The long native calls of the scripts (see AggregationQuery) check it,
+   * since the script itself only checks it at its outputs.
+   */
+  static const QAtomicInt* cancelFlag();
+
+  const QString& path() const { return m_path; }
+  const QDateTime& lastModified() const { return m_lastModified; }
+
+  /**
+   * @brief Number of blocks of text outside of code tags
+   */
+  int textCount() const { return m_texts.size(); }
+
+  /**
+   * @brief Name of the function that outputs a block of text in the program
+   */
+  static const QString FUNCTION_TEXT;
+
+ private:
+  ReportTemplate(const QString& _path, const QDateTime& _lastModified);
+
+  /**
+   * @brief Splits _source in text and code blocks, and builds the program.
+   */
+  void parse(const QString& _source);
+
+  /**
+   * @brief Line of the template of the line _scriptLine of the program.
+   */
+  int templateLine(int _scriptLine) const;
+
+  static QScriptValue print(QScriptContext* _context, QScriptEngine* _engine,
+                            void* _output);
+  static QScriptValue printText(QScriptContext* _context,
+                                QScriptEngine* _engine, void* _output);
+
+  QString m_path;
+  QDateTime m_lastModified;
+
+  QStringList m_texts;
+  QString m_program;
+  QVector<int> m_lineMap;  ///< Line in the template of each program line
+
+  mutable QAtomicInt m_sizeHint;  ///< Largest output so far
+
+  static QHash<QString, QSharedPointer<const ReportTemplate>> m_cache;
+  static QMutex m_cacheMutex;
+  static fn_initializer m_initializer;
+};
+}  // namespace KLib
+
+#endif  // REPORTTEMPLATE_H
@@ -20,6 +20,10 @@
 #ifndef IFILEMANAGER_H
 #define IFILEMANAGER_H
 
+#include <QBuffer>
+#include <QByteArray>
+#include <QVariant>
+
 #include "../model/stored.h"
 
 class QIODevice;
@@ -37,6 +41,29 @@ class IFileManager : public IStored {
   virtual void loadFile(const QString& _name, QIODevice* _file) = 0;
   virtual void saveFiles(Archive& _archive) = 0;
 
+  /**
+   * @brief Decodes the content of file _name. Called on a worker thread,
+   * concurrently for many files: it must not modify the manager.
+   *
+   * The result is passed to loadDecodedFile(), on the main thread. By default,
+   * the data is not decoded.
+   */
+  virtual QVariant decodeFile(const QString& _name,
+                              const QByteArray& _data) const {
+    Q_UNUSED(_name)
+    return _data;
+  }
+
+  /**
+   * @brief Loads a file decoded by decodeFile(). By default, calls loadFile().
+   */
+  virtual void loadDecodedFile(const QString& _name, const QVariant& _decoded) {
+    QByteArray data = _decoded.toByteArray();
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    loadFile(_name, &buffer);
+  }
+
   void load(QXmlStreamReader& _reader) { Q_UNUSED(_reader) }
   void save(QXmlStreamWriter& _writer) const { Q_UNUSED(_writer) }
 
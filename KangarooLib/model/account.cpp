@@ -21,6 +21,8 @@
 
 #include <QStack>
 #include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <algorithm>
 
 #include "../controller/io.h"
 #include "../ui/core.h"
@@ -858,36 +860,7 @@ void Account::load(QXmlStreamReader& _reader) {
 
 void Account::rec_load(QXmlStreamReader& _reader, Account* _parent) {
   QXmlStreamAttributes attributes = _reader.attributes();
-
-  m_id = IO::getAttribute("id", attributes).toInt();
-  m_type = IO::getAttribute("type", attributes).toInt();
-  m_name = IO::getAttribute("name", attributes);
-  m_mainCurrency = IO::getAttribute("currency", attributes);
-  m_code = IO::getOptAttribute("code", attributes);
-  m_note = IO::getOptAttribute("note", attributes);
-  m_isPlaceholder = IO::getAttribute("placeholder", attributes) == "true";
-  m_isOpen = IO::getAttribute("open", attributes) == "true";
-  m_idInstitution =
-      IO::getOptAttribute("institution", attributes, Constants::NO_ID).toInt();
-  m_idPicture =
-      IO::getOptAttribute("picture", attributes, Constants::NO_ID).toInt();
-  m_idSecurity =
-      IO::getOptAttribute("security", attributes, Constants::NO_ID).toInt();
-  m_idDefaultDividendAccount =
-      IO::getOptAttribute("dividendaccount", attributes, Constants::NO_ID)
-          .toInt();
-
-  const QStringList clist =
-      IO::getOptAttribute("secondarycurrencies", attributes, "")
-          .split(',', Qt::SkipEmptyParts);
-
-  m_secondaryCurrencies.clear();
-
-  for (const QString& c : clist) {
-    m_secondaryCurrencies.insert(c);
-  }
-
-  m_nextId = std::max(m_nextId, m_id + 1);
+  loadFields(attributes);
 
   m_parent = _parent;
 
@@ -921,6 +894,48 @@ void Account::rec_load(QXmlStreamReader& _reader, Account* _parent) {
 void Account::save(QXmlStreamWriter& _writer) const { this->rec_save(_writer); }
 
 void Account::rec_save(QXmlStreamWriter& _writer) const {
+  saveFields(_writer);
+
+  for (Account* a : m_children) {
+    _writer.writeStartElement(StdTags::ACCOUNT);
+    a->rec_save(_writer);
+    _writer.writeEndElement();
+  }
+}
+
+void Account::loadFields(QXmlStreamAttributes& _attributes) {
+  m_id = IO::getAttribute("id", _attributes).toInt();
+  m_type = IO::getAttribute("type", _attributes).toInt();
+  m_name = IO::getAttribute("name", _attributes);
+  m_mainCurrency = IO::getAttribute("currency", _attributes);
+  m_code = IO::getOptAttribute("code", _attributes);
+  m_note = IO::getOptAttribute("note", _attributes);
+  m_isPlaceholder = IO::getAttribute("placeholder", _attributes) == "true";
+  m_isOpen = IO::getAttribute("open", _attributes) == "true";
+  m_idInstitution =
+      IO::getOptAttribute("institution", _attributes, Constants::NO_ID).toInt();
+  m_idPicture =
+      IO::getOptAttribute("picture", _attributes, Constants::NO_ID).toInt();
+  m_idSecurity =
+      IO::getOptAttribute("security", _attributes, Constants::NO_ID).toInt();
+  m_idDefaultDividendAccount =
+      IO::getOptAttribute("dividendaccount", _attributes, Constants::NO_ID)
+          .toInt();
+
+  const QStringList clist =
+      IO::getOptAttribute("secondarycurrencies", _attributes, "")
+          .split(',', Qt::SkipEmptyParts);
+
+  m_secondaryCurrencies.clear();
+
+  for (const QString& c : clist) {
+    m_secondaryCurrencies.insert(c);
+  }
+
+  m_nextId = std::max(m_nextId, m_id + 1);
+}
+
+void Account::saveFields(QXmlStreamWriter& _writer) const {
   _writer.writeAttribute("id", QString::number(m_id));
   _writer.writeAttribute("type", QString::number(m_type));
   _writer.writeAttribute("name", m_name);
@@ -937,11 +952,153 @@ void Account::rec_save(QXmlStreamWriter& _writer) const {
   _writer.writeAttribute("dividendaccount",
                          QString::number(m_idDefaultDividendAccount));
   m_properties->save(_writer);
+}
 
-  for (Account* a : m_children) {
-    _writer.writeStartElement(StdTags::ACCOUNT);
-    a->rec_save(_writer);
-    _writer.writeEndElement();
+void Account::saveObjects(const QList<int>& _ids,
+                          QXmlStreamWriter& _writer) const {
+  for (int id : _ids) {
+    Account* a = m_accounts.value(id);
+
+    if (a) {
+      _writer.writeStartElement(StdTags::ACCOUNT);
+      if (a->m_parent) {
+        _writer.writeAttribute("parent", QString::number(a->m_parent->m_id));
+      }
+      a->saveFields(_writer);
+      _writer.writeEndElement();
+    } else {
+      _writer.writeEmptyElement(StdTags::REMOVED);
+      _writer.writeAttribute("id", QString::number(id));
+    }
+  }
+}
+
+void Account::restoreObjects(QXmlStreamReader& _reader) {
+  // The accounts of a record can be in any order: read them all before
+  // attaching them to their parents, which may be in the same record.
+  QList<QPair<Account*, int>> restored;
+  QSet<Account*> created;
+  QList<int> removed;
+
+  while (_reader.readNextStartElement()) {
+    QXmlStreamAttributes attributes = _reader.attributes();
+    const int id = IO::getAttribute("id", attributes).toInt();
+
+    if (_reader.name() == StdTags::REMOVED) {
+      removed << id;
+      _reader.skipCurrentElement();
+      continue;
+    }
+
+    Account* a = m_accounts.value(id);
+    const bool wasPlaceholder = a ? a->m_isPlaceholder : true;
+
+    if (!a) {
+      a = new Account();
+      created.insert(a);
+    }
+
+    a->loadFields(attributes);
+    restored << qMakePair(
+        a, IO::getOptAttribute("parent", attributes, Constants::NO_ID).toInt());
+    m_accounts[id] = a;
+
+    bool hasProperties = false;
+    while (_reader.readNextStartElement()) {
+      if (_reader.name() == StdTags::PROPERTIES) {
+        a->m_properties->load(_reader);
+        hasProperties = true;
+      } else {
+        _reader.skipCurrentElement();
+      }
+    }
+
+    if (!hasProperties) {
+      a->m_properties->clear();
+    }
+
+    // Same as setIsPlaceholder(), the ledgers of new accounts are created by
+    // setupAccount().
+    if (!created.contains(a) && wasPlaceholder != a->m_isPlaceholder) {
+      if (!a->m_isPlaceholder) {
+        a->m_ledger = new Ledger(a);
+        LedgerManager::instance()->addAccount(a);
+      } else {
+        a->m_isPlaceholder = false;
+        LedgerManager::instance()->removeAccount(a);
+        a->m_ledger->deleteLater();
+        a->m_ledger = nullptr;
+        a->m_isPlaceholder = true;
+      }
+    }
+  }
+
+  for (const QPair<Account*, int>& r : restored) {
+    Account* a = r.first;
+
+    if (r.second == Constants::NO_ID) {
+      continue;  // Top level
+    }
+
+    Account* parent = m_accounts.value(r.second);
+
+    if (!parent) {
+      throw IOException(
+          tr("Invalid account in the journal: %1").arg(a->m_id));
+    }
+
+    if (a->m_parent != parent) {
+      if (a->m_parent) {
+        std::vector<Account*>& siblings = a->m_parent->m_children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), a));
+      }
+
+      a->m_parent = parent;
+      parent->m_children.push_back(a);
+    }
+
+    if (parent == m_topLevel && a->m_type == AccountType::TRADING) {
+      m_topLevel->m_topTradingAccount = a;
+    }
+
+    if (created.contains(a)) {
+      setupAccount(a);
+    }
+  }
+
+  for (int id : removed) {
+    Account* a = m_accounts.value(id);
+
+    if (!a || !a->m_parent) {
+      continue;
+    }
+
+    std::vector<Account*>& siblings = a->m_parent->m_children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), a));
+
+    // Removed along with their children, as removeChild() does
+    QStack<Account*> stack;
+    stack.push(a);
+
+    while (!stack.isEmpty()) {
+      Account* cur = stack.pop();
+
+      for (Account* c : cur->m_children) {
+        stack.push(c);
+      }
+
+      if (!cur->m_isPlaceholder) {
+        LedgerManager::instance()->removeAccount(cur);
+      }
+
+      if (m_topLevel->m_topTradingAccount == cur) {
+        m_topLevel->m_topTradingAccount = nullptr;
+      }
+
+      m_accounts.remove(cur->m_id);
+    }
+
+    delete a;
   }
 }
 
@@ -983,6 +1140,14 @@ void Account::setupTopLevel() {
   m_topLevel->m_mainCurrency = Constants::DEFAULT_CURRENCY_CODE;
   m_accounts[m_topLevel->m_id] = m_topLevel;
 
+  // Before modified(), which is emitted after each of these
+  auto objectModified = [](Account* a) {
+    emit m_topLevel->objectModified(a->id());
+  };
+  connect(m_topLevel, &Account::accountAdded, m_topLevel, objectModified);
+  connect(m_topLevel, &Account::accountModified, m_topLevel, objectModified);
+  connect(m_topLevel, &Account::accountRemoved, m_topLevel, objectModified);
+
   connect(m_topLevel, SIGNAL(accountModified(KLib::Account*)), m_topLevel,
           SIGNAL(modified()));
 
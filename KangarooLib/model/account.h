@@ -320,6 +320,11 @@ class Account : public IStored {
   void save(QXmlStreamWriter& _writer) const override;
   void unload() override;
 
+  bool journalsObjects() const override { return true; }
+  void saveObjects(const QList<int>& _ids,
+                   QXmlStreamWriter& _writer) const override;
+  void restoreObjects(QXmlStreamReader& _reader) override;
+
  private slots:
   void onPropertiesModified();
 
@@ -333,6 +338,9 @@ class Account : public IStored {
   void rec_load(QXmlStreamReader& _reader, Account* _parent);
   void rec_save(QXmlStreamWriter& _writer) const;
 
+  void loadFields(QXmlStreamAttributes& _attributes);
+  void saveFields(QXmlStreamWriter& _writer) const;
+
   int m_type;
 
   QString m_name;
@@ -0,0 +1,289 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "accountvaluation.h"
+
+#include <QScriptEngine>
+
+#include "account.h"
+#include "ledger.h"
+#include "modelexception.h"
+#include "pricemanager.h"
+#include "snapshotobjects.h"
+
+namespace KLib {
+
+AccountValuation::AccountValuation(const QVector<QDate>& _dates,
+                                   QObject* _parent)
+    : QObject(_parent),
+      m_dates(_dates),
+      m_snapshot(ModelSnapshot::current()) {
+  for (int i = 0; i < m_dates.size(); ++i) {
+    if (!m_dates[i].isValid() || (i > 0 && m_dates[i] <= m_dates[i - 1])) {
+      ModelException::throwException(
+          tr("The valuation dates must be valid and increasing."), nullptr);
+    }
+  }
+}
+
+void AccountValuation::compute(const QList<Account*>& _accounts) {
+  for (Account* a : _accounts) {
+    tree(a->id());
+  }
+}
+
+QVector<Amount> AccountValuation::treeValues(const Account* _account) {
+  return tree(_account->id()).at;
+}
+
+QVector<Amount> AccountValuation::values(const Account* _account) {
+  return own(_account->id()).at;
+}
+
+Amount AccountValuation::treeValueAt(const Account* _account, int _i) {
+  checkIndex(_i);
+  return tree(_account->id()).at[_i];
+}
+
+Amount AccountValuation::treeValueBetween(const Account* _account, int _i) {
+  checkIndex(_i);
+  return tree(_account->id()).between[_i];
+}
+
+Amount AccountValuation::valueAt(const Account* _account, int _i) {
+  checkIndex(_i);
+  return own(_account->id()).at[_i];
+}
+
+Amount AccountValuation::valueBetween(const Account* _account, int _i) {
+  checkIndex(_i);
+  return own(_account->id()).between[_i];
+}
+
+Amount AccountValuation::treeValueAt(QObject* _account, int _i) {
+  checkIndex(_i);
+  return tree(accountId(_account)).at[_i];
+}
+
+Amount AccountValuation::treeValueBetween(QObject* _account, int _i) {
+  checkIndex(_i);
+  return tree(accountId(_account)).between[_i];
+}
+
+Amount AccountValuation::valueAt(QObject* _account, int _i) {
+  checkIndex(_i);
+  return own(accountId(_account)).at[_i];
+}
+
+Amount AccountValuation::valueBetween(QObject* _account, int _i) {
+  checkIndex(_i);
+  return own(accountId(_account)).between[_i];
+}
+
+const AccountValuation::Values& AccountValuation::own(int _id) {
+  auto i = m_own.constFind(_id);
+  if (i != m_own.constEnd()) {
+    return *i;
+  }
+
+  return *m_own.insert(_id,
+                       m_snapshot.isNull()
+                           ? ownLive(Account::getTopLevel()->account(_id))
+                           : ownSnapshot(_id));
+}
+
+AccountValuation::Values AccountValuation::ownLive(
+    const Account* _account) const {
+  const int n = m_dates.size();
+  const QString& topCurrency = Account::getTopLevel()->mainCurrency();
+
+  Values v;
+  v.at.fill(0, n);
+  v.between.fill(0, n);
+
+  Ledger* ledger = _account->ledger();
+
+  if (ledger && ledger->count()) {
+    QVector<Balances> balances = ledger->balancesAt(m_dates);
+    QVector<double> rates;
+
+    if (_account->mainCurrency().isEmpty()) {  // Security
+      rates = PriceManager::instance()->rates(_account->idSecurity(),
+                                              topCurrency, m_dates);
+    } else if (_account->mainCurrency() != topCurrency) {
+      rates = PriceManager::instance()->rates(_account->mainCurrency(),
+                                              topCurrency, m_dates);
+    }
+
+    const bool negate = Account::negativeDebits(_account->type());
+
+    for (int d = 0; d < n; ++d) {
+      Amount at = ledger->balanceIn(balances[d], QString(), m_dates[d]);
+      Amount between = ledger->balanceIn(
+          d ? balances[d] - balances[d - 1] : balances[d], QString(),
+          m_dates[d]);
+
+      if (negate) {
+        at *= -1;
+        between *= -1;
+      }
+
+      if (!rates.isEmpty()) {
+        at = at * rates[d];
+        between = between * rates[d];
+      }
+
+      v.at[d] = at;
+      v.between[d] = between;
+    }
+  }
+
+  return v;
+}
+
+AccountValuation::Values AccountValuation::ownSnapshot(int _id) const {
+  const int n = m_dates.size();
+  const ModelSnapshot::AccountInfo* a = m_snapshot.account(_id);
+  const QString& topCurrency =
+      m_snapshot.account(m_snapshot.topLevelId())->mainCurrency;
+
+  Values v;
+  v.at.fill(0, n);
+  v.between.fill(0, n);
+
+  if (m_snapshot.ledger(_id)) {
+    QVector<Balances> balances = m_snapshot.balancesAt(_id, m_dates);
+    const bool negate = Account::negativeDebits(a->type);
+
+    for (int d = 0; d < n; ++d) {
+      Amount at = m_snapshot.balanceIn(_id, balances[d], QString(), m_dates[d]);
+      Amount between = m_snapshot.balanceIn(
+          _id, d ? balances[d] - balances[d - 1] : balances[d], QString(),
+          m_dates[d]);
+
+      if (negate) {
+        at *= -1;
+        between *= -1;
+      }
+
+      if (a->mainCurrency.isEmpty()) {  // Security
+        const double rate =
+            m_snapshot.rate(a->idSecurity, topCurrency, m_dates[d]);
+        at = at * rate;
+        between = between * rate;
+      } else if (a->mainCurrency != topCurrency) {
+        const double rate =
+            m_snapshot.rate(a->mainCurrency, topCurrency, m_dates[d]);
+        at = at * rate;
+        between = between * rate;
+      }
+
+      v.at[d] = at;
+      v.between[d] = between;
+    }
+  }
+
+  return v;
+}
+
+const AccountValuation::Values& AccountValuation::tree(int _id) {
+  auto i = m_tree.constFind(_id);
+  if (i != m_tree.constEnd()) {
+    return *i;
+  }
+
+  Values v = own(_id);
+  QVector<int> children;
+
+  if (m_snapshot.isNull()) {
+    const Account* a = Account::getTopLevel()->account(_id);
+
+    for (const Account* c : a->getChildren()) {
+      children << c->id();
+    }
+  } else {
+    children = m_snapshot.account(_id)->children;
+  }
+
+  for (int c : children) {
+    const Values& child = tree(c);
+
+    for (int d = 0; d < m_dates.size(); ++d) {
+      v.at[d] += child.at[d];
+      v.between[d] += child.between[d];
+    }
+  }
+
+  return *m_tree.insert(_id, v);
+}
+
+namespace {
+QScriptValue constructAccountValuation(QScriptContext* _context,
+                                       QScriptEngine* _engine) {
+  const QVariantList list = _context->argument(0).toVariant().toList();
+  QVector<QDate> dates;
+  dates.reserve(list.size());
+
+  for (const QVariant& v : list) {
+    const QDate date = v.toDate();
+
+    if (!date.isValid() || (!dates.isEmpty() && date <= dates.last())) {
+      return _context->throwError(
+          QScriptContext::RangeError,
+          AccountValuation::tr(
+              "The valuation dates must be valid and increasing."));
+    }
+
+    dates << date;
+  }
+
+  return _engine->newQObject(new AccountValuation(dates),
+                             QScriptEngine::ScriptOwnership);
+}
+}  // namespace
+
+void AccountValuation::addToEngine(QScriptEngine* _engine) {
+  _engine->globalObject().setProperty(
+      "AccountValuation",
+      _engine->newQMetaObject(
+          &AccountValuation::staticMetaObject,
+          _engine->newFunction(&constructAccountValuation)));
+}
+
+void AccountValuation::checkIndex(int _i) const {
+  if (_i < 0 || _i >= m_dates.size()) {
+    ModelException::throwException(tr("Invalid date index %1").arg(_i),
+                                   nullptr);
+  }
+}
+
+int AccountValuation::accountId(const QObject* _account) const {
+  const int id = SnapshotAccount::idOf(_account);
+  const bool exists = m_snapshot.isNull()
+                          ? Account::getTopLevel()->account(id) != nullptr
+                          : m_snapshot.account(id) != nullptr;
+
+  if (!exists) {
+    ModelException::throwException(tr("Invalid account"), nullptr);
+  }
+
+  return id;
+}
+
+}  // namespace KLib
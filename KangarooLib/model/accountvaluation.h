@@ -0,0 +1,140 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef ACCOUNTVALUATION_H
+#define ACCOUNTVALUATION_H
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QVector>
+
+#include "../amount.h"
+#include "../interfaces/scriptable.h"
+#include "modelsnapshot.h"
+
+class QScriptEngine;
+
+namespace KLib {
+
+class Account;
+
+/**
+ * @brief Values of accounts and of their subtrees on many dates, in the main
+ * currency of the top level account.
+ *
+ * The values of an account are computed once, for all the dates: each ledger
+ * is read in a single pass (see Ledger::balancesAt()), and the rates of each
+ * currency are looked up once per date. The value of a subtree is the sum of
+ * the values of its children, which are kept and reused.
+ *
+ * Values at date i are as Account::treeValueAt(dates[i]). Values between date
+ * i-1 and date i are as Account::treeValueBetween(dates[i-1] + 1, dates[i]),
+ * and from the first transaction for i = 0.
+ *
+ * If the thread has a current snapshot when the valuation is created (see
+ * ModelSnapshot::current()), the ledgers and rates are read from it instead of
+ * the live model.
+ *
+ * In scripts (see addToEngine()):
+ * @code
+ * var valuation = new AccountValuation([new Date(2015, 0, 31),
+ *                                       new Date(2015, 1, 28)]);
+ * var value = valuation.treeValueAt(account, 1);
+ * @endcode
+ */
+class AccountValuation : public QObject {
+  Q_OBJECT
+  K_SCRIPTABLE(AccountValuation)
+
+  Q_PROPERTY(int dateCount READ dateCount)
+
+ public:
+  /**
+   * @param _dates Valid dates in increasing order
+   */
+  explicit AccountValuation(const QVector<QDate>& _dates,
+                            QObject* _parent = nullptr);
+
+  int dateCount() const { return m_dates.size(); }
+  const QVector<QDate>& dates() const { return m_dates; }
+
+  /**
+   * @brief Values the subtrees of _accounts. Values are otherwise computed
+   * on demand.
+   */
+  void compute(const QList<Account*>& _accounts);
+
+  /**
+   * @brief Values of the subtree of _account at each date
+   */
+  QVector<Amount> treeValues(const Account* _account);
+
+  /**
+   * @brief Values of the ledger of _account only at each date
+   */
+  QVector<Amount> values(const Account* _account);
+
+  Amount treeValueAt(const Account* _account, int _i);
+  Amount treeValueBetween(const Account* _account, int _i);
+  Amount valueAt(const Account* _account, int _i);
+  Amount valueBetween(const Account* _account, int _i);
+
+  /**
+   * @brief The same for scripts: _account is an account of the live model or
+   * of the snapshot (see SnapshotAccount).
+   */
+  Q_INVOKABLE KLib::Amount treeValueAt(QObject* _account, int _i);
+  Q_INVOKABLE KLib::Amount treeValueBetween(QObject* _account, int _i);
+  Q_INVOKABLE KLib::Amount valueAt(QObject* _account, int _i);
+  Q_INVOKABLE KLib::Amount valueBetween(QObject* _account, int _i);
+
+  /**
+   * @brief Adds the AccountValuation constructor to _engine. Its argument is
+   * the array of dates.
+   */
+  static void addToEngine(QScriptEngine* _engine);
+
+ private:
+  struct Values {
+    QVector<Amount> at;       ///< Value at each date
+    QVector<Amount> between;  ///< Value of the changes since the previous date
+  };
+
+  const Values& own(int _id);
+  const Values& tree(int _id);
+
+  Values ownLive(const Account* _account) const;
+  Values ownSnapshot(int _id) const;
+
+  void checkIndex(int _i) const;
+  int accountId(const QObject* _account) const;
+
+  QVector<QDate> m_dates;
+  ModelSnapshot m_snapshot;
+  QHash<int, Values> m_own;
+  QHash<int, Values> m_tree;
+};
+
+}  // namespace KLib
+
+Q_DECLARE_METATYPE(KLib::AccountValuation*)
+
+#endif  // ACCOUNTVALUATION_H
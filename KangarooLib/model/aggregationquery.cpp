@@ -0,0 +1,398 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "aggregationquery.h"
+
+#include <QScriptEngine>
+#include <QSet>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
+
+#include "../controller/reporttemplate.h"
+#include "account.h"
+#include "ledger.h"
+#include "modelexception.h"
+#include "modelsnapshot.h"
+#include "pricemanager.h"
+#include "snapshotobjects.h"
+
+namespace KLib {
+
+const int AggregationQuery::PARALLEL_MIN_COUNT = 8;
+
+AggregationQuery::AggregationQuery(QObject* _parent)
+    : QObject(_parent), m_includeChildren(true), m_parallel(true) {}
+
+QString AggregationQuery::currency() const {
+  if (!m_currency.isEmpty()) {
+    return m_currency;
+  }
+
+  const ModelSnapshot snapshot = ModelSnapshot::current();
+  return snapshot.isNull()
+             ? Account::getTopLevel()->mainCurrency()
+             : snapshot.account(snapshot.topLevelId())->mainCurrency;
+}
+
+QVector<QVector<Amount>> AggregationQuery::between(
+    const QList<const Account*>& _accounts, const QVector<QDate>& _from,
+    const QVector<QDate>& _to) const {
+  QList<int> ids;
+
+  for (const Account* a : _accounts) {
+    ids << a->id();
+  }
+
+  return betweenIds(ids, _from, _to);
+}
+
+QVector<QVector<Amount>> AggregationQuery::betweenIds(
+    const QList<int>& _ids, const QVector<QDate>& _from,
+    const QVector<QDate>& _to) const {
+  if (_from.size() != _to.size()) {
+    ModelException::throwException(
+        tr("There must be as many start dates as end dates."), nullptr);
+  }
+
+  // The days needed by the periods: their last days and the days before them
+  QVector<QDate> dates;
+
+  for (int i = 0; i < _to.size(); ++i) {
+    if (!_to[i].isValid() || (_from[i].isValid() && _from[i] > _to[i])) {
+      ModelException::throwException(tr("Invalid period %1").arg(i),
+                                     nullptr);
+    }
+
+    dates << _to[i];
+
+    if (_from[i].isValid()) {
+      dates << _from[i].addDays(-1);
+    }
+  }
+
+  std::sort(dates.begin(), dates.end());
+  dates.erase(std::unique(dates.begin(), dates.end()), dates.end());
+
+  auto indexOf = [&dates](const QDate& _date) {
+    return int(std::lower_bound(dates.begin(), dates.end(), _date) -
+               dates.begin());
+  };
+
+  QVector<int> fromIdx(_to.size());
+  QVector<int> toIdx(_to.size());
+
+  for (int i = 0; i < _to.size(); ++i) {
+    fromIdx[i] = _from[i].isValid() ? indexOf(_from[i].addDays(-1)) : -1;
+    toIdx[i] = indexOf(_to[i]);
+  }
+
+  // The accounts whose ledgers are read, from the snapshot of the thread if
+  // there is one.
+  const ModelSnapshot snapshot = ModelSnapshot::current();
+  QHash<int, QVector<int>> children;
+  QList<int> ledgers;
+  QHash<int, const Account*> live;
+
+  std::function<void(const Account*)> collect = [&](const Account* _a) {
+    if (children.contains(_a->id())) {
+      return;
+    }
+
+    QVector<int>& ids = children[_a->id()];
+
+    if (_a->ledger()) {
+      ledgers << _a->id();
+      live[_a->id()] = _a;
+    }
+
+    if (m_includeChildren) {
+      for (const Account* c : _a->getChildren()) {
+        ids << c->id();
+        collect(c);
+      }
+    }
+  };
+
+  std::function<void(int)> collectSnapshot = [&](int _id) {
+    const ModelSnapshot::AccountInfo* a = snapshot.account(_id);
+
+    if (children.contains(_id) || !a) {
+      return;
+    }
+
+    children[_id] = m_includeChildren ? a->children : QVector<int>();
+
+    if (snapshot.ledger(_id)) {
+      ledgers << _id;
+    }
+
+    for (int c : children[_id]) {
+      collectSnapshot(c);
+    }
+  };
+
+  for (int id : _ids) {
+    if (snapshot.isNull()) {
+      collect(Account::getTopLevel()->account(id));
+    } else {
+      collectSnapshot(id);
+    }
+  }
+
+  // Each task only reads its own ledger. Once the report is cancelled, the
+  // remaining ledgers are skipped: the output is discarded anyway.
+  const QString cur = currency();
+  const QAtomicInt* cancel = ReportTemplate::cancelFlag();
+  std::function<QVector<Amount>(int)> read = [&](int _id) {
+    if (cancel && cancel->load()) {
+      return QVector<Amount>(_to.size(), 0);
+    } else if (snapshot.isNull()) {
+      return ownBalances(live.value(_id), dates, fromIdx, toIdx, cur);
+    }
+
+    return ownBalances(snapshot, _id, dates, fromIdx, toIdx, cur);
+  };
+
+  QList<QVector<Amount>> balances;
+
+  if (m_parallel && ledgers.size() >= PARALLEL_MIN_COUNT) {
+    balances = QtConcurrent::mapped(ledgers, read).results();
+  } else {
+    for (int id : ledgers) {
+      balances << read(id);
+    }
+  }
+
+  QHash<int, QVector<Amount>> own;
+
+  for (int i = 0; i < ledgers.size(); ++i) {
+    own[ledgers[i]] = balances[i];
+  }
+
+  // Sum the subtrees
+  QHash<int, QVector<Amount>> trees;
+
+  std::function<QVector<Amount>(int)> tree = [&](int _id) {
+    auto i = trees.constFind(_id);
+    if (i != trees.constEnd()) {
+      return *i;
+    }
+
+    QVector<Amount> v = own.value(_id, QVector<Amount>(_to.size(), 0));
+
+    for (int c : children.value(_id)) {
+      const QVector<Amount> child = tree(c);
+
+      for (int p = 0; p < v.size(); ++p) {
+        v[p] += child[p];
+      }
+    }
+
+    return *trees.insert(_id, v);
+  };
+
+  QVector<QVector<Amount>> result;
+  result.reserve(_ids.size());
+
+  for (int id : _ids) {
+    result << tree(id);
+  }
+
+  return result;
+}
+
+QVector<QVector<Amount>> AggregationQuery::at(
+    const QList<const Account*>& _accounts,
+    const QVector<QDate>& _dates) const {
+  return between(_accounts, QVector<QDate>(_dates.size()), _dates);
+}
+
+QVariantList AggregationQuery::balancesBetween(const QVariantList& _accounts,
+                                               const QVariantList& _from,
+                                               const QVariantList& _to) const {
+  return toVariant(
+      betweenIds(toIds(_accounts), toDates(_from), toDates(_to)));
+}
+
+QVariantList AggregationQuery::balancesAt(const QVariantList& _accounts,
+                                          const QVariantList& _dates) const {
+  const QVector<QDate> dates = toDates(_dates);
+  return toVariant(
+      betweenIds(toIds(_accounts), QVector<QDate>(dates.size()), dates));
+}
+
+QVector<Amount> AggregationQuery::ownBalances(const Account* _account,
+                                              const QVector<QDate>& _dates,
+                                              const QVector<int>& _fromIdx,
+                                              const QVector<int>& _toIdx,
+                                              const QString& _currency) const {
+  const int n = _toIdx.size();
+  QVector<Amount> result(n, 0);
+
+  Ledger* ledger = _account->ledger();
+
+  if (!ledger->count()) {
+    return result;
+  }
+
+  QVector<QDate> ends(n);
+
+  for (int p = 0; p < n; ++p) {
+    ends[p] = _dates[_toIdx[p]];
+  }
+
+  const QVector<Balances> balances = ledger->balancesAt(_dates);
+  QVector<double> rates;
+
+  if (_account->mainCurrency().isEmpty()) {  // Security
+    rates = PriceManager::instance()->rates(_account->idSecurity(), _currency,
+                                            ends);
+  } else if (_account->mainCurrency() != _currency) {
+    rates = PriceManager::instance()->rates(_account->mainCurrency(),
+                                            _currency, ends);
+  }
+
+  const bool negate = Account::negativeDebits(_account->type());
+
+  for (int p = 0; p < n; ++p) {
+    const Balances& to = balances[_toIdx[p]];
+    Amount a = ledger->balanceIn(
+        _fromIdx[p] == -1 ? to : to - balances[_fromIdx[p]], QString(),
+        ends[p]);
+
+    if (negate) {
+      a *= -1;
+    }
+
+    result[p] = rates.isEmpty() ? a : a * rates[p];
+  }
+
+  return result;
+}
+
+QVector<Amount> AggregationQuery::ownBalances(const ModelSnapshot& _snapshot,
+                                              int _id,
+                                              const QVector<QDate>& _dates,
+                                              const QVector<int>& _fromIdx,
+                                              const QVector<int>& _toIdx,
+                                              const QString& _currency) const {
+  const int n = _toIdx.size();
+  QVector<Amount> result(n, 0);
+
+  const ModelSnapshot::AccountInfo* a = _snapshot.account(_id);
+  const QVector<Balances> balances = _snapshot.balancesAt(_id, _dates);
+  const bool negate = Account::negativeDebits(a->type);
+
+  for (int p = 0; p < n; ++p) {
+    const QDate& end = _dates[_toIdx[p]];
+    const Balances& to = balances[_toIdx[p]];
+    Amount amount = _snapshot.balanceIn(
+        _id, _fromIdx[p] == -1 ? to : to - balances[_fromIdx[p]], QString(),
+        end);
+
+    if (negate) {
+      amount *= -1;
+    }
+
+    if (a->mainCurrency.isEmpty()) {  // Security
+      amount = amount * _snapshot.rate(a->idSecurity, _currency, end);
+    } else if (a->mainCurrency != _currency) {
+      amount = amount * _snapshot.rate(a->mainCurrency, _currency, end);
+    }
+
+    result[p] = amount;
+  }
+
+  return result;
+}
+
+QList<int> AggregationQuery::toIds(const QVariantList& _list) {
+  const ModelSnapshot snapshot = ModelSnapshot::current();
+  QList<int> ids;
+
+  for (const QVariant& v : _list) {
+    int id = v.toInt();
+
+    // Only the id of an account object is read: it never changes
+    if (v.canConvert<QObject*>()) {
+      id = SnapshotAccount::idOf(v.value<QObject*>());
+    }
+
+    const bool exists = snapshot.isNull()
+                            ? Account::getTopLevel()->account(id) != nullptr
+                            : snapshot.account(id) != nullptr;
+
+    if (!exists) {
+      ModelException::throwException(
+          tr("Invalid account: %1").arg(v.toString()), nullptr);
+    }
+
+    ids << id;
+  }
+
+  return ids;
+}
+
+QVector<QDate> AggregationQuery::toDates(const QVariantList& _list) {
+  QVector<QDate> dates;
+  dates.reserve(_list.size());
+
+  for (const QVariant& v : _list) {
+    dates << v.toDate();
+  }
+
+  return dates;
+}
+
+QVariantList AggregationQuery::toVariant(
+    const QVector<QVector<Amount>>& _matrix) {
+  QVariantList rows;
+  rows.reserve(_matrix.size());
+
+  for (const QVector<Amount>& r : _matrix) {
+    QVariantList row;
+    row.reserve(r.size());
+
+    for (const Amount& a : r) {
+      row << a.toDouble();
+    }
+
+    rows << QVariant(row);
+  }
+
+  return rows;
+}
+
+namespace {
+QScriptValue constructAggregationQuery(QScriptContext*, QScriptEngine* _engine) {
+  return _engine->newQObject(new AggregationQuery(),
+                             QScriptEngine::ScriptOwnership);
+}
+}  // namespace
+
+void AggregationQuery::addToEngine(QScriptEngine* _engine) {
+  _engine->globalObject().setProperty(
+      "AggregationQuery",
+      _engine->newQMetaObject(
+          &AggregationQuery::staticMetaObject,
+          _engine->newFunction(&constructAggregationQuery)));
+}
+
+}  // namespace KLib
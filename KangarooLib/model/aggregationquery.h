@@ -0,0 +1,186 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef AGGREGATIONQUERY_H
+#define AGGREGATIONQUERY_H
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QVariantList>
+#include <QVector>
+
+#include "../amount.h"
+#include "../interfaces/scriptable.h"
+
+class QScriptEngine;
+
+namespace KLib {
+
+class Account;
+class ModelSnapshot;
+
+/**
+ * @brief Balances of many accounts over many periods, converted to a single
+ * currency, in one call.
+ *
+ * This is the native query of the report scripts: a script asks for a whole
+ * matrix (one row per account, one column per period) and only formats it.
+ * Each ledger is read once for all the periods (see Ledger::balancesAt()), the
+ * rates of each currency are looked up once per period, and the ledgers are
+ * read in parallel.
+ *
+ * The balance of a period is converted at the rate of its last day. As in
+ * AccountValuation, the balances of accounts with negative debits (see
+ * Account::negativeDebits()) are negated.
+ *
+ * If the thread has a current snapshot (see ModelSnapshot::current()), the
+ * accounts, ledgers and rates are read from it instead of the live model. If
+ * the report being generated on the thread is cancelled (see
+ * ReportTemplate::cancelFlag()), the query stops reading the ledgers.
+ *
+ * In scripts:
+ * @code
+ * var q = new AggregationQuery();
+ * q.currency = "CAD";
+ * var m = q.balancesBetween([income, expenses], starts, ends);
+ * @endcode
+ */
+class AggregationQuery : public QObject {
+  Q_OBJECT
+  K_SCRIPTABLE(AggregationQuery)
+
+  Q_PROPERTY(QString currency READ currency WRITE setCurrency)
+  Q_PROPERTY(bool includeChildren READ includeChildren WRITE
+                 setIncludeChildren)
+  Q_PROPERTY(bool parallel READ parallel WRITE setParallel)
+
+ public:
+  explicit AggregationQuery(QObject* _parent = nullptr);
+
+  /**
+   * @brief Currency of the results. By default, the main currency of the top
+   * level account.
+   */
+  QString currency() const;
+  void setCurrency(const QString& _currency) { m_currency = _currency; }
+
+  /**
+   * @brief If the rows include the balances of the children of the accounts.
+   * True by default.
+   */
+  bool includeChildren() const { return m_includeChildren; }
+  void setIncludeChildren(bool _include) { m_includeChildren = _include; }
+
+  /**
+   * @brief If the ledgers are read in parallel. True by default.
+   */
+  bool parallel() const { return m_parallel; }
+  void setParallel(bool _parallel) { m_parallel = _parallel; }
+
+  /**
+   * @brief Balances of _accounts from _from[i] to _to[i], inclusively. An
+   * invalid _from[i] starts at the first transaction.
+   *
+   * @return One row per account, with one column per period.
+   */
+  QVector<QVector<Amount>> between(const QList<const Account*>& _accounts,
+                                   const QVector<QDate>& _from,
+                                   const QVector<QDate>& _to) const;
+
+  /**
+   * @brief Balances of _accounts at each of _dates.
+   */
+  QVector<QVector<Amount>> at(const QList<const Account*>& _accounts,
+                              const QVector<QDate>& _dates) const;
+
+  /**
+   * @brief between() for scripts: _accounts are accounts or account ids,
+   * _from and _to are dates. Returns an array of arrays of numbers.
+   */
+  Q_INVOKABLE QVariantList balancesBetween(const QVariantList& _accounts,
+                                           const QVariantList& _from,
+                                           const QVariantList& _to) const;
+
+  /**
+   * @brief at() for scripts, see balancesBetween().
+   */
+  Q_INVOKABLE QVariantList balancesAt(const QVariantList& _accounts,
+                                      const QVariantList& _dates) const;
+
+  /**
+   * @brief Adds the AggregationQuery constructor to _engine.
+   */
+  static void addToEngine(QScriptEngine* _engine);
+
+  /**
+   * @brief Minimum number of ledgers to read them in parallel
+   */
+  static const int PARALLEL_MIN_COUNT;
+
+ private:
+  /**
+   * @brief Balances of the ledger of _account only, for each period.
+   *
+   * _dates are the sorted days needed by the periods: period i is from
+   * _dates[_fromIdx[i]] (exclusively, -1 for the first transaction) to
+   * _dates[_toIdx[i]].
+   */
+  QVector<Amount> ownBalances(const Account* _account,
+                              const QVector<QDate>& _dates,
+                              const QVector<int>& _fromIdx,
+                              const QVector<int>& _toIdx,
+                              const QString& _currency) const;
+
+  /**
+   * @brief Same as above, from _snapshot.
+   */
+  QVector<Amount> ownBalances(const ModelSnapshot& _snapshot, int _id,
+                              const QVector<QDate>& _dates,
+                              const QVector<int>& _fromIdx,
+                              const QVector<int>& _toIdx,
+                              const QString& _currency) const;
+
+  /**
+   * @brief between() for account ids, which are looked up in the snapshot of
+   * the thread if there is one.
+   */
+  QVector<QVector<Amount>> betweenIds(const QList<int>& _ids,
+                                      const QVector<QDate>& _from,
+                                      const QVector<QDate>& _to) const;
+
+  /**
+   * @brief Ids of _list (accounts or account ids), checked against the
+   * snapshot of the thread if there is one.
+   */
+  static QList<int> toIds(const QVariantList& _list);
+  static QVector<QDate> toDates(const QVariantList& _list);
+  static QVariantList toVariant(const QVector<QVector<Amount>>& _matrix);
+
+  QString m_currency;
+  bool m_includeChildren;
+  bool m_parallel;
+};
+
+}  // namespace KLib
+
+Q_DECLARE_METATYPE(KLib::AggregationQuery*)
+
+#endif  // AGGREGATIONQUERY_H
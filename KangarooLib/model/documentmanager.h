@@ -96,6 +96,9 @@ namespace KLib
         void afterLoad();
         void unload();
 
+        //Documents are not QObjects, nothing to move after a concurrent load.
+        bool loadsConcurrently() const { return true; }
+
     private:
         QHash<int, Document*> m_documents;
 
@@ -209,6 +209,14 @@ void InstitutionManager::unload()
     m_nextId = 0;
 }
 
+void InstitutionManager::moveLoadedObjects(QThread* _thread)
+{
+    for (Institution* o : m_institutions)
+    {
+        o->moveToThread(_thread);
+    }
+}
+
 QStringList InstitutionManager::countries() const
 {
     QSet<QString> list;
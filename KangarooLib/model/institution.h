@@ -148,6 +148,9 @@ class InstitutionManager : public IStored
         void save(QXmlStreamWriter& _writer) const override;
         void unload() override;
 
+        bool loadsConcurrently() const override { return true; }
+        void moveLoadedObjects(QThread* _thread) override;
+
     private:
         QHash<int, int> m_index;
         QVector<Institution*> m_institutions;
@@ -27,6 +27,7 @@
 #include <QXmlStreamReader>
 #include <QLinkedList>
 #include <QDebug>
+#include <limits>
 
 namespace KLib
 {
@@ -100,6 +101,42 @@ namespace KLib
     }
 
 
+    void InvestmentLotsManager::addEvent(ILotAvailabilityCalculator* _event)
+    {
+        QVector<int> accounts = _event->investmentAccounts();
+
+        for (int i = 0; i < accounts.size(); ++i)
+        {
+            if (accounts.indexOf(accounts[i]) != i) //Transfer to the same account
+                continue;
+
+            LotStream*& stream = m_streams[accounts[i]];
+
+            if (!stream)
+            {
+                const int idAccount = accounts[i];
+                stream = new LotStream([idAccount] (Lots& _lots, ILotAvailabilityCalculator* const& _e)
+                                       {
+                                           _e->adjustAvailability(_lots, idAccount);
+                                       },
+                                       &ILotAvailabilityCalculator::cleanLots);
+            }
+
+            stream->insert(eventKey(_event), _event);
+        }
+    }
+
+    void InvestmentLotsManager::removeEvent(ILotAvailabilityCalculator* _event)
+    {
+        for (int idAccount : _event->investmentAccounts())
+        {
+            if (LotStream* stream = m_streams.value(idAccount, nullptr))
+            {
+                stream->remove(eventKey(_event), _event);
+            }
+        }
+    }
+
     InvestmentLotsManager::InvestmentLotsManager() :
         m_nextId(0)
     {
@@ -147,26 +184,22 @@ namespace KLib
                               _transaction->date());
 
                 m_indexLots[_transaction->id()] = lot;
-                m_available.insert(PriorityDate(_transaction->date(), lot->sortingPriority()), lot);
+                addEvent(lot);
                 m_lots[lot->idLot] = lot;
             }
             else
             {
-                //Check if the date changed
-                if (_transaction->date() != lot->transactionDate)
-                {
-                    m_available.remove(PriorityDate(lot->transactionDate, lot->sortingPriority()),
-                                       lot);
-                    m_available.insert(PriorityDate(_transaction->date(), lot->sortingPriority()),
-                                       lot);
-                    lot->transactionDate = _transaction->date();
-                }
+                removeEvent(lot);
 
+                lot->transactionDate = _transaction->date();
                 lot->action = _transaction->action();
                 lot->amount = investmentSplit.amount.abs();
                 lot->idInvestmentAccount = investmentSplit.idAccount;
+
+                addEvent(lot);
             }
 
+            emit objectModified(_transaction->id());
             emit modified();
             break;
         }
@@ -194,24 +227,20 @@ namespace KLib
                                                _transaction->date());
 
                 m_indexSplits[_transaction->id()] = split;
-                m_available.insert(PriorityDate(_transaction->date(), split->sortingPriority()), split);
+                addEvent(split);
             }
             else
             {
-                //Check if the date changed
-                if (_transaction->date() != split->transactionDate)
-                {
-                    m_available.remove(PriorityDate(split->transactionDate, split->sortingPriority()),
-                                       split);
-                    m_available.insert(PriorityDate(_transaction->date(), split->sortingPriority()),
-                                       split);
-                    split->transactionDate = _transaction->date();
-                }
+                removeEvent(split);
 
+                split->transactionDate = _transaction->date();
                 split->idInvestmentAccount = _transaction->idInvestmentAccount();
                 split->splitFraction = _transaction->splitFraction();
+
+                addEvent(split);
             }
 
+            emit objectModified(_transaction->id());
             emit modified();
 
             break;
@@ -248,9 +277,9 @@ namespace KLib
 
         if (current)
         {
-            m_available.remove(PriorityDate(current->transactionDate, current->sortingPriority()), current);
+            removeEvent(current);
             current->transactionDate = _transaction->date();
-            m_available.insert(PriorityDate(current->transactionDate, current->sortingPriority()), current);
+            addEvent(current);
         }
 
     }
@@ -260,41 +289,51 @@ namespace KLib
         if (!_transaction || _transaction->id() == Constants::NO_ID)
             return;
 
+        if (removeEntries(_transaction->id()))
+        {
+            emit objectModified(_transaction->id());
+            emit modified();
+        }
+    }
+
+    bool InvestmentLotsManager::removeEntries(int _idTransaction)
+    {
         ILotAvailabilityCalculator* object = nullptr;
 
-        if (m_indexLots.contains(_transaction->id()))
+        if (m_indexLots.contains(_idTransaction))
         {
             //Remove the lot. Some transactions may become invalid (over usage/nonexistent lots), but
             //this should not cause problems and will be fixed next time these transaction are modified.
-            object = m_indexLots[_transaction->id()];
-            m_lots.remove(m_indexLots[_transaction->id()]->idLot);
-            m_indexLots.remove(_transaction->id());
+            object = m_indexLots[_idTransaction];
+            m_lots.remove(m_indexLots[_idTransaction]->idLot);
+            m_indexLots.remove(_idTransaction);
         }
 
-        if (m_indexSplits.contains(_transaction->id()))
+        if (m_indexSplits.contains(_idTransaction))
         {
-            object = m_indexSplits[_transaction->id()];
-            m_indexSplits.remove(_transaction->id());
+            object = m_indexSplits[_idTransaction];
+            m_indexSplits.remove(_idTransaction);
         }
 
-        if (m_indexUsages.contains(_transaction->id()))
+        if (m_indexUsages.contains(_idTransaction))
         {
-            object = m_indexUsages[_transaction->id()];
-            m_indexUsages.remove(_transaction->id());
+            object = m_indexUsages[_idTransaction];
+            m_indexUsages.remove(_idTransaction);
         }
 
-        if (m_indexTransfersSwaps.contains(_transaction->id()))
+        if (m_indexTransfersSwaps.contains(_idTransaction))
         {
-            object = m_indexTransfersSwaps[_transaction->id()];
-            m_indexTransfersSwaps.remove(_transaction->id());
+            object = m_indexTransfersSwaps[_idTransaction];
+            m_indexTransfersSwaps.remove(_idTransaction);
         }
 
         if (object)
         {
-            m_available.remove(PriorityDate(object->transactionDate, object->sortingPriority()), object);
+            removeEvent(object);
             delete object;
-            emit modified();
         }
+
+        return object;
     }
 
     void InvestmentLotsManager::updateUsages(InvestmentTransaction* _transaction,
@@ -361,7 +400,7 @@ namespace KLib
                                                                   _lots,
                                                                   _transaction->date());
                         m_indexTransfersSwaps[_transaction->id()] = ts;
-                        m_available.insert(PriorityDate(_transaction->date(), ts->sortingPriority()), ts);
+                        addEvent(ts);
                     }
                     else
                     {
@@ -370,7 +409,7 @@ namespace KLib
                                                     _lots,
                                                     _transaction->date());
                         m_indexUsages[_transaction->id()] = us;
-                        m_available.insert(PriorityDate(_transaction->date(), us->sortingPriority()), us);
+                        addEvent(us);
                     }
                 }
             }
@@ -462,12 +501,8 @@ namespace KLib
 //                }
 
                 //Ok, all is well, so lets save the changes.
-                if (current->transactionDate != _transaction->date())
-                {
-                    m_available.remove(PriorityDate(current->transactionDate, current->sortingPriority()), current);
-                    m_available.insert(PriorityDate(_transaction->date(), current->sortingPriority()), current);
-                    current->transactionDate = _transaction->date();
-                }
+                removeEvent(current);
+                current->transactionDate = _transaction->date();
 
                 if (_transaction->action() == InvestmentAction::Transfer
                     || _transaction->action() == InvestmentAction::Swap)
@@ -487,12 +522,15 @@ namespace KLib
                     us->idInvestmentAccount = _transaction->idInvestmentToAccount();
                     ILotAvailabilityCalculator::cleanLots(us->lots);
                 }
+
+                addEvent(current);
             }
             else //Nothing in the lot, just clear.
             {
                 removeTransaction(_transaction);
             }
 
+            emit objectModified(_transaction->id());
             emit modified();
             break;
         }
@@ -508,17 +546,39 @@ namespace KLib
                                                        const QDate& _date,
                                                        int _idTransaction) const
     {
-        Lots available;
+        LotStream* stream = m_streams.value(_idInvestmentAccount, nullptr);
+
+        if (!stream)
+        {
+            return Lots();
+        }
+
+        //Replay the lots+splits from the last checkpoint before the date and the excluded transaction
+        const ILotAvailabilityCalculator* excluded = nullptr;
 
-        //Add the lots+splits
-        for (auto i = m_available.begin(); i != m_available.end() && i.key().first <= _date; ++i)
+        if (_idTransaction != Constants::NO_ID)
         {
-            if (i.value()->idTransaction != _idTransaction)
+            for (const ILotAvailabilityCalculator* e : {static_cast<ILotAvailabilityCalculator*>(m_indexLots.value(_idTransaction)),
+                                                        static_cast<ILotAvailabilityCalculator*>(m_indexSplits.value(_idTransaction)),
+                                                        static_cast<ILotAvailabilityCalculator*>(m_indexUsages.value(_idTransaction)),
+                                                        static_cast<ILotAvailabilityCalculator*>(m_indexTransfersSwaps.value(_idTransaction))})
             {
-                i.value()->adjustAvailability(available, _idInvestmentAccount);
+                if (e && (!excluded || eventKey(e) < eventKey(excluded)))
+                {
+                    excluded = e;
+                }
             }
         }
 
+        const PriorityDate skipFrom = excluded ? eventKey(excluded) : PriorityDate();
+
+        Lots available = stream->stateThrough(PriorityDate(_date, std::numeric_limits<int>::max()),
+                                              excluded ? &skipFrom : nullptr,
+                                              [_idTransaction] (const ILotAvailabilityCalculator* _e)
+        {
+            return _e->idTransaction == _idTransaction;
+        });
+
         //Remove the lots with a wrong action class
         QLinkedList<int> toRemove;
 
@@ -793,65 +853,72 @@ namespace KLib
 
         while (!(_reader.tokenType() == QXmlStreamReader::EndElement && _reader.name() == StdTags::INVEST_LOT_MGR))
         {
-            QXmlStreamAttributes attributes = _reader.attributes();
-
-            if (_reader.tokenType() == QXmlStreamReader::StartElement
-                && (_reader.name() == StdTags::INVEST_LOT_USAGE
-                    || _reader.name() == StdTags::INVEST_LOT_TRANSFER))
+            if (_reader.tokenType() == QXmlStreamReader::StartElement)
             {
-                Lots lots;
-                int idTransaction = IO::getAttribute("idtransaction", attributes).toInt();
-                QStringList list = IO::getAttribute("lots", attributes).split(',', QString::SkipEmptyParts);
+                loadEntry(_reader);
+            }
 
-                for (const QString& s : list)
-                {
-                    QStringList cur = s.split(':', QString::SkipEmptyParts);
+            _reader.readNext();
+        }
+    }
 
-                    if (cur.count() != 2)
-                    {
-                        throw IOException(tr("Unexpected number of arguments in investment lot usage."));
-                    }
+    void InvestmentLotsManager::loadEntry(QXmlStreamReader& _reader)
+    {
+        QXmlStreamAttributes attributes = _reader.attributes();
 
-                    lots[cur[0].toInt()] = Amount::fromStoreable(cur[1]);
-                }
+        if (_reader.name() == StdTags::INVEST_LOT_USAGE
+            || _reader.name() == StdTags::INVEST_LOT_TRANSFER)
+        {
+            Lots lots;
+            int idTransaction = IO::getAttribute("idtransaction", attributes).toInt();
+            QStringList list = IO::getAttribute("lots", attributes).split(',', QString::SkipEmptyParts);
 
-                if (lots.count())
+            for (const QString& s : list)
+            {
+                QStringList cur = s.split(':', QString::SkipEmptyParts);
+
+                if (cur.count() != 2)
                 {
-                    if (_reader.name() == StdTags::INVEST_LOT_USAGE)
-                    {
-                        LotUsage* lot = new LotUsage();
-                        lot->idTransaction = idTransaction;
-                        lot->lots = lots;
-                        m_indexUsages[idTransaction] = lot;
-                    }
-                    else //Transfer
-                    {
-                        LotTransferSwap* lot = new LotTransferSwap();
-                        lot->idTransaction = idTransaction;
-                        lot->lots = lots;
-                        m_indexTransfersSwaps[idTransaction] = lot;
-                    }
+                    throw IOException(tr("Unexpected number of arguments in investment lot usage."));
                 }
+
+                lots[cur[0].toInt()] = Amount::fromStoreable(cur[1]);
             }
-            else if (_reader.tokenType() == QXmlStreamReader::StartElement && _reader.name() == StdTags::INVEST_LOT_SPLIT)
-            {
-                LotSplit* lot = new LotSplit();
-                lot->idTransaction = IO::getAttribute("idtransaction", attributes).toInt();
-                m_indexSplits[lot->idTransaction] = lot;
-            }
-            else if (_reader.tokenType() == QXmlStreamReader::StartElement && _reader.name() == StdTags::INVEST_LOT)
+
+            if (lots.count())
             {
-                Lot* l = new Lot();
-                l->idLot = IO::getAttribute("id", attributes).toInt();
-                l->amount = Amount::fromStoreable(IO::getAttribute("amount", attributes));
-                l->idTransaction = IO::getAttribute("idtransaction", attributes).toInt();
-
-                m_lots[l->idLot] = l;
-                m_indexLots[l->idTransaction] = l;
-                m_nextId = std::max(m_nextId, l->idLot);
+                if (_reader.name() == StdTags::INVEST_LOT_USAGE)
+                {
+                    LotUsage* lot = new LotUsage();
+                    lot->idTransaction = idTransaction;
+                    lot->lots = lots;
+                    m_indexUsages[idTransaction] = lot;
+                }
+                else //Transfer
+                {
+                    LotTransferSwap* lot = new LotTransferSwap();
+                    lot->idTransaction = idTransaction;
+                    lot->lots = lots;
+                    m_indexTransfersSwaps[idTransaction] = lot;
+                }
             }
-
-            _reader.readNext();
+        }
+        else if (_reader.name() == StdTags::INVEST_LOT_SPLIT)
+        {
+            LotSplit* lot = new LotSplit();
+            lot->idTransaction = IO::getAttribute("idtransaction", attributes).toInt();
+            m_indexSplits[lot->idTransaction] = lot;
+        }
+        else if (_reader.name() == StdTags::INVEST_LOT)
+        {
+            Lot* l = new Lot();
+            l->idLot = IO::getAttribute("id", attributes).toInt();
+            l->amount = Amount::fromStoreable(IO::getAttribute("amount", attributes));
+            l->idTransaction = IO::getAttribute("idtransaction", attributes).toInt();
+
+            m_lots[l->idLot] = l;
+            m_indexLots[l->idTransaction] = l;
+            m_nextId = std::max(m_nextId, l->idLot);
         }
     }
 
@@ -862,15 +929,7 @@ namespace KLib
         //Save usages
         for (const LotUsage* usage : m_indexUsages)
         {
-            QStringList lots;
-            for (auto j = usage->lots.begin(); j != usage->lots.end(); ++j)
-            {
-                lots.append(QString("%1:%2").arg(j.key()).arg(j.value().toStoreable()));
-            }
-
-            _writer.writeEmptyElement(StdTags::INVEST_LOT_USAGE);
-            _writer.writeAttribute("idtransaction", QString::number(usage->idTransaction));
-            _writer.writeAttribute("lots", lots.join(","));
+            saveUsage(StdTags::INVEST_LOT_USAGE, usage->idTransaction, usage->lots, _writer);
         }
 
         //Save splits
@@ -883,30 +942,90 @@ namespace KLib
         //Save transfers/swaps
         for (const LotTransferSwap* trsw : m_indexTransfersSwaps)
         {
-            QStringList lots;
-            for (auto j = trsw->lots.begin(); j != trsw->lots.end(); ++j)
-            {
-                lots.append(QString("%1:%2").arg(j.key()).arg(j.value().toStoreable()));
-            }
-
-            _writer.writeEmptyElement(StdTags::INVEST_LOT_TRANSFER);
-            _writer.writeAttribute("idtransaction", QString::number(trsw->idTransaction));
-            _writer.writeAttribute("lots", lots.join(","));
+            saveUsage(StdTags::INVEST_LOT_TRANSFER, trsw->idTransaction, trsw->lots, _writer);
         }
 
         //Save the lots
         for (const Lot* lot : m_indexLots)
         {
-            _writer.writeEmptyElement(StdTags::INVEST_LOT);
-            _writer.writeAttribute("id", QString::number(lot->idLot));
-            _writer.writeAttribute("amount", lot->amount.toStoreable());
-            _writer.writeAttribute("idtransaction", QString::number(lot->idTransaction));
+            saveLot(lot, _writer);
         }
 
         _writer.writeEndElement();
 
     }
 
+    void InvestmentLotsManager::saveObjects(const QList<int>& _ids, QXmlStreamWriter& _writer) const
+    {
+        //The entries of each transaction are removed, then its current entries follow
+        for (int id : _ids)
+        {
+            _writer.writeEmptyElement(StdTags::REMOVED);
+            _writer.writeAttribute("id", QString::number(id));
+
+            if (m_indexUsages.contains(id))
+            {
+                saveUsage(StdTags::INVEST_LOT_USAGE, id, m_indexUsages[id]->lots, _writer);
+            }
+
+            if (m_indexSplits.contains(id))
+            {
+                _writer.writeEmptyElement(StdTags::INVEST_LOT_SPLIT);
+                _writer.writeAttribute("idtransaction", QString::number(id));
+            }
+
+            if (m_indexTransfersSwaps.contains(id))
+            {
+                saveUsage(StdTags::INVEST_LOT_TRANSFER, id, m_indexTransfersSwaps[id]->lots, _writer);
+            }
+
+            if (m_indexLots.contains(id))
+            {
+                saveLot(m_indexLots[id], _writer);
+            }
+        }
+    }
+
+    void InvestmentLotsManager::restoreObjects(QXmlStreamReader& _reader)
+    {
+        while (_reader.readNextStartElement())
+        {
+            if (_reader.name() == StdTags::REMOVED)
+            {
+                QXmlStreamAttributes attributes = _reader.attributes();
+                removeEntries(IO::getAttribute("id", attributes).toInt());
+            }
+            else
+            {
+                loadEntry(_reader);
+            }
+
+            _reader.skipCurrentElement();
+        }
+    }
+
+    void InvestmentLotsManager::saveUsage(const char* _tag, int _idTransaction, const Lots& _lots,
+                                          QXmlStreamWriter& _writer)
+    {
+        QStringList lots;
+        for (auto j = _lots.begin(); j != _lots.end(); ++j)
+        {
+            lots.append(QString("%1:%2").arg(j.key()).arg(j.value().toStoreable()));
+        }
+
+        _writer.writeEmptyElement(_tag);
+        _writer.writeAttribute("idtransaction", QString::number(_idTransaction));
+        _writer.writeAttribute("lots", lots.join(","));
+    }
+
+    void InvestmentLotsManager::saveLot(const Lot* _lot, QXmlStreamWriter& _writer)
+    {
+        _writer.writeEmptyElement(StdTags::INVEST_LOT);
+        _writer.writeAttribute("id", QString::number(_lot->idLot));
+        _writer.writeAttribute("amount", _lot->amount.toStoreable());
+        _writer.writeAttribute("idtransaction", QString::number(_lot->idTransaction));
+    }
+
     void InvestmentLotsManager::afterLoad()
     {
         //Load accounts, actions for lots
@@ -930,7 +1049,7 @@ namespace KLib
                 lot->transactionDate = trans->date();
 
                 //Add to the availability index
-                m_available.insert(PriorityDate(lot->transactionDate, lot->sortingPriority()), lot);
+                addEvent(lot);
             }
             catch (ModelException)
             {
@@ -960,7 +1079,7 @@ namespace KLib
             lot->transactionDate = trans->date();
 
             //Add to the availability index
-            m_available.insert(PriorityDate(lot->transactionDate, lot->sortingPriority()), lot);
+            addEvent(lot);
         }
 
         //Load the usages
@@ -979,7 +1098,7 @@ namespace KLib
             trans->m_lots = lot->lots;
 
             //Add to the availability index
-            m_available.insert(PriorityDate(lot->transactionDate, lot->sortingPriority()), lot);
+            addEvent(lot);
         }
 
         //Load the transfers
@@ -999,7 +1118,7 @@ namespace KLib
             trans->m_lots = lot->lots;
 
             //Add to the availability index
-            m_available.insert(PriorityDate(lot->transactionDate, lot->sortingPriority()), lot);
+            addEvent(lot);
         }
 
     }
@@ -1007,7 +1126,13 @@ namespace KLib
     void InvestmentLotsManager::unload()
     {
         m_nextId = 0;
-        m_available.clear();
+
+        for (LotStream* s : m_streams)
+        {
+            delete s;
+        }
+
+        m_streams.clear();
 
         for (Lot* l : m_indexLots)
         {
@@ -1034,7 +1159,6 @@ namespace KLib
         m_indexUsages.clear();
         m_indexTransfersSwaps.clear();
         m_lots.clear();
-        m_available.clear();
     }
 
 }
@@ -22,7 +22,9 @@
 
 #include "stored.h"
 #include "../amount.h"
+#include "../util/checkpointedstream.h"
 #include <QDate>
+#include <QVector>
 
 namespace KLib
 {
@@ -54,6 +56,11 @@ namespace KLib
 
         virtual int sortingPriority() const = 0;
 
+        /**
+         * @brief Investment accounts whose availability is adjusted
+         */
+        virtual QVector<int> investmentAccounts() const = 0;
+
         static void cleanLots(Lots& _lots);
 
         int     idTransaction;
@@ -78,6 +85,7 @@ namespace KLib
 
         void adjustAvailability(Lots& _previous, int _idInvestmentAccount) const override;
         int sortingPriority() const override { return 0; }
+        QVector<int> investmentAccounts() const override { return QVector<int>() << idInvestmentAccount; }
 
         //Amount  availableBalanceCache;
 
@@ -100,6 +108,7 @@ namespace KLib
 
         void adjustAvailability(Lots& _previous, int _idInvestmentAccount) const override;
         int sortingPriority() const override { return -1; }
+        QVector<int> investmentAccounts() const override { return QVector<int>() << idInvestmentAccount; }
     };
 
     struct LotTransferSwap : public ILotAvailabilityCalculator
@@ -124,6 +133,7 @@ namespace KLib
 
         void adjustAvailability(Lots& _previous, int _idInvestmentAccount) const override;
         int sortingPriority() const override { return 1; }
+        QVector<int> investmentAccounts() const override { return QVector<int>() << idAccountFrom << idAccountTo; }
     };
 
     struct LotUsage : public ILotAvailabilityCalculator
@@ -141,6 +151,7 @@ namespace KLib
 
         void adjustAvailability(Lots& _previous, int _idInvestmentAccount) const override;
         int sortingPriority() const override { return 1; }
+        QVector<int> investmentAccounts() const override { return QVector<int>() << idInvestmentAccount; }
     };
 
     class InvestmentLotsManager : public IStored
@@ -151,6 +162,11 @@ namespace KLib
 
         typedef QPair<QDate, int> PriorityDate;
 
+        /**
+         * @brief Events of an investment account, with checkpoints of its available lots.
+         */
+        typedef CheckpointedStream<PriorityDate, ILotAvailabilityCalculator*, Lots> LotStream;
+
         public:
             static InvestmentLotsManager* instance() { return m_instance; }
 
@@ -240,13 +256,53 @@ namespace KLib
             void afterLoad() override;
             void unload() override;
 
+            /**
+             * @brief The objects are the entries (lot, usage, split, transfer) of each transaction.
+             */
+            bool journalsObjects() const override { return true; }
+            void saveObjects(const QList<int>& _ids, QXmlStreamWriter& _writer) const override;
+            void restoreObjects(QXmlStreamReader& _reader) override;
+
         private:
 
+            /**
+             * @brief Loads the entry at the current start element of _reader.
+             */
+            void loadEntry(QXmlStreamReader& _reader);
+
+            static void saveUsage(const char* _tag, int _idTransaction, const Lots& _lots,
+                                  QXmlStreamWriter& _writer);
+            static void saveLot(const Lot* _lot, QXmlStreamWriter& _writer);
+
+            /**
+             * @brief Removes and deletes the entries of _idTransaction. Returns false if there were none.
+             */
+            bool removeEntries(int _idTransaction);
+
             bool lotsHaveSameClass(const Lots& _lots) const;
 
-            //In the future, separate by account? (QMap of QMap)
-            //Contains everything.
-            QMultiMap<PriorityDate, ILotAvailabilityCalculator*> m_available; //Ordered by transaction date AND order
+            /**
+             * @brief Adds _event to the streams of its accounts. Must be called after _event is created or
+             * modified.
+             */
+            void addEvent(ILotAvailabilityCalculator* _event);
+
+            /**
+             * @brief Removes _event from the streams of its accounts. Must be called before _event is modified
+             * or deleted.
+             */
+            void removeEvent(ILotAvailabilityCalculator* _event);
+
+            static PriorityDate eventKey(const ILotAvailabilityCalculator* _event)
+            {
+                return PriorityDate(_event->transactionDate, _event->sortingPriority());
+            }
+
+            /**
+             * @brief Lot availability events of each investment account, ordered by transaction date AND order.
+             * A transfer is in the streams of both of its accounts.
+             */
+            QHash<int, LotStream*> m_streams;
 
             //QMultiMap<int, ILotAvailabilityCalculator*> m_usagesTransfersSwaps; //Ordered by account ID
 
@@ -23,8 +23,12 @@
 #include "account.h"
 #include "investmenttransaction.h"
 #include "investmentlotsmanager.h"
+#include <algorithm>
 #include <stdexcept>
 #include <QPair>
+#include <QThread>
+#include <QtConcurrent>
+#include <functional>
 #include "modelexception.h"
 #include "security.h"
 #include "payee.h"
@@ -33,6 +37,25 @@
 
 namespace KLib {
 
+    Transaction* TransactionRef::get() const
+    {
+        if (m_transaction || m_id == Constants::NO_ID)
+        {
+            return m_transaction;
+        }
+
+        Transaction* t = TransactionManager::instance()->get(m_id);
+
+        //The references are shared with the readers of other threads (see
+        //LedgerManager::prepareConcurrentReads()): only the thread of the model caches the transaction.
+        if (QThread::currentThread() == TransactionManager::instance()->thread())
+        {
+            m_transaction = t;
+        }
+
+        return t;
+    }
+
     namespace AugmentedTreapSum
     {
         template<>
@@ -69,9 +92,297 @@ namespace KLib {
 
 LedgerManager* LedgerManager::m_instance = nullptr;
 const QDate LedgerManager::m_today = QDate::currentDate();
+const int Ledger::REBUILD_INDEX_AFTER = 16;
+const int LedgerManager::PARALLEL_VALIDATION_MIN_COUNT = 256;
+
+bool LedgerIndex::build(const LedgerMap& _map)
+{
+    invalidate();
+
+    //After a stock split, the balances before the split are transformed
+    if (_map.fragmentCount() > 1)
+    {
+        return false;
+    }
+
+    m_transactions.reserve(_map.count());
+
+    for (auto i = _map.begin(); i != _map.end(); ++i)
+    {
+        if (m_dates.isEmpty() || m_dates.last() != i.key())
+        {
+            m_dates.append(i.key());
+            m_starts.append(m_transactions.size());
+            m_balances.append(sum());
+        }
+
+        m_balances.last() += i.weight();
+        m_transactions.append(i.value());
+    }
+
+    m_valid = true;
+    return true;
+}
+
+void LedgerIndex::invalidate()
+{
+    m_dates.clear();
+    m_balances.clear();
+    m_starts.clear();
+    m_transactions.clear();
+    m_valid = false;
+}
+
+bool LedgerIndex::append(const QDate& _date, const TransactionRef& _tr, const Balances& _weight)
+{
+    if (!m_valid)
+    {
+        return false;
+    }
+    else if (!m_dates.isEmpty() && _date < m_dates.last())
+    {
+        invalidate();
+        return false;
+    }
+
+    if (m_dates.isEmpty() || m_dates.last() != _date)
+    {
+        m_dates.append(_date);
+        m_starts.append(m_transactions.size());
+        m_balances.append(sum());
+        m_transactions.append(_tr);
+    }
+    else //LedgerMap::insert() puts the new transaction first in its date
+    {
+        m_transactions.insert(m_starts.last(), _tr);
+    }
+
+    m_balances.last() += _weight;
+    return true;
+}
+
+Balances LedgerIndex::sumTo(const QDate& _date) const
+{
+    int i = std::upper_bound(m_dates.constBegin(), m_dates.constEnd(), _date) - m_dates.constBegin();
+    return i ? m_balances[i - 1] : Balances();
+}
+
+Balances LedgerIndex::sumBefore(const QDate& _date) const
+{
+    int i = std::lower_bound(m_dates.constBegin(), m_dates.constEnd(), _date) - m_dates.constBegin();
+    return i ? m_balances[i - 1] : Balances();
+}
+
+QVector<Balances> LedgerIndex::sumsTo(const QVector<QDate>& _dates) const
+{
+    QVector<Balances> sums;
+    sums.reserve(_dates.size());
+
+    //The dates are sorted: each search starts where the previous one ended
+    auto from = m_dates.constBegin();
+
+    for (const QDate& d : _dates)
+    {
+        from = std::upper_bound(from, m_dates.constEnd(), d);
+        int i = from - m_dates.constBegin();
+        sums.append(i ? m_balances[i - 1] : Balances());
+    }
+
+    return sums;
+}
+
+QPair<int, int> LedgerIndex::range(const QDate& _from, const QDate& _to) const
+{
+    auto position = [this] (QVector<QDate>::const_iterator _date)
+    {
+        return _date == m_dates.constEnd() ? m_transactions.size()
+                                           : m_starts[_date - m_dates.constBegin()];
+    };
+
+    return QPair<int, int>(_from.isValid() ? position(std::lower_bound(m_dates.constBegin(), m_dates.constEnd(), _from))
+                                           : 0,
+                           _to.isValid() ? position(std::upper_bound(m_dates.constBegin(), m_dates.constEnd(), _to))
+                                         : m_transactions.size());
+}
+
+Ledger::Ledger(Account* _account) :
+    m_account(_account),
+    m_transactions(true),
+    m_flatIndex(true),
+    m_queriesSinceChange(0),
+    m_persistentBuilt(false)
+{
+}
+
+void Ledger::setFlatIndex(bool _enabled)
+{
+    m_flatIndex = _enabled;
+
+    if (!_enabled)
+    {
+        invalidateIndex();
+    }
+    else if (!m_index.isValid())
+    {
+        m_index.build(m_transactions);
+    }
+}
+
+void Ledger::buildIndex() const
+{
+    if (m_flatIndex && !m_index.isValid())
+    {
+        m_queriesSinceChange = 0;
+        m_index.build(m_transactions);
+    }
+}
+
+const LedgerIndex* Ledger::index() const
+{
+    if (!m_flatIndex)
+    {
+        return nullptr;
+    }
+
+    //Queries from other threads must not modify the ledger: they use the index only if it was built by
+    //buildIndex() (see LedgerManager::prepareConcurrentReads()).
+    if (QThread::currentThread() != thread())
+    {
+        return m_index.isValid() ? &m_index : nullptr;
+    }
+
+    if (!m_index.isValid() && ++m_queriesSinceChange >= REBUILD_INDEX_AFTER)
+    {
+        m_queriesSinceChange = 0;
+        m_index.build(m_transactions);
+    }
+
+    return m_index.isValid() ? &m_index : nullptr;
+}
+
+void Ledger::insert(const QDate& _date, const TransactionRef& _tr, const Balances& _weight)
+{
+    m_transactions.insert(_date, _tr, _weight);
+
+    if (m_persistentBuilt)
+    {
+        m_persistent.insert(persistentKey(_date, _tr), _weight);
+    }
+
+    if (!m_index.append(_date, _tr, _weight))
+    {
+        m_queriesSinceChange = 0;
+    }
+}
+
+bool Ledger::remove(const QDate& _date, const TransactionRef& _tr)
+{
+    bool removed = m_transactions.remove(_date, _tr);
+
+    if (removed)
+    {
+        if (m_persistentBuilt)
+        {
+            m_persistent.remove(persistentKey(_date, _tr));
+        }
+
+        invalidateIndex();
+    }
+
+    return removed;
+}
+
+bool Ledger::setWeight(const QDate& _date, const TransactionRef& _tr, const Balances& _weight)
+{
+    bool changed = m_transactions.setWeight(_date, _tr, _weight);
+
+    if (changed)
+    {
+        if (m_persistentBuilt)
+        {
+            m_persistent.insert(persistentKey(_date, _tr), _weight);
+        }
+
+        invalidateIndex();
+    }
+
+    return changed;
+}
+
+bool Ledger::move(const QDate& _old, const TransactionRef& _tr, const QDate& _new)
+{
+    bool moved = m_transactions.move(_old, _tr, _new);
+
+    if (moved)
+    {
+        Balances weight;
+
+        if (m_persistentBuilt && m_persistent.take(persistentKey(_old, _tr), &weight))
+        {
+            m_persistent.insert(persistentKey(_new, _tr), weight);
+        }
+
+        invalidateIndex();
+    }
+
+    return moved;
+}
+
+void Ledger::insertSorted(const QVector<LedgerMap::element_type>& _elements)
+{
+    const bool wasEmpty = m_transactions.isEmpty();
 
-Ledger::Ledger(Account* _account) : m_account(_account)
+    m_transactions.insertSorted(_elements.constBegin(), _elements.constEnd());
+
+    if (m_persistentBuilt && wasEmpty)
+    {
+        buildPersistent();
+    }
+    else if (m_persistentBuilt)
+    {
+        for (const LedgerMap::element_type& e : _elements)
+        {
+            m_persistent.insert(persistentKey(e.key, e.value), e.weight);
+        }
+    }
+
+    invalidateIndex();
+}
+
+const PersistentLedger& Ledger::persistent() const
+{
+    if (!m_persistentBuilt)
+    {
+        buildPersistent();
+    }
+
+    return m_persistent;
+}
+
+void Ledger::buildPersistent() const
 {
+    std::vector<PersistentLedger::element_type> elements;
+    elements.reserve(m_transactions.size());
+
+    for (auto i = m_transactions.begin(); i != m_transactions.end(); ++i)
+    {
+        elements.emplace_back(persistentKey(i.key(), i.value()), i.weight());
+    }
+
+    std::sort(elements.begin(), elements.end(), [] (const PersistentLedger::element_type& _a,
+                                                    const PersistentLedger::element_type& _b)
+    {
+        return _a.first < _b.first;
+    });
+
+    m_persistent = PersistentLedger::fromSorted(elements.begin(), elements.end());
+    m_persistentBuilt = true;
+}
+
+void Ledger::invalidateIndex()
+{
+    m_index.invalidate();
+    m_queriesSinceChange = 0;
 }
 
 Amount Ledger::balanceAt(const QDate& _date, const QString& _currency) const
@@ -99,7 +410,13 @@ Amount Ledger::balanceBetween(const QDate& _from, const QDate& _to, const QStrin
 
 Balances Ledger::balancesBetween(const QDate& _from, const QDate& _to) const
 {
-    if (!_to.isValid() && !_to.isValid())
+    if (const LedgerIndex* idx = index())
+    {
+        Balances to = _to.isValid() ? idx->sumTo(_to) : idx->sum();
+        return _from.isValid() ? to - idx->sumBefore(_from) : to;
+    }
+
+    if (!_from.isValid() && !_to.isValid())
     {
         return m_transactions.sum();
     }
@@ -117,6 +434,24 @@ Balances Ledger::balancesBetween(const QDate& _from, const QDate& _to) const
     }
 }
 
+QVector<Balances> Ledger::balancesAt(const QVector<QDate>& _dates) const
+{
+    if (const LedgerIndex* idx = index())
+    {
+        return idx->sumsTo(_dates);
+    }
+
+    QVector<Balances> balances;
+    balances.reserve(_dates.size());
+
+    for (const QDate& d : _dates)
+    {
+        balances.append(m_transactions.sumTo(d));
+    }
+
+    return balances;
+}
+
 Amount Ledger::balanceIn(const Balances& _balances, const QString& _currency, const QDate& _date) const
 {
     if (_currency.isEmpty() && account()->mainCurrency().isEmpty()) //Security-based account
@@ -156,9 +491,22 @@ TransactionRange Ledger::transactionRange(const QDate& _begin, const QDate& _end
 
 QLinkedList<KLib::Transaction*> Ledger::transactionsBetween(const QDate& _from, const QDate& _to) const
 {
-    TransactionRange range = transactionRange(_from, _to);
     QLinkedList<Transaction*> list;
 
+    if (const LedgerIndex* idx = index())
+    {
+        QPair<int, int> range = idx->range(_from, _to);
+
+        for (int i = range.first; i < range.second; ++i)
+        {
+            list.append(idx->transactionAt(i));
+        }
+
+        return list;
+    }
+
+    TransactionRange range = transactionRange(_from, _to);
+
     for (auto i = range.first; i != range.second; ++i)
     {
         list.append(i.value());
@@ -218,7 +566,7 @@ Amount Ledger::costBasisAt(const QDate& _date) const
     else
     {
         auto i = m_transactions.upperBound(_date); //Returns iterator to first transaction after _date.
-        return costBasisBefore(i == m_transactions.end() ? nullptr : i.value());
+        return costBasisBefore(i == m_transactions.end() ? nullptr : i.value().get());
     }
 }
 
@@ -231,7 +579,7 @@ KLib::Amount Ledger::costBasisBefore(const Transaction* _tr) const
         Amount cost(0, precCur);
         Amount balance(0, s->precision());
 
-        for (auto i = m_transactions.begin(); i != m_transactions.end() && i.value() != _tr; ++i)
+        for (auto i = m_transactions.begin(); i != m_transactions.end() && (!_tr || i.value().id() != _tr->id()); ++i)
         {
             const InvestmentTransaction* trans = qobject_cast<InvestmentTransaction*>(i.value());
 
@@ -359,17 +707,35 @@ KLib::Amount Ledger::costBasisBefore(const Transaction* _tr) const
 QSet<QString> Ledger::currenciesUsed(const QDate& _from, const QDate& _to) const
 {
     QSet<QString> currencies;
-    TransactionRange range = transactionRange(_from, _to);
 
-    for (auto i = range.first; i != range.second; ++i)
+    auto addCurrencies = [this, &currencies] (const Transaction* _tr)
     {
-        for (Transaction::Split s : i.value()->splits())
+        for (const Transaction::Split& s : _tr->splits())
         {
             if (s.idAccount == idAccount() && !s.currency.isEmpty())
             {
                 currencies.insert(s.currency);
             }
         }
+    };
+
+    if (const LedgerIndex* idx = index())
+    {
+        QPair<int, int> range = idx->range(_from, _to);
+
+        for (int i = range.first; i < range.second; ++i)
+        {
+            addCurrencies(idx->transactionAt(i));
+        }
+    }
+    else
+    {
+        TransactionRange range = transactionRange(_from, _to);
+
+        for (auto i = range.first; i != range.second; ++i)
+        {
+            addCurrencies(i.value());
+        }
     }
 
     return currencies;
@@ -435,59 +801,23 @@ KLib::Transaction* LedgerManager::addTransaction(Transaction* _tr)
         ModelException::throwException(tr("The transaction is null."), nullptr);
     }
 
-    //Check the date
-    if (!_tr->date().isValid())
-    {
-        _tr->deleteLater();
-        ModelException::throwException(tr("The transaction's date must be valid."), nullptr);
-    }
-
     //Check the ID
     if (_tr->id() != Constants::NO_ID)
     {
         ModelException::throwException(tr("The transaction cannot have a valid ID."), nullptr);
     }
 
-    //Check if investment transaction
-    InvestmentTransaction* inv_tr = qobject_cast<InvestmentTransaction*>(_tr);
-
-    if (inv_tr && inv_tr->action() == InvestmentAction::Invalid)
-    {
-        _tr->deleteLater();
-        ModelException::throwException(tr("The transaction cannot have an invalid action."), nullptr);
-    }
-
     //Find the ledgers related to the transaction
     QHash<int, Balances> amountsPerAccount;
+    QString error = validate(_tr, amountsPerAccount);
 
-    foreach (const Transaction::Split &s, _tr->splits())
+    if (!error.isEmpty())
     {
-        if (!m_ledgers.contains(s.idAccount))
-        {
-            _tr->deleteLater();
-            ModelException::throwException(tr("Cannot add a split for account %1: it is a placeholder.")
-                                           .arg(Account::getTopLevel()->account(s.idAccount)->name()), nullptr);
-        }
-        else
-        {
-            amountsPerAccount[s.idAccount].add(s.currency, s.amount);
-        }
+        _tr->deleteLater();
+        ModelException::throwException(error, nullptr);
     }
 
-    //Check for zero amounts
-    if (!inv_tr)
-    {
-        for (auto i = amountsPerAccount.begin(); i != amountsPerAccount.end(); ++i)
-        {
-            if (i.value().isEmpty())
-            {
-                _tr->deleteLater();
-                ModelException::throwException(tr("The total splits for account %1 cannot be zero.")
-                                               .arg(Account::getTopLevel()->getChild(i.key())->name()), nullptr);
-                return nullptr;
-            }
-        }
-    }
+    InvestmentTransaction* inv_tr = qobject_cast<InvestmentTransaction*>(_tr);
 
     _tr->m_id = TransactionManager::newId();
     _tr->checkIfCurrencyExchange();
@@ -499,7 +829,7 @@ KLib::Transaction* LedgerManager::addTransaction(Transaction* _tr)
         //Add the values to the respective ledger's balances
 
         Balances priorBalance = m_ledgers[i.key()]->m_transactions.sum();
-        m_ledgers[i.key()]->m_transactions.insert(_tr->date(), _tr, i.value());
+        m_ledgers[i.key()]->insert(_tr->date(), _tr, i.value());
 
         if (inv_tr && inv_tr->action() == InvestmentAction::StockSplit)
         {
@@ -510,7 +840,7 @@ KLib::Transaction* LedgerManager::addTransaction(Transaction* _tr)
             checkIfBalancesChanged(i.key(), _tr->date(), priorBalance);
         }
 
-        emit m_ledgers[i.key()]->modified();
+        notifyLedgerModified(i.key());
     }
 
     connectSignals(_tr);
@@ -525,32 +855,306 @@ KLib::Transaction* LedgerManager::addTransaction(Transaction* _tr)
 
     for (Transaction::Split s : _tr->m_splits)
     {
-        emit splitAdded(s, _tr);
+        notifySplitChanged(&LedgerManager::splitAdded, s, _tr);
     }
 
     return _tr;
 }
 
-void LedgerManager::removeTransaction(int _id)
+QString LedgerManager::validate(const Transaction* _tr, QHash<int, Balances>& _amountsPerAccount) const
 {
-    Transaction* tr = TransactionManager::instance()->get(_id);
+    //Check the date
+    if (!_tr->date().isValid())
+    {
+        return tr("The transaction's date must be valid.");
+    }
 
-    if (tr)
+    //Check if investment transaction
+    const InvestmentTransaction* inv_tr = qobject_cast<const InvestmentTransaction*>(_tr);
+
+    if (inv_tr && inv_tr->action() == InvestmentAction::Invalid)
     {
-        //Check if investment transaction
-        InvestmentTransaction* inv_tr = qobject_cast<InvestmentTransaction*>(tr);
+        return tr("The transaction cannot have an invalid action.");
+    }
 
-        if (inv_tr)
+    //Find the ledgers related to the transaction
+    foreach (const Transaction::Split &s, _tr->splits())
+    {
+        if (!m_ledgers.contains(s.idAccount))
         {
-            if (inv_tr->action() == InvestmentAction::StockSplit)
+            return tr("Cannot add a split for account %1: it is a placeholder.")
+                    .arg(Account::getTopLevel()->account(s.idAccount)->name());
+        }
+        else
+        {
+            _amountsPerAccount[s.idAccount].add(s.currency, s.amount);
+        }
+    }
+
+    //Check for zero amounts
+    if (!inv_tr)
+    {
+        for (auto i = _amountsPerAccount.begin(); i != _amountsPerAccount.end(); ++i)
+        {
+            if (i.value().isEmpty())
             {
-                removeStockSplit(inv_tr);
+                return tr("The total splits for account %1 cannot be zero.")
+                        .arg(Account::getTopLevel()->getChild(i.key())->name());
             }
-
-            inv_tr->m_action = InvestmentAction::Invalid;
         }
+    }
 
-        QList<Transaction::Split> oldSplits = tr->m_splits;
+    return QString();
+}
+
+QList<Transaction*> LedgerManager::addTransactions(const QList<Transaction*>& _transactions,
+                                                   QHash<int, QString>* _errors)
+{
+    struct Item
+    {
+        Transaction* tr;
+        int index;
+        bool owned;     ///< If LedgerManager must delete the transaction if it is invalid
+        QHash<int, Balances> amountsPerAccount;
+        QString error;
+    };
+
+    QVector<Item> items;
+    items.reserve(_transactions.size());
+    QSet<Transaction*> seen;
+
+    for (int i = 0; i < _transactions.size(); ++i)
+    {
+        Item item{_transactions[i], i, false, QHash<int, Balances>(), QString()};
+
+        if (!item.tr)
+        {
+            item.error = tr("The transaction is null.");
+        }
+        else if (item.tr->id() != Constants::NO_ID)
+        {
+            item.error = tr("The transaction cannot have a valid ID.");
+        }
+        else if (seen.contains(item.tr))
+        {
+            item.error = tr("The transaction is in the list more than once.");
+        }
+        else
+        {
+            item.owned = true;
+            seen.insert(item.tr);
+        }
+
+        items.append(item);
+    }
+
+    //The model is not modified until all the transactions are validated.
+    std::function<void(Item&)> check = [this] (Item& _item)
+    {
+        if (_item.error.isEmpty())
+        {
+            _item.error = validate(_item.tr, _item.amountsPerAccount);
+        }
+    };
+
+    if (items.size() >= PARALLEL_VALIDATION_MIN_COUNT)
+    {
+        QtConcurrent::blockingMap(items, check);
+    }
+    else
+    {
+        std::for_each(items.begin(), items.end(), check);
+    }
+
+    QVector<Item*> valid;
+    valid.reserve(items.size());
+    const Item* firstError = nullptr;
+
+    for (Item& item : items)
+    {
+        if (item.error.isEmpty())
+        {
+            valid.append(&item);
+        }
+        else if (!firstError)
+        {
+            firstError = &item;
+        }
+    }
+
+    if (firstError && !_errors)
+    {
+        for (const Item& item : items)
+        {
+            if (item.owned)
+                item.tr->deleteLater();
+        }
+
+        ModelException::throwException(tr("Transaction %1: %2").arg(firstError->index).arg(firstError->error),
+                                       nullptr);
+    }
+
+    for (const Item& item : items)
+    {
+        if (!item.error.isEmpty())
+        {
+            _errors->insert(item.index, item.error);
+
+            if (item.owned)
+                item.tr->deleteLater();
+        }
+    }
+
+    //Merge the transactions in the ledgers by date
+    std::stable_sort(valid.begin(), valid.end(), [] (const Item* _a, const Item* _b)
+    {
+        return _a->tr->date() < _b->tr->date();
+    });
+
+    QHash<int, QVector<LedgerMap::element_type> > elements;
+
+    for (Item* item : valid)
+    {
+        item->tr->m_id = TransactionManager::newId();
+        item->tr->checkIfCurrencyExchange();
+
+        for (auto i = item->amountsPerAccount.begin(); i != item->amountsPerAccount.end(); ++i)
+        {
+            elements[i.key()].append(LedgerMap::element_type{item->tr->date(), item->tr, i.value()});
+        }
+    }
+
+    //The differences are computed once the stock splits are added, since they fragment the ledgers
+    QHash<int, Balances> prior;
+    QHash<int, Balances> priorToday;
+
+    for (auto i = elements.begin(); i != elements.end(); ++i)
+    {
+        Ledger* l = m_ledgers[i.key()];
+        prior[i.key()] = l->m_transactions.sum();
+        priorToday[i.key()] = l->m_transactions.sumTo(m_today);
+
+        l->insertSorted(i.value());
+    }
+
+    //Connect the transactions and add the lots, in order of date
+    QList<Transaction*> added;
+    QString lotError;
+
+    for (Item* item : valid)
+    {
+        InvestmentTransaction* inv_tr = qobject_cast<InvestmentTransaction*>(item->tr);
+
+        connectSignals(item->tr);
+
+        if (inv_tr)
+        {
+            if (inv_tr->action() == InvestmentAction::StockSplit)
+            {
+                addStockSplit(inv_tr);
+            }
+
+            connectInvestmentSignals(inv_tr);
+
+            try
+            {
+                inv_tr->addToInvestmentLotsManager();
+            }
+            catch (const ModelException& e)
+            {
+                if (_errors)
+                {
+                    _errors->insert(item->index, e.description());
+                }
+                else if (lotError.isEmpty())
+                {
+                    lotError = tr("Transaction %1: %2").arg(item->index).arg(e.description());
+                }
+            }
+        }
+
+        TransactionManager::instance()->add(item->tr);
+        added.append(item->tr);
+    }
+
+    //Notify once per ledger
+    QSet<int> idAccounts;
+
+    for (auto i = elements.begin(); i != elements.end(); ++i)
+    {
+        const Ledger* l = m_ledgers[i.key()];
+        const Balances difference = l->m_transactions.sum() - prior[i.key()];
+        const Balances differenceToday = l->m_transactions.sumTo(m_today) - priorToday[i.key()];
+
+        idAccounts.insert(i.key());
+
+        if (!difference.isEmpty())
+        {
+            notifyBalanceChanged(i.key(), difference);
+        }
+
+        if (!differenceToday.isEmpty())
+        {
+            notifyBalanceTodayChanged(i.key(), differenceToday);
+        }
+
+        notifyLedgerModified(i.key());
+    }
+
+    if (m_changeDepth)
+    {
+        for (Transaction* tr : added)
+        {
+            for (const Transaction::Split& s : tr->splits())
+            {
+                m_delta.touch(s.idAccount, tr->date(), tr->id());
+            }
+        }
+    }
+    else if (!added.isEmpty())
+    {
+        emit transactionsAdded(added, idAccounts);
+    }
+
+    if (!lotError.isEmpty())
+    {
+        ModelException::throwException(lotError, nullptr);
+    }
+
+    return added;
+}
+
+void LedgerManager::prepareConcurrentReads() const
+{
+    for (const Ledger* l : m_ledgers)
+    {
+        l->buildIndex();
+    }
+
+    //Built lazily otherwise, which the other threads must not do (TransactionSearch)
+    TransactionManager::instance()->index();
+}
+
+void LedgerManager::removeTransaction(int _id)
+{
+    Transaction* tr = TransactionManager::instance()->get(_id);
+
+    if (tr)
+    {
+        //Check if investment transaction
+        InvestmentTransaction* inv_tr = qobject_cast<InvestmentTransaction*>(tr);
+
+        if (inv_tr)
+        {
+            if (inv_tr->action() == InvestmentAction::StockSplit)
+            {
+                removeStockSplit(inv_tr);
+            }
+
+            inv_tr->m_action = InvestmentAction::Invalid;
+        }
+
+        QList<Transaction::Split> oldSplits = tr->m_splits;
         tr->m_splits.clear();
 
         for (Transaction::Split& s : oldSplits)
@@ -561,13 +1165,13 @@ void LedgerManager::removeTransaction(int _id)
 
                 //If the account has multiple splits in this transaction, the transaction will only be removed once,
                 //no need to emit the signal multiple times then.
-                if (m_ledgers[s.idAccount]->m_transactions.remove(tr->date(), tr))
-                    emit m_ledgers[s.idAccount]->modified();
+                if (m_ledgers[s.idAccount]->remove(tr->date(), tr))
+                    notifyLedgerModified(s.idAccount);
 
                 checkIfBalancesChanged(s.idAccount, tr->date(), priorBalance);
             }
 
-            emit splitRemoved(s, tr);
+            notifySplitChanged(&LedgerManager::splitRemoved, s, tr);
         }
 
         TransactionManager::instance()->remove(_id);
@@ -585,25 +1189,25 @@ void LedgerManager::onSplitAdded(const Transaction::Split& _split)
 
         if (!m_ledgers[_split.idAccount]->m_transactions.contains(tr->date(), tr))
         {
-            m_ledgers[_split.idAccount]->m_transactions.insert(tr->date(),
-                                                               tr,
-                                                               Transaction::totalsForAccount(_split.idAccount,
-                                                                                             tr->splits()));
+            m_ledgers[_split.idAccount]->insert(tr->date(),
+                                                tr,
+                                                Transaction::totalsForAccount(_split.idAccount,
+                                                                              tr->splits()));
         }
         else
         {
-            m_ledgers[_split.idAccount]->m_transactions.setWeight(tr->date(),
-                                                                  tr,
-                                                                  Transaction::totalsForAccount(_split.idAccount,
-                                                                                                tr->splits()));
+            m_ledgers[_split.idAccount]->setWeight(tr->date(),
+                                                   tr,
+                                                   Transaction::totalsForAccount(_split.idAccount,
+                                                                                 tr->splits()));
         }
 
         checkIfBalancesChanged(_split.idAccount, tr->date(), priorBalance);
 
-        emit m_ledgers[_split.idAccount]->modified();
+        notifyLedgerModified(_split.idAccount);
     }
 
-    emit splitAdded(_split, tr);
+    notifySplitChanged(&LedgerManager::splitAdded, _split, tr);
 }
 
 void LedgerManager::onSplitRemoved(const Transaction::Split& _split)
@@ -617,22 +1221,22 @@ void LedgerManager::onSplitRemoved(const Transaction::Split& _split)
         //Only remove the transaction if the split was unique with this account number in the transaction.
         if (!tr->relatedTo(_split.idAccount))
         {
-            m_ledgers[_split.idAccount]->m_transactions.remove(tr->date(), tr);
+            m_ledgers[_split.idAccount]->remove(tr->date(), tr);
         }
         else
         {
-            m_ledgers[_split.idAccount]->m_transactions.setWeight(tr->date(),
-                                                                  tr,
-                                                                  Transaction::totalsForAccount(_split.idAccount,
-                                                                                                tr->splits()));
+            m_ledgers[_split.idAccount]->setWeight(tr->date(),
+                                                   tr,
+                                                   Transaction::totalsForAccount(_split.idAccount,
+                                                                                 tr->splits()));
         }
 
         checkIfBalancesChanged(_split.idAccount, tr->date(), priorBalance);
 
-        emit m_ledgers[_split.idAccount]->modified();
+        notifyLedgerModified(_split.idAccount);
     }
 
-    emit splitRemoved(_split, tr);
+    notifySplitChanged(&LedgerManager::splitRemoved, _split, tr);
 }
 
 void LedgerManager::onSplitAmountChanged(const Transaction::Split& _split)
@@ -642,16 +1246,16 @@ void LedgerManager::onSplitAmountChanged(const Transaction::Split& _split)
     if (m_ledgers.contains(_split.idAccount) && tr)
     {
         Balances priorBalance = m_ledgers[_split.idAccount]->m_transactions.sum();
-        m_ledgers[_split.idAccount]->m_transactions.setWeight(tr->date(),
-                                                              tr,
-                                                              Transaction::totalsForAccount(_split.idAccount,
-                                                                                            tr->splits()));
+        m_ledgers[_split.idAccount]->setWeight(tr->date(),
+                                               tr,
+                                               Transaction::totalsForAccount(_split.idAccount,
+                                                                             tr->splits()));
         checkIfBalancesChanged(_split.idAccount, tr->date(), priorBalance);
 
-        emit m_ledgers[_split.idAccount]->modified();
+        notifyLedgerModified(_split.idAccount);
     }
 
-    emit splitAmountChanged(_split, tr);
+    notifySplitChanged(&LedgerManager::splitAmountChanged, _split, tr);
 }
 
 void LedgerManager::removeStockSplit(InvestmentTransaction* _inv_tr)
@@ -666,6 +1270,7 @@ void LedgerManager::removeStockSplit(InvestmentTransaction* _inv_tr)
 
         ledger->m_transactions.joinFragmentsAt(curDate);
         ledger->m_splits.remove(_inv_tr->id());
+        ledger->invalidateIndex();
 
         checkIfBalancesChanged(idAccount, curDate, priorBalance);
     }
@@ -684,6 +1289,7 @@ void LedgerManager::addStockSplit(InvestmentTransaction* _inv_tr)
 
     ledger->m_transactions.splitFragmentAt(_inv_tr->date(), _inv_tr->splitFraction());
     ledger->m_splits[_inv_tr->id()] = _inv_tr->date();
+    ledger->invalidateIndex();
 
     checkIfBalancesChanged(idAccount, _inv_tr->date(), priorBalance);
 }
@@ -708,12 +1314,232 @@ void LedgerManager::checkIfBalancesChanged(int _idAccount, const QDate& _date, c
 
     if (!diff.isEmpty())
     {
-        emit balanceChanged(_idAccount, diff);
+        notifyBalanceChanged(_idAccount, diff);
 
         if (_date <= m_today)
         {
-            emit balanceTodayChanged(_idAccount, diff);
+            notifyBalanceTodayChanged(_idAccount, diff);
+        }
+    }
+}
+
+void LedgerManager::notifyBalanceChanged(int _idAccount, const Balances& _difference)
+{
+    if (m_changeDepth)
+    {
+        m_delta.accounts.insert(_idAccount);
+        m_delta.balanceDifferences[_idAccount] += _difference;
+    }
+    else
+    {
+        emit balanceChanged(_idAccount, _difference);
+    }
+}
+
+void LedgerManager::notifyBalanceTodayChanged(int _idAccount, const Balances& _difference)
+{
+    if (m_changeDepth)
+    {
+        m_delta.accounts.insert(_idAccount);
+        m_delta.balanceTodayDifferences[_idAccount] += _difference;
+    }
+    else
+    {
+        emit balanceTodayChanged(_idAccount, _difference);
+    }
+}
+
+void LedgerManager::notifyLedgerModified(int _idAccount)
+{
+    if (m_changeDepth)
+    {
+        m_delta.accounts.insert(_idAccount);
+    }
+    else
+    {
+        emit m_ledgers[_idAccount]->modified();
+    }
+}
+
+void LedgerManager::notifySplitChanged(void (LedgerManager::*_signal)(const Transaction::Split&, Transaction*),
+                                       const Transaction::Split& _split, Transaction* _tr)
+{
+    if (!m_changeDepth)
+    {
+        emit (this->*_signal)(_split, _tr);
+    }
+    else if (_tr)
+    {
+        m_delta.touch(_split.idAccount, _tr->date(), _tr->id());
+    }
+}
+
+void LedgerManager::beginChanges()
+{
+    ++m_changeDepth;
+}
+
+void LedgerManager::endChanges(bool _commit)
+{
+    if (m_changeDepth == 0 || --m_changeDepth > 0)
+        return;
+
+    //Take the delta first: the listeners may open scopes of their own.
+    ModelDelta delta = m_delta;
+    QList<QPointer<IStored> > held = m_held;
+    m_delta = ModelDelta();
+    m_held.clear();
+
+    if (!_commit)
+    {
+        //An exception is propagating: the held objects must not stay on hold, but nothing may throw.
+        for (const QPointer<IStored>& o : held)
+        {
+            try
+            {
+                if (o)
+                    o->doneHoldToModify();
+            }
+            catch (...) {}
+        }
+
+        //The changes made before the exception stay in the ledgers: notify them once the stack has unwound, so
+        //that the listeners do not keep stale balances.
+        if (!delta.isEmpty())
+        {
+            QMetaObject::invokeMethod(this, [this, delta]()
+            {
+                ModelDelta current = delta;
+
+                //The book may have been closed since
+                for (int id : delta.accounts)
+                {
+                    if (!m_ledgers.contains(id))
+                    {
+                        current.accounts.remove(id);
+                        current.firstDates.remove(id);
+                        current.balanceDifferences.remove(id);
+                        current.balanceTodayDifferences.remove(id);
+                    }
+                }
+
+                notifyChanges(current, QList<QPointer<IStored> >());
+            }, Qt::QueuedConnection);
         }
+
+        return;
+    }
+
+    notifyChanges(delta, held);
+}
+
+void LedgerManager::notifyChanges(ModelDelta _delta, const QList<QPointer<IStored> >& _held)
+{
+    if (m_changeDepth)
+    {
+        m_delta.merge(_delta);
+        return;
+    }
+
+    for (int id : _delta.accounts)
+    {
+        Account* a = Account::getTopLevel()->account(id);
+
+        if (a && a->type() == AccountType::INVESTMENT)
+        {
+            _delta.securities.insert(a->idSecurity());
+        }
+    }
+
+    for (auto i = _delta.balanceDifferences.begin(); i != _delta.balanceDifferences.end(); ++i)
+    {
+        if (!i.value().isEmpty())
+            emit balanceChanged(i.key(), i.value());
+    }
+
+    for (auto i = _delta.balanceTodayDifferences.begin(); i != _delta.balanceTodayDifferences.end(); ++i)
+    {
+        if (!i.value().isEmpty())
+            emit balanceTodayChanged(i.key(), i.value());
+    }
+
+    for (int id : _delta.accounts)
+    {
+        if (m_ledgers.contains(id))
+            emit m_ledgers[id]->modified();
+    }
+
+    for (const QPointer<IStored>& o : _held)
+    {
+        if (o)
+            o->doneHoldToModify();
+    }
+
+    if (!_delta.isEmpty())
+    {
+        emit changesCommitted(_delta);
+    }
+}
+
+void LedgerManager::holdUntilCommitted(IStored* _object)
+{
+    if (m_changeDepth && _object && !_object->onHoldToModify())
+    {
+        _object->holdToModify();
+        m_held.append(_object);
+
+        if (Transaction* tr = qobject_cast<Transaction*>(_object))
+        {
+            m_delta.transactions.insert(tr->id());
+        }
+    }
+}
+
+void ModelDelta::touch(int _idAccount, const QDate& _date, int _idTransaction)
+{
+    accounts.insert(_idAccount);
+    transactions.insert(_idTransaction);
+
+    auto i = firstDates.find(_idAccount);
+
+    if (i == firstDates.end())
+    {
+        firstDates.insert(_idAccount, _date);
+    }
+    else if (_date < i.value())
+    {
+        i.value() = _date;
+    }
+}
+
+void ModelDelta::merge(const ModelDelta& _other)
+{
+    accounts.unite(_other.accounts);
+    securities.unite(_other.securities);
+    transactions.unite(_other.transactions);
+
+    for (auto i = _other.firstDates.begin(); i != _other.firstDates.end(); ++i)
+    {
+        auto j = firstDates.find(i.key());
+
+        if (j == firstDates.end())
+        {
+            firstDates.insert(i.key(), i.value());
+        }
+        else if (i.value() < j.value())
+        {
+            j.value() = i.value();
+        }
+    }
+
+    for (auto i = _other.balanceDifferences.begin(); i != _other.balanceDifferences.end(); ++i)
+    {
+        balanceDifferences[i.key()] += i.value();
+    }
+
+    for (auto i = _other.balanceTodayDifferences.begin(); i != _other.balanceTodayDifferences.end(); ++i)
+    {
+        balanceTodayDifferences[i.key()] += i.value();
     }
 }
 
@@ -749,13 +1575,14 @@ void LedgerManager::onStockSplitAmountChanged()
         Balances diff = ledger->m_transactions.sum();
 
         ledger->m_transactions.setFragmentRatio(ledger->m_splits.value(tr->id()), tr->splitFraction());
+        ledger->invalidateIndex();
         diff = ledger->m_transactions.sum() - diff;
 
-        emit balanceChanged(idAccount, diff);
+        notifyBalanceChanged(idAccount, diff);
 
         if (tr->date() <= m_today)
         {
-            emit balanceTodayChanged(idAccount, diff);
+            notifyBalanceTodayChanged(idAccount, diff);
         }
     }
     else
@@ -787,7 +1614,7 @@ void LedgerManager::onTransactionDateChanged(const QDate& _old)
                 addStockSplit(inv_tr);
             }
 
-            m_ledgers[inv_tr->idInvestmentAccount()]->m_transactions.move(_old, tr, tr->date());
+            m_ledgers[inv_tr->idInvestmentAccount()]->move(_old, tr, tr->date());
         }
         else
         {
@@ -798,13 +1625,13 @@ void LedgerManager::onTransactionDateChanged(const QDate& _old)
                 if (!moved.contains(s.idAccount))
                 {
                     Balances b = m_ledgers[s.idAccount]->m_transactions.sum();
-                    m_ledgers[s.idAccount]->m_transactions.move(_old, tr, tr->date());
+                    m_ledgers[s.idAccount]->move(_old, tr, tr->date());
                     moved.insert(s.idAccount);
                     b = m_ledgers[s.idAccount]->m_transactions.sum() - b;
 
                     if (!b.isEmpty()) //Change in balance caused by stock split
                     {
-                        emit balanceChanged(s.idAccount, b);
+                        notifyBalanceChanged(s.idAccount, b);
                     }
                 }
 
@@ -813,19 +1640,29 @@ void LedgerManager::onTransactionDateChanged(const QDate& _old)
                     Balances b;
                     b.add(s.currency, s.amount);
 
-                    emit balanceTodayChanged(s.idAccount, b);
+                    notifyBalanceTodayChanged(s.idAccount, b);
                 }
                 else if (tr->date() > m_today && _old <= m_today) //Moved from today or before to future
                 {
                     Balances b;
                     b.add(s.currency, s.amount);
-                    emit balanceTodayChanged(s.idAccount, b);
+                    notifyBalanceTodayChanged(s.idAccount, b);
                 }
             }
         }
     }
 
-    emit transactionDateChanged(tr, _old);
+    if (m_changeDepth && tr)
+    {
+        for (const Transaction::Split& s : tr->splits())
+        {
+            m_delta.touch(s.idAccount, std::min(_old, tr->date()), tr->id());
+        }
+    }
+    else
+    {
+        emit transactionDateChanged(tr, _old);
+    }
 }
 
 void LedgerManager::addAccount(Account *_acc)
@@ -854,52 +1691,106 @@ void LedgerManager::removeAccount(Account *_acc)
 
 void LedgerManager::load()
 {
-    // Add all transactions to the corresponding ledgers
+    // Collect the transactions of each ledger, then build each ledger at once from its date-sorted
+    // transactions. Transactions that are not materialized are indexed from their stored splits, and
+    // connected when they are materialized.
 
-    for (Transaction* t : TransactionManager::instance()->transactions())
+    QHash<int, QVector<LedgerMap::element_type> > elements;
+    QList<InvestmentTransaction*> stockSplits;
+
+    for (Transaction* t : TransactionManager::instance()->m_transactions)
     {
-        //Compute the total balance for each account per transaction. The hash is necessary
-        //since it is possible to have the same account multiple times per transaction.
+        indexTransaction(t, t->date(), t->splits(), elements);
+        connectSignals(t);
 
-        QHash<int, Balances> balancesPerAccount;
+        //Check if investment transaction
+        InvestmentTransaction* inv_tr = qobject_cast<InvestmentTransaction*>(t);
 
-        foreach (Transaction::Split s, t->splits())
+        if (inv_tr)
         {
-            if (!m_ledgers.contains(s.idAccount))
-            {
-                throw IOException(tr("Unrecognized account ID in transaction # %1.").arg(t->id()));
-            }
-            else
+            connectInvestmentSignals(inv_tr);
+
+            if (inv_tr->action() == InvestmentAction::StockSplit)
             {
-                balancesPerAccount[s.idAccount].add(s.currency, s.amount);
+                stockSplits << inv_tr;
             }
         }
+    }
+
+    TransactionManager::instance()->forEachUnmaterialized([this, &elements] (int _id, const QDate& _date,
+                                                                             const QList<Transaction::Split>& _splits)
+    {
+        indexTransaction(TransactionRef::unmaterialized(_id), _date, _splits, elements);
+    });
+
+    for (auto i = elements.begin(); i != elements.end(); ++i)
+    {
+        QVector<LedgerMap::element_type>& list = i.value();
 
-        for (auto i = balancesPerAccount.begin(); i != balancesPerAccount.end(); ++i)
+        //Stable: transactions on the same date keep the order in which they would have been inserted
+        std::stable_sort(list.begin(), list.end(), [] (const LedgerMap::element_type& _a,
+                                                       const LedgerMap::element_type& _b)
         {
-            m_ledgers[i.key()]->m_transactions.insert(t->date(), t, i.value());
-        }
+            return _a.key < _b.key;
+        });
 
-        connectSignals(t);
+        m_ledgers[i.key()]->m_transactions.insertSorted(list.constBegin(), list.constEnd());
+    }
 
-        //Check if investment transaction
-        InvestmentTransaction* inv_tr = qobject_cast<InvestmentTransaction*>(t);
+    //Fragment the complete ledgers at the stock splits
+    for (InvestmentTransaction* inv_tr : stockSplits)
+    {
+        addStockSplit(inv_tr);
+    }
 
-        if (inv_tr)
+    for (Ledger* l : m_ledgers)
+    {
+        if (l->flatIndex())
         {
-            connectInvestmentSignals(inv_tr);
+            l->m_index.build(l->m_transactions);
+        }
 
-            if (inv_tr->action() == InvestmentAction::StockSplit)
-            {
-                addStockSplit(inv_tr);
-            }
+        if (l->m_persistentBuilt)
+        {
+            l->buildPersistent();
         }
     }
+
+    connect(TransactionManager::instance(), &TransactionManager::transactionMaterialized,
+            this, [this] (Transaction* _tr) { connectSignals(_tr); });
+}
+
+void LedgerManager::indexTransaction(const TransactionRef& _tr, const QDate& _date,
+                                     const QList<Transaction::Split>& _splits,
+                                     QHash<int, QVector<LedgerMap::element_type> >& _elements)
+{
+    //Compute the total balance for each account per transaction. The hash is necessary
+    //since it is possible to have the same account multiple times per transaction.
+
+    QHash<int, Balances> balancesPerAccount;
+
+    for (const Transaction::Split& s : _splits)
+    {
+        if (!m_ledgers.contains(s.idAccount))
+        {
+            throw IOException(tr("Unrecognized account ID in transaction # %1.").arg(_tr.id()));
+        }
+        else
+        {
+            balancesPerAccount[s.idAccount].add(s.currency, s.amount);
+        }
+    }
+
+    for (auto i = balancesPerAccount.begin(); i != balancesPerAccount.end(); ++i)
+    {
+        _elements[i.key()].append(LedgerMap::element_type{_date, _tr, i.value()});
+    }
 }
 
 void LedgerManager::unload()
 {
     m_ledgers.clear();
+    TransactionManager::instance()->disconnect(this);
 }
 
 
@@ -24,10 +24,15 @@
 #include <QHash>
 #include <QDate>
 #include <QLinkedList>
+#include <QVector>
+#include <QSet>
+#include <QPointer>
+#include <exception>
 #include "transaction.h"
 #include "../interfaces/scriptable.h"
 //#include "../util/augmentedtreapmap.h"
 #include "../util/fragmentedtreapmap.h"
+#include "../util/persistenttreap.h"
 
 namespace KLib {
 
@@ -58,10 +63,130 @@ namespace KLib {
     class InvestmentTransaction;
     enum class InvestmentAction;
 
-    typedef FragmentedTreapMap1<QDate, Transaction*, SplitFraction,  Balances> LedgerMap;
+    /**
+     * @brief Reference to a transaction stored in a ledger.
+     *
+     * When TransactionManager loads a book lazily, ledgers are indexed from the mapped transaction
+     * columns and only know the id of the transactions. The Transaction object is materialized
+     * by TransactionManager the first time it is dereferenced.
+     *
+     * References are equal if they refer to the same transaction id.
+     */
+    class TransactionRef
+    {
+        public:
+            TransactionRef() : m_id(Constants::NO_ID), m_transaction(nullptr) {}
+
+            TransactionRef(Transaction* _tr) : m_id(_tr ? _tr->id() : Constants::NO_ID),
+                                               m_transaction(_tr) {}
+
+            static TransactionRef unmaterialized(int _id)
+            {
+                TransactionRef ref;
+                ref.m_id = _id;
+                return ref;
+            }
+
+            int id() const { return m_id; }
+
+            /**
+             * @brief If the transaction has been materialized (or was given at construction)
+             */
+            bool isMaterialized() const { return m_transaction; }
+
+            /**
+             * @brief Returns the transaction, materializing it if required.
+             */
+            Transaction* get() const;
+
+            operator Transaction*() const { return get(); }
+            Transaction* operator->() const { return get(); }
+
+            bool operator==(const TransactionRef& _other) const { return m_id == _other.m_id; }
+            bool operator!=(const TransactionRef& _other) const { return m_id != _other.m_id; }
+
+        private:
+            int m_id;
+            mutable Transaction* m_transaction;
+    };
+
+    typedef FragmentedTreapMap1<QDate, TransactionRef, SplitFraction,  Balances> LedgerMap;
     typedef LedgerMap::const_iterator TransactionIterator;
     typedef std::pair<TransactionIterator, TransactionIterator> TransactionRange;
 
+    /**
+     * @brief Weights of a ledger by (Julian day, transaction id), as a persistent treap (see ModelSnapshot).
+     */
+    typedef PersistentTreap<QPair<qint32, int>, Balances> PersistentLedger;
+
+    /**
+     * @brief Flat index of a ledger, for ledgers that are mostly read and appended to.
+     *
+     * Holds the distinct dates of the ledger in a sorted array, with the balance at the end of each date, and
+     * the transactions in ledger order. A balance is a binary search and one lookup, and the transactions
+     * between two dates are a contiguous range.
+     *
+     * Appending transactions at or after the last date keeps the index valid. Any other change must invalidate
+     * it; the ledger then uses its treap until the index is rebuilt. Ledgers with stock splits (several
+     * fragments) are not indexed.
+     */
+    class LedgerIndex
+    {
+        public:
+            LedgerIndex() : m_valid(false) {}
+
+            bool isValid() const { return m_valid; }
+
+            /**
+             * @brief Rebuilds the index from _map in O(n).
+             * @return False if _map cannot be indexed.
+             */
+            bool build(const LedgerMap& _map);
+
+            /**
+             * @brief Marks the index invalid and frees its memory.
+             */
+            void invalidate();
+
+            /**
+             * @brief Adds a transaction to a valid index, as LedgerMap::insert() would.
+             * @return False, and invalidates the index, if _date is before the last date.
+             */
+            bool append(const QDate& _date, const TransactionRef& _tr, const Balances& _weight);
+
+            Balances sum() const { return m_balances.isEmpty() ? Balances() : m_balances.last(); }
+
+            /**
+             * @brief Balance at the end of _date
+             */
+            Balances sumTo(const QDate& _date) const;
+
+            /**
+             * @brief Balance before _date
+             */
+            Balances sumBefore(const QDate& _date) const;
+
+            /**
+             * @brief sumTo() of each of _dates, which must be sorted
+             */
+            QVector<Balances> sumsTo(const QVector<QDate>& _dates) const;
+
+            /**
+             * @brief Positions of the first transaction at or after _from and of the first transaction after _to.
+             * Invalid dates are unbounded.
+             */
+            QPair<int, int> range(const QDate& _from, const QDate& _to) const;
+
+            const TransactionRef& transactionAt(int _pos) const { return m_transactions[_pos]; }
+
+        private:
+            QVector<QDate>          m_dates;
+            QVector<Balances>       m_balances;     ///< Balance at the end of m_dates[i]
+            QVector<int>            m_starts;       ///< Position in m_transactions of the first transaction of m_dates[i]
+            QVector<TransactionRef> m_transactions;
+            bool m_valid;
+    };
+
     class Ledger : public QObject
     {
         Q_OBJECT
@@ -69,6 +194,7 @@ namespace KLib {
 
         Q_PROPERTY(int count READ count)
         Q_PROPERTY(int idAccount READ idAccount)
+        Q_PROPERTY(bool flatIndex READ flatIndex WRITE setFlatIndex)
 
         public:
             Ledger(KLib::Account* _account);
@@ -117,7 +243,7 @@ namespace KLib {
 
               @return The balances for all currencies in the account.
              */
-            Q_INVOKABLE Balances balancesToday() const { return m_transactions.sumTo(QDate::currentDate()); }
+            Q_INVOKABLE Balances balancesToday() const { return balancesBetween(QDate(), QDate::currentDate()); }
 
             /**
               @brief Balance including all the transactions in the account, including future ones.
@@ -125,7 +251,7 @@ namespace KLib {
               @return The balances for all currencies in the account.
             */
 
-            Q_INVOKABLE Balances balances() const { return m_transactions.sum(); }
+            Q_INVOKABLE Balances balances() const { return balancesBetween(QDate(), QDate()); }
 
             /**
               @brief balanceBetween
@@ -138,6 +264,20 @@ namespace KLib {
 
             Balances balancesBetween(const QDate& _from, const QDate& _to) const;
 
+            /**
+             * @brief Balances at the end of each of _dates, which must be sorted and valid.
+             *
+             * Equivalent to calling balancesBetween(QDate(), date) for each date, in a single pass over the flat
+             * index when it is valid.
+             */
+            QVector<Balances> balancesAt(const QVector<QDate>& _dates) const;
+
+            /**
+             * @brief Combines _balances in the main currency of the account on _date, or returns the amount in
+             * _currency if it is specified.
+             */
+            Amount balanceIn(const Balances& _balances, const QString& _currency, const QDate& _date) const;
+
             Q_INVOKABLE QLinkedList<KLib::Transaction*> transactionsBetween(const QDate& _from, const QDate& _to) const;
 
             /**
@@ -183,21 +323,83 @@ namespace KLib {
              */
             Q_INVOKABLE KLib::Account* account() const { return m_account; }
 
+            /**
+             * @brief If the ledger keeps a LedgerIndex for its balance queries (the default).
+             */
+            bool flatIndex() const { return m_flatIndex; }
+            void setFlatIndex(bool _enabled);
+
+            /**
+             * @brief Builds the flat index now if it is enabled and invalid. Until the next change, balance
+             * queries do not modify the ledger, and can be made from other threads.
+             */
+            void buildIndex() const;
+
+            /**
+             * @brief Current version of the weights of the ledger. Copies are O(1) and are not affected by later
+             * changes. The weights are not adjusted for stock splits.
+             *
+             * Built on the first call, in O(n log n), then kept up to date: each later change copies the
+             * O(log n) nodes on its path. Books that never take a snapshot (see ModelSnapshot) pay neither.
+             * Must be called from the thread of the ledger.
+             */
+            const PersistentLedger& persistent() const;
+
 
         signals:
             void modified();
 
         private:            
             TransactionRange    transactionRange(const QDate& _begin, const QDate& _end) const;
-            Amount              balanceIn(const Balances& _balances, const QString& _currency, const QDate& _date) const;
 
             Balances balancesBefore(const KLib::Transaction* _tr, QDate& _lastDate) const;
 
+            /**
+             * @brief The flat index if it is enabled and valid, nullptr if the treap must be used.
+             *
+             * An invalid index is rebuilt after REBUILD_INDEX_AFTER queries without changes, made from the thread of
+             * the ledger. Queries from other threads never modify the ledger.
+             */
+            const LedgerIndex* index() const;
+
+            //Changes to m_transactions, which keep the index up to date
+            void insert(const QDate& _date, const TransactionRef& _tr, const Balances& _weight);
+            bool remove(const QDate& _date, const TransactionRef& _tr);
+            bool setWeight(const QDate& _date, const TransactionRef& _tr, const Balances& _weight);
+            bool move(const QDate& _old, const TransactionRef& _tr, const QDate& _new);
+            void invalidateIndex();
+
+            /**
+             * @brief Inserts _elements, which must be sorted by date. Built at once if the ledger is empty.
+             */
+            void insertSorted(const QVector<LedgerMap::element_type>& _elements);
+
+            /**
+             * @brief Rebuilds m_persistent from m_transactions, on the first call to persistent() and after a
+             * bulk load.
+             */
+            void buildPersistent() const;
+
+            static PersistentLedger::element_type::first_type persistentKey(const QDate& _date,
+                                                                            const TransactionRef& _tr)
+            {
+                return qMakePair(qint32(_date.toJulianDay()), _tr.id());
+            }
+
             Account* m_account;
 
-            LedgerMap     m_transactions;
+            LedgerMap     m_transactions;   ///< Pooled: the nodes are freed at once with the ledger
             QHash<int, QDate>  m_splits;
 
+            bool m_flatIndex;
+            mutable LedgerIndex m_index;
+            mutable int m_queriesSinceChange;
+
+            mutable PersistentLedger m_persistent;
+            mutable bool m_persistentBuilt;     ///< If m_persistent is built and kept up to date
+
+            static const int REBUILD_INDEX_AFTER;
+
             friend class LedgerManager;
 
             /*
@@ -214,12 +416,38 @@ namespace KLib {
              */
     };
 
+    /**
+     * @brief Changes made to the ledgers during a change scope (see LedgerManager::beginChanges()).
+     */
+    struct ModelDelta
+    {
+        QSet<int> accounts;                 ///< Accounts whose ledger was modified
+        QSet<int> securities;               ///< Securities of the modified investment accounts
+        QSet<int> transactions;             ///< Transactions that were added, removed or modified
+        QHash<int, QDate> firstDates;       ///< Earliest date modified in each account
+
+        QHash<int, Balances> balanceDifferences;        ///< Sum of the balanceChanged() of each account
+        QHash<int, Balances> balanceTodayDifferences;   ///< Sum of the balanceTodayChanged() of each account
+
+        bool isEmpty() const { return accounts.isEmpty() && transactions.isEmpty(); }
+
+        /**
+         * @brief Marks account _idAccount modified on _date by transaction _idTransaction.
+         */
+        void touch(int _idAccount, const QDate& _date, int _idTransaction);
+
+        /**
+         * @brief Adds the changes of _other to this delta.
+         */
+        void merge(const ModelDelta& _other);
+    };
+
     class LedgerManager : public QObject
     {
         Q_OBJECT
         K_SCRIPTABLE(LedgerManager)
 
-        LedgerManager() {}
+        LedgerManager() : m_changeDepth(0) {}
 
         public:
 
@@ -246,10 +474,66 @@ namespace KLib {
             */
             Q_INVOKABLE KLib::Transaction* addTransaction(Transaction* _tr);
 
+            /**
+             * @brief Adds many transactions at once, for importers.
+             *
+             * The transactions are validated in parallel, merged in the ledgers by date (the ledgers that were
+             * empty are built at once) and added to the investment lots manager in order of date. Instead of the
+             * signals of each split, each modified ledger emits modified() once, each account emits
+             * balanceChanged() once, and transactionsAdded() is emitted (see beginChanges() inside a change scope).
+             *
+             * As with addTransaction(), LedgerManager takes ownership of the transactions, and the invalid ones are
+             * deleted. If _errors is null, a ModelException is thrown if any transaction is invalid, and none is
+             * added. Otherwise, the valid transactions are added and _errors is filled with the error of each
+             * invalid one, by index in _transactions. The transactions whose lots cannot be added to the lots
+             * manager are added without lots, with an error.
+             *
+             * @return The transactions that were added, in order of date.
+             */
+            QList<KLib::Transaction*> addTransactions(const QList<KLib::Transaction*>& _transactions,
+                                                      QHash<int, QString>* _errors = nullptr);
+
             Q_INVOKABLE void removeTransaction(int _id);
 
             Q_INVOKABLE KLib::Ledger* ledger(int _idAccount) const { return m_ledgers[_idAccount]; }
 
+            /**
+             * @brief Prepares the model to be read from other threads: builds the indexes of the ledgers and
+             * TransactionManager::index(), which are otherwise built lazily by the readers. The transactions of a
+             * lazily loaded book are still materialized as they are read (see TransactionManager::get()).
+             *
+             * Must be called from the thread of the model. The model must not be modified while it is read.
+             */
+            void prepareConcurrentReads() const;
+
+            /**
+             * @brief Starts a change scope. Scopes can be nested; use ChangeScope rather than calling this directly.
+             *
+             * The ledgers are still updated right away, but instead of the signals of each split and transaction
+             * (splitAdded(), splitRemoved(), splitAmountChanged(), transactionDateChanged() and transactionsAdded()),
+             * the changes are accumulated in a ModelDelta. When the outermost scope ends, each account emits
+             * balanceChanged() and balanceTodayChanged() once, each modified ledger emits modified() once, and
+             * changesCommitted() is emitted with the delta.
+             */
+            void beginChanges();
+
+            /**
+             * @brief Ends the change scope started by the last call to beginChanges().
+             *
+             * If _commit is false and the outermost scope ends, the scope is being left by an exception: the objects
+             * held by holdUntilCommitted() are released without throwing, and the changes, which were applied
+             * anyway, are notified from the event loop once the stack has unwound (see notifyChanges()).
+             */
+            void endChanges(bool _commit = true);
+
+            bool inChanges() const { return m_changeDepth > 0; }
+
+            /**
+             * @brief Holds _object to modify until the end of the outermost change scope, so that it emits
+             * modified() once. Does nothing if no scope is open or if _object is already on hold.
+             */
+            void holdUntilCommitted(IStored* _object);
+
             static LedgerManager* instance() { return m_instance; }
 
         signals:
@@ -261,6 +545,17 @@ namespace KLib {
             void balanceChanged(int _idAccount, const Balances& _difference);
             void balanceTodayChanged(int _idAccount, const Balances& _difference);
 
+            /**
+             * @brief Emitted by addTransactions(), instead of splitAdded() for each split.
+             * @param _idAccounts Accounts of the splits of the transactions
+             */
+            void transactionsAdded(const QList<KLib::Transaction*>& _transactions, const QSet<int>& _idAccounts);
+
+            /**
+             * @brief Emitted at the end of the outermost change scope, if anything was modified during it.
+             */
+            void changesCommitted(const KLib::ModelDelta& _delta);
+
         public slots:
             void onSplitAdded(const KLib::Transaction::Split& _split);
             void onSplitRemoved(const KLib::Transaction::Split& _split);
@@ -281,20 +576,90 @@ namespace KLib {
 
             void checkIfBalancesChanged(int _idAccount, const QDate& _date, const Balances& _prior);
 
+            /*
+             * The notifications below are emitted right away outside of change scopes, and accumulated in
+             * m_delta otherwise.
+             */
+            void notifyBalanceChanged(int _idAccount, const Balances& _difference);
+            void notifyBalanceTodayChanged(int _idAccount, const Balances& _difference);
+            void notifyLedgerModified(int _idAccount);
+            void notifySplitChanged(void (LedgerManager::*_signal)(const KLib::Transaction::Split&, KLib::Transaction*),
+                                    const Transaction::Split& _split, Transaction* _tr);
+
+            /**
+             * @brief Emits the signals of the changes in _delta (see beginChanges()), and releases _held. If a change
+             * scope is open, _delta is added to it instead.
+             */
+            void notifyChanges(ModelDelta _delta, const QList<QPointer<IStored> >& _held);
+
+            /**
+             * @brief Checks a transaction that is being added, and computes its balance in each account.
+             * @return The error message, empty if _tr is valid. Can be called from any thread.
+             */
+            QString validate(const Transaction* _tr, QHash<int, Balances>& _amountsPerAccount) const;
+
+            /**
+             * @brief Minimum number of transactions to validate them in parallel in addTransactions()
+             */
+            static const int PARALLEL_VALIDATION_MIN_COUNT;
+
+            /**
+             * @brief Adds the balance of _tr in each account to the elements of the ledger of the account.
+             */
+            void indexTransaction(const TransactionRef& _tr, const QDate& _date,
+                                  const QList<Transaction::Split>& _splits,
+                                  QHash<int, QVector<LedgerMap::element_type> >& _elements);
+
             void load();
             void unload();
 
             QHash<int, Ledger*> m_ledgers;
 
+            int m_changeDepth;
+            ModelDelta m_delta;
+            QList<QPointer<IStored> > m_held;
+
             static LedgerManager* m_instance;
             static const QDate m_today;
 
             friend class Account;
     };
 
+    /**
+     * @brief Change scope of LedgerManager for the lifetime of the object (see LedgerManager::beginChanges()).
+     *
+     * Used around mass edits, so that the listeners recompute once per scope instead of once per change.
+     */
+    class ChangeScope
+    {
+        public:
+            ChangeScope() : m_uncaught(std::uncaught_exceptions()) { LedgerManager::instance()->beginChanges(); }
+
+            /**
+             * @brief Ends the scope. If it is left by an exception, the changes are notified from the event loop
+             * (see LedgerManager::endChanges()).
+             */
+            ~ChangeScope()
+            {
+                LedgerManager::instance()->endChanges(std::uncaught_exceptions() == m_uncaught);
+            }
+
+            /**
+             * @brief See LedgerManager::holdUntilCommitted()
+             */
+            void hold(IStored* _object) { LedgerManager::instance()->holdUntilCommitted(_object); }
+
+        private:
+            ChangeScope(const ChangeScope&) = delete;
+            ChangeScope& operator=(const ChangeScope&) = delete;
+
+            int m_uncaught;     ///< Exceptions in flight when the scope was opened
+    };
+
 }
 
 Q_DECLARE_METATYPE(KLib::Ledger*)
 Q_DECLARE_METATYPE(KLib::LedgerManager*)
+Q_DECLARE_METATYPE(KLib::ModelDelta)
 
 #endif // LEDGER_H
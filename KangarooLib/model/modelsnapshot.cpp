@@ -0,0 +1,311 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "modelsnapshot.h"
+
+#include <QAtomicInteger>
+#include <QQueue>
+#include <QThreadStorage>
+#include <functional>
+#include <limits>
+
+#include "account.h"
+#include "currency.h"
+#include "payee.h"
+#include "pricemanager.h"
+#include "security.h"
+
+namespace KLib {
+
+namespace {
+QAtomicInteger<quint64> lastVersion(0);
+QThreadStorage<ModelSnapshot> currentSnapshots;
+}  // namespace
+
+ModelSnapshot ModelSnapshot::take() {
+  QSharedPointer<Data> data(new Data());
+  data->version = ++lastVersion;
+  data->topLevel = Account::getTopLevel()->id();
+
+  std::function<void(const Account*)> addAccount = [&](const Account* _a) {
+    AccountInfo info;
+    info.id = _a->id();
+    info.parent = _a->parent() ? _a->parent()->id() : -1;
+    info.name = _a->name();
+    info.type = _a->type();
+    info.mainCurrency = _a->mainCurrency();
+    info.idSecurity = _a->idSecurity();
+    info.isPlaceholder = _a->isPlaceholder();
+    info.children.reserve(int(_a->getChildren().size()));
+
+    for (const Account* c : _a->getChildren()) {
+      info.children << c->id();
+      addAccount(c);
+    }
+
+    data->accounts.insert(info.id, info);
+
+    if (const Ledger* l = _a->ledger()) {
+      LedgerVersion version{l->persistent(), QVector<StockSplit>()};
+
+      // A fragment starts at the day of its stock split
+      for (const auto& f : l->transactions()->fragments()) {
+        version.splits << StockSplit{
+            qMakePair(qint32(f.first.toJulianDay()),
+                      std::numeric_limits<int>::min()),
+            f.second};
+      }
+
+      data->ledgers.insert(info.id, version);
+    }
+  };
+
+  addAccount(Account::getTopLevel());
+
+  for (const ExchangePair* p : PriceManager::instance()->pairs()) {
+    data->pairsFrom[p->from()] << data->pairs.size();
+    data->pairsTo[p->to()] << data->pairs.size();
+    data->pairs << Pair{p->from(), p->to(), p->series()};
+  }
+
+  for (const Security* s : SecurityManager::instance()->securities()) {
+    data->securityCurrencies.insert(s->id(), s->currency());
+    data->securityCommodities.insert(PriceManager::securityId(s->id()));
+  }
+
+  for (const Currency* c : CurrencyManager::instance()->currencies()) {
+    data->currencies.insert(c->code(),
+                            CurrencyFormat{c->symbol(), int(c->precision())});
+  }
+
+  for (const Payee* p : PayeeManager::instance()->payees()) {
+    data->payees.insert(p->id(), p->name());
+  }
+
+  ModelSnapshot snapshot;
+  snapshot.d = data;
+  return snapshot;
+}
+
+const ModelSnapshot::AccountInfo* ModelSnapshot::account(int _id) const {
+  if (!d) {
+    return nullptr;
+  }
+
+  auto i = d->accounts.constFind(_id);
+  return i == d->accounts.constEnd() ? nullptr : &i.value();
+}
+
+const PersistentLedger* ModelSnapshot::ledger(int _id) const {
+  const LedgerVersion* l = ledgerVersion(_id);
+  return l ? &l->tree : nullptr;
+}
+
+const ModelSnapshot::LedgerVersion* ModelSnapshot::ledgerVersion(
+    int _id) const {
+  if (!d) {
+    return nullptr;
+  }
+
+  auto i = d->ledgers.constFind(_id);
+  return i == d->ledgers.constEnd() ? nullptr : &i.value();
+}
+
+QString ModelSnapshot::formatAmount(const QString& _currency,
+                                    const Amount& _amount) const {
+  if (!d || !d->currencies.contains(_currency)) {
+    return QString::number(_amount.toDouble());
+  }
+
+  const CurrencyFormat& f = d->currencies[_currency];
+  return f.symbol + _amount.toPrecision(f.precision).toString();
+}
+
+QString ModelSnapshot::payeeName(int _id) const {
+  return d ? d->payees.value(_id) : QString();
+}
+
+QPair<qint32, int> ModelSnapshot::endOfDay(const QDate& _date) {
+  return qMakePair(qint32(_date.toJulianDay()) + 1,
+                   std::numeric_limits<int>::min());
+}
+
+Balances ModelSnapshot::sumBefore(const LedgerVersion& _ledger,
+                                  const QPair<qint32, int>& _key) {
+  if (_ledger.splits.isEmpty()) {
+    return _ledger.tree.sumBefore(_key);
+  }
+
+  Balances sum;
+  Balances before;  // Untransformed sum before the current fragment
+
+  for (const StockSplit& s : _ledger.splits) {
+    if (!(s.start < _key)) {
+      break;
+    }
+
+    const Balances upTo = _ledger.tree.sumBefore(s.start);
+    sum = FragmentedTreap::transform<SplitFraction, Balances>(
+        s.ratio, sum + (upTo - before));
+    before = upTo;
+  }
+
+  return sum + (_ledger.tree.sumBefore(_key) - before);
+}
+
+Balances ModelSnapshot::balancesBetween(int _id, const QDate& _from,
+                                        const QDate& _to) const {
+  const LedgerVersion* l = ledgerVersion(_id);
+
+  if (!l) {
+    return Balances();
+  }
+
+  const QPair<qint32, int> end(std::numeric_limits<qint32>::max(),
+                               std::numeric_limits<int>::max());
+
+  Balances to = sumBefore(*l, _to.isValid() ? endOfDay(_to) : end);
+  return _from.isValid() ? to - sumBefore(*l, endOfDay(_from.addDays(-1)))
+                         : to;
+}
+
+QVector<Balances> ModelSnapshot::balancesAt(
+    int _id, const QVector<QDate>& _dates) const {
+  const LedgerVersion* l = ledgerVersion(_id);
+  QVector<Balances> balances;
+  balances.reserve(_dates.size());
+
+  for (const QDate& date : _dates) {
+    balances << (l ? sumBefore(*l, endOfDay(date)) : Balances());
+  }
+
+  return balances;
+}
+
+Amount ModelSnapshot::balanceIn(int _id, const Balances& _balances,
+                                const QString& _currency,
+                                const QDate& _date) const {
+  const AccountInfo* a = account(_id);
+
+  if (!a) {
+    return 0;
+  } else if (_currency.isEmpty() && a->mainCurrency.isEmpty()) {  // Security
+    return _balances.contains("") ? _balances.value("") : 0;
+  } else if (_currency.isEmpty()) {
+    Amount inMain;
+
+    for (auto i = _balances.begin(); i != _balances.end(); ++i) {
+      if (i.value() != 0) {
+        inMain += i.value() * rate(i.key(), a->mainCurrency, _date);
+      }
+    }
+
+    return inMain;
+  } else {
+    return _balances.contains(_currency) ? _balances[_currency] : 0;
+  }
+}
+
+double ModelSnapshot::rate(const QString& _from, const QString& _to,
+                           const QDate& _date) const {
+  if (_from == _to) {
+    return 1.;
+  }
+
+  return d ? triangulate(_from, _to, _date) : 0;
+}
+
+double ModelSnapshot::rate(int _idSecurity, const QString& _to,
+                           const QDate& _date) const {
+  if (!d) {
+    return 0;
+  }
+
+  const QString from = PriceManager::securityId(_idSecurity);
+  const QString currency = d->securityCurrencies.value(_idSecurity);
+
+  if (currency == _to) {
+    return rate(from, _to, _date);
+  } else {
+    return rate(from, currency, _date) * rate(currency, _to, _date);
+  }
+}
+
+double ModelSnapshot::triangulate(const QString& _from, const QString& _to,
+                                  const QDate& _date) const {
+  // Rate from _from to each reached commodity
+  QHash<QString, double> rates;
+  QQueue<QString> queue;
+
+  rates[_from] = 1.;
+  queue.enqueue(_from);
+
+  while (!queue.isEmpty()) {
+    const QString c = queue.dequeue();
+    const double rc = rates.value(c);
+
+    // Direct rates first, then the inverse ones. As in PriceManager, a rate to
+    // a security is not inverted to convert from it.
+    for (int inverse = 0; inverse < 2; ++inverse) {
+      const QVector<int> pairs =
+          inverse ? (d->securityCommodities.contains(c)
+                         ? QVector<int>()
+                         : d->pairsTo.value(c))
+                  : d->pairsFrom.value(c);
+
+      for (int i : pairs) {
+        const Pair& p = d->pairs[i];
+        const QString& next = inverse ? p.from : p.to;
+
+        if (rates.contains(next)) {
+          continue;
+        }
+
+        double r = _date.isValid() ? p.rates.on(_date) : p.rates.last();
+
+        if (r == 0) {
+          continue;  // No rate on this date
+        } else if (inverse) {
+          r = 1. / r;
+        }
+
+        rates[next] = rc * r;
+
+        if (next == _to) {
+          return rc * r;
+        } else if (!d->securityCommodities.contains(next)) {
+          queue.enqueue(next);
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+ModelSnapshot ModelSnapshot::current() {
+  return currentSnapshots.hasLocalData() ? currentSnapshots.localData()
+                                         : ModelSnapshot();
+}
+
+void ModelSnapshot::setCurrent(const ModelSnapshot& _snapshot) {
+  currentSnapshots.setLocalData(_snapshot);
+}
+
+}  // namespace KLib
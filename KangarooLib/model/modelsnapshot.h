@@ -0,0 +1,207 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef MODELSNAPSHOT_H
+#define MODELSNAPSHOT_H
+
+#include <QDate>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "../amount.h"
+#include "../util/balances.h"
+#include "../util/priceseries.h"
+#include "ledger.h"
+
+namespace KLib {
+
+/**
+ * @brief Immutable view of the accounts, ledgers and prices at one point in
+ * time, for readers on other threads.
+ *
+ * take() copies the account tree and the current version of each ledger (see
+ * Ledger::persistent()) and of each price series. The ledgers are persistent
+ * treaps and the price series are implicitly shared, so taking a snapshot does
+ * not copy any transaction or price: the model can be modified right after,
+ * and only the parts it modifies are copied. The stock splits of each ledger
+ * (the fragments of Ledger::transactions()) are copied too, and the balances
+ * are adjusted for them as in the ledger. The currency formats and the payee
+ * names are copied for the report scripts (see SnapshotAccount). A snapshot
+ * can be read from any number of threads.
+ *
+ * Copies of a snapshot share the same data.
+ */
+class ModelSnapshot {
+ public:
+  struct AccountInfo {
+    int id;
+    int parent;  ///< -1 for the top level account
+    QString name;
+    int type;
+    QString mainCurrency;  ///< Empty for investment accounts
+    int idSecurity;
+    bool isPlaceholder;
+    QVector<int> children;
+  };
+
+  /**
+   * @brief Builds a null snapshot
+   */
+  ModelSnapshot() {}
+
+  /**
+   * @brief Snapshot of the current model. Must be called from the thread of
+   * the model. O(number of accounts + number of exchange pairs), except for
+   * the first one, which builds the persistent ledgers (see
+   * Ledger::persistent()).
+   */
+  static ModelSnapshot take();
+
+  bool isNull() const { return !d; }
+
+  /**
+   * @brief Increases with each snapshot taken
+   */
+  quint64 version() const { return d ? d->version : 0; }
+
+  int topLevelId() const { return d ? d->topLevel : -1; }
+
+  /**
+   * @brief Account _id, nullptr if it did not exist when the snapshot was taken
+   */
+  const AccountInfo* account(int _id) const;
+
+  /**
+   * @brief Ledger of account _id, nullptr if it has none.
+   */
+  const PersistentLedger* ledger(int _id) const;
+
+  /**
+   * @brief Balances of account _id from _from to _to, inclusively. Invalid
+   * dates are unbounded.
+   */
+  Balances balancesBetween(int _id, const QDate& _from, const QDate& _to) const;
+
+  /**
+   * @brief Balances of account _id at the end of each of _dates.
+   */
+  QVector<Balances> balancesAt(int _id, const QVector<QDate>& _dates) const;
+
+  /**
+   * @brief Same as Ledger::balanceIn(), with the prices of the snapshot.
+   */
+  Amount balanceIn(int _id, const Balances& _balances, const QString& _currency,
+                   const QDate& _date) const;
+
+  /**
+   * @brief Same as PriceManager::rate(), with the prices of the snapshot.
+   */
+  double rate(const QString& _from, const QString& _to,
+              const QDate& _date = QDate()) const;
+  double rate(int _idSecurity, const QString& _to,
+              const QDate& _date = QDate()) const;
+
+  /**
+   * @brief Same as Currency::formatAmount(), with the currencies of the
+   * snapshot. The number only if _currency is not a currency.
+   */
+  QString formatAmount(const QString& _currency, const Amount& _amount) const;
+
+  /**
+   * @brief Name of payee _id, empty if it did not exist.
+   */
+  QString payeeName(int _id) const;
+
+  /**
+   * @brief Snapshot used by the readers of the current thread, null by
+   * default. See AggregationQuery.
+   */
+  static ModelSnapshot current();
+
+  /**
+   * @brief Sets the snapshot of the current thread. A null snapshot makes the
+   * readers use the live model again.
+   */
+  static void setCurrent(const ModelSnapshot& _snapshot);
+
+ private:
+  struct Pair {
+    QString from;
+    QString to;
+    PriceSeries rates;
+  };
+
+  struct StockSplit {
+    QPair<qint32, int> start;  ///< Key of the first transaction it applies to
+    SplitFraction ratio;
+  };
+
+  struct LedgerVersion {
+    PersistentLedger tree;
+    QVector<StockSplit> splits;  ///< In order
+  };
+
+  struct CurrencyFormat {
+    QString symbol;
+    int precision;
+  };
+
+  struct Data {
+    quint64 version;
+    int topLevel;
+    QHash<int, AccountInfo> accounts;
+    QHash<int, LedgerVersion> ledgers;
+
+    QVector<Pair> pairs;
+    QHash<QString, QVector<int>> pairsFrom;  ///< Indexes in pairs by from
+    QHash<QString, QVector<int>> pairsTo;    ///< Indexes in pairs by to
+    QHash<int, QString> securityCurrencies;
+    QSet<QString> securityCommodities;  ///< See PriceManager::securityId()
+
+    QHash<QString, CurrencyFormat> currencies;
+    QHash<int, QString> payees;
+  };
+
+  /**
+   * @brief Breadth-first search of the conversion with the fewest steps, as
+   * PriceManager does.
+   */
+  double triangulate(const QString& _from, const QString& _to,
+                     const QDate& _date) const;
+
+  const LedgerVersion* ledgerVersion(int _id) const;
+
+  static QPair<qint32, int> endOfDay(const QDate& _date);
+
+  /**
+   * @brief Same as FragmentedTreapMap::sumBefore(): the sum before each stock
+   * split is transformed by its ratio.
+   */
+  static Balances sumBefore(const LedgerVersion& _ledger,
+                            const QPair<qint32, int>& _key);
+
+  QSharedPointer<const Data> d;
+};
+
+}  // namespace KLib
+
+#endif  // MODELSNAPSHOT_H
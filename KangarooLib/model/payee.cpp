@@ -22,6 +22,8 @@
 #include "transaction.h"
 #include "picturemanager.h"
 #include "transactionmanager.h"
+#include "transactionindex.h"
+#include "ledger.h"
 #include "modelexception.h"
 #include <QXmlStreamReader>
 
@@ -149,6 +151,7 @@ Payee* PayeeManager::add(const QString& _name, int _idPicture)
         m_index[o->m_id] = m_payees.size();
         m_nameIndex[o->m_name] = m_payees.size();
         m_payees.append(o);
+        emit objectModified(o->m_id);
         emit modified();
         emit payeeAdded(o);
 
@@ -214,29 +217,41 @@ void PayeeManager::merge(const QSet<int>& _ids, int _idTo)
     QSet<int> newSet = _ids;
     newSet.remove(_idTo); //We don't modify transactions that already have this payee...
 
-    //Do the merge
-    for (Transaction* t : TransactionManager::instance()->transactions())
+    //Do the merge, notifying the listeners once
+    ChangeScope scope;
+    const TransactionIndex& index = TransactionManager::instance()->index();
+
+    for (int id : newSet)
     {
-        if (newSet.contains(t->idPayee()))
+        for (int idTransaction : index.transactions(TransactionIndex::ByPayee, id))
         {
+            Transaction* t = TransactionManager::instance()->get(idTransaction);
+            scope.hold(t);
             t->setIdPayee(_idTo);
         }
     }
 
     //Delete the payees
-    for (int i = 0; i < m_payees.size(); ++i)
+    for (int i = 0; i < m_payees.size();)
     {
         if (newSet.contains(m_payees[i]->id()))
         {
-            emit payeeRemoved(m_payees[i]);
-            m_payees[i]->deleteLater();
+            Payee* p = m_payees[i];
+            emit payeeRemoved(p);
+            m_index.remove(p->id());
+            m_nameIndex.remove(p->name());
             m_payees.removeAt(i);
+            p->deleteLater();
 
+            emit objectModified(p->id());
             emit modified();
         }
-
-        m_index[m_payees[i]->id()] = i;
-        m_nameIndex[m_payees[i]->name()] = i;
+        else
+        {
+            m_index[m_payees[i]->id()] = i;
+            m_nameIndex[m_payees[i]->name()] = i;
+            ++i;
+        }
     }
 }
 
@@ -261,6 +276,8 @@ void PayeeManager::remove(int _id)
     {
         int idx = m_index[_id];
         emit payeeRemoved(m_payees[idx]);
+        m_index.remove(_id);
+        m_nameIndex.remove(m_payees[idx]->name());
         m_payees[idx]->deleteLater();
         m_payees.removeAt(idx);
 
@@ -272,14 +289,12 @@ void PayeeManager::remove(int _id)
         }
 
         // Change all transactions with this payee
-        for (Transaction* t : TransactionManager::instance()->transactions())
+        for (int idTransaction : TransactionManager::instance()->index().transactions(TransactionIndex::ByPayee, _id))
         {
-            if (t->idPayee() == _id)
-            {
-                t->setIdPayee(Constants::NO_ID);
-            }
+            TransactionManager::instance()->get(idTransaction)->setIdPayee(Constants::NO_ID);
         }
 
+        emit objectModified(_id);
         emit modified();
     }
 }
@@ -291,6 +306,7 @@ void PayeeManager::onModified()
     if (o)
     {
         emit payeeModified(o);
+        emit objectModified(o->id());
         emit modified();
     }
 
@@ -303,7 +319,7 @@ void PayeeManager::onNameChanged(const QString& _old, const QString& _new)
     if (p)
     {
         m_nameIndex.remove(_old);
-        m_nameIndex[_new] = p->id();
+        m_nameIndex[_new] = m_index[p->id()];
     }
 }
 
@@ -370,6 +386,75 @@ void PayeeManager::save(QXmlStreamWriter& _writer) const
     }
 }
 
+void PayeeManager::saveObjects(const QList<int>& _ids, QXmlStreamWriter& _writer) const
+{
+    for (int id : _ids)
+    {
+        if (m_index.contains(id))
+        {
+            m_payees[m_index[id]]->save(_writer);
+        }
+        else
+        {
+            _writer.writeEmptyElement(StdTags::REMOVED);
+            _writer.writeAttribute("id", QString::number(id));
+        }
+    }
+}
+
+void PayeeManager::restoreObjects(QXmlStreamReader& _reader)
+{
+    while (_reader.readNextStartElement())
+    {
+        QXmlStreamAttributes attributes = _reader.attributes();
+        const int id = IO::getAttribute("id", attributes).toInt();
+        Payee* o = nullptr;
+
+        if (_reader.name() == StdTags::PAYEE)
+        {
+            o = new Payee();
+            o->load(_reader);
+            m_nextId = std::max(m_nextId, o->m_id + 1);
+
+            connect(o, &Payee::modified, this, &PayeeManager::onModified);
+            connect(o, &Payee::nameChanged, this, &PayeeManager::onNameChanged);
+        }
+
+        if (m_index.contains(id))
+        {
+            // Replaced by its new version, or removed
+            const int idx = m_index[id];
+            m_nameIndex.remove(m_payees[idx]->name());
+            delete m_payees[idx];
+
+            if (o)
+            {
+                m_payees[idx] = o;
+                m_nameIndex[o->m_name] = idx;
+            }
+            else
+            {
+                m_index.remove(id);
+                m_payees.removeAt(idx);
+
+                for (int i = idx; i < m_payees.size(); ++i)
+                {
+                    m_index[m_payees[i]->id()] = i;
+                    m_nameIndex[m_payees[i]->name()] = i;
+                }
+            }
+        }
+        else if (o)
+        {
+            m_index[o->m_id] = m_payees.size();
+            m_nameIndex[o->m_name] = m_payees.size();
+            m_payees.append(o);
+        }
+
+        _reader.skipCurrentElement();
+    }
+}
+
 void PayeeManager::unload()
 {
     for (Payee* i : m_payees)
@@ -383,4 +468,12 @@ void PayeeManager::unload()
     m_nextId = 0;
 }
 
+void PayeeManager::moveLoadedObjects(QThread* _thread)
+{
+    for (Payee* o : m_payees)
+    {
+        o->moveToThread(_thread);
+    }
+}
+
 }
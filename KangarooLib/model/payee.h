@@ -133,6 +133,14 @@ class PayeeManager : public IStored {
   void save(QXmlStreamWriter& _writer) const override;
   void unload() override;
 
+  bool loadsConcurrently() const override { return true; }
+  void moveLoadedObjects(QThread* _thread) override;
+
+  bool journalsObjects() const override { return true; }
+  void saveObjects(const QList<int>& _ids,
+                   QXmlStreamWriter& _writer) const override;
+  void restoreObjects(QXmlStreamReader& _reader) override;
+
  private:
   QHash<int, int> m_index;
   QHash<QString, int> m_nameIndex;
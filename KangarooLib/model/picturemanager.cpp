@@ -22,6 +22,8 @@
 #include "../controller/archive.h"
 #include "../controller/io.h"
 
+#include <QBuffer>
+#include <QImage>
 #include <QImageReader>
 #include <QXmlStreamReader>
 
@@ -143,6 +145,45 @@ namespace KLib
         }
     }
 
+    QVariant PictureManager::decodeFile(const QString& _name, const QByteArray& _data) const
+    {
+        Q_UNUSED(_name)
+
+        //QPixmap can only be used on the main thread, decode and scale as QImage here.
+        QBuffer buffer;
+        buffer.setData(_data);
+        buffer.open(QIODevice::ReadOnly);
+
+        QImageReader reader(&buffer, PictureManager::SAVE_FILE_FORMAT);
+        QImage image = reader.read();
+        QImage thumbnail;
+
+        if (!image.isNull())
+        {
+            thumbnail = image.scaled(PictureManager::THUMBNAIL_SIZE,
+                                     Qt::KeepAspectRatio,
+                                     Qt::SmoothTransformation);
+        }
+
+        return QVariantList() << image << thumbnail;
+    }
+
+    void PictureManager::loadDecodedFile(const QString& _name, const QVariant& _decoded)
+    {
+        int id = _name.toInt();
+        QVariantList images = _decoded.toList();
+
+        if (m_pictures.contains(id) && images.size() == 2)
+        {
+            m_pictures[id]->picture = QPixmap::fromImage(images[0].value<QImage>());
+            m_pictures[id]->thumbnail = QPixmap::fromImage(images[1].value<QImage>());
+        }
+        else
+        {
+            qDebug() << tr("Unknown picture file received: %1").arg(_name);
+        }
+    }
+
     void PictureManager::saveFiles(Archive& _archive)
     {
         for (Picture* p : m_pictures)
@@ -86,6 +86,9 @@ namespace KLib
 
             void saveFiles(Archive& _archive);
 
+            QVariant decodeFile(const QString& _name, const QByteArray& _data) const;
+            void loadDecodedFile(const QString& _name, const QVariant& _decoded);
+
             //From Stored
             void load(QXmlStreamReader& _reader);
             void save(QXmlStreamWriter& _writer) const;
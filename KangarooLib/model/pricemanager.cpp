@@ -19,51 +19,50 @@
 
 #include "pricemanager.h"
 
+#include "../controller/columnarformat.h"
 #include "../controller/io.h"
 #include "modelexception.h"
 #include "security.h"
 // #include "currency.h"
 
+#include <QQueue>
 #include <QXmlStreamReader>
 
 namespace KLib {
 
 PriceManager* PriceManager::m_instance = new PriceManager();
 const unsigned int PriceManager::DECIMALS_RATE = 8;
+const int PriceManager::MAX_MEMOIZED_RATES = 1 << 16;
 
 void ExchangePair::set(const QDate& _date, double _rate) {
-  m_rates[_date] = _rate;
+  {
+    QWriteLocker locker(&PriceManager::instance()->m_ratesLock);
+    m_rates.set(_date, _rate);
+  }
+
   emit rateSet(_date);
 }
 
 void ExchangePair::remove(const QDate& _date) {
-  m_rates.erase(_date);
-  emit rateRemoved(_date);
-}
-
-double ExchangePair::on(const QDate& _date) const {
-  if (m_rates.empty()) {
-    return 0;
-  }
-  auto it = m_rates.lower_bound(_date);
-  if (it->first > _date && it == m_rates.begin()) {
-    return 0;
-  } else if (it == m_rates.end() || it->first > _date) {
-    --it;
+  {
+    QWriteLocker locker(&PriceManager::instance()->m_ratesLock);
+    m_rates.remove(_date);
   }
 
-  return it->second;
+  emit rateRemoved(_date);
 }
 
-double ExchangePair::last() const {
-  return m_rates.empty() ? 0 : (--m_rates.end())->second;
-}
+double ExchangePair::on(const QDate& _date) const { return m_rates.on(_date); }
+
+double ExchangePair::last() const { return m_rates.last(); }
 
 const QList<ExchangePair::Rate> ExchangePair::rates() const {
   QList<Rate> rat;
+  PriceSeries::View all = m_rates.all();
+  rat.reserve(all.size());
 
-  for (auto i = m_rates.begin(); i != m_rates.end(); ++i) {
-    rat << QPair<QDate, double>(i->first, i->second);
+  for (int i = 0; i < all.size(); ++i) {
+    rat << Rate(all.dateAt(i), all.valueAt(i));
   }
 
   return rat;
@@ -109,9 +108,9 @@ void ExchangePair::load(QXmlStreamReader& _reader) {
           _reader.name() == StdTags::PRICE) {
         attributes = _reader.attributes();
 
-        m_rates.insert({QDate::fromString(IO::getAttribute("date", attributes),
-                                          Qt::ISODate),
-                        IO::getAttribute("value", attributes).toDouble()});
+        m_rates.set(QDate::fromString(IO::getAttribute("date", attributes),
+                                      Qt::ISODate),
+                    IO::getAttribute("value", attributes).toDouble());
       }
 
       _reader.readNext();
@@ -127,10 +126,12 @@ void ExchangePair::save(QXmlStreamWriter& _writer) const {
   _writer.writeAttribute("autoupdate", m_autoUpdate ? "true" : "false");
   _writer.writeAttribute("updatesource", m_updateSource);
 
-  for (auto i = m_rates.begin(); i != m_rates.end(); ++i) {
+  PriceSeries::View all = m_rates.all();
+
+  for (int i = 0; i < all.size(); ++i) {
     _writer.writeEmptyElement(StdTags::PRICE);
-    _writer.writeAttribute("date", i->first.toString(Qt::ISODate));
-    _writer.writeAttribute("value", QString::number(i->second));
+    _writer.writeAttribute("date", all.dateAt(i).toString(Qt::ISODate));
+    _writer.writeAttribute("value", QString::number(all.valueAt(i)));
   }
 
   _writer.writeEndElement();
@@ -138,7 +139,7 @@ void ExchangePair::save(QXmlStreamWriter& _writer) const {
 
 /* ####################################################################### */
 
-PriceManager::PriceManager() : m_noEmit(false) {}
+PriceManager::PriceManager() : m_noEmit(false), m_graphValid(false) {}
 
 ExchangePair* PriceManager::add(const QString& _from, const QString& _to) {
   if (m_index.contains(PricePair(_from, _to))) {
@@ -155,6 +156,7 @@ ExchangePair* PriceManager::add(const QString& _from, const QString& _to) {
 
   m_index[PricePair(_from, _to)] = m_pairs.size();
   m_pairs << p;
+  registerPair(p);
 
   emit modified();
   emit exchangePairAdded(p);
@@ -205,6 +207,8 @@ void PriceManager::remove(const QString& _from, const QString& _to) {
       m_index[PricePair(m_pairs[i]->from(), m_pairs[i]->to())] = i;
     }
 
+    invalidateRates(true);
+
     emit modified();
     emit exchangePairRemoved(p);
     p->deleteLater();
@@ -225,16 +229,20 @@ void PriceManager::removeAll(const QString& _fromTo) {
       ++i;
     }
   }
+
+  invalidateRates(true);
 }
 
 void PriceManager::onRateSet(const QDate& _date) {
   ExchangePair* p = static_cast<ExchangePair*>(sender());
 
   if (p) {
+    invalidateRates(false);
+
     emit rateSet(p, _date);
     emit modified();
 
-    if (_date == p->m_rates.end()->first) {
+    if (_date == p->m_rates.lastDate()) {
       emit lastRateModified(p);
     }
   }
@@ -244,10 +252,12 @@ void PriceManager::onRateRemoved(const QDate& _date) {
   ExchangePair* p = static_cast<ExchangePair*>(sender());
 
   if (p) {
+    invalidateRates(false);
+
     emit rateRemoved(p, _date);
     emit modified();
 
-    if (_date > p->m_rates.end()->first) {
+    if (p->m_rates.isEmpty() || _date > p->m_rates.lastDate()) {
       emit lastRateModified(p);
     }
   }
@@ -263,37 +273,213 @@ double PriceManager::rate(const QString& _from, const QString& _to,
     return 1.;
   }
 
-  if (m_index.contains(PricePair(_from, _to))) {
-    if (_date.isValid()) {
-      return get(_from, _to)->on(_date);
-    } else {
-      return get(_from, _to)->last();
-    }
-  }
-  // Try the reverse
-  else if (!_from.startsWith("SEC") &&
-           m_index.contains(PricePair(_to, _from))) {
-    if (_date.isValid()) {
-      return 1. / get(_to, _from)->on(_date);
-    } else {
-      return 1. / get(_to, _from)->last();
-    }
-  } else {
-    return 0;
-  }
+  QReadLocker locker(&m_ratesLock);
+  const int from = m_commodityIds.value(_from, -1);
+  const int to = m_commodityIds.value(_to, -1);
+  locker.unlock();
+
+  return cachedRate(from, to, _date);
 }
 
 double PriceManager::rate(int _idSecurity, const QString& _to,
                           const QDate& _date) const {
   Security* s = SecurityManager::instance()->get(_idSecurity);
+
+  // No "SEC<id>" formatting: securities are looked up by id.
+  QReadLocker locker(&m_ratesLock);
+  const int from = m_securityIds.value(_idSecurity, -1);
+  const int currency = m_commodityIds.value(s->currency(), -1);
+  const int to = m_commodityIds.value(_to, -1);
+  locker.unlock();
+
   if (s->currency() == _to) {
-    return rate(securityId(_idSecurity), _to, _date);
+    return cachedRate(from, to, _date);
   } else {
-    return rate(securityId(_idSecurity), s->currency(), _date) *
-           rate(s->currency(), _to, _date);
+    return cachedRate(from, currency, _date) *
+           cachedRate(currency, to, _date);
   }
 }
 
+QVector<double> PriceManager::rates(const QString& _from, const QString& _to,
+                                   const QVector<QDate>& _dates) const {
+  if (_from == _to) {
+    return QVector<double>(_dates.size(), 1.);
+  }
+
+  QReadLocker locker(&m_ratesLock);
+  const int from = m_commodityIds.value(_from, -1);
+  const int to = m_commodityIds.value(_to, -1);
+  locker.unlock();
+
+  QVector<double> result(_dates.size());
+
+  for (int i = 0; i < _dates.size(); ++i) {
+    result[i] = cachedRate(from, to, _dates[i]);
+  }
+
+  return result;
+}
+
+QVector<double> PriceManager::rates(int _idSecurity, const QString& _to,
+                                   const QVector<QDate>& _dates) const {
+  Security* s = SecurityManager::instance()->get(_idSecurity);
+
+  QReadLocker locker(&m_ratesLock);
+  const int from = m_securityIds.value(_idSecurity, -1);
+  const int currency = m_commodityIds.value(s->currency(), -1);
+  const int to = m_commodityIds.value(_to, -1);
+  locker.unlock();
+
+  QVector<double> result(_dates.size());
+
+  for (int i = 0; i < _dates.size(); ++i) {
+    result[i] = s->currency() == _to
+                    ? cachedRate(from, to, _dates[i])
+                    : cachedRate(from, currency, _dates[i]) *
+                          cachedRate(currency, to, _dates[i]);
+  }
+
+  return result;
+}
+
+double PriceManager::cachedRate(int _from, int _to, const QDate& _date) const {
+  if (_from == -1 || _to == -1) {
+    return 0;
+  } else if (_from == _to) {
+    return 1.;
+  }
+
+  const RateKey key(_from, _to, _date);
+
+  {
+    QReadLocker locker(&m_ratesLock);
+    auto i = m_memo.constFind(key);
+
+    if (i != m_memo.constEnd()) {
+      return *i;
+    }
+  }
+
+  QWriteLocker locker(&m_ratesLock);
+
+  // Another thread may have resolved it in the meantime
+  auto i = m_memo.constFind(key);
+  if (i != m_memo.constEnd()) {
+    return *i;
+  }
+
+  if (!m_graphValid) {
+    buildGraph();
+  }
+
+  if (m_memo.size() >= MAX_MEMOIZED_RATES) {
+    m_memo.clear();
+  }
+
+  const double rate = triangulate(_from, _to, _date);
+  m_memo.insert(key, rate);
+  return rate;
+}
+
+double PriceManager::triangulate(int _from, int _to, const QDate& _date) const {
+  // Rate from _from to each reached commodity, 0 if not reached yet
+  QVector<double> rates(m_graph.size(), 0);
+  QQueue<int> queue;
+
+  rates[_from] = 1.;
+  queue.enqueue(_from);
+
+  while (!queue.isEmpty()) {
+    const int c = queue.dequeue();
+
+    for (const Edge& e : m_graph[c]) {
+      if (rates[e.to] != 0) {
+        continue;
+      }
+
+      double r = _date.isValid() ? e.pair->on(_date) : e.pair->last();
+
+      if (r == 0) {
+        continue;  // No rate on this date
+      } else if (e.inverse) {
+        r = 1. / r;
+      }
+
+      rates[e.to] = rates[c] * r;
+
+      if (e.to == _to) {
+        return rates[e.to];
+      } else if (!m_isSecurity[e.to]) {
+        queue.enqueue(e.to);
+      }
+    }
+  }
+
+  return 0;
+}
+
+void PriceManager::buildGraph() const {
+  m_graph.fill(QVector<Edge>(), m_isSecurity.size());
+
+  // Direct edges first, so that they are preferred to the inverse ones.
+  for (const ExchangePair* p : m_pairs) {
+    m_graph[m_commodityIds.value(p->m_from)]
+        << Edge{m_commodityIds.value(p->m_to), p, false};
+  }
+
+  // As before, a rate to a security is not inverted to convert from it.
+  for (const ExchangePair* p : m_pairs) {
+    const int to = m_commodityIds.value(p->m_to);
+
+    if (!m_isSecurity[to]) {
+      m_graph[to] << Edge{m_commodityIds.value(p->m_from), p, true};
+    }
+  }
+
+  m_graphValid = true;
+}
+
+void PriceManager::registerPair(const ExchangePair* _p) {
+  QWriteLocker locker(&m_ratesLock);
+  intern(_p->m_from);
+  intern(_p->m_to);
+  m_graphValid = false;
+  m_memo.clear();
+}
+
+int PriceManager::intern(const QString& _commodity) {
+  auto i = m_commodityIds.constFind(_commodity);
+  if (i != m_commodityIds.constEnd()) {
+    return *i;
+  }
+
+  const int id = m_isSecurity.size();
+  m_commodityIds.insert(_commodity, id);
+
+  bool isSecurity = false;
+  if (_commodity.startsWith("SEC")) {
+    int idSecurity = QStringRef(&_commodity, 3, _commodity.size() - 3)
+                         .toInt(&isSecurity);
+
+    if (isSecurity) {
+      m_securityIds.insert(idSecurity, id);
+    }
+  }
+
+  m_isSecurity << isSecurity;
+  return id;
+}
+
+void PriceManager::invalidateRates(bool _graph) {
+  QWriteLocker locker(&m_ratesLock);
+
+  if (_graph) {
+    m_graphValid = false;
+  }
+
+  m_memo.clear();
+}
+
 void PriceManager::load(QXmlStreamReader& _reader) {
   unload();
 
@@ -307,6 +493,7 @@ void PriceManager::load(QXmlStreamReader& _reader) {
       p->load(_reader);
       m_index[PricePair(p->from(), p->to())] = m_pairs.size();
       m_pairs << p;
+      registerPair(p);
 
       connect(p, SIGNAL(rateSet(QDate)), this, SLOT(onRateSet(QDate)));
       connect(p, SIGNAL(rateRemoved(QDate)), this, SLOT(onRateRemoved(QDate)));
@@ -324,6 +511,92 @@ void PriceManager::save(QXmlStreamWriter& _writer) const {
   }
 }
 
+void PriceManager::saveColumns(ColumnWriter& _writer) const {
+  const int n = m_pairs.size();
+
+  QVector<QString> from(n), to(n), source(n);
+  QVector<quint8> autoUpdate(n);
+  QVector<qint32> rateCount(n);
+  QVector<qint32> rateDate;
+  QVector<double> rateValue;
+
+  for (int row = 0; row < n; ++row) {
+    const ExchangePair* p = m_pairs[row];
+
+    from[row] = p->m_from;
+    to[row] = p->m_to;
+    source[row] = p->m_updateSource;
+    autoUpdate[row] = p->m_autoUpdate;
+    rateCount[row] = p->m_rates.count();
+
+    PriceSeries::View all = p->m_rates.all();
+    rateDate.reserve(rateDate.size() + all.size());
+    rateValue.reserve(rateValue.size() + all.size());
+
+    for (int i = 0; i < all.size(); ++i) {
+      rateDate << all.days()[i];
+      rateValue << all.valueAt(i);
+    }
+  }
+
+  _writer.addStringColumn("px.from", from);
+  _writer.addStringColumn("px.to", to);
+  _writer.addStringColumn("px.source", source);
+  _writer.addColumn("px.auto", autoUpdate);
+  _writer.addColumn("px.rates", rateCount);
+  _writer.addColumn("rt.date", rateDate);
+  _writer.addColumn("rt.value", rateValue);
+}
+
+void PriceManager::loadColumns(const ColumnReader& _reader) {
+  unload();
+
+  const int n = _reader.count("px.auto");
+  const int nRates = _reader.count("rt.date");
+
+  ColumnReader::StringColumn from = _reader.strings("px.from", n);
+  ColumnReader::StringColumn to = _reader.strings("px.to", n);
+  ColumnReader::StringColumn source = _reader.strings("px.source", n);
+  const quint8* autoUpdate = _reader.column<quint8>("px.auto", n);
+  const qint32* rateCount = _reader.column<qint32>("px.rates", n);
+  const qint32* rateDate = _reader.column<qint32>("rt.date", nRates);
+  const double* rateValue = _reader.column<double>("rt.value", nRates);
+
+  m_noEmit = true;
+  m_pairs.reserve(n);
+
+  int rate = 0;
+
+  for (int row = 0; row < n; ++row) {
+    if (rateCount[row] < 0 || rate + rateCount[row] > nRates) {
+      throw IOException(tr("Invalid rate columns for exchange pair %1 -> %2.")
+                            .arg(from.at(row))
+                            .arg(to.at(row)));
+    }
+
+    ExchangePair* p = new ExchangePair();
+    p->m_from = from.at(row);
+    p->m_to = to.at(row);
+    p->m_updateSource = source.at(row);
+    p->m_autoUpdate = autoUpdate[row];
+
+    // Rates are saved in order, so each one is appended.
+    p->m_rates.reserve(rateCount[row]);
+    for (int end = rate + rateCount[row]; rate < end; ++rate) {
+      p->m_rates.set(QDate::fromJulianDay(rateDate[rate]), rateValue[rate]);
+    }
+
+    m_index[PricePair(p->from(), p->to())] = m_pairs.size();
+    m_pairs << p;
+    registerPair(p);
+
+    connect(p, SIGNAL(rateSet(QDate)), this, SLOT(onRateSet(QDate)));
+    connect(p, SIGNAL(rateRemoved(QDate)), this, SLOT(onRateRemoved(QDate)));
+  }
+
+  m_noEmit = false;
+}
+
 void PriceManager::unload() {
   for (ExchangePair* p : m_pairs) {
     delete p;
@@ -332,6 +605,20 @@ void PriceManager::unload() {
   m_pairs.clear();
   m_index.clear();
   m_noEmit = false;
+
+  QWriteLocker locker(&m_ratesLock);
+  m_commodityIds.clear();
+  m_securityIds.clear();
+  m_isSecurity.clear();
+  m_graph.clear();
+  m_graphValid = false;
+  m_memo.clear();
+}
+
+void PriceManager::moveLoadedObjects(QThread* _thread) {
+  for (ExchangePair* p : m_pairs) {
+    p->moveToThread(_thread);
+  }
 }
 
 }  // namespace KLib
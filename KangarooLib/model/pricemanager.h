@@ -22,6 +22,7 @@
 
 #include "stored.h"
 #include "../amount.h"
+#include "../util/priceseries.h"
 //#include "../util/treapmap.h"
 #include "../interfaces/scriptable.h"
 
@@ -29,6 +30,7 @@
 #include <QPair>
 #include <QDate>
 #include <QVector>
+#include <QReadWriteLock>
 
 namespace KLib
 {
@@ -55,13 +57,22 @@ namespace KLib
 
             typedef QPair<QDate, double> Rate;
 
+            /**
+             * @brief Sets or removes a rate. The rates are modified with the rates lock of PriceManager held for
+             * writing, since other threads may be converting amounts with them.
+             */
             Q_INVOKABLE void set(const QDate& _date, double _rate);
             Q_INVOKABLE void remove(const QDate& _date);
 
             Q_INVOKABLE double on(const QDate& _date) const;
             Q_INVOKABLE double last() const;
 
-            int count() const { return m_rates.size(); }
+            /**
+             * @brief Rates as of each of _dates, see PriceSeries::on()
+             */
+            QVector<double> on(const QVector<QDate>& _dates) const { return m_rates.on(_dates); }
+
+            int count() const { return m_rates.count(); }
 
             bool isSecurity() const { return m_from.size() > 3; }
             QString to() const { return m_to; }
@@ -74,8 +85,21 @@ namespace KLib
 
             Q_INVOKABLE Security* securityFrom() const;
 
+            /**
+             * @brief Copy of the rates, for scripts. Use series() to read them without copying.
+             */
             Q_INVOKABLE const QList<Rate> rates() const;
 
+            const PriceSeries& series() const { return m_rates; }
+
+            /**
+             * @brief Rates from _from to _to, inclusively. The view is invalidated by set() and remove().
+             */
+            PriceSeries::View ratesBetween(const QDate& _from, const QDate& _to) const
+            {
+                return m_rates.between(_from, _to);
+            }
+
         signals:
             void rateSet(const QDate& _date);
             void rateRemoved(const QDate& _date);
@@ -92,7 +116,7 @@ namespace KLib
 
             mutable Security* m_security;
 
-            std::map<QDate, double> m_rates;
+            PriceSeries m_rates;
 
             friend class PriceManager;
     };
@@ -117,15 +141,35 @@ namespace KLib
 
             Q_INVOKABLE const QVector<KLib::ExchangePair*>& pairs() const { return m_pairs; }
 
+            /**
+             * @brief Rate from _from to _to on _date (the last rate if _date is invalid).
+             *
+             * If there is no exchange pair between the two, the rate is triangulated through the currencies
+             * with the fewest conversions. Securities are only converted from or to, never through. Returns 0
+             * if there is no such path.
+             *
+             * Rates are memoized per (from, to, date) until a rate or an exchange pair is modified.
+             */
             Q_INVOKABLE double rate(int _idSecurity, const QString& _to, const QDate& _date = QDate()) const;
             Q_INVOKABLE double rate(const QString& _from, const QString& _to, const QDate& _date = QDate()) const;
 
+            /**
+             * @brief rate() on each of _dates. The commodities are resolved once for all the dates.
+             */
+            QVector<double> rates(int _idSecurity, const QString& _to, const QVector<QDate>& _dates) const;
+            QVector<double> rates(const QString& _from, const QString& _to, const QVector<QDate>& _dates) const;
+
             static PriceManager* instance() { return m_instance; }
 
             static QString securityId(int _idSecurity);
 
             static const unsigned int DECIMALS_RATE;
 
+            /**
+             * @brief Number of memoized rates after which the memo is cleared
+             */
+            static const int MAX_MEMOIZED_RATES;
+
         signals:
             void exchangePairAdded(KLib::ExchangePair* _p);
             void exchangePairRemoved(KLib::ExchangePair* _p);
@@ -144,15 +188,86 @@ namespace KLib
             virtual void save(QXmlStreamWriter& _writer) const override;
             virtual void unload() override;
 
+            virtual bool hasColumns() const override { return true; }
+            virtual void loadColumns(const ColumnReader& _reader) override;
+            virtual void saveColumns(ColumnWriter& _writer) const override;
+
+            virtual bool loadsConcurrently() const override { return true; }
+            virtual void moveLoadedObjects(QThread* _thread) override;
+
         private:
             PriceManager();
 
+            struct RateKey
+            {
+                RateKey(int _from, int _to, const QDate& _date) : from(_from), to(_to), date(_date) {}
+
+                bool operator==(const RateKey& _other) const
+                {
+                    return from == _other.from && to == _other.to && date == _other.date;
+                }
+
+                int from;
+                int to;
+                QDate date;
+            };
+
+            friend uint qHash(const RateKey& _key, uint _seed)
+            {
+                return qHash(qMakePair(_key.from, _key.to), _seed) ^ qHash(_key.date, _seed);
+            }
+
+            /**
+             * @brief Conversion from a commodity to another by an exchange pair, or by its inverse
+             */
+            struct Edge
+            {
+                int to;
+                const ExchangePair* pair;
+                bool inverse;
+            };
+
+            /**
+             * @brief Interns the commodities of _p and invalidates the graph. Locks m_ratesLock for writing, so the
+             * caller must not hold it.
+             */
+            void registerPair(const ExchangePair* _p);
+            int  intern(const QString& _commodity);
+
+            /**
+             * @brief Clears the memoized rates, and the graph if _graph is true.
+             */
+            void invalidateRates(bool _graph);
+
+            /**
+             * @brief Memoized rate between two commodity ids, -1 being an unknown commodity.
+             */
+            double cachedRate(int _from, int _to, const QDate& _date) const;
+
+            /**
+             * @brief Breadth-first search of the conversion with the fewest steps. m_ratesLock must be locked for
+             * writing, and the graph must be built.
+             */
+            double triangulate(int _from, int _to, const QDate& _date) const;
+            void   buildGraph() const;
+
             QVector<ExchangePair*> m_pairs;
             QHash<PricePair, int> m_index;
 
             bool m_noEmit;
 
+            //Rate resolution. Commodity ids are stable until unload().
+            mutable QReadWriteLock m_ratesLock;
+            QHash<QString, int> m_commodityIds;
+            QHash<int, int> m_securityIds;      ///< Security id -> commodity id of "SEC<id>"
+            QVector<bool> m_isSecurity;         ///< Per commodity id
+            mutable QVector<QVector<Edge> > m_graph;
+            mutable bool m_graphValid;
+            mutable QHash<RateKey, double> m_memo;
+
             static PriceManager* m_instance;
+
+            friend class ExchangePair;
     };
 
 }
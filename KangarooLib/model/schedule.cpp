@@ -989,6 +989,9 @@ Schedule* ScheduleManager::add(const QString& _name,
     }
 
     m_schedules.append(o);
+    m_index.insert(o->id(), o);
+    reindex(o);
+
     emit modified();
     emit scheduleAdded(o);
 
@@ -1011,6 +1014,7 @@ void ScheduleManager::onModified()
 
     if (sch)
     {
+        reindex(sch);
         emit scheduleModified(sch);
         emit modified();
     }
@@ -1022,6 +1026,7 @@ void ScheduleManager::onRecurrenceModified()
 
     if (sch)
     {
+        reindex(sch);
         emit scheduleRecurrenceModified(sch);
     }
 }
@@ -1032,6 +1037,7 @@ void ScheduleManager::onEntered(const QDate& _occurrenceDate)
 
     if (sch)
     {
+        reindex(sch);
         emit scheduleOccurrenceEntered(sch, _occurrenceDate);
     }
 }
@@ -1042,22 +1048,21 @@ void ScheduleManager::onCanceled(const QDate& _occurrenceDate)
 
     if (sch)
     {
+        reindex(sch);
         emit scheduleOccurrenceCanceled(sch, _occurrenceDate);
     }
 }
 
 Schedule* ScheduleManager::get(int _id) const
 {
-    foreach (Schedule* i, m_schedules)
+    Schedule* s = m_index.value(_id);
+
+    if (!s)
     {
-        if (i->id() == _id)
-        {
-            return i;
-        }
+        ModelException::throwException(tr("No such schedule."), this);
     }
 
-    ModelException::throwException(tr("No such schedule."), this);
-    return nullptr;
+    return s;
 }
 
 void ScheduleManager::remove(int _id)
@@ -1067,6 +1072,7 @@ void ScheduleManager::remove(int _id)
         if (m_schedules[i]->id() == _id)
         {
             emit scheduleRemoved(m_schedules[i]);
+            unindex(m_schedules[i]);
             m_schedules[i]->deleteLater();
             m_schedules.removeAt(i);
 
@@ -1078,60 +1084,139 @@ void ScheduleManager::remove(int _id)
 
 void ScheduleManager::removeSchedulesForAccount(int _idAccount)
 {
-    auto i = m_schedules.begin();
+    //Copy, since unindex() modifies the list
+    const QList<Schedule*> related = m_byAccount.value(_idAccount);
 
-    while (i != m_schedules.end())
+    for (Schedule* s : related)
     {
-        //Check if related to the account
-        if ((*i)->transaction()->relatedTo(_idAccount))
-        {
-            emit scheduleRemoved(*i);
-            (*i)->deleteLater();
-            i = m_schedules.erase(i);
-            emit modified();
-        }
-        else
-        {
-            ++i;
-        }
+        emit scheduleRemoved(s);
+        unindex(s);
+        m_schedules.removeOne(s);
+        s->deleteLater();
+        emit modified();
     }
 }
 
 QList<Schedule*> ScheduleManager::schedulesFor(int _idAccount) const
+{
+    return m_byAccount.value(_idAccount);
+}
+
+QList<KLib::Schedule*> ScheduleManager::dueSchedules(QList<QDate>& _dates) const
 {
     QList<Schedule*> list;
+    _dates.clear();
+
+    const QDate today = QDate::currentDate();
 
-    for (Schedule* s : m_schedules)
+    for (auto i = m_queue.begin(); i != m_queue.end() && i->first <= today; ++i)
     {
-        if (s->transaction()->relatedTo(_idAccount))
-        {
-            list << s;
-        }
+        list << m_index.value(i->second);
+        _dates << i->first;
     }
 
     return list;
 }
 
-QList<KLib::Schedule*> ScheduleManager::dueSchedules(QList<QDate>& _dates) const
+int ScheduleManager::enterDueOccurrences()
 {
-    QList<Schedule*> list;
-    _dates.clear();
+    ChangeScope scope;
+    const QDate today = QDate::currentDate();
+    QList<QDate> dates;
+    int count = 0;
 
-    for (Schedule* s : m_schedules)
+    for (Schedule* s : dueSchedules(dates))
     {
-        if (s->isActive())
+        if (s->autoEnter())
         {
-            QList<QDate> d = s->nextOccurrencesDates(1);
-
-            if (d.count() && d[0] <= QDate::currentDate())
+            for (const QDate& d : s->nextOccurrencesDates(-1, today))
             {
-                list << s;
-                _dates << d;
+                s->enterOccurrenceOf(d);
+                ++count;
             }
         }
     }
 
-    return list;
+    return count;
+}
+
+void ScheduleManager::reindex(Schedule* _schedule)
+{
+    const int id = _schedule->id();
+
+    //Queue of the next occurrences
+    auto prev = m_nextOccurrences.find(id);
+
+    if (prev != m_nextOccurrences.end())
+    {
+        m_queue.erase(std::make_pair(prev.value(), id));
+        m_nextOccurrences.erase(prev);
+    }
+
+    QList<QDate> next = _schedule->nextOccurrencesDates(1); //Empty if not active
+
+    if (!next.isEmpty())
+    {
+        m_queue.insert(std::make_pair(next.first(), id));
+        m_nextOccurrences.insert(id, next.first());
+    }
+
+    //Accounts
+    QSet<int> accounts;
+
+    if (_schedule->transaction())
+    {
+        for (const Transaction::Split& s : _schedule->transaction()->splits())
+        {
+            accounts.insert(s.idAccount);
+        }
+    }
+
+    const QSet<int> previous = m_accounts.value(id);
+
+    for (int idAccount : previous)
+    {
+        if (!accounts.contains(idAccount))
+        {
+            auto i = m_byAccount.find(idAccount);
+            i.value().removeOne(_schedule);
+
+            if (i.value().isEmpty())
+                m_byAccount.erase(i);
+        }
+    }
+
+    for (int idAccount : accounts)
+    {
+        if (!previous.contains(idAccount))
+            m_byAccount[idAccount].append(_schedule);
+    }
+
+    if (accounts.isEmpty())
+        m_accounts.remove(id);
+    else
+        m_accounts.insert(id, accounts);
+}
+
+void ScheduleManager::unindex(Schedule* _schedule)
+{
+    const int id = _schedule->id();
+
+    if (m_nextOccurrences.contains(id))
+    {
+        m_queue.erase(std::make_pair(m_nextOccurrences.take(id), id));
+    }
+
+    for (int idAccount : m_accounts.take(id))
+    {
+        auto i = m_byAccount.find(idAccount);
+        i.value().removeOne(_schedule);
+
+        if (i.value().isEmpty())
+            m_byAccount.erase(i);
+    }
+
+    m_index.remove(id);
 }
 
 void ScheduleManager::load(QXmlStreamReader& _reader)
@@ -1147,6 +1232,8 @@ void ScheduleManager::load(QXmlStreamReader& _reader)
             o->load(_reader);
             m_nextId = std::max(m_nextId, o->m_id + 1);
             m_schedules.append(o);
+            m_index.insert(o->id(), o);
+            reindex(o);
             connectSignals(o);
         }
 
@@ -1170,6 +1257,11 @@ void ScheduleManager::unload()
     }
 
     m_schedules.clear();
+    m_index.clear();
+    m_queue.clear();
+    m_nextOccurrences.clear();
+    m_byAccount.clear();
+    m_accounts.clear();
     m_nextId = 0;
 }
 
@@ -1184,6 +1276,7 @@ void ScheduleManager::afterLoad()
         if ((*i)->nextOccurrencesDates(1).isEmpty())
         {
             emit scheduleRemoved(*i);
+            unindex(*i);
             (*i)->deleteLater();
             i = m_schedules.erase(i);
             emit modified();
@@ -22,7 +22,11 @@
 
 #include <QDate>
 #include <list>
+#include <set>
+#include <utility>
+#include <QHash>
 #include <QList>
+#include <QSet>
 #include "stored.h"
 #include "transaction.h"
 
@@ -271,6 +275,8 @@ namespace KLib
     {
         Q_OBJECT
 
+        Q_PROPERTY(int count READ count)
+
         public:
             Schedule*   add(const QString& _name,
                             bool _autoEnter,
@@ -292,17 +298,35 @@ namespace KLib
              * @return All the active schedules matching the criteria.
              *
              * Returns a list of <b>active</b> schedules that include the account identified by _idAccount in a split
-             * of the scheduled transaction.
+             * of the scheduled transaction. O(number of schedules returned).
              */
             QList<Schedule*> schedulesFor(int _idAccount) const;
 
             /**
              * @brief dueSchedules
              * @param[out] _dates Will contain the dates the schedules are due, same order as returned list.
-             * @return A list of the schedules due to be added.
+             * @return A list of the schedules due to be added, earliest first.
+             *
+             * O(log n + number of schedules returned), see nextOccurrence().
              */
             QList<Schedule*> dueSchedules(QList<QDate>& _dates) const;
 
+            /**
+             * @brief Next occurrence of schedule _idSchedule, invalid if it is not active or has no more
+             * occurrences. O(1).
+             *
+             * The next occurrence of each schedule is kept in a queue ordered by date, which is updated when an
+             * occurrence is entered or canceled and when the schedule is modified.
+             */
+            QDate nextOccurrence(int _idSchedule) const { return m_nextOccurrences.value(_idSchedule); }
+
+            /**
+             * @brief Enters all the occurrences of the active auto-entered schedules that are due today or before,
+             * in a single change scope (see ChangeScope).
+             * @return The number of occurrences entered.
+             */
+            int enterDueOccurrences();
+
             static ScheduleManager* instance() { return m_instance; }
 
         signals:
@@ -324,8 +348,24 @@ namespace KLib
         private:
             void connectSignals(Schedule* _schedule);
 
+            /**
+             * @brief Updates the next occurrence of _schedule in the queue, and its accounts in m_byAccount.
+             */
+            void reindex(Schedule* _schedule);
+
+            /**
+             * @brief Removes _schedule from the indexes.
+             */
+            void unindex(Schedule* _schedule);
+
             QList<Schedule*> m_schedules;
 
+            QHash<int, Schedule*> m_index;                  ///< Schedules by id
+            std::set<std::pair<QDate, int> > m_queue;       ///< (Next occurrence, id) of each schedule, earliest first
+            QHash<int, QDate> m_nextOccurrences;            ///< Key of each schedule in m_queue
+            QHash<int, QList<Schedule*> > m_byAccount;      ///< Schedules with a split in each account
+            QHash<int, QSet<int> > m_accounts;              ///< Accounts of each schedule in m_byAccount
+
             static ScheduleManager* m_instance;
             static int m_nextId;
 
@@ -0,0 +1,271 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "snapshotobjects.h"
+
+#include <QScriptEngine>
+
+#include "account.h"
+
+namespace KLib {
+
+namespace {
+const SnapshotAccount* thisAccount(QScriptContext* _context) {
+  return qobject_cast<const SnapshotAccount*>(
+      _context->thisObject().toQObject());
+}
+
+QScriptValue accountParent(QScriptContext* _context, QScriptEngine* _engine) {
+  const SnapshotAccount* a = thisAccount(_context);
+
+  if (!a) {
+    return _context->throwError(QScriptContext::TypeError,
+                                "parent() of a non account");
+  }
+
+  return SnapshotAccount::toScript(
+      _engine, a->snapshot(), a->snapshot().account(a->id())->parent);
+}
+
+QScriptValue accountChildren(QScriptContext* _context,
+                             QScriptEngine* _engine) {
+  const SnapshotAccount* a = thisAccount(_context);
+
+  if (!a) {
+    return _context->throwError(QScriptContext::TypeError,
+                                "getChildren() of a non account");
+  }
+
+  const QVector<int>& children = a->snapshot().account(a->id())->children;
+  QScriptValue array = _engine->newArray(children.size());
+
+  for (int i = 0; i < children.size(); ++i) {
+    array.setProperty(i, SnapshotAccount::toScript(_engine, a->snapshot(),
+                                                   children[i]));
+  }
+
+  return array;
+}
+
+QScriptValue accountChildAt(QScriptContext* _context, QScriptEngine* _engine) {
+  const SnapshotAccount* a = thisAccount(_context);
+
+  if (!a) {
+    return _context->throwError(QScriptContext::TypeError,
+                                "childAt() of a non account");
+  }
+
+  const QVector<int>& children = a->snapshot().account(a->id())->children;
+  const int i = _context->argument(0).toInt32();
+
+  return i >= 0 && i < children.size()
+             ? SnapshotAccount::toScript(_engine, a->snapshot(), children[i])
+             : QScriptValue(QScriptValue::NullValue);
+}
+
+QScriptValue accountAccount(QScriptContext* _context, QScriptEngine* _engine) {
+  const SnapshotAccount* a = thisAccount(_context);
+
+  if (!a) {
+    return _context->throwError(QScriptContext::TypeError,
+                                "account() of a non account");
+  }
+
+  return SnapshotAccount::toScript(_engine, a->snapshot(),
+                                   _context->argument(0).toInt32());
+}
+
+QScriptValue accountGetChild(QScriptContext* _context,
+                            QScriptEngine* _engine) {
+  const SnapshotAccount* a = thisAccount(_context);
+
+  if (!a) {
+    return _context->throwError(QScriptContext::TypeError,
+                                "getChild() of a non account");
+  }
+
+  // A descendant of the account: one of its ancestors is the account
+  const int id = _context->argument(0).toInt32();
+  const ModelSnapshot::AccountInfo* c = a->snapshot().account(id);
+
+  while (c && c->parent != a->id()) {
+    c = a->snapshot().account(c->parent);
+  }
+
+  return c ? SnapshotAccount::toScript(_engine, a->snapshot(), id)
+           : QScriptValue(QScriptValue::NullValue);
+}
+
+QScriptValue accountLedger(QScriptContext* _context, QScriptEngine* _engine) {
+  const SnapshotAccount* a = thisAccount(_context);
+
+  if (!a) {
+    return _context->throwError(QScriptContext::TypeError,
+                                "ledger() of a non account");
+  }
+
+  if (!a->snapshot().ledger(a->id())) {
+    return QScriptValue(QScriptValue::NullValue);
+  }
+
+  return _engine->newQObject(new SnapshotLedger(a->snapshot(), a->id()),
+                             QScriptEngine::ScriptOwnership);
+}
+}  // namespace
+
+SnapshotAccount::SnapshotAccount(const ModelSnapshot& _snapshot, int _id)
+    : m_snapshot(_snapshot), m_info(_snapshot.account(_id)) {}
+
+Amount SnapshotAccount::balanceBetween(const QDate& _start,
+                                       const QDate& _end) const {
+  if (!m_snapshot.ledger(id())) {
+    return 0;
+  }
+
+  Amount bal = m_snapshot.balanceIn(
+      id(), m_snapshot.balancesBetween(id(), _start, _end), QString(), _end);
+
+  if (Account::negativeDebits(type())) {
+    bal *= -1;
+  }
+
+  return bal;
+}
+
+Amount SnapshotAccount::balanceAt(const QDate& _date) const {
+  return balanceBetween(QDate(), _date);
+}
+
+Amount SnapshotAccount::balance() const {
+  return balanceBetween(QDate(), QDate());
+}
+
+Amount SnapshotAccount::treeValueBetween(const QDate& _start,
+                                         const QDate& _end) const {
+  return treeValueBetween(
+      id(), _start, _end,
+      m_snapshot.account(m_snapshot.topLevelId())->mainCurrency);
+}
+
+Amount SnapshotAccount::treeValueAt(const QDate& _date) const {
+  return treeValueBetween(QDate(), _date);
+}
+
+Amount SnapshotAccount::treeValue() const {
+  return treeValueBetween(QDate(), QDate());
+}
+
+Amount SnapshotAccount::treeValueBetween(int _id, const QDate& _start,
+                                         const QDate& _end,
+                                         const QString& _currency) const {
+  const SnapshotAccount a(m_snapshot, _id);
+  Amount total = a.balanceBetween(_start, _end);
+
+  if (a.mainCurrency().isEmpty()) {  // Security
+    total = total * m_snapshot.rate(a.idSecurity(), _currency, _end);
+  } else if (a.mainCurrency() != _currency) {
+    total = total * m_snapshot.rate(a.mainCurrency(), _currency, _end);
+  }
+
+  for (int c : a.m_info->children) {
+    total += treeValueBetween(c, _start, _end, _currency);
+  }
+
+  return total;
+}
+
+QString SnapshotAccount::formatAmount(const Amount& _amount) const {
+  return m_snapshot.formatAmount(mainCurrency(), _amount);
+}
+
+QScriptValue SnapshotAccount::toScript(QScriptEngine* _engine,
+                                       const ModelSnapshot& _snapshot,
+                                       int _id) {
+  if (!_snapshot.account(_id)) {
+    return QScriptValue(QScriptValue::NullValue);
+  }
+
+  QScriptValue object = _engine->newQObject(
+      new SnapshotAccount(_snapshot, _id), QScriptEngine::ScriptOwnership);
+  object.setProperty("parent", _engine->newFunction(&accountParent));
+  object.setProperty("getChildren", _engine->newFunction(&accountChildren));
+  object.setProperty("childAt", _engine->newFunction(&accountChildAt));
+  object.setProperty("account", _engine->newFunction(&accountAccount));
+  object.setProperty("getChild", _engine->newFunction(&accountGetChild));
+  object.setProperty("ledger", _engine->newFunction(&accountLedger));
+  return object;
+}
+
+int SnapshotAccount::idOf(const QObject* _object) {
+  if (const Account* a = qobject_cast<const Account*>(_object)) {
+    return a->id();
+  } else if (const SnapshotAccount* a =
+                 qobject_cast<const SnapshotAccount*>(_object)) {
+    return a->id();
+  }
+
+  return Constants::NO_ID;
+}
+
+SnapshotLedger::SnapshotLedger(const ModelSnapshot& _snapshot, int _idAccount)
+    : m_snapshot(_snapshot), m_idAccount(_idAccount) {}
+
+Amount SnapshotLedger::balanceBetween(const QDate& _from, const QDate& _to,
+                                      const QString& _currency) const {
+  return m_snapshot.balanceIn(
+      m_idAccount, m_snapshot.balancesBetween(m_idAccount, _from, _to),
+      _currency, _to);
+}
+
+Amount SnapshotLedger::balanceAt(const QDate& _date,
+                                 const QString& _currency) const {
+  return balanceBetween(QDate(), _date, _currency);
+}
+
+Amount SnapshotLedger::balance(const QString& _currency) const {
+  return balanceBetween(QDate(), QDate(), _currency);
+}
+
+SnapshotPriceManager::SnapshotPriceManager(const ModelSnapshot& _snapshot)
+    : m_snapshot(_snapshot) {}
+
+double SnapshotPriceManager::rate(int _idSecurity, const QString& _to,
+                                  const QDate& _date) const {
+  return m_snapshot.rate(_idSecurity, _to, _date);
+}
+
+double SnapshotPriceManager::rate(const QString& _from, const QString& _to,
+                                  const QDate& _date) const {
+  return m_snapshot.rate(_from, _to, _date);
+}
+
+SnapshotPayeeManager::SnapshotPayeeManager(const ModelSnapshot& _snapshot)
+    : m_snapshot(_snapshot) {}
+
+QVariantMap SnapshotPayeeManager::get(int _id) const {
+  const QString name = m_snapshot.payeeName(_id);
+
+  if (name.isNull()) {
+    return QVariantMap();
+  }
+
+  return QVariantMap{{"id", _id}, {"name", name}};
+}
+
+}  // namespace KLib
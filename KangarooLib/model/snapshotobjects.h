@@ -0,0 +1,175 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef SNAPSHOTOBJECTS_H
+#define SNAPSHOTOBJECTS_H
+
+#include <QDate>
+#include <QObject>
+#include <QVariantMap>
+
+#include "../amount.h"
+#include "modelsnapshot.h"
+
+class QScriptEngine;
+class QScriptValue;
+
+namespace KLib {
+
+/**
+ * @brief Account of a ModelSnapshot, for the report scripts.
+ *
+ * It has the read-only properties and methods of Account that the reports
+ * use, so the scripts written for the live accounts run on the snapshot
+ * unchanged. The methods that return accounts or a ledger (parent(),
+ * getChildren(), childAt(), getChild(id), account() and ledger()) are added by
+ * toScript().
+ */
+class SnapshotAccount : public QObject {
+  Q_OBJECT
+
+  Q_PROPERTY(int id READ id)
+  Q_PROPERTY(bool hasParent READ hasParent)
+  Q_PROPERTY(int childCount READ childCount)
+  Q_PROPERTY(int type READ type)
+  Q_PROPERTY(QString name READ name)
+  Q_PROPERTY(QString mainCurrency READ mainCurrency)
+  Q_PROPERTY(bool isPlaceholder READ isPlaceholder)
+  Q_PROPERTY(int idSecurity READ idSecurity)
+
+ public:
+  /**
+   * @param _id Must be in _snapshot
+   */
+  SnapshotAccount(const ModelSnapshot& _snapshot, int _id);
+
+  const ModelSnapshot& snapshot() const { return m_snapshot; }
+
+  int id() const { return m_info->id; }
+  bool hasParent() const { return m_info->parent != -1; }
+  int childCount() const { return m_info->children.size(); }
+  int type() const { return m_info->type; }
+  QString name() const { return m_info->name; }
+  QString mainCurrency() const { return m_info->mainCurrency; }
+  bool isPlaceholder() const { return m_info->isPlaceholder; }
+  int idSecurity() const { return m_info->idSecurity; }
+
+  /**
+   * @brief Same as Account::balanceBetween()
+   */
+  Q_INVOKABLE KLib::Amount balanceBetween(const QDate& _start,
+                                          const QDate& _end) const;
+  Q_INVOKABLE KLib::Amount balanceAt(const QDate& _date) const;
+  Q_INVOKABLE KLib::Amount balance() const;
+
+  /**
+   * @brief Same as Account::treeValueBetween(), with the rates of the
+   * snapshot.
+   */
+  Q_INVOKABLE KLib::Amount treeValueBetween(const QDate& _start,
+                                            const QDate& _end) const;
+  Q_INVOKABLE KLib::Amount treeValueAt(const QDate& _date) const;
+  Q_INVOKABLE KLib::Amount treeValue() const;
+
+  Q_INVOKABLE QString formatAmount(const KLib::Amount& _amount) const;
+
+  /**
+   * @brief Script object of account _id of _snapshot, owned by _engine. Null
+   * if _id is not in the snapshot.
+   */
+  static QScriptValue toScript(QScriptEngine* _engine,
+                               const ModelSnapshot& _snapshot, int _id);
+
+  /**
+   * @brief Id of _object if it is an Account or a SnapshotAccount,
+   * Constants::NO_ID otherwise.
+   */
+  static int idOf(const QObject* _object);
+
+ private:
+  Amount treeValueBetween(int _id, const QDate& _start, const QDate& _end,
+                          const QString& _currency) const;
+
+  ModelSnapshot m_snapshot;
+  const ModelSnapshot::AccountInfo* m_info;
+};
+
+/**
+ * @brief Ledger of a ModelSnapshot, for the report scripts. Same as the
+ * balance methods of Ledger.
+ */
+class SnapshotLedger : public QObject {
+  Q_OBJECT
+
+ public:
+  SnapshotLedger(const ModelSnapshot& _snapshot, int _idAccount);
+
+  Q_INVOKABLE KLib::Amount balanceBetween(
+      const QDate& _from, const QDate& _to,
+      const QString& _currency = QString()) const;
+  Q_INVOKABLE KLib::Amount balanceAt(
+      const QDate& _date, const QString& _currency = QString()) const;
+  Q_INVOKABLE KLib::Amount balance(const QString& _currency = QString()) const;
+
+ private:
+  ModelSnapshot m_snapshot;
+  int m_idAccount;
+};
+
+/**
+ * @brief Rates of a ModelSnapshot, for the report scripts. Same as
+ * PriceManager::rate().
+ */
+class SnapshotPriceManager : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit SnapshotPriceManager(const ModelSnapshot& _snapshot);
+
+  Q_INVOKABLE double rate(int _idSecurity, const QString& _to,
+                          const QDate& _date = QDate()) const;
+  Q_INVOKABLE double rate(const QString& _from, const QString& _to,
+                          const QDate& _date = QDate()) const;
+
+ private:
+  ModelSnapshot m_snapshot;
+};
+
+/**
+ * @brief Payees of a ModelSnapshot, for the report scripts.
+ */
+class SnapshotPayeeManager : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit SnapshotPayeeManager(const ModelSnapshot& _snapshot);
+
+  /**
+   * @brief {id, name} of payee _id, as PayeeManager::get(). Empty if it did
+   * not exist.
+   */
+  Q_INVOKABLE QVariantMap get(int _id) const;
+
+ private:
+  ModelSnapshot m_snapshot;
+};
+
+}  // namespace KLib
+
+#endif  // SNAPSHOTOBJECTS_H
@@ -22,14 +22,18 @@
 
 #include "../klib.h"
 //#include "../interfaces/scriptable.h"
+#include <QList>
 #include <QString>
 #include <QObject>
 
+class QThread;
 class QXmlStreamReader;
 class QXmlStreamWriter;
 
 namespace KLib
 {
+    class ColumnReader;
+    class ColumnWriter;
 
     class IStored : public QObject
     {
@@ -51,6 +55,12 @@ namespace KLib
         signals:
             void modified();
 
+            /**
+             * @brief Emitted by the objects that journal their changes object by object (see
+             *        journalsObjects()), for each change to the object _id, before modified().
+             */
+            void objectModified(int _id);
+
         protected:
             IStored() : m_id(Constants::NO_ID), m_onModifyHold(false) {}
             IStored(int _id) : m_id(_id), m_onModifyHold(false) {}
@@ -72,6 +82,58 @@ namespace KLib
              */
             virtual void save(QXmlStreamWriter& _writer) const = 0;
 
+            /**
+             * @brief If the object supports the binary columnar format. If so, starting at
+             *        IO::COLUMNAR_FILE_VERSION, loadColumns() and saveColumns() are used instead
+             *        of load() and save().
+             */
+            virtual bool hasColumns() const { return false; }
+
+            /**
+             * @brief Loads the object from a binary columnar file.
+             */
+            virtual void loadColumns(const ColumnReader& _reader) { Q_UNUSED(_reader) }
+
+            /**
+             * @brief Saves the object to a binary columnar file.
+             */
+            virtual void saveColumns(ColumnWriter& _writer) const { Q_UNUSED(_writer) }
+
+            /**
+             * @brief If the changes are journaled one object at a time instead of as a whole: the
+             *        object then emits objectModified() for every change, and implements saveObjects()
+             *        and restoreObjects().
+             */
+            virtual bool journalsObjects() const { return false; }
+
+            /**
+             * @brief Writes the current state of the objects _ids, in any order. An object that no
+             *        longer exists is written as an empty StdTags::REMOVED element with its id.
+             */
+            virtual void saveObjects(const QList<int>& _ids, QXmlStreamWriter& _writer) const
+            {
+                Q_UNUSED(_ids) Q_UNUSED(_writer)
+            }
+
+            /**
+             * @brief Restores objects written by saveObjects(), up to the end of the current element.
+             *        Called when a journal is replayed, after load() and before afterLoad().
+             */
+            virtual void restoreObjects(QXmlStreamReader& _reader) { Q_UNUSED(_reader) }
+
+            /**
+             * @brief If load() and loadColumns() can run on a worker thread, concurrently with the
+             *        loading of the other objects. They must then only modify this object and the
+             *        objects they create, without depending on other objects.
+             */
+            virtual bool loadsConcurrently() const { return false; }
+
+            /**
+             * @brief Called after a concurrent load, on the worker thread. Must move the QObjects
+             *        created by load() or loadColumns() to _thread.
+             */
+            virtual void moveLoadedObjects(QThread* _thread) { Q_UNUSED(_thread) }
+
             /**
              * @brief Creates a "blank state" for the object
              */
@@ -0,0 +1,200 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "transactionindex.h"
+
+#include <algorithm>
+
+#include "account.h"
+
+namespace KLib {
+
+namespace {
+// Bookkeeping of the allocator for each allocated block
+const qint64 ALLOCATION_OVERHEAD = 2 * sizeof(void*);
+
+qint64 hashBytes(int _capacity, int _size, qint64 _nodeSize) {
+  return _capacity ? qint64(_capacity) * sizeof(void*) +
+                         qint64(_size) * (_nodeSize + ALLOCATION_OVERHEAD)
+                   : 0;
+}
+
+template <class K, class V>
+qint64 hashBytes(const QHash<K, V>& _hash) {
+  return hashBytes(_hash.capacity(), _hash.size(), sizeof(QHashNode<K, V>));
+}
+
+qint64 setBytes(const QSet<int>& _set) {
+  return hashBytes(_set.capacity(), _set.size(),
+                   sizeof(QHashNode<int, QHashDummyValue>));
+}
+
+qint64 vectorBytes(const QVector<int>& _vector) {
+  return _vector.capacity() ? sizeof(QArrayData) + ALLOCATION_OVERHEAD +
+                                  qint64(_vector.capacity()) * sizeof(int)
+                            : 0;
+}
+}  // namespace
+
+TransactionIndex::MemoryUsage& TransactionIndex::MemoryUsage::operator+=(
+    const MemoryUsage& _other) {
+  keys += _other.keys;
+  entries += _other.entries;
+  bytes += _other.bytes;
+  return *this;
+}
+
+void TransactionIndex::clear() {
+  for (int k = 0; k < NumKeys; ++k) {
+    m_indexes[k].clear();
+  }
+
+  m_keys.clear();
+}
+
+void TransactionIndex::insert(const Transaction* _tr) {
+  QVector<int> accounts;
+  accounts.reserve(_tr->splits().size());
+
+  for (const Transaction::Split& s : _tr->splits()) {
+    accounts << s.idAccount;
+  }
+
+  insert(_tr->id(), _tr->idPayee(), accounts, _tr->attachments());
+}
+
+void TransactionIndex::insert(int _idTransaction, int _idPayee,
+                              const QVector<int>& _idAccounts,
+                              const QSet<int>& _idDocuments) {
+  Keys keys;
+
+  if (_idPayee != Constants::NO_ID) {
+    keys.keys[ByPayee] << _idPayee;
+  }
+
+  keys.keys[ByAccount] = _idAccounts;
+  sortUnique(keys.keys[ByAccount]);
+
+  for (int id : keys.keys[ByAccount]) {
+    const Account* a = Account::getTopLevel()->account(id);
+
+    if (a && a->idSecurity() != Constants::NO_ID) {
+      keys.keys[BySecurity] << a->idSecurity();
+    }
+  }
+
+  sortUnique(keys.keys[BySecurity]);
+
+  keys.keys[ByDocument].reserve(_idDocuments.size());
+  for (int id : _idDocuments) {
+    keys.keys[ByDocument] << id;
+  }
+
+  sortUnique(keys.keys[ByDocument]);
+
+  auto i = m_keys.find(_idTransaction);
+
+  if (i == m_keys.end()) {
+    move(_idTransaction, Keys(), keys);
+    m_keys.insert(_idTransaction, keys);
+  } else {
+    move(_idTransaction, i.value(), keys);
+    i.value() = keys;
+  }
+}
+
+void TransactionIndex::remove(int _idTransaction) {
+  auto i = m_keys.find(_idTransaction);
+
+  if (i != m_keys.end()) {
+    move(_idTransaction, i.value(), Keys());
+    m_keys.erase(i);
+  }
+}
+
+void TransactionIndex::move(int _idTransaction, const Keys& _old,
+                            const Keys& _new) {
+  for (int k = 0; k < NumKeys; ++k) {
+    const KeyList& o = _old.keys[k];
+    const KeyList& n = _new.keys[k];
+    QHash<int, QSet<int> >& index = m_indexes[k];
+
+    // Both lists are sorted: walk them together and only touch the keys that
+    // are in one of them.
+    auto io = o.begin();
+    auto in = n.begin();
+
+    while (io != o.end() || in != n.end()) {
+      if (in == n.end() || (io != o.end() && *io < *in)) {
+        auto i = index.find(*io);
+
+        if (i != index.end()) {
+          i.value().remove(_idTransaction);
+
+          if (i.value().isEmpty()) {
+            index.erase(i);
+          }
+        }
+
+        ++io;
+      } else if (io == o.end() || *in < *io) {
+        index[*in].insert(_idTransaction);
+        ++in;
+      } else {
+        ++io;
+        ++in;
+      }
+    }
+  }
+}
+
+void TransactionIndex::sortUnique(KeyList& _list) {
+  std::sort(_list.begin(), _list.end());
+  _list.erase(std::unique(_list.begin(), _list.end()), _list.end());
+}
+
+TransactionIndex::MemoryUsage TransactionIndex::memoryUsage(Key _key) const {
+  const QHash<int, QSet<int> >& index = m_indexes[_key];
+  MemoryUsage usage{index.size(), 0, hashBytes(index)};
+
+  for (const QSet<int>& s : index) {
+    usage.entries += s.size();
+    usage.bytes += setBytes(s);
+  }
+
+  return usage;
+}
+
+TransactionIndex::MemoryUsage TransactionIndex::memoryUsage() const {
+  MemoryUsage usage{0, 0, hashBytes(m_keys)};
+
+  for (int k = 0; k < NumKeys; ++k) {
+    usage += memoryUsage(Key(k));
+  }
+
+  for (const Keys& keys : m_keys) {
+    for (int k = 0; k < NumKeys; ++k) {
+      usage.bytes += vectorBytes(keys.keys[k]);
+    }
+  }
+
+  return usage;
+}
+
+}  // namespace KLib
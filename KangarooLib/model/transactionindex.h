@@ -0,0 +1,136 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef TRANSACTIONINDEX_H
+#define TRANSACTIONINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QVector>
+
+#include "transaction.h"
+
+namespace KLib {
+
+/**
+ * @brief Secondary indexes of the transactions by payee, account, security
+ * and attached document.
+ *
+ * Each index maps a key to the ids of the transactions that reference it, so
+ * that the transactions of a key are found in O(k) instead of scanning all the
+ * transactions. The keys of each transaction are kept as well, which allows
+ * updating the indexes when a transaction changes (only the keys that changed
+ * are moved) or when its splits are already gone.
+ *
+ * The security of a split is the security of its account (investment and
+ * security trading accounts), as it was when the transaction was indexed.
+ *
+ * See TransactionManager::index().
+ */
+class TransactionIndex {
+ public:
+  enum Key { ByPayee = 0, ByAccount, BySecurity, ByDocument, NumKeys };
+
+  /**
+   * @brief Estimated memory used by an index.
+   */
+  struct MemoryUsage {
+    qint64 keys;     ///< Number of keys
+    qint64 entries;  ///< Number of (key, transaction) pairs
+    qint64 bytes;    ///< Estimated number of bytes, including the hash tables
+
+    MemoryUsage& operator+=(const MemoryUsage& _other);
+  };
+
+  TransactionIndex() {}
+
+  void clear();
+
+  /**
+   * @brief Indexes _tr. If it was already indexed, same as update().
+   */
+  void insert(const Transaction* _tr);
+
+  /**
+   * @brief Indexes transaction _idTransaction from its data, for the
+   * transactions that are not materialized.
+   */
+  void insert(int _idTransaction, int _idPayee, const QVector<int>& _idAccounts,
+              const QSet<int>& _idDocuments);
+
+  /**
+   * @brief Moves _tr to its current keys.
+   */
+  void update(const Transaction* _tr) { insert(_tr); }
+
+  void remove(int _idTransaction);
+
+  bool contains(int _idTransaction) const {
+    return m_keys.contains(_idTransaction);
+  }
+
+  int transactionCount() const { return m_keys.size(); }
+
+  /**
+   * @brief Ids of the transactions that reference _id, in no particular order.
+   */
+  QList<int> transactions(Key _key, int _id) const {
+    return m_indexes[_key].value(_id).toList();
+  }
+
+  /**
+   * @brief Number of transactions that reference _id. O(1).
+   */
+  int count(Key _key, int _id) const {
+    auto i = m_indexes[_key].constFind(_id);
+    return i == m_indexes[_key].constEnd() ? 0 : i.value().size();
+  }
+
+  /**
+   * @brief Memory used by index _key.
+   */
+  MemoryUsage memoryUsage(Key _key) const;
+
+  /**
+   * @brief Memory used by all the indexes and by the keys of each transaction.
+   */
+  MemoryUsage memoryUsage() const;
+
+ private:
+  typedef QVector<int> KeyList;  ///< Sorted, without duplicates
+
+  struct Keys {
+    KeyList keys[NumKeys];
+  };
+
+  /**
+   * @brief Moves _idTransaction from the keys _old to _new.
+   */
+  void move(int _idTransaction, const Keys& _old, const Keys& _new);
+
+  static void sortUnique(KeyList& _list);
+
+  QHash<int, QSet<int> > m_indexes[NumKeys];
+  QHash<int, Keys> m_keys;  ///< Keys of each indexed transaction
+};
+
+}  // namespace KLib
+
+#endif  // TRANSACTIONINDEX_H
@@ -19,36 +19,270 @@
 
 #include "transactionmanager.h"
 
+#include <QTemporaryFile>
+#include <QThread>
 #include <QXmlStreamReader>
+#include <algorithm>
+#include <memory>
 
+#include "../controller/columnarformat.h"
 #include "../controller/io.h"
 #include "account.h"
 #include "investmentlotsmanager.h"
 #include "investmenttransaction.h"
 #include "modelexception.h"
+#include "transactionindex.h"
 
 namespace KLib {
 
 int TransactionManager::m_nextId = 0;
+bool TransactionManager::m_lazyLoading = false;
 TransactionManager* TransactionManager::m_instance = new TransactionManager();
 
+/**
+ * @brief Columns of the transactions of a columnar book.
+ *
+ * Also contains the offsets of the variable-length parts (splits, properties
+ * and investment data) of each row, so that rows can be read in any order.
+ */
+struct TransactionManager::Columns {
+  explicit Columns(const ColumnReader& _reader);
+
+  /**
+   * @brief Returns the row of transaction _id, -1 if none. Requires the ids
+   * to be sorted.
+   */
+  int row(int _id) const {
+    const qint32* i = std::lower_bound(trId, trId + n, _id);
+    return i != trId + n && *i == _id ? i - trId : -1;
+  }
+
+  bool isSorted() const { return std::is_sorted(trId, trId + n); }
+
+  int n, nInv, nSplits, nProps;
+
+  const qint32* trId;
+  const qint32* trDate;
+  const qint32* trPayee;
+  const qint8* trCleared;
+  const quint8* trFlags;
+  ColumnReader::StringColumn trNo, trMemo, trNote, trAttachments;
+
+  const qint32* invAction;
+  const ColumnAmount* invPricePerShare;
+  const qint32* invFracNew;
+  const qint32* invFracOld;
+  const ColumnAmount* invBasisAdjustment;
+  const ColumnAmount* invTaxPaid;
+  ColumnReader::StringColumn invDistrib;
+
+  const qint32* spAccount;
+  const ColumnAmount* spAmount;
+  const qint32* spCurrency;
+  ColumnReader::StringColumn spMemo, spUserData;
+
+  ColumnReader::StringColumn prKey, prValue;
+
+  QVector<QString> currencies;
+
+  // Offsets per row. The last element of splitBegin and propBegin is the
+  // total count. invRow is -1 for rows that are not investment transactions.
+  QVector<qint32> splitBegin, propBegin, invRow;
+};
+
+TransactionManager::TransactionManager()
+    : m_mappedFile(nullptr),
+      m_mappedReader(nullptr),
+      m_columns(nullptr),
+      m_numPending(0),
+      m_index(new TransactionIndex()),
+      m_indexBuilt(false) {}
+
 Transaction* TransactionManager::get(int _id) const {
-  if (!m_transactions.contains(_id)) {
-    ModelException::throwException(tr("No such transaction."), this);
+  QMutexLocker locker(m_columns ? &m_materializeMutex : nullptr);
+  auto i = m_transactions.find(_id);
+
+  if (i != m_transactions.end()) {
+    return i.value();
+  } else if (Transaction* t = materialize(_id)) {
+    return t;
+  }
+
+  ModelException::throwException(tr("No such transaction."), this);
+  return nullptr;
+}
+
+const QHash<int, Transaction*>& TransactionManager::transactions() const {
+  QMutexLocker locker(m_columns ? &m_materializeMutex : nullptr);
+
+  if (m_numPending) {
+    for (int row = 0; row < m_columns->n; ++row) {
+      if (m_pending.testBit(row)) {
+        materialize(m_columns->trId[row]);
+      }
+    }
+  }
+
+  return m_transactions;
+}
+
+const TransactionIndex& TransactionManager::index() const {
+  if (m_indexBuilt) {
+    return *m_index;
+  }
+
+  m_index->clear();
+
+  for (Transaction* t : m_transactions) {
+    m_index->insert(t);
+  }
+
+  // The pending transactions are indexed from the columns, without
+  // materializing them.
+  QVector<int> accounts;
+  QSet<int> documents;
+
+  for (int row = 0; m_numPending && row < m_columns->n; ++row) {
+    if (!m_pending.testBit(row)) {
+      continue;
+    }
+
+    const Columns& c = *m_columns;
+    accounts.clear();
+    documents.clear();
+
+    for (int i = c.splitBegin[row]; i < c.splitBegin[row + 1]; ++i) {
+      accounts << c.spAccount[i];
+    }
+
+    for (const QString& s :
+         c.trAttachments.at(row).split(",", QString::SkipEmptyParts)) {
+      documents.insert(s.toInt());
+    }
+
+    m_index->insert(c.trId[row], c.trPayee[row], accounts, documents);
+  }
+
+  m_indexBuilt = true;
+  return *m_index;
+}
+
+void TransactionManager::forEachUnmaterialized(
+    const std::function<void(int, const QDate&,
+                             const QList<Transaction::Split>&)>& _f) const {
+  if (!m_numPending) {
+    return;
+  }
+
+  const Columns& c = *m_columns;
+  QList<Transaction::Split> splits;
+
+  for (int row = 0; row < c.n; ++row) {
+    if (!m_pending.testBit(row)) {
+      continue;
+    }
+
+    splits.clear();
+
+    for (int i = c.splitBegin[row]; i < c.splitBegin[row + 1]; ++i) {
+      splits << Transaction::Split(c.spAmount[i].toAmount(), c.spAccount[i],
+                                   c.currencies[c.spCurrency[i]]);
+    }
+
+    _f(c.trId[row], QDate::fromJulianDay(c.trDate[row]), splits);
+  }
+}
+
+Transaction* TransactionManager::materialize(int _id) const {
+  int row = m_numPending ? m_columns->row(_id) : -1;
+
+  if (row == -1 || !m_pending.testBit(row)) {
     return nullptr;
   }
 
-  return m_transactions[_id];
+  Transaction* t = createTransaction(*m_columns, row);
+  m_pending.clearBit(row);
+  --m_numPending;
+
+  // Materialized by a reader on another thread: like the other transactions,
+  // it belongs to the thread of the model.
+  if (t->thread() != thread()) {
+    t->m_properties->moveToThread(thread());
+    t->moveToThread(thread());
+  }
+
+  m_transactions.insert(_id, t);
+  connectTransaction(t);
+
+  // The book is already loaded, so do what afterLoad() would have done.
+  t->checkIfCurrencyExchange();
+
+  emit const_cast<TransactionManager*>(this)->transactionMaterialized(t);
+  return t;
+}
+
+void TransactionManager::connectTransaction(Transaction* _transaction) const {
+  TransactionManager* self = const_cast<TransactionManager*>(this);
+
+  connect(_transaction, &Transaction::modified, self, [self, _transaction]() {
+    if (self->m_indexBuilt) {
+      self->m_index->update(_transaction);
+    }
+
+    emit self->transactionModified(_transaction);
+    emit self->modified();
+  });
+}
+
+void TransactionManager::restore(QXmlStreamReader& _reader) {
+  while (!_reader.atEnd() && !_reader.isStartElement()) {
+    _reader.readNext();
+  }
+
+  Transaction* t = _reader.name() == StdTags::INVEST_TRANSACTION
+                       ? new InvestmentTransaction()
+                       : new Transaction();
+
+  try {
+    t->load(_reader);
+  } catch (...) {
+    delete t;
+    throw;
+  }
+
+  restoreRemoved(t->id());
+
+  m_nextId = std::max(m_nextId, t->m_id + 1);
+  m_transactions.insert(t->id(), t);
+  connectTransaction(t);
+}
+
+void TransactionManager::restoreRemoved(int _id) {
+  delete m_transactions.take(_id);
+  reset();
+
+  int row = m_numPending ? m_columns->row(_id) : -1;
+
+  if (row != -1 && m_pending.testBit(row)) {
+    m_pending.clearBit(row);
+    --m_numPending;
+  }
 }
 
 void TransactionManager::add(Transaction* _transaction) {
   m_transactions.insert(_transaction->id(), _transaction);
-  connect(_transaction, SIGNAL(modified()), this, SIGNAL(modified()));
+  connectTransaction(_transaction);
+
+  if (m_indexBuilt) {
+    m_index->insert(_transaction);
+  }
+
+  emit transactionAdded(_transaction);
   emit modified();
 }
 
 void TransactionManager::remove(int _id) {
-  if (m_transactions.contains(_id)) {
+  if (m_transactions.contains(_id) || materialize(_id)) {
     Transaction* trans = m_transactions[_id];
 
     if (qobject_cast<InvestmentTransaction*>(trans)) {
@@ -58,7 +292,9 @@ void TransactionManager::remove(int _id) {
 
     trans->deleteLater();
     m_transactions.remove(_id);
+    m_index->remove(_id);
 
+    emit transactionRemoved(_id);
     emit modified();
   }
 }
@@ -276,7 +512,7 @@ void TransactionManager::load(QXmlStreamReader& _reader) {
       //            }
 
       m_transactions.insert(o->id(), o);
-      connect(o, &Transaction::modified, this, &TransactionManager::modified);
+      connectTransaction(o);
     } else if (_reader.tokenType() == QXmlStreamReader::StartElement &&
                _reader.name() == StdTags::INVEST_TRANSACTION) {
       InvestmentTransaction* o = new InvestmentTransaction();
@@ -284,7 +520,7 @@ void TransactionManager::load(QXmlStreamReader& _reader) {
       m_nextId = std::max(m_nextId, o->m_id + 1);
 
       m_transactions.insert(o->id(), o);
-      connect(o, &Transaction::modified, this, &TransactionManager::modified);
+      connectTransaction(o);
     }
 
     _reader.readNext();
@@ -306,10 +542,402 @@ void TransactionManager::afterLoad() {
   }
 }
 
+namespace {
+enum TransactionFlags : quint8 { Flagged = 1, Investment = 2 };
+
+QString distribCompositionToString(const DistribComposition& _composition) {
+  QStringList l;
+
+  for (auto i = _composition.begin(); i != _composition.end(); ++i) {
+    l << QString("%1:%2").arg((int)i.key()).arg(i.value().toStoreable());
+  }
+
+  return l.join(',');
+}
+
+DistribComposition distribCompositionFromString(const QString& _str) {
+  DistribComposition composition;
+
+  for (const QString& s : _str.split(",", QString::SkipEmptyParts)) {
+    QStringList d = s.split(":", QString::SkipEmptyParts);
+
+    if (d.size() != 2) {
+      throw IOException(QObject::tr(
+          "Invalid value for the distribution composition."));
+    }
+    composition.insert((DistribType)d[0].toInt(), Amount::fromStoreable(d[1]));
+  }
+
+  return composition;
+}
+}  // namespace
+
+void TransactionManager::saveColumns(ColumnWriter& _writer) const {
+  // Rows are (id, row in m_columns), the row being -1 for materialized
+  // transactions. Sort by id so that files are stable from one save to the
+  // next, and so that they can be loaded lazily.
+  QVector<QPair<int, int>> rows;
+  rows.reserve(count());
+
+  for (int id : m_transactions.keys()) {
+    rows << qMakePair(id, -1);
+  }
+
+  for (int row = 0; m_numPending && row < m_columns->n; ++row) {
+    if (m_pending.testBit(row)) {
+      rows << qMakePair(int(m_columns->trId[row]), row);
+    }
+  }
+
+  std::sort(rows.begin(), rows.end());
+
+  const int n = rows.size();
+
+  QVector<qint32> trId(n), trDate(n), trPayee(n), trSplits(n), trProps(n);
+  QVector<qint8> trCleared(n);
+  QVector<quint8> trFlags(n);
+  QVector<QString> trNo(n), trMemo(n), trNote(n), trAttachments(n);
+
+  QVector<qint32> invAction, invFracNew, invFracOld;
+  QVector<ColumnAmount> invPricePerShare, invBasisAdjustment, invTaxPaid;
+  QVector<QString> invDistrib;
+
+  QVector<qint32> spAccount, spCurrency;
+  QVector<ColumnAmount> spAmount;
+  QVector<QString> spMemo, spUserData;
+
+  QVector<QString> prKey, prValue;
+
+  // Currencies are repeated in almost every split: intern them.
+  QVector<QString> currencies;
+  QHash<QString, int> currencyIndex;
+
+  for (int row = 0; row < n; ++row) {
+    // Pending transactions are only created for the time they are saved.
+    std::unique_ptr<Transaction> pending;
+    const Transaction* t;
+
+    if (rows[row].second == -1) {
+      t = m_transactions[rows[row].first];
+    } else {
+      pending.reset(createTransaction(*m_columns, rows[row].second));
+      t = pending.get();
+    }
+
+    const InvestmentTransaction* it =
+        qobject_cast<const InvestmentTransaction*>(t);
+
+    trId[row] = t->m_id;
+    trDate[row] = t->m_date.toJulianDay();
+    trPayee[row] = t->m_idPayee;
+    trCleared[row] = t->m_clearedStatus;
+    trFlags[row] = (t->m_flagged ? Flagged : 0) | (it ? Investment : 0);
+    trSplits[row] = t->m_splits.size();
+    trNo[row] = t->m_no;
+    trMemo[row] = t->m_memo;
+    trNote[row] = t->m_note;
+
+    if (!t->m_attachments.isEmpty()) {
+      QStringList listAttachments;
+      for (int idDoc : t->m_attachments) {
+        listAttachments.append(QString::number(idDoc));
+      }
+      trAttachments[row] = listAttachments.join(",");
+    }
+
+    for (const Transaction::Split& s : t->m_splits) {
+      auto cur = currencyIndex.find(s.currency);
+
+      if (cur == currencyIndex.end()) {
+        cur = currencyIndex.insert(s.currency, currencies.size());
+        currencies << s.currency;
+      }
+
+      spAccount << s.idAccount;
+      spAmount << ColumnAmount::fromAmount(s.amount);
+      spCurrency << cur.value();
+      spMemo << s.memo;
+      spUserData << s.userData;
+    }
+
+    trProps[row] = t->m_properties->count();
+
+    for (const QString& key : t->m_properties->keys()) {
+      prKey << key;
+      prValue << t->m_properties->get(key).toString();
+    }
+
+    if (it) {
+      invAction << (int)it->m_action;
+      invPricePerShare << ColumnAmount::fromAmount(it->m_pricePerShare);
+      invFracNew << it->m_splitFraction.first;
+      invFracOld << it->m_splitFraction.second;
+      invBasisAdjustment << ColumnAmount::fromAmount(it->m_basisAdjustment);
+      invTaxPaid << ColumnAmount::fromAmount(it->m_taxPaid);
+      invDistrib << distribCompositionToString(it->m_distribComposition);
+    }
+  }
+
+  _writer.addColumn("tr.id", trId);
+  _writer.addColumn("tr.date", trDate);
+  _writer.addColumn("tr.payee", trPayee);
+  _writer.addColumn("tr.cleared", trCleared);
+  _writer.addColumn("tr.flags", trFlags);
+  _writer.addColumn("tr.splits", trSplits);
+  _writer.addColumn("tr.props", trProps);
+  _writer.addStringColumn("tr.no", trNo);
+  _writer.addStringColumn("tr.memo", trMemo);
+  _writer.addStringColumn("tr.note", trNote);
+  _writer.addStringColumn("tr.attach", trAttachments);
+
+  _writer.addColumn("inv.action", invAction);
+  _writer.addColumn("inv.pps", invPricePerShare);
+  _writer.addColumn("inv.fracnew", invFracNew);
+  _writer.addColumn("inv.fracold", invFracOld);
+  _writer.addColumn("inv.basisadj", invBasisAdjustment);
+  _writer.addColumn("inv.taxpaid", invTaxPaid);
+  _writer.addStringColumn("inv.distrib", invDistrib);
+
+  _writer.addColumn("sp.account", spAccount);
+  _writer.addColumn("sp.amount", spAmount);
+  _writer.addColumn("sp.currency", spCurrency);
+  _writer.addStringColumn("sp.memo", spMemo);
+  _writer.addStringColumn("sp.userdata", spUserData);
+
+  _writer.addStringColumn("pr.key", prKey);
+  _writer.addStringColumn("pr.value", prValue);
+
+  _writer.addStringColumn("cur.code", currencies);
+}
+
+TransactionManager::Columns::Columns(const ColumnReader& _reader)
+    : n(_reader.count("tr.id")),
+      nInv(_reader.count("inv.action")),
+      nSplits(_reader.count("sp.account")),
+      nProps(_reader.count("pr.key")) {
+  const int nCurrencies = _reader.count("cur.code");
+
+  trId = _reader.column<qint32>("tr.id", n);
+  trDate = _reader.column<qint32>("tr.date", n);
+  trPayee = _reader.column<qint32>("tr.payee", n);
+  trCleared = _reader.column<qint8>("tr.cleared", n);
+  trFlags = _reader.column<quint8>("tr.flags", n);
+  trNo = _reader.strings("tr.no", n);
+  trMemo = _reader.strings("tr.memo", n);
+  trNote = _reader.strings("tr.note", n);
+  trAttachments = _reader.strings("tr.attach", n);
+
+  invAction = _reader.column<qint32>("inv.action", nInv);
+  invPricePerShare = _reader.column<ColumnAmount>("inv.pps", nInv);
+  invFracNew = _reader.column<qint32>("inv.fracnew", nInv);
+  invFracOld = _reader.column<qint32>("inv.fracold", nInv);
+  invBasisAdjustment = _reader.column<ColumnAmount>("inv.basisadj", nInv);
+  invTaxPaid = _reader.column<ColumnAmount>("inv.taxpaid", nInv);
+  invDistrib = _reader.strings("inv.distrib", nInv);
+
+  spAccount = _reader.column<qint32>("sp.account", nSplits);
+  spAmount = _reader.column<ColumnAmount>("sp.amount", nSplits);
+  spCurrency = _reader.column<qint32>("sp.currency", nSplits);
+  spMemo = _reader.strings("sp.memo", nSplits);
+  spUserData = _reader.strings("sp.userdata", nSplits);
+
+  prKey = _reader.strings("pr.key", nProps);
+  prValue = _reader.strings("pr.value", nProps);
+
+  // Decode the currencies once, splits share them.
+  ColumnReader::StringColumn curCode = _reader.strings("cur.code", nCurrencies);
+  currencies.resize(nCurrencies);
+  for (int i = 0; i < nCurrencies; ++i) {
+    currencies[i] = curCode.at(i);
+  }
+
+  // Compute and validate the offsets of each row.
+  const qint32* trSplits = _reader.column<qint32>("tr.splits", n);
+  const qint32* trProps = _reader.column<qint32>("tr.props", n);
+
+  splitBegin.resize(n + 1);
+  propBegin.resize(n + 1);
+  invRow.resize(n);
+  splitBegin[0] = propBegin[0] = 0;
+
+  int inv = 0;
+
+  for (int row = 0; row < n; ++row) {
+    if (trSplits[row] < 0 || splitBegin[row] + trSplits[row] > nSplits ||
+        trProps[row] < 0 || propBegin[row] + trProps[row] > nProps) {
+      throw IOException(QObject::tr("Invalid split columns for transaction %1.")
+                            .arg(trId[row]));
+    }
+
+    splitBegin[row + 1] = splitBegin[row] + trSplits[row];
+    propBegin[row + 1] = propBegin[row] + trProps[row];
+
+    if (trFlags[row] & Investment) {
+      if (inv >= nInv) {
+        throw IOException(
+            QObject::tr("Invalid investment transaction columns."));
+      }
+
+      invRow[row] = inv++;
+    } else {
+      invRow[row] = -1;
+    }
+  }
+
+  for (int i = 0; i < nSplits; ++i) {
+    if (spCurrency[i] < 0 || spCurrency[i] >= nCurrencies) {
+      throw IOException(QObject::tr("Invalid currency in split %1.").arg(i));
+    }
+  }
+}
+
+Transaction* TransactionManager::createTransaction(const Columns& _columns,
+                                                   int _row) const {
+  const Columns& c = _columns;
+  InvestmentTransaction* it = nullptr;
+  Transaction* t;
+
+  if (c.invRow[_row] != -1) {
+    const int inv = c.invRow[_row];
+
+    t = it = new InvestmentTransaction();
+    it->m_action = (InvestmentAction)c.invAction[inv];
+    it->m_pricePerShare = c.invPricePerShare[inv].toAmount();
+    it->m_splitFraction.first = c.invFracNew[inv];
+    it->m_splitFraction.second = c.invFracOld[inv];
+    it->m_basisAdjustment = c.invBasisAdjustment[inv].toAmount();
+    it->m_taxPaid = c.invTaxPaid[inv].toAmount();
+
+    try {
+      it->m_distribComposition =
+          distribCompositionFromString(c.invDistrib.at(inv));
+    } catch (...) {
+      delete t;
+      throw;
+    }
+  } else {
+    t = new Transaction();
+  }
+
+  t->m_id = c.trId[_row];
+  t->m_date = QDate::fromJulianDay(c.trDate[_row]);
+  t->m_idPayee = c.trPayee[_row];
+  t->m_clearedStatus = c.trCleared[_row];
+  t->m_flagged = c.trFlags[_row] & Flagged;
+  t->m_no = c.trNo.at(_row);
+  t->m_memo = c.trMemo.at(_row);
+  t->m_note = c.trNote.at(_row);
+
+  for (const QString& s :
+       c.trAttachments.at(_row).split(",", QString::SkipEmptyParts)) {
+    t->m_attachments.insert(s.toInt());
+  }
+
+  t->m_splits.reserve(c.splitBegin[_row + 1] - c.splitBegin[_row]);
+
+  for (int i = c.splitBegin[_row]; i < c.splitBegin[_row + 1]; ++i) {
+    Transaction::Split s(c.spAmount[i].toAmount(), c.spAccount[i],
+                         c.currencies[c.spCurrency[i]], c.spMemo.at(i));
+    s.userData = c.spUserData.at(i);
+    t->m_splits << s;
+  }
+
+  for (int i = c.propBegin[_row]; i < c.propBegin[_row + 1]; ++i) {
+    t->m_properties->set(c.prKey.at(i), c.prValue.at(i));
+  }
+
+  if (it) {
+    // Load the types, as in InvestmentTransaction::load()
+    int i = 0;
+    for (const Transaction::Split& s : it->m_splits) {
+      it->m_types[(InvestmentSplitType)s.userData.toInt()] = i++;
+    }
+  }
+
+  return t;
+}
+
+void TransactionManager::mapColumns(const QByteArray& _data) {
+  // Copy the columns to a temporary file and use them from there, so that
+  // they are paged in only when needed. If this fails, keep them in memory.
+  QTemporaryFile* file = new QTemporaryFile(this);
+  uchar* map = nullptr;
+
+  if (file->open() && file->write(_data) == _data.size() && file->flush()) {
+    map = file->map(0, _data.size());
+  }
+
+  if (map) {
+    m_mappedFile = file;
+    m_mappedReader = new ColumnReader(QByteArray::fromRawData(
+        reinterpret_cast<const char*>(map), _data.size()));
+  } else {
+    delete file;
+    m_mappedReader = new ColumnReader(_data);
+  }
+}
+
+void TransactionManager::loadColumns(const ColumnReader& _reader) {
+  unload();
+
+  if (m_lazyLoading) {
+    mapColumns(_reader.data());
+    m_columns = new Columns(*m_mappedReader);
+
+    if (!m_columns->isSorted()) {
+      // Rows can not be found by id, so load everything.
+      unload();
+    }
+  }
+
+  if (m_columns) {
+    const Columns& c = *m_columns;
+
+    m_pending.fill(true, c.n);
+    m_numPending = c.n;
+
+    for (int row = 0; row < c.n; ++row) {
+      m_nextId = std::max(m_nextId, c.trId[row] + 1);
+    }
+
+    // Investment transactions are required by InvestmentLotsManager and by
+    // stock splits as soon as the book is loaded.
+    for (int row = 0; row < c.n; ++row) {
+      if (c.invRow[row] != -1) {
+        Transaction* t = createTransaction(c, row);
+        m_pending.clearBit(row);
+        --m_numPending;
+
+        m_transactions.insert(t->id(), t);
+        connectTransaction(t);
+      }
+    }
+  } else {
+    Columns c(_reader);
+    m_transactions.reserve(c.n);
+
+    for (int row = 0; row < c.n; ++row) {
+      Transaction* t = createTransaction(c, row);
+
+      m_nextId = std::max(m_nextId, t->m_id + 1);
+      m_transactions.insert(t->id(), t);
+      connectTransaction(t);
+    }
+  }
+}
+
 void TransactionManager::save(QXmlStreamWriter& _writer) const {
   for (Transaction* o : m_transactions) {
     o->save(_writer);
   }
+
+  // Pending transactions are only created for the time they are saved.
+  for (int row = 0; m_numPending && row < m_columns->n; ++row) {
+    if (m_pending.testBit(row)) {
+      std::unique_ptr<Transaction> t(createTransaction(*m_columns, row));
+      t->save(_writer);
+    }
+  }
 }
 
 void TransactionManager::unload() {
@@ -319,6 +947,23 @@ void TransactionManager::unload() {
 
   m_transactions.clear();
   m_nextId = 0;
+
+  delete m_columns;
+  delete m_mappedReader;
+  delete m_mappedFile;
+  m_columns = nullptr;
+  m_mappedReader = nullptr;
+  m_mappedFile = nullptr;
+  m_pending.clear();
+  m_numPending = 0;
+
+  reset();
+}
+
+void TransactionManager::reset() {
+  m_index->clear();
+  m_indexBuilt = false;
+  emit transactionsReset();
 }
 
 }  // namespace KLib
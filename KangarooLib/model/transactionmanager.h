@@ -20,29 +20,89 @@
 #ifndef TRANSACTIONMANAGER_H
 #define TRANSACTIONMANAGER_H
 
+#include <QBitArray>
 #include <QList>
+#include <QMutex>
 #include <QVector>
+#include <functional>
 
 #include "../interfaces/scriptable.h"
 #include "stored.h"
 #include "transaction.h"
 
+class QTemporaryFile;
+
 namespace KLib {
 
+class TransactionIndex;
+
 class TransactionManager : public IStored {
   Q_OBJECT
   K_SCRIPTABLE(TransactionManager)
 
   Q_PROPERTY(int count READ count)
 
+  TransactionManager();
+
  public:
+  /**
+   * @brief Returns transaction _id, materializing it if required.
+   *
+   * Can be called from other threads while the model is not modified (see
+   * LedgerManager::prepareConcurrentReads()): the transactions they
+   * materialize are moved to the thread of the model.
+   */
   Q_INVOKABLE KLib::Transaction* get(int _id) const;
 
-  int count() const { return m_transactions.size(); }
-
-  Q_INVOKABLE const QHash<int, Transaction*>& transactions() const {
-    return m_transactions;
-  }
+  /**
+   * @brief Number of transactions, including the ones that are not
+   * materialized yet.
+   */
+  int count() const { return m_transactions.size() + m_numPending; }
+
+  /**
+   * @brief Number of Transaction objects currently in memory.
+   */
+  int materializedCount() const { return m_transactions.size(); }
+
+  /**
+   * @brief Returns all the transactions.
+   *
+   * If the book was loaded lazily, this materializes every transaction: use
+   * get() when possible.
+   */
+  Q_INVOKABLE const QHash<int, Transaction*>& transactions() const;
+
+  /**
+   * @brief Indexes of the transactions by payee, account, security and
+   * attached document.
+   *
+   * Built on the first call (without materializing the transactions of a
+   * lazily loaded book), then kept up to date as transactions are added,
+   * removed and modified. A transaction that is on hold to modify is
+   * reindexed when it emits modified().
+   */
+  const TransactionIndex& index() const;
+
+  /**
+   * @brief Calls _f for each transaction that is not materialized yet, with
+   * its id, date and splits (the memos of the splits are not loaded).
+   */
+  void forEachUnmaterialized(
+      const std::function<void(int _id, const QDate& _date,
+                               const QList<Transaction::Split>& _splits)>& _f)
+      const;
+
+  /**
+   * @brief Sets if books in the columnar format are loaded lazily.
+   *
+   * In lazy mode, the transaction columns are kept in a memory-mapped file
+   * and Transaction objects are created only when they are first accessed
+   * (investment transactions are always created at load time, since the
+   * lots and stock splits need them). Takes effect on the next load.
+   */
+  static void setLazyLoading(bool _lazy) { m_lazyLoading = _lazy; }
+  static bool lazyLoading() { return m_lazyLoading; }
 
   void reassignTransactions(const std::vector<int>& transaction_ids,
                             int reassign_from, int reassign_to,
@@ -56,18 +116,94 @@ class TransactionManager : public IStored {
   virtual void unload() override;
   virtual void afterLoad() override;
 
+  virtual bool hasColumns() const override { return true; }
+  virtual void loadColumns(const ColumnReader& _reader) override;
+  virtual void saveColumns(ColumnWriter& _writer) const override;
+
+ signals:
+  void transactionAdded(KLib::Transaction* _transaction);
+  void transactionModified(KLib::Transaction* _transaction);
+  void transactionRemoved(int _id);
+
+  /**
+   * @brief Emitted when a transaction of a lazily loaded book is created.
+   */
+  void transactionMaterialized(KLib::Transaction* _transaction);
+
+  /**
+   * @brief Emitted when the transactions are replaced without the signals of
+   * each transaction: when the book is unloaded and when the journal is
+   * replayed.
+   */
+  void transactionsReset();
+
  private:
+  struct Columns;
+
   void add(Transaction* _transaction);
   void remove(int _id);
 
-  QHash<int, Transaction*> m_transactions;
+  void connectTransaction(Transaction* _transaction) const;
+
+  /**
+   * @brief Drops the index, which is rebuilt on the next call to index(), and
+   * emits transactionsReset().
+   */
+  void reset();
+
+  /**
+   * @brief Replaces (or adds) the transaction at the current element of
+   * _reader, without any notification. Used to replay the journal.
+   */
+  void restore(QXmlStreamReader& _reader);
+
+  /**
+   * @brief Removes transaction _id without any notification. Used to replay
+   * the journal.
+   */
+  void restoreRemoved(int _id);
+
+  /**
+   * @brief Creates the transaction at _row of _columns. The transaction is not
+   * added to m_transactions.
+   */
+  Transaction* createTransaction(const Columns& _columns, int _row) const;
+
+  /**
+   * @brief Materializes the pending transaction _id. Returns nullptr if there
+   * is no such pending transaction.
+   */
+  Transaction* materialize(int _id) const;
+
+  void mapColumns(const QByteArray& _data);
+
+  // Transactions that are materialized are in m_transactions, the others are
+  // only in the mapped columns. Since materializing does not change the
+  // content of the manager, this is mutable.
+  mutable QHash<int, Transaction*> m_transactions;
+
+  QTemporaryFile* m_mappedFile;
+  ColumnReader* m_mappedReader;
+  Columns* m_columns;
+  mutable QBitArray m_pending;  // Per row of m_columns
+  mutable int m_numPending;
+
+  // Locked by get() and transactions() in lazy books, which readers on other
+  // threads may materialize at the same time.
+  mutable QMutex m_materializeMutex;
+
+  // Built lazily by index()
+  TransactionIndex* m_index;
+  mutable bool m_indexBuilt;
 
   static int newId();
 
   static TransactionManager* m_instance;
   static int m_nextId;
+  static bool m_lazyLoading;
 
   friend class LedgerManager;
+  friend class IO;
 };
 
 }  // namespace KLib
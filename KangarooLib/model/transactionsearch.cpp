@@ -0,0 +1,487 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include "transactionsearch.h"
+
+#include <QMutexLocker>
+#include <QScriptEngine>
+#include <algorithm>
+#include <limits>
+
+#include "modelexception.h"
+#include "payee.h"
+#include "transaction.h"
+#include "transactionmanager.h"
+
+namespace KLib {
+
+TransactionSearch* TransactionSearch::m_instance = nullptr;
+
+TransactionSearch::Query::Query()
+    : hasMinAmount(false),
+      hasMaxAmount(false),
+      idPayee(Constants::NO_ID),
+      limit(0) {}
+
+TransactionSearch::TransactionSearch() : m_built(false) {
+  TransactionManager* manager = TransactionManager::instance();
+
+  connect(manager, &TransactionManager::transactionAdded, this,
+          &TransactionSearch::onTransactionStored);
+  connect(manager, &TransactionManager::transactionModified, this,
+          &TransactionSearch::onTransactionStored);
+  connect(manager, &TransactionManager::transactionRemoved, this,
+          &TransactionSearch::onTransactionRemoved);
+  connect(manager, &TransactionManager::transactionsReset, this,
+          &TransactionSearch::onTransactionsReset);
+  connect(PayeeManager::instance(), &PayeeManager::payeeModified, this,
+          &TransactionSearch::onPayeeModified);
+}
+
+TransactionSearch* TransactionSearch::instance() {
+  static QMutex mutex;
+  QMutexLocker locker(&mutex);
+
+  if (!m_instance) {
+    // The first call can come from a report thread: the signals of the model
+    // must still be received on the thread of the model.
+    m_instance = new TransactionSearch();
+    m_instance->moveToThread(TransactionManager::instance()->thread());
+  }
+
+  return m_instance;
+}
+
+QStringList TransactionSearch::words(const QString& _text) {
+  const QString folded = _text.toCaseFolded();
+  QStringList list;
+  int begin = -1;
+
+  for (int i = 0; i <= folded.size(); ++i) {
+    if (i < folded.size() && folded[i].isLetterOrNumber()) {
+      if (begin == -1) {
+        begin = i;
+      }
+    } else if (begin != -1) {
+      list << folded.mid(begin, i - begin);
+      begin = -1;
+    }
+  }
+
+  return list;
+}
+
+void TransactionSearch::addToEngine(QScriptEngine* _engine) {
+  _engine->globalObject().setProperty("TransactionSearch",
+                                      _engine->newQObject(instance()));
+}
+
+QList<int> TransactionSearch::search(const Query& _query) {
+  // Reversed range of dates: nothing matches, and the scan of the dates
+  // below needs from <= to.
+  if (_query.from.isValid() && _query.to.isValid() &&
+      _query.to < _query.from) {
+    return QList<int>();
+  }
+
+  QMutexLocker locker(&m_mutex);
+  build();
+
+  const QStringList queryWords = words(_query.text);
+
+  // The smallest set of candidates given by the words, the payee and the
+  // accounts. The words are needed anyway; the payee and account sets are
+  // only built if they are the smallest.
+  enum Source { None, Words, Payee, Accounts } source = None;
+  int size = std::numeric_limits<int>::max();
+  QSet<int> fromWords;
+
+  for (const QString& w : queryWords) {
+    QSet<int> s = withPrefix(w);
+
+    if (s.size() < size) {
+      fromWords = s;
+      size = s.size();
+      source = Words;
+    }
+  }
+
+  if (_query.idPayee != Constants::NO_ID &&
+      m_payees.value(_query.idPayee).size() < size) {
+    size = m_payees.value(_query.idPayee).size();
+    source = Payee;
+  }
+
+  if (!_query.idAccounts.isEmpty()) {
+    int count = 0;
+
+    for (int id : _query.idAccounts) {
+      count += m_accounts.value(id).size();
+    }
+
+    if (count < size) {
+      source = Accounts;
+    }
+  }
+
+  QVector<std::pair<qint32, int>> found;  // Date, id
+
+  auto check = [&](int _id) {
+    auto d = m_documents.constFind(_id);
+
+    if (d != m_documents.constEnd() && matches(d.value(), _query, queryWords)) {
+      found << std::make_pair(d.value().date, _id);
+    }
+  };
+
+  if (source == Words) {
+    for (int id : fromWords) {
+      check(id);
+    }
+  } else if (source == Payee) {
+    for (int id : m_payees.value(_query.idPayee)) {
+      check(id);
+    }
+  } else if (source == Accounts) {
+    QSet<int> ids;
+
+    for (int idAccount : _query.idAccounts) {
+      ids.unite(m_accounts.value(idAccount));
+    }
+
+    for (int id : ids) {
+      check(id);
+    }
+  } else if ((_query.hasMinAmount || _query.hasMaxAmount) &&
+             !_query.from.isValid() && !_query.to.isValid()) {
+    // Range of amounts. A transaction can be there once per split.
+    auto i = _query.hasMinAmount
+                 ? m_amounts.lower_bound(std::make_pair(
+                       _query.minAmount, std::numeric_limits<int>::min()))
+                 : m_amounts.begin();
+    QSet<int> seen;
+
+    for (; i != m_amounts.end() &&
+           (!_query.hasMaxAmount || !(_query.maxAmount < i->first));
+         ++i) {
+      if (!seen.contains(i->second)) {
+        seen.insert(i->second);
+        check(i->second);
+      }
+    }
+  } else {
+    // Range of dates, most recent first, so the scan stops at the limit.
+    auto begin = _query.from.isValid()
+                     ? m_dates.lower_bound(
+                           std::make_pair(qint32(_query.from.toJulianDay()),
+                                          std::numeric_limits<int>::min()))
+                     : m_dates.begin();
+    auto i = _query.to.isValid()
+                 ? m_dates.upper_bound(
+                       std::make_pair(qint32(_query.to.toJulianDay()),
+                                      std::numeric_limits<int>::max()))
+                 : m_dates.end();
+
+    while (i != begin && (_query.limit <= 0 || found.size() < _query.limit)) {
+      --i;
+      check(i->second);
+    }
+  }
+
+  std::sort(found.begin(), found.end(),
+            [](const std::pair<qint32, int>& _a,
+               const std::pair<qint32, int>& _b) { return _b < _a; });
+
+  QList<int> ids;
+  const int count = _query.limit > 0 ? std::min(_query.limit, found.size())
+                                     : found.size();
+  ids.reserve(count);
+
+  for (int i = 0; i < count; ++i) {
+    ids << found[i].second;
+  }
+
+  return ids;
+}
+
+QVariantList TransactionSearch::find(const QVariantMap& _query) {
+  Query query;
+  query.text = _query.value("text").toString();
+  query.from = _query.value("from").toDate();
+  query.to = _query.value("to").toDate();
+  query.limit = _query.value("limit", 0).toInt();
+
+  if (_query.contains("minAmount")) {
+    query.hasMinAmount = true;
+    query.minAmount = Amount(_query.value("minAmount").toDouble());
+  }
+
+  if (_query.contains("maxAmount")) {
+    query.hasMaxAmount = true;
+    query.maxAmount = Amount(_query.value("maxAmount").toDouble());
+  }
+
+  if (_query.contains("payee")) {
+    query.idPayee = _query.value("payee").toInt();
+  }
+
+  for (const QVariant& v : _query.value("accounts").toList()) {
+    query.idAccounts.insert(v.toInt());
+  }
+
+  const QList<int> ids = search(query);
+  QVariantList transactions;
+  transactions.reserve(ids.size());
+
+  QMutexLocker locker(&m_mutex);
+
+  for (int id : ids) {
+    auto d = m_documents.constFind(id);
+
+    // Removed since the search
+    if (d != m_documents.constEnd()) {
+      transactions << d.value().value;
+    }
+  }
+
+  return transactions;
+}
+
+void TransactionSearch::prepare() {
+  QMutexLocker locker(&m_mutex);
+  build();
+}
+
+bool TransactionSearch::matches(const Document& _doc, const Query& _query,
+                                const QStringList& _words) {
+  if ((_query.from.isValid() && _doc.date < _query.from.toJulianDay()) ||
+      (_query.to.isValid() && _doc.date > _query.to.toJulianDay())) {
+    return false;
+  }
+
+  if (_query.idPayee != Constants::NO_ID && _doc.idPayee != _query.idPayee) {
+    return false;
+  }
+
+  if (!_query.idAccounts.isEmpty() &&
+      std::none_of(_doc.idAccounts.begin(), _doc.idAccounts.end(),
+                   [&_query](int _id) {
+                     return _query.idAccounts.contains(_id);
+                   })) {
+    return false;
+  }
+
+  if ((_query.hasMinAmount || _query.hasMaxAmount) &&
+      std::none_of(_doc.amounts.begin(), _doc.amounts.end(),
+                   [&_query](const Amount& _a) {
+                     return (!_query.hasMinAmount || !(_a < _query.minAmount)) &&
+                            (!_query.hasMaxAmount || !(_query.maxAmount < _a));
+                   })) {
+    return false;
+  }
+
+  // The words of the document are sorted: the first one that is not before
+  // the query word starts with it if any does.
+  for (const QString& w : _words) {
+    auto i = std::lower_bound(_doc.words.begin(), _doc.words.end(), w);
+
+    if (i == _doc.words.end() || !i->startsWith(w)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+QSet<int> TransactionSearch::withPrefix(const QString& _prefix) const {
+  QSet<int> ids;
+
+  for (auto i = m_words.lowerBound(_prefix);
+       i != m_words.end() && i.key().startsWith(_prefix); ++i) {
+    ids.unite(i.value());
+  }
+
+  return ids;
+}
+
+void TransactionSearch::build() {
+  if (m_built) {
+    return;
+  }
+
+  for (const Transaction* t : TransactionManager::instance()->transactions()) {
+    insert(t);
+  }
+
+  m_built = true;
+}
+
+void TransactionSearch::insert(const Transaction* _tr) {
+  remove(_tr->id());
+
+  Document doc;
+  doc.date = _tr->date().toJulianDay();
+  doc.idPayee = _tr->idPayee();
+
+  QStringList text = words(_tr->memo()) + words(_tr->no());
+
+  if (_tr->idPayee() != Constants::NO_ID) {
+    try {
+      text += words(PayeeManager::instance()->get(_tr->idPayee())->name());
+    } catch (const ModelException&) {
+    }  // No such payee, only the other words are indexed.
+  }
+
+  QVariantList splits;
+
+  for (const Transaction::Split& s : _tr->splits()) {
+    text += words(s.memo);
+    doc.idAccounts << s.idAccount;
+    doc.amounts << s.amount.abs();
+    splits << QVariantMap{{"idAccount", s.idAccount},
+                          {"amount", s.amount.toDouble()},
+                          {"currency", s.currency},
+                          {"memo", s.memo}};
+  }
+
+  doc.value = QVariantMap{{"id", _tr->id()},
+                          {"date", _tr->date()},
+                          {"no", _tr->no()},
+                          {"memo", _tr->memo()},
+                          {"idPayee", _tr->idPayee()},
+                          {"splits", splits}};
+
+  doc.words = text.toVector();
+  std::sort(doc.words.begin(), doc.words.end());
+  doc.words.erase(std::unique(doc.words.begin(), doc.words.end()),
+                  doc.words.end());
+
+  std::sort(doc.amounts.begin(), doc.amounts.end());
+  doc.amounts.erase(std::unique(doc.amounts.begin(), doc.amounts.end()),
+                    doc.amounts.end());
+
+  for (const QString& w : doc.words) {
+    m_words[w].insert(_tr->id());
+  }
+
+  for (const Amount& a : doc.amounts) {
+    m_amounts.insert(std::make_pair(a, _tr->id()));
+  }
+
+  if (doc.idPayee != Constants::NO_ID) {
+    m_payees[doc.idPayee].insert(_tr->id());
+  }
+
+  for (int idAccount : doc.idAccounts) {
+    m_accounts[idAccount].insert(_tr->id());
+  }
+
+  m_dates.insert(std::make_pair(doc.date, _tr->id()));
+  m_documents.insert(_tr->id(), doc);
+}
+
+void TransactionSearch::remove(int _id) {
+  auto d = m_documents.find(_id);
+
+  if (d == m_documents.end()) {
+    return;
+  }
+
+  for (const QString& w : d.value().words) {
+    auto i = m_words.find(w);
+
+    if (i != m_words.end()) {
+      i.value().remove(_id);
+
+      if (i.value().isEmpty()) {
+        m_words.erase(i);
+      }
+    }
+  }
+
+  for (const Amount& a : d.value().amounts) {
+    m_amounts.erase(std::make_pair(a, _id));
+  }
+
+  for (int idAccount : d.value().idAccounts) {
+    auto i = m_accounts.find(idAccount);
+
+    if (i != m_accounts.end()) {
+      i.value().remove(_id);
+
+      if (i.value().isEmpty()) {
+        m_accounts.erase(i);
+      }
+    }
+  }
+
+  auto p = m_payees.find(d.value().idPayee);
+
+  if (p != m_payees.end()) {
+    p.value().remove(_id);
+
+    if (p.value().isEmpty()) {
+      m_payees.erase(p);
+    }
+  }
+
+  m_dates.erase(std::make_pair(d.value().date, _id));
+  m_documents.erase(d);
+}
+
+void TransactionSearch::onTransactionStored(Transaction* _tr) {
+  QMutexLocker locker(&m_mutex);
+
+  if (m_built) {
+    insert(_tr);
+  }
+}
+
+void TransactionSearch::onTransactionRemoved(int _id) {
+  QMutexLocker locker(&m_mutex);
+
+  if (m_built) {
+    remove(_id);
+  }
+}
+
+void TransactionSearch::onPayeeModified(Payee* _payee) {
+  QMutexLocker locker(&m_mutex);
+
+  if (!m_built) {
+    return;
+  }
+
+  for (int id : m_payees.value(_payee->id())) {
+    insert(TransactionManager::instance()->get(id));
+  }
+}
+
+void TransactionSearch::onTransactionsReset() {
+  QMutexLocker locker(&m_mutex);
+  m_words.clear();
+  m_dates.clear();
+  m_amounts.clear();
+  m_documents.clear();
+  m_payees.clear();
+  m_accounts.clear();
+  m_built = false;
+}
+
+}  // namespace KLib
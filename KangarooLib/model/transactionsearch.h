@@ -0,0 +1,189 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef TRANSACTIONSEARCH_H
+#define TRANSACTIONSEARCH_H
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+#include <set>
+#include <utility>
+
+#include "../amount.h"
+#include "../interfaces/scriptable.h"
+#include "../klib.h"
+
+class QScriptEngine;
+
+namespace KLib {
+
+class Payee;
+class Transaction;
+
+/**
+ * @brief Search of the transactions of the whole book by words, date, amount,
+ * account and payee.
+ *
+ * Keeps an inverted index of the words of the memo, number, payee name and
+ * split memos of each transaction, and ordered indexes of the dates and of
+ * the amounts of the splits, and of the transactions of each account and
+ * payee.
+ *
+ * A query starts from the smallest set of candidates given by one of the
+ * indexes, then checks the other criteria on each candidate, so its cost
+ * depends on the number of candidates rather than on the size of the book.
+ *
+ * The indexes are built on the first search (which materializes the
+ * transactions of a lazily loaded book), then updated as transactions are
+ * added, modified and removed, and as payees are renamed. A search only reads
+ * the indexes, under a mutex, and find() returns copies of the transactions,
+ * so searches can run on the report threads (see ReportTemplate) while the
+ * model is modified, once prepare() has built the indexes on the thread of the
+ * model.
+ *
+ * In report scripts (see addToEngine()):
+ * @code
+ * var found = TransactionSearch.find({text: "grocer", from: new Date(2015, 0, 1),
+ *                                     minAmount: 50, limit: 20});
+ * @endcode
+ */
+class TransactionSearch : public QObject {
+  Q_OBJECT
+  K_SCRIPTABLE(TransactionSearch)
+
+  TransactionSearch();
+
+ public:
+  struct Query {
+    Query();
+
+    /**
+     * @brief Each word of the text must start a word of the transaction. Case
+     * insensitive.
+     */
+    QString text;
+
+    QDate from;  ///< Inclusive, invalid for no lower bound
+    QDate to;    ///< Inclusive, invalid for no upper bound
+
+    /**
+     * @brief Bounds of the absolute amount of at least one split
+     */
+    bool hasMinAmount;
+    Amount minAmount;
+    bool hasMaxAmount;
+    Amount maxAmount;
+
+    QSet<int> idAccounts;  ///< A split in one of the accounts, empty for any
+    int idPayee;           ///< Constants::NO_ID for any
+    int limit;             ///< Maximum number of results, 0 for no limit
+  };
+
+  /**
+   * @return The ids of the matching transactions, most recent first.
+   */
+  QList<int> search(const Query& _query);
+
+  /**
+   * @brief search() for scripts. The keys of _query are text, from, to,
+   * minAmount, maxAmount, accounts (a list of account ids), payee and limit.
+   *
+   * @return The matching transactions, as maps with the keys id, date, no,
+   * memo, idPayee and splits (maps with the keys idAccount, amount, currency
+   * and memo).
+   */
+  Q_INVOKABLE QVariantList find(const QVariantMap& _query);
+
+  /**
+   * @brief Builds the indexes if they are not built yet. Must be called from
+   * the thread of the model before searching from another thread.
+   */
+  void prepare();
+
+  /**
+   * @brief Case folded words of _text: sequences of letters and digits.
+   */
+  static QStringList words(const QString& _text);
+
+  /**
+   * @brief Number of distinct words in the index
+   */
+  int wordCount() const { return m_words.size(); }
+
+  static TransactionSearch* instance();
+
+  /**
+   * @brief Adds the global TransactionSearch, the instance, to _engine.
+   */
+  static void addToEngine(QScriptEngine* _engine);
+
+ private slots:
+  void onTransactionStored(KLib::Transaction* _tr);
+  void onTransactionRemoved(int _id);
+  void onPayeeModified(KLib::Payee* _payee);
+  void onTransactionsReset();
+
+ private:
+  struct Document {
+    qint32 date;
+    int idPayee;
+    QVector<int> idAccounts;
+    QVector<QString> words;  ///< Sorted, without duplicates
+    QVector<Amount> amounts;  ///< Absolute amounts, without duplicates
+    QVariantMap value;        ///< Copy of the transaction, see find()
+  };
+
+  void build();
+  void insert(const Transaction* _tr);
+  void remove(int _id);
+
+  /**
+   * @brief Transactions that have a word starting with _prefix.
+   */
+  QSet<int> withPrefix(const QString& _prefix) const;
+
+  static bool matches(const Document& _doc, const Query& _query,
+                      const QStringList& _words);
+
+  mutable QMutex m_mutex;  ///< Indexes, between the report threads
+  bool m_built;
+
+  QMap<QString, QSet<int>> m_words;  ///< Ordered, for the prefixes
+  std::set<std::pair<qint32, int>> m_dates;
+  std::set<std::pair<Amount, int>> m_amounts;
+  QHash<int, Document> m_documents;
+  QHash<int, QSet<int>> m_payees;    ///< Transactions of each payee
+  QHash<int, QSet<int>> m_accounts;  ///< Transactions of each account
+
+  static TransactionSearch* m_instance;
+};
+
+}  // namespace KLib
+
+Q_DECLARE_METATYPE(KLib::TransactionSearch*)
+
+#endif  // TRANSACTIONSEARCH_H
@@ -0,0 +1,6 @@
+# AccountValuation (model/accountvaluation.h) against the values of Account.
+
+include(../tests.pri)
+
+TARGET = tst_accountvaluation
+SOURCES += tst_accountvaluation.cpp
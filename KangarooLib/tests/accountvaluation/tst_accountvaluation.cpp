@@ -0,0 +1,138 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include <QScriptEngine>
+#include <QtTest>
+#include <random>
+
+#include "model/accountvaluation.h"
+#include "model/currency.h"
+#include "model/pricemanager.h"
+#include "testbook.h"
+
+using namespace KLib;
+
+namespace {
+
+const QDate FIRST(2014, 1, 1);
+
+}  // namespace
+
+class TestAccountValuation : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void init();
+
+  void matchesAccount();
+  void script();
+
+ private:
+  QList<Account*> m_accounts;
+  QVector<QDate> m_dates;
+};
+
+void TestAccountValuation::init() {
+  TestBook::Accounts a = TestBook::newBook();
+  const QString usd = Constants::DEFAULT_CURRENCY_CODE;
+
+  CurrencyManager::instance()->add("CAD", "Canadian dollar");
+
+  Account* bank = TestBook::addAccount(a.assets, "Bank", AccountType::CHECKING);
+  Account* savings = a.assets->addChild("Savings", AccountType::SAVINGS, "CAD",
+                                        Constants::NO_ID);
+  Account* interest = a.income->addChild("Interest", AccountType::INCOME,
+                                         "CAD", Constants::NO_ID);
+  Account* food = TestBook::addAccount(a.expenses, "Food", AccountType::EXPENSE);
+  Account* groceries =
+      TestBook::addAccount(food, "Groceries", AccountType::EXPENSE);
+  Account* restaurants =
+      TestBook::addAccount(food, "Restaurants", AccountType::EXPENSE);
+
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<int> day(0, 365);
+  std::uniform_int_distribution<int> cents(1, 20000);
+
+  for (int i = 0; i < 300; ++i) {
+    const QDate date = FIRST.addDays(day(gen));
+    const Amount amount(cents(gen) / 100.0);
+
+    if (i % 3 == 0) {
+      Transaction* t = new Transaction();
+      t->setDate(date);
+      t->setSplits({Transaction::Split(amount, savings->id(), "CAD"),
+                    Transaction::Split(-amount, interest->id(), "CAD")});
+      LedgerManager::instance()->addTransaction(t);
+    } else {
+      TestBook::addTransfer(date, amount, bank->id(),
+                            i % 3 == 1 ? groceries->id() : restaurants->id());
+    }
+  }
+
+  ExchangePair* pair = PriceManager::instance()->getOrAdd("CAD", usd);
+  for (int d = 0; d < 365; d += 7) {
+    pair->set(FIRST.addDays(d), 0.75 + d / 3650.0);
+  }
+
+  m_accounts = {Account::getTopLevel(), a.assets, bank, savings, a.expenses,
+                food, groceries, a.income};
+
+  // Before the first transaction, in the middle of each month, and after the
+  // last transaction
+  m_dates = {FIRST.addDays(-10)};
+  for (int m = 0; m < 12; ++m) {
+    m_dates << FIRST.addMonths(m).addDays(14);
+  }
+  m_dates << FIRST.addDays(400);
+}
+
+void TestAccountValuation::matchesAccount() {
+  AccountValuation valuation(m_dates);
+  valuation.compute(m_accounts);
+
+  for (Account* a : m_accounts) {
+    for (int i = 0; i < m_dates.size(); ++i) {
+      const QDate start = i == 0 ? QDate() : m_dates[i - 1].addDays(1);
+
+      QCOMPARE(valuation.treeValueAt(a, i), a->treeValueAt(m_dates[i]));
+      QCOMPARE(valuation.treeValueBetween(a, i),
+               a->treeValueBetween(start, m_dates[i]));
+    }
+  }
+}
+
+void TestAccountValuation::script() {
+  QScriptEngine engine;
+  AccountValuation::addToEngine(&engine);
+
+  QScriptValue v = engine.evaluate(
+      "var v = new AccountValuation([new Date(2014, 0, 31), "
+      "new Date(2014, 1, 28)]); v.dateCount");
+  QVERIFY(!engine.hasUncaughtException());
+  QCOMPARE(v.toInt32(), 2);
+
+  // Dates that are not increasing
+  engine.evaluate(
+      "new AccountValuation([new Date(2014, 1, 28), new Date(2014, 0, 31)])");
+  QVERIFY(engine.hasUncaughtException());
+}
+
+QTEST_GUILESS_MAIN(TestAccountValuation)
+
+#include "tst_accountvaluation.moc"
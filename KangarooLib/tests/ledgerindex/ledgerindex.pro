@@ -0,0 +1,6 @@
+# Balance queries of Ledger with its flat index and with the treap walk.
+
+include(../tests.pri)
+
+TARGET = tst_ledgerindex
+SOURCES += tst_ledgerindex.cpp
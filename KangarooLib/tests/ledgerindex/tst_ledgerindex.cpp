@@ -0,0 +1,177 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include <QPair>
+#include <QVector>
+#include <QtConcurrent>
+#include <QtTest>
+#include <algorithm>
+#include <random>
+
+#include "model/ledger.h"
+#include "testbook.h"
+
+using namespace KLib;
+
+namespace {
+
+typedef QPair<QDate, QDate> Range;
+
+const QDate FIRST(2010, 1, 1);
+const int DAYS = 2000;
+
+/**
+ * @brief Everything the ledger answers for _ranges and _dates.
+ */
+struct Results {
+  QVector<Balances> between;
+  QVector<Balances> at;
+  QVector<QList<Transaction*>> transactions;
+
+  bool operator==(const Results& _other) const {
+    return between == _other.between && at == _other.at &&
+           transactions == _other.transactions;
+  }
+};
+
+Results query(const Ledger* _ledger, const QVector<Range>& _ranges,
+              const QVector<QDate>& _dates) {
+  Results r;
+
+  for (const Range& range : _ranges) {
+    r.between << _ledger->balancesBetween(range.first, range.second);
+
+    QList<Transaction*> list;
+    for (Transaction* t :
+         _ledger->transactionsBetween(range.first, range.second)) {
+      list << t;
+    }
+    r.transactions << list;
+  }
+
+  r.at = _ledger->balancesAt(_dates);
+  return r;
+}
+
+}  // namespace
+
+class TestLedgerIndex : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void init();
+
+  void indexEqualsTreap();
+  void concurrentQueries();
+
+ private:
+  QVector<Range> m_ranges;
+  QVector<QDate> m_dates;
+  Ledger* m_ledger;
+  int m_idOther;
+};
+
+void TestLedgerIndex::init() {
+  TestBook::Accounts a = TestBook::newBook();
+  Account* bank = TestBook::addAccount(a.assets, "Bank", AccountType::CHECKING);
+  m_idOther =
+      TestBook::addAccount(a.expenses, "Food", AccountType::EXPENSE)->id();
+  m_ledger = LedgerManager::instance()->ledger(bank->id());
+
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<int> day(0, DAYS);
+  std::uniform_int_distribution<int> cents(-50000, 50000);
+
+  // Appended in order of date (the index stays valid), then in the past
+  for (int i = 0; i < 1000; ++i) {
+    const QDate date =
+        i < 800 ? FIRST.addDays(i * DAYS / 800) : FIRST.addDays(day(gen));
+    TestBook::addTransfer(date, Amount(cents(gen) / 100.0), bank->id(),
+                          m_idOther);
+  }
+
+  // Unbounded, empty, reversed and out of the ledger ranges as well
+  m_ranges.clear();
+  m_ranges << Range(QDate(), QDate()) << Range(QDate(), FIRST.addDays(10))
+           << Range(FIRST.addDays(10), QDate())
+           << Range(FIRST.addDays(20), FIRST.addDays(10))
+           << Range(FIRST.addDays(-100), FIRST.addDays(-1))
+           << Range(FIRST.addDays(DAYS + 1), FIRST.addDays(DAYS + 100));
+
+  for (int i = 0; i < 200; ++i) {
+    QDate from = FIRST.addDays(day(gen) - 10);
+    QDate to = from.addDays(day(gen) % 200);
+    m_ranges << Range(from, to);
+  }
+
+  m_dates.clear();
+  for (int i = 0; i < 200; ++i) {
+    m_dates << FIRST.addDays(day(gen) - 10);
+  }
+  std::sort(m_dates.begin(), m_dates.end());
+}
+
+void TestLedgerIndex::indexEqualsTreap() {
+  m_ledger->setFlatIndex(false);
+  const Results walk = query(m_ledger, m_ranges, m_dates);
+
+  m_ledger->setFlatIndex(true);
+  const Results indexed = query(m_ledger, m_ranges, m_dates);
+
+  QVERIFY(walk == indexed);
+  QCOMPARE(walk.between.first(), m_ledger->balances());
+}
+
+void TestLedgerIndex::concurrentQueries() {
+  m_ledger->setFlatIndex(false);
+  const Results expected = query(m_ledger, m_ranges, m_dates);
+
+  // Once with the index built by prepareConcurrentReads(), once with an
+  // invalid index (a transaction was added in the past, then removed), which
+  // the other threads must not rebuild
+  for (int pass = 0; pass < 2; ++pass) {
+    m_ledger->setFlatIndex(true);
+
+    if (pass == 0) {
+      LedgerManager::instance()->prepareConcurrentReads();
+    } else {
+      Transaction* t = TestBook::addTransfer(
+          FIRST.addDays(5), Amount(1.0), m_ledger->idAccount(), m_idOther);
+      LedgerManager::instance()->removeTransaction(t->id());
+    }
+
+    const Ledger* ledger = m_ledger;
+    const QVector<Range> ranges = m_ranges;
+    const QVector<QDate> dates = m_dates;
+    QList<QFuture<Results>> futures;
+
+    for (int i = 0; i < 16; ++i) {
+      futures << QtConcurrent::run(
+          [ledger, ranges, dates]() { return query(ledger, ranges, dates); });
+    }
+
+    for (QFuture<Results>& f : futures) {
+      QVERIFY(f.result() == expected);
+    }
+  }
+}
+
+QTEST_GUILESS_MAIN(TestLedgerIndex)
+
+#include "tst_ledgerindex.moc"
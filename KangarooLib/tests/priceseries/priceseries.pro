@@ -0,0 +1,6 @@
+# Lookups and changes of PriceSeries (util/priceseries.h).
+
+include(../tests.pri)
+
+TARGET = tst_priceseries
+SOURCES += tst_priceseries.cpp
@@ -0,0 +1,236 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include <QtTest>
+#include <map>
+#include <random>
+
+#include "util/priceseries.h"
+
+using namespace KLib;
+
+namespace {
+
+const QDate D1(2015, 1, 10);
+const QDate D2(2015, 2, 10);
+const QDate D3(2015, 3, 10);
+
+/**
+ * @brief D1 -> 1, D2 -> 2, D3 -> 3, inserted out of order.
+ */
+PriceSeries threePrices() {
+  PriceSeries s;
+  s.set(D2, 2);
+  s.set(D3, 3);
+  s.set(D1, 1);
+  return s;
+}
+
+/**
+ * @brief Price as of _day in _reference, as PriceSeries::on() defines it.
+ */
+double asOf(const std::map<int, double>& _reference, int _day) {
+  auto i = _reference.upper_bound(_day);
+  return i == _reference.begin() ? 0 : std::prev(i)->second;
+}
+
+}  // namespace
+
+class TestPriceSeries : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void empty();
+  void lookups();
+  void batchedLookups();
+  void overwrite();
+  void remove();
+  void between();
+  void randomOperations();
+};
+
+void TestPriceSeries::empty() {
+  PriceSeries s;
+
+  QVERIFY(s.isEmpty());
+  QCOMPARE(s.on(D1), 0.);
+  QCOMPARE(s.last(), 0.);
+  QVERIFY(!s.lastDate().isValid());
+  QVERIFY(s.between(QDate(), QDate()).isEmpty());
+  QVERIFY(!s.remove(D1));
+}
+
+void TestPriceSeries::lookups() {
+  PriceSeries s = threePrices();
+
+  QCOMPARE(s.count(), 3);
+  QCOMPARE(s.lastDate(), D3);
+  QCOMPARE(s.last(), 3.);
+
+  // Before the first date
+  QCOMPARE(s.on(D1.addDays(-1)), 0.);
+  QCOMPARE(s.on(QDate(1990, 1, 1)), 0.);
+
+  // On and between the stored dates
+  QCOMPARE(s.on(D1), 1.);
+  QCOMPARE(s.on(D1.addDays(1)), 1.);
+  QCOMPARE(s.on(D2.addDays(-1)), 1.);
+  QCOMPARE(s.on(D2), 2.);
+  QCOMPARE(s.on(D3.addDays(-1)), 2.);
+  QCOMPARE(s.on(D3), 3.);
+
+  // After the last date
+  QCOMPARE(s.on(D3.addDays(1)), 3.);
+  QCOMPARE(s.on(QDate(2100, 1, 1)), 3.);
+
+  QVERIFY(s.contains(D2));
+  QVERIFY(!s.contains(D2.addDays(1)));
+}
+
+void TestPriceSeries::batchedLookups() {
+  PriceSeries s = threePrices();
+
+  // Sorted, with duplicates, then going back
+  QVector<QDate> dates;
+  dates << D1.addDays(-1) << D1 << D1.addDays(5) << D2 << D2 << D3.addDays(-1)
+        << D3.addDays(100) << D1.addDays(1) << D3 << D1.addDays(-10);
+
+  QVector<double> values = s.on(dates);
+  QCOMPARE(values.size(), dates.size());
+
+  for (int i = 0; i < dates.size(); ++i) {
+    QCOMPARE(values[i], s.on(dates[i]));
+  }
+}
+
+void TestPriceSeries::overwrite() {
+  PriceSeries s = threePrices();
+
+  s.set(D2, 20);
+  QCOMPARE(s.count(), 3);
+  QCOMPARE(s.on(D2), 20.);
+  QCOMPARE(s.on(D2.addDays(1)), 20.);
+  QCOMPARE(s.on(D2.addDays(-1)), 1.);
+
+  // The last one, which is on the appending path
+  s.set(D3, 30);
+  QCOMPARE(s.count(), 3);
+  QCOMPARE(s.last(), 30.);
+  QCOMPARE(s.lastDate(), D3);
+
+  s.set(D1, 10);
+  QCOMPARE(s.count(), 3);
+  QCOMPARE(s.on(D1), 10.);
+  QCOMPARE(s.on(D1.addDays(-1)), 0.);
+}
+
+void TestPriceSeries::remove() {
+  PriceSeries s = threePrices();
+
+  QVERIFY(!s.remove(D2.addDays(1)));
+  QCOMPARE(s.count(), 3);
+
+  QVERIFY(s.remove(D2));
+  QCOMPARE(s.count(), 2);
+  QVERIFY(!s.contains(D2));
+  QCOMPARE(s.on(D2), 1.);
+
+  QVERIFY(s.remove(D3));
+  QCOMPARE(s.last(), 1.);
+  QCOMPARE(s.lastDate(), D1);
+}
+
+void TestPriceSeries::between() {
+  PriceSeries s = threePrices();
+
+  PriceSeries::View all = s.between(QDate(), QDate());
+  QCOMPARE(all.size(), 3);
+  QCOMPARE(all.dateAt(0), D1);
+  QCOMPARE(all.valueAt(2), 3.);
+
+  // Inclusive bounds
+  PriceSeries::View v = s.between(D1, D2);
+  QCOMPARE(v.size(), 2);
+  QCOMPARE(v.dateAt(0), D1);
+  QCOMPARE(v.dateAt(1), D2);
+
+  v = s.between(D1.addDays(1), D3.addDays(-1));
+  QCOMPARE(v.size(), 1);
+  QCOMPARE(v.dateAt(0), D2);
+
+  QCOMPARE(s.between(D2, QDate()).size(), 2);
+  QCOMPARE(s.between(QDate(), D2).size(), 2);
+
+  // Outside of the series, and reversed
+  QVERIFY(s.between(QDate(1990, 1, 1), D1.addDays(-1)).isEmpty());
+  QVERIFY(s.between(D3.addDays(1), QDate()).isEmpty());
+  QVERIFY(s.between(D3, D1).isEmpty());
+}
+
+void TestPriceSeries::randomOperations() {
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> day(0, 400);
+  std::uniform_int_distribution<int> op(0, 9);
+
+  const QDate first(2010, 1, 1);
+  PriceSeries s;
+  std::map<int, double> reference;
+
+  for (int i = 0; i < 5000; ++i) {
+    const int d = day(gen);
+    const QDate date = first.addDays(d);
+
+    switch (op(gen)) {
+      case 0:
+      case 1:
+        QCOMPARE(s.remove(date), reference.erase(d) == 1);
+        break;
+      case 2: {
+        // Appending after the last date
+        const int last = reference.empty() ? 0 : reference.rbegin()->first;
+        s.set(first.addDays(last + 1), i);
+        reference[last + 1] = i;
+        break;
+      }
+      default:
+        s.set(date, i);
+        reference[d] = i;
+        break;
+    }
+
+    QCOMPARE(s.count(), int(reference.size()));
+
+    const int q = day(gen) - 10;
+    QCOMPARE(s.on(first.addDays(q)), asOf(reference, q));
+  }
+
+  QVector<QDate> dates;
+  for (int d = -10; d < 420; ++d) {
+    dates << first.addDays(d);
+  }
+
+  QVector<double> values = s.on(dates);
+  for (int d = -10; d < 420; ++d) {
+    QCOMPARE(values[d + 10], asOf(reference, d));
+  }
+}
+
+QTEST_APPLESS_MAIN(TestPriceSeries)
+
+#include "tst_priceseries.moc"
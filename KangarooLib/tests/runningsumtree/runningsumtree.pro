@@ -0,0 +1,7 @@
+# Random operations on RunningSumTree (util/runningsumtree.h) against a
+# plain vector.
+
+include(../tests.pri)
+
+TARGET = tst_runningsumtree
+SOURCES += tst_runningsumtree.cpp
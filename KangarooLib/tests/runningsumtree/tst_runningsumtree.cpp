@@ -0,0 +1,192 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include <QtTest>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/runningsumtree.h"
+
+using namespace KLib;
+
+namespace {
+
+/**
+ * @brief Random inserts, removals, moves and reweights of a RunningSumTree<S>,
+ * mirrored in a vector of (node, weight). Returns an empty string, or the
+ * first difference with the vector.
+ *
+ * Weights are made by _weight(i). With a non commutative S (such as strings),
+ * the sums also check the order in which the weights are added.
+ */
+template <typename S, typename MakeWeight>
+std::string fuzz(unsigned _seed, int _operations, int _maxSize,
+                 MakeWeight _weight) {
+  typedef RunningSumTree<S> Tree;
+  typedef std::vector<std::pair<typename Tree::Node*, S>> Reference;
+
+  std::mt19937 gen(_seed);
+  Tree tree(_seed);
+  Reference ref;
+
+  auto random = [&gen](int _n) {
+    return std::uniform_int_distribution<int>(0, _n - 1)(gen);
+  };
+
+  auto prefix = [&ref](int _pos) {
+    S s = S();
+    for (int i = 0; i <= _pos; ++i) {
+      s = s + ref[i].second;
+    }
+    return s;
+  };
+
+  auto check = [&](int _pos, int _op) -> std::string {
+    typename Tree::Node* n = ref[_pos].first;
+    const std::string where =
+        " at operation " + std::to_string(_op) + ", position " +
+        std::to_string(_pos);
+
+    if (tree.at(_pos) != n) {
+      return "at()" + where;
+    } else if (tree.positionOf(n) != _pos) {
+      return "positionOf()" + where;
+    } else if (!(n->weight() == ref[_pos].second)) {
+      return "weight()" + where;
+    } else if (!(tree.sumTo(n) == prefix(_pos))) {
+      return "sumTo()" + where;
+    }
+    return std::string();
+  };
+
+  for (int op = 0; op < _operations; ++op) {
+    const int size = int(ref.size());
+    const int kind = size == 0 ? 0 : random(size >= _maxSize ? 3 : 4) + 1;
+
+    switch (kind) {
+      case 0:
+      case 4: {
+        const int pos = random(size + 1);
+        const S w = _weight(op);
+        ref.insert(ref.begin() + pos, std::make_pair(tree.insert(pos, w), w));
+        break;
+      }
+      case 1: {
+        const int pos = random(size);
+        tree.remove(ref[pos].first);
+        ref.erase(ref.begin() + pos);
+        break;
+      }
+      case 2: {
+        const int from = random(size);
+        const int to = random(size);
+        auto e = ref[from];
+        tree.move(e.first, to);
+        ref.erase(ref.begin() + from);
+        ref.insert(ref.begin() + to, e);
+        break;
+      }
+      case 3: {
+        const int pos = random(size);
+        ref[pos].second = _weight(op);
+        tree.setWeight(ref[pos].first, ref[pos].second);
+        break;
+      }
+    }
+
+    if (tree.size() != int(ref.size())) {
+      return "size() at operation " + std::to_string(op);
+    } else if (tree.isEmpty() != ref.empty()) {
+      return "isEmpty() at operation " + std::to_string(op);
+    } else if (ref.empty()) {
+      continue;
+    } else if (!(tree.sum() == prefix(int(ref.size()) - 1))) {
+      return "sum() at operation " + std::to_string(op);
+    }
+
+    // A few random positions, and every position from time to time
+    const bool all = op % 97 == 0;
+    for (int i = 0; i < (all ? int(ref.size()) : 3); ++i) {
+      std::string error = check(all ? i : random(int(ref.size())), op);
+      if (!error.empty()) {
+        return error;
+      }
+    }
+  }
+
+  tree.clear();
+  return tree.isEmpty() && tree.sum() == S() ? std::string()
+                                             : "clear()";
+}
+
+}  // namespace
+
+class TestRunningSumTree : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void empty();
+  void outOfRange();
+  void randomIntegers();
+  void randomStrings();
+};
+
+void TestRunningSumTree::empty() {
+  RunningSumTree<long long> tree;
+
+  QVERIFY(tree.isEmpty());
+  QCOMPARE(tree.size(), 0);
+  QCOMPARE(tree.sum(), 0LL);
+}
+
+void TestRunningSumTree::outOfRange() {
+  RunningSumTree<long long> tree;
+  tree.insert(0, 1);
+
+  QVERIFY_EXCEPTION_THROWN(tree.at(1), std::out_of_range);
+  QVERIFY_EXCEPTION_THROWN(tree.at(-1), std::out_of_range);
+  QVERIFY_EXCEPTION_THROWN(tree.insert(2, 1), std::out_of_range);
+  QCOMPARE(tree.size(), 1);
+}
+
+void TestRunningSumTree::randomIntegers() {
+  // Small trees go through the empty and single element cases often
+  for (unsigned seed = 1; seed <= 20; ++seed) {
+    const std::string error = fuzz<long long>(
+        seed, 2000, seed <= 10 ? 8 : 500,
+        [seed](int _op) { return (long long)(_op * 7919 % 2001) - 1000; });
+    QVERIFY2(error.empty(), error.c_str());
+  }
+}
+
+void TestRunningSumTree::randomStrings() {
+  for (unsigned seed = 1; seed <= 5; ++seed) {
+    const std::string error = fuzz<std::string>(
+        seed, 1000, 60,
+        [](int _op) { return std::string(1, char('a' + _op % 26)); });
+    QVERIFY2(error.empty(), error.c_str());
+  }
+}
+
+QTEST_APPLESS_MAIN(TestRunningSumTree)
+
+#include "tst_runningsumtree.moc"
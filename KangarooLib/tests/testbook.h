@@ -0,0 +1,97 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#ifndef TESTBOOK_H
+#define TESTBOOK_H
+
+#include <QDate>
+#include <QList>
+#include <QString>
+
+#include "amount.h"
+#include "controller/io.h"
+#include "klib.h"
+#include "model/account.h"
+#include "model/ledger.h"
+#include "model/payee.h"
+#include "model/transaction.h"
+
+/**
+ * @brief Helpers that fill a new, empty book for the tests.
+ *
+ * The book has the top level accounts of the default currency; the other
+ * accounts, payees and transactions are added by each test.
+ */
+namespace TestBook {
+
+struct Accounts {
+  KLib::Account* assets;
+  KLib::Account* expenses;
+  KLib::Account* income;
+};
+
+/**
+ * @brief Replaces the current book by an empty one, without a journal.
+ */
+inline Accounts newBook() {
+  KLib::IO::instance()->setJournalEnabled(false);
+  KLib::IO::instance()->loadNew();
+
+  const QString cur = KLib::Constants::DEFAULT_CURRENCY_CODE;
+  KLib::Account* top = KLib::Account::getTopLevel();
+
+  Accounts a;
+  a.assets = top->addChild("Assets", KLib::AccountType::ASSET, cur,
+                           KLib::Constants::NO_ID, true);
+  a.expenses = top->addChild("Expenses", KLib::AccountType::EXPENSE, cur,
+                             KLib::Constants::NO_ID, true);
+  a.income = top->addChild("Income", KLib::AccountType::INCOME, cur,
+                           KLib::Constants::NO_ID);
+  return a;
+}
+
+inline KLib::Account* addAccount(KLib::Account* _parent, const QString& _name,
+                                 int _type) {
+  return _parent->addChild(_name, _type, KLib::Constants::DEFAULT_CURRENCY_CODE,
+                           KLib::Constants::NO_ID);
+}
+
+/**
+ * @brief Adds a transaction of _amount from _from to _to, in the default
+ * currency.
+ */
+inline KLib::Transaction* addTransfer(
+    const QDate& _date, const KLib::Amount& _amount, int _from, int _to,
+    const QString& _memo = QString(),
+    int _idPayee = KLib::Constants::NO_ID) {
+  const QString cur = KLib::Constants::DEFAULT_CURRENCY_CODE;
+
+  KLib::Transaction* t = new KLib::Transaction();
+  t->setDate(_date);
+  t->setMemo(_memo);
+  t->setIdPayee(_idPayee);
+  t->setSplits({KLib::Transaction::Split(-_amount, _from, cur),
+                KLib::Transaction::Split(_amount, _to, cur)});
+
+  return KLib::LedgerManager::instance()->addTransaction(t);
+}
+
+}  // namespace TestBook
+
+#endif  // TESTBOOK_H
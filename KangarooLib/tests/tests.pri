@@ -0,0 +1,14 @@
+# Common settings of the tests of KangarooLib. Each test is a QtTest program
+# that links to KangarooLib (build it first), run with "make check".
+
+QMAKE_CXXFLAGS += -std=c++20
+CONFIG += console testcase
+CONFIG -= app_bundle
+QT += testlib gui widgets script printsupport concurrent
+TEMPLATE = app
+INCLUDEPATH += $$PWD/../ $$PWD
+HEADERS += $$PWD/testbook.h
+unix:LIBS += -L$$PWD/../../Kangaroo/lib -lkangaroo
+
+OBJECTS_DIR = build/obj
+MOC_DIR = build/moc
@@ -0,0 +1,7 @@
+# TransactionManager::index() (model/transactionindex.h) against an index
+# rebuilt from the transactions, through changes and journal replays.
+
+include(../tests.pri)
+
+TARGET = tst_transactionindex
+SOURCES += tst_transactionindex.cpp
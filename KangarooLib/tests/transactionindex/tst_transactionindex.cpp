@@ -0,0 +1,259 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include <QTemporaryDir>
+#include <QtTest>
+#include <algorithm>
+#include <random>
+
+#include "model/transactionindex.h"
+#include "model/transactionmanager.h"
+#include "testbook.h"
+
+using namespace KLib;
+
+namespace {
+
+const QDate FIRST(2015, 1, 1);
+
+typedef QList<QList<int>> IndexContent;
+
+/**
+ * @brief Sorted transactions of each of _accounts, then of each of _payees.
+ */
+IndexContent contentOf(const TransactionIndex& _index,
+                       const QVector<int>& _accounts,
+                       const QVector<int>& _payees) {
+  IndexContent content;
+
+  auto add = [&](TransactionIndex::Key _key, int _id) {
+    QList<int> ids = _index.transactions(_key, _id);
+    std::sort(ids.begin(), ids.end());
+    content << ids;
+  };
+
+  for (int id : _accounts) {
+    add(TransactionIndex::ByAccount, id);
+  }
+
+  for (int id : _payees) {
+    add(TransactionIndex::ByPayee, id);
+  }
+
+  return content;
+}
+
+/**
+ * @brief If TransactionManager::index() equals an index built from the
+ * transactions as they are now.
+ */
+bool matchesRebuilt(const QVector<int>& _accounts,
+                    const QVector<int>& _payees) {
+  // index() first: in a lazy book, it must not need the transactions
+  const TransactionIndex& index = TransactionManager::instance()->index();
+  TransactionIndex rebuilt;
+
+  for (Transaction* t : TransactionManager::instance()->transactions()) {
+    rebuilt.insert(t);
+  }
+
+  return index.transactionCount() == rebuilt.transactionCount() &&
+         contentOf(index, _accounts, _payees) ==
+             contentOf(rebuilt, _accounts, _payees);
+}
+
+}  // namespace
+
+class TestTransactionIndex : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void init();
+
+  void add();
+  void modify();
+  void remove();
+  void journalReplay_data();
+  void journalReplay();
+
+ private:
+  const TransactionIndex& index() const {
+    return TransactionManager::instance()->index();
+  }
+
+  QVector<int> m_accounts;
+  QVector<int> m_payees;
+  QVector<int> m_transactions;
+};
+
+void TestTransactionIndex::init() {
+  TestBook::Accounts a = TestBook::newBook();
+
+  m_accounts = {
+      TestBook::addAccount(a.assets, "Bank", AccountType::CHECKING)->id(),
+      TestBook::addAccount(a.assets, "Card", AccountType::CREDITCARD)->id(),
+      TestBook::addAccount(a.expenses, "Food", AccountType::EXPENSE)->id(),
+      TestBook::addAccount(a.expenses, "Rent", AccountType::EXPENSE)->id()};
+
+  m_payees.clear();
+  for (const QString& name : {"Grocer", "Landlord", "Bakery"}) {
+    m_payees << PayeeManager::instance()->add(name)->id();
+  }
+
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> pick(0, 1);
+  std::uniform_int_distribution<int> payee(-1, 2);
+
+  m_transactions.clear();
+  for (int i = 0; i < 60; ++i) {
+    const int p = payee(gen);
+    Transaction* t = TestBook::addTransfer(
+        FIRST.addDays(i), Amount(10.0 + i), m_accounts[pick(gen)],
+        m_accounts[2 + pick(gen)], QString(),
+        p == -1 ? Constants::NO_ID : m_payees[p]);
+    m_transactions << t->id();
+  }
+}
+
+void TestTransactionIndex::add() {
+  // Built before the changes, then kept up to date
+  index();
+
+  Transaction* t =
+      TestBook::addTransfer(FIRST, Amount(5.0), m_accounts[0], m_accounts[3],
+                            QString(), m_payees[1]);
+
+  QVERIFY(index().transactions(TransactionIndex::ByPayee, m_payees[1])
+              .contains(t->id()));
+  QVERIFY(index().transactions(TransactionIndex::ByAccount, m_accounts[3])
+              .contains(t->id()));
+  QVERIFY(matchesRebuilt(m_accounts, m_payees));
+}
+
+void TestTransactionIndex::modify() {
+  index();
+
+  Transaction* t = TransactionManager::instance()->get(m_transactions[0]);
+  const QString cur = Constants::DEFAULT_CURRENCY_CODE;
+
+  // No key changes
+  t->setMemo("Changed");
+  QVERIFY(matchesRebuilt(m_accounts, m_payees));
+
+  t->setIdPayee(m_payees[2]);
+  QVERIFY(index().transactions(TransactionIndex::ByPayee, m_payees[2])
+              .contains(t->id()));
+  QVERIFY(matchesRebuilt(m_accounts, m_payees));
+
+  // Reindexed once, when the hold is released
+  t->holdToModify();
+  t->setSplits({Transaction::Split(Amount(-1.0), m_accounts[1], cur),
+                Transaction::Split(Amount(1.0), m_accounts[3], cur)});
+  t->setIdPayee(Constants::NO_ID);
+  t->doneHoldToModify();
+
+  QVERIFY(!index().transactions(TransactionIndex::ByAccount, m_accounts[0])
+               .contains(t->id()));
+  QVERIFY(!index().transactions(TransactionIndex::ByAccount, m_accounts[2])
+               .contains(t->id()));
+  QVERIFY(index().transactions(TransactionIndex::ByAccount, m_accounts[1])
+              .contains(t->id()));
+  QVERIFY(!index().transactions(TransactionIndex::ByPayee, m_payees[2])
+               .contains(t->id()));
+  QVERIFY(matchesRebuilt(m_accounts, m_payees));
+}
+
+void TestTransactionIndex::remove() {
+  index();
+
+  for (int i = 0; i < m_transactions.size(); i += 3) {
+    LedgerManager::instance()->removeTransaction(m_transactions[i]);
+    QVERIFY(!index().contains(m_transactions[i]));
+  }
+
+  QCOMPARE(index().transactionCount(), TransactionManager::instance()->count());
+  QVERIFY(matchesRebuilt(m_accounts, m_payees));
+}
+
+void TestTransactionIndex::journalReplay_data() {
+  QTest::addColumn<bool>("lazy");
+
+  QTest::newRow("eager") << false;
+  QTest::newRow("lazy") << true;
+}
+
+void TestTransactionIndex::journalReplay() {
+  QFETCH(bool, lazy);
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath("book.kang");
+  const QString cur = Constants::DEFAULT_CURRENCY_CODE;
+
+  // Only the columnar books are loaded lazily
+  TransactionManager::setLazyLoading(lazy);
+  IO::instance()->setSaveFileVersion(lazy ? IO::COLUMNAR_FILE_VERSION
+                                          : IO::XML_FILE_VERSION);
+  IO::instance()->setJournalEnabled(true);
+  IO::instance()->save(path);
+
+  // Journaled changes, committed by the second save
+  index();
+
+  Transaction* added =
+      TestBook::addTransfer(FIRST, Amount(5.0), m_accounts[1], m_accounts[2],
+                            QString(), m_payees[0]);
+  const int idAdded = added->id();
+
+  Transaction* modified =
+      TransactionManager::instance()->get(m_transactions[1]);
+  modified->holdToModify();
+  modified->setSplits({Transaction::Split(Amount(-2.0), m_accounts[1], cur),
+                       Transaction::Split(Amount(2.0), m_accounts[3], cur)});
+  modified->setIdPayee(m_payees[1]);
+  modified->doneHoldToModify();
+
+  LedgerManager::instance()->removeTransaction(m_transactions[2]);
+
+  const IndexContent expected = contentOf(index(), m_accounts, m_payees);
+  const int expectedCount = index().transactionCount();
+  IO::instance()->save(path);
+
+  IO::instance()->load(path);
+
+  QCOMPARE(index().transactionCount(), expectedCount);
+  QVERIFY(contentOf(index(), m_accounts, m_payees) == expected);
+  QVERIFY(!index().contains(m_transactions[2]));
+
+  // The replayed transactions keep the index up to date
+  TransactionManager::instance()->get(idAdded)->setIdPayee(m_payees[2]);
+  QVERIFY(index().transactions(TransactionIndex::ByPayee, m_payees[2])
+              .contains(idAdded));
+  QVERIFY(!index().transactions(TransactionIndex::ByPayee, m_payees[0])
+               .contains(idAdded));
+  QVERIFY(matchesRebuilt(m_accounts, m_payees));
+
+  IO::instance()->discardChanges();
+  IO::instance()->setJournalEnabled(false);
+  TransactionManager::setLazyLoading(false);
+}
+
+QTEST_GUILESS_MAIN(TestTransactionIndex)
+
+#include "tst_transactionindex.moc"
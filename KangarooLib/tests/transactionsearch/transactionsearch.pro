@@ -0,0 +1,7 @@
+# TransactionSearch (model/transactionsearch.h) by words, prefixes, amounts
+# and dates, and as the transactions change.
+
+include(../tests.pri)
+
+TARGET = tst_transactionsearch
+SOURCES += tst_transactionsearch.cpp
@@ -0,0 +1,191 @@
+/*
+ * Kangaroo Lib, the library of Kangaroo PFM
+ * Copyright (C) 2015 Lucas Rioux-Maldague <lucasr.mal@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  US
+ */
+
+#include <QtTest>
+
+#include "model/transactionmanager.h"
+#include "model/transactionsearch.h"
+#include "testbook.h"
+
+using namespace KLib;
+
+class TestTransactionSearch : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void init();
+
+  void words();
+  void byWord();
+  void byPrefix();
+  void byAmount();
+  void byDate();
+  void reversedDates();
+  void updates();
+
+ private:
+  QList<int> search(const TransactionSearch::Query& _query) const {
+    return TransactionSearch::instance()->search(_query);
+  }
+
+  QList<int> searchText(const QString& _text) const {
+    TransactionSearch::Query q;
+    q.text = _text;
+    return search(q);
+  }
+
+  QList<int> m_ids;  ///< In order of date
+};
+
+void TestTransactionSearch::init() {
+  TestBook::Accounts a = TestBook::newBook();
+
+  const int bank =
+      TestBook::addAccount(a.assets, "Bank", AccountType::CHECKING)->id();
+  const int food =
+      TestBook::addAccount(a.expenses, "Food", AccountType::EXPENSE)->id();
+  const int rent =
+      TestBook::addAccount(a.expenses, "Rent", AccountType::EXPENSE)->id();
+
+  const int grocer = PayeeManager::instance()->add("Grocer")->id();
+  const int landlord = PayeeManager::instance()->add("Landlord")->id();
+  const int bakery = PayeeManager::instance()->add("Bakery")->id();
+
+  m_ids = {TestBook::addTransfer(QDate(2015, 1, 5), Amount(45.5), bank, food,
+                                 "Weekly groceries", grocer)->id(),
+           TestBook::addTransfer(QDate(2015, 1, 20), Amount(1200.0), bank,
+                                 rent, "January rent", landlord)->id(),
+           TestBook::addTransfer(QDate(2015, 2, 3), Amount(12.25), bank, food,
+                                 "Bread and groceries", bakery)->id(),
+           TestBook::addTransfer(QDate(2015, 2, 20), Amount(1200.0), bank,
+                                 rent, "February rent", landlord)->id(),
+           TestBook::addTransfer(QDate(2015, 3, 2), Amount(80.0), bank, food,
+                                 "Groceries", grocer)->id()};
+}
+
+void TestTransactionSearch::words() {
+  QCOMPARE(TransactionSearch::words("Bread-and  GROCERIES, 2015"),
+           QStringList({"bread", "and", "groceries", "2015"}));
+  QVERIFY(TransactionSearch::words(" ,- ").isEmpty());
+}
+
+void TestTransactionSearch::byWord() {
+  // Most recent first, case insensitive, every word must match
+  QCOMPARE(searchText("rent"), QList<int>({m_ids[3], m_ids[1]}));
+  QCOMPARE(searchText("RENT february"), QList<int>({m_ids[3]}));
+  QVERIFY(searchText("rent march").isEmpty());
+
+  // The name of the payee is indexed as well
+  QCOMPARE(searchText("landlord"), QList<int>({m_ids[3], m_ids[1]}));
+}
+
+void TestTransactionSearch::byPrefix() {
+  QCOMPARE(searchText("groc"), QList<int>({m_ids[4], m_ids[2], m_ids[0]}));
+  QCOMPARE(searchText("gro bre"), QList<int>({m_ids[2]}));
+
+  // Prefixes only, not any part of a word
+  QVERIFY(searchText("ceries").isEmpty());
+  QVERIFY(searchText("xyz").isEmpty());
+}
+
+void TestTransactionSearch::byAmount() {
+  // Absolute amounts of the splits, inclusive bounds
+  TransactionSearch::Query q;
+  q.hasMinAmount = true;
+  q.minAmount = Amount(45.5);
+  q.hasMaxAmount = true;
+  q.maxAmount = Amount(100.0);
+  QCOMPARE(search(q), QList<int>({m_ids[4], m_ids[0]}));
+
+  q.hasMaxAmount = false;
+  q.minAmount = Amount(1000.0);
+  QCOMPARE(search(q), QList<int>({m_ids[3], m_ids[1]}));
+
+  q.hasMinAmount = false;
+  q.hasMaxAmount = true;
+  q.maxAmount = Amount(20.0);
+  QCOMPARE(search(q), QList<int>({m_ids[2]}));
+
+  // With words
+  q.text = "groceries";
+  q.maxAmount = Amount(50.0);
+  QCOMPARE(search(q), QList<int>({m_ids[2], m_ids[0]}));
+}
+
+void TestTransactionSearch::byDate() {
+  // Inclusive bounds
+  TransactionSearch::Query q;
+  q.from = QDate(2015, 1, 20);
+  q.to = QDate(2015, 2, 20);
+  QCOMPARE(search(q), QList<int>({m_ids[3], m_ids[2], m_ids[1]}));
+
+  q.to = QDate();
+  q.from = QDate(2015, 2, 1);
+  QCOMPARE(search(q), QList<int>({m_ids[4], m_ids[3], m_ids[2]}));
+
+  q.from = QDate();
+  q.to = QDate(2015, 1, 19);
+  QCOMPARE(search(q), QList<int>({m_ids[0]}));
+
+  // The most recent ones
+  q.to = QDate();
+  q.limit = 2;
+  QCOMPARE(search(q), QList<int>({m_ids[4], m_ids[3]}));
+
+  // With words
+  q.limit = 0;
+  q.text = "rent";
+  q.from = QDate(2015, 2, 1);
+  QCOMPARE(search(q), QList<int>({m_ids[3]}));
+}
+
+void TestTransactionSearch::reversedDates() {
+  TransactionSearch::Query q;
+  q.from = QDate(2015, 2, 20);
+  q.to = QDate(2015, 1, 20);
+  QVERIFY(search(q).isEmpty());
+
+  q.limit = 1;
+  QVERIFY(search(q).isEmpty());
+
+  q.text = "rent";
+  QVERIFY(search(q).isEmpty());
+}
+
+void TestTransactionSearch::updates() {
+  // Built, then kept up to date
+  QCOMPARE(searchText("groc").size(), 3);
+
+  TransactionManager::instance()->get(m_ids[0])->setMemo("Market");
+  QCOMPARE(searchText("groc"), QList<int>({m_ids[4], m_ids[2]}));
+  QCOMPARE(searchText("market"), QList<int>({m_ids[0]}));
+
+  LedgerManager::instance()->removeTransaction(m_ids[4]);
+  QCOMPARE(searchText("groc"), QList<int>({m_ids[2]}));
+
+  PayeeManager::instance()->get(
+      TransactionManager::instance()->get(m_ids[1])->idPayee())
+      ->setName("Owner");
+  QCOMPARE(searchText("owner"), QList<int>({m_ids[3], m_ids[1]}));
+  QVERIFY(searchText("landlord").isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestTransactionSearch)
+
+#include "tst_transactionsearch.moc"
@@ -247,7 +247,12 @@ namespace KLib
 
                 priv_notifyLoad();
                 priv_setLoaded(true);
-                onFileClean();
+
+                //Changes that were not saved can be recovered from the journal
+                if (IO::instance()->isDirty())
+                    onFileDirty();
+                else
+                    onFileClean();
 
                 addRecentFile(filePath);
                 updateWindowTitle();
@@ -325,6 +330,10 @@ namespace KLib
                 return false;
             case QMessageBox::Save:
                 saveFile();
+                break;
+            case QMessageBox::Discard:
+                IO::instance()->discardChanges();
+                break;
             default:
                 break;
             }
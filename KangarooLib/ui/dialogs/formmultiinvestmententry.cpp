@@ -187,6 +187,8 @@ bool MultiInvestmentModel::setData(const QModelIndex& _index,
 
 void MultiInvestmentModel::save(const QDate& _date,
                                 const Account* m_brokerageAccount) {
+  QList<Transaction*> transactions;
+
   for (RowInfo& info : m_rows) {
     if (info.shares != 0 && (info.amount != 0 || info.pricePerShare != 0)) {
       if (info.pricePerShare == 0) {
@@ -218,9 +220,11 @@ void MultiInvestmentModel::save(const QDate& _date,
       transaction->setMemo(info.memo);
       transaction->makeBuySellFee(InvestmentAction::Buy, info.pricePerShare,
                                   splits, types);
-      LedgerManager::instance()->addTransaction(transaction);
+      transactions << transaction;
     }
   }
+
+  LedgerManager::instance()->addTransactions(transactions);
 }
 
 FormMultiInvestmentEntry::FormMultiInvestmentEntry(int _brokerageAccountId,
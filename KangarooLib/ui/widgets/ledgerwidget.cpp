@@ -27,6 +27,7 @@
 #include <QMessageBox>
 #include <QPainter>
 #include <QPen>
+#include <QScrollBar>
 #include <QSettings>
 #include <QTimer>
 #include <QtDebug>
@@ -45,6 +46,14 @@
 
 namespace KLib {
 
+namespace {
+/**
+ * @brief Rows prefetched from the top of the viewport when its bottom is not
+ * on a row.
+ */
+const int PREFETCH_PAGE_ROWS = 100;
+}  // namespace
+
 //    class ControlOverlay : public QWidget
 //    {
 //        public:
@@ -174,6 +183,11 @@ LedgerWidget::LedgerWidget(Account* _account, QWidget* parent)
 
   connect(m_account, &Account::modified, this, &LedgerWidget::checkActions);
 
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          &LedgerWidget::prefetchVisibleRows);
+  connect(verticalScrollBar(), &QScrollBar::rangeChanged, this,
+          &LedgerWidget::prefetchVisibleRows);
+
   // Actions
   createBasicActions();
 
@@ -443,6 +457,26 @@ void LedgerWidget::onEditStarted(int _row) {
   checkEnableActions(selectedRows());
 }
 
+void LedgerWidget::prefetchVisibleRows() {
+  auto mainRow = [](const QModelIndex& _index) {
+    return _index.parent().isValid() ? _index.parent().row() : _index.row();
+  };
+
+  const QModelIndex top = indexAt(viewport()->rect().topLeft());
+  const QModelIndex bottom = indexAt(viewport()->rect().bottomLeft());
+
+  // Nothing is laid out yet: the scroll bar signals come again once it is.
+  if (!top.isValid()) {
+    return;
+  }
+
+  // The bottom is past the last row (or not laid out): prefetch a page from
+  // the top rather than every row up to the end of the ledger.
+  const int first = mainRow(top);
+  m_controller->prefetchRows(
+      first, bottom.isValid() ? mainRow(bottom) : first + PREFETCH_PAGE_ROWS);
+}
+
 void LedgerWidget::keyPressEvent(QKeyEvent* _event) {
   switch (_event->key()) {
     case Qt::Key_Return:
@@ -247,6 +247,12 @@ class LedgerWidget : public QTreeView {
 
   void onEditStarted(int _row);
 
+  /**
+   * @brief Materializes the rows shown in the viewport (and around them) in
+   * large ledgers. See LedgerController::prefetchRows().
+   */
+  void prefetchVisibleRows();
+
  private:
   void createBasicActions();
   void checkEnableActions(const QList<int>& _selectedRows);
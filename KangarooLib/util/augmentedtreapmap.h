@@ -31,7 +31,11 @@
 #define AUGMENTEDTREAPMAP_H
 
 #include "treaputil.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
 
 namespace KLib
 {
@@ -54,13 +58,27 @@ namespace KLib
             typedef Node      node_type;
             typedef V         value_type;
             typedef K         key_type;
+            typedef TreapPool<Node> pool_type;
+            typedef TreapElement<K, V, weight> element_type;
 
             typedef AugmentedTreapMapIterator<AugmentedTreapMap<K,V, Node>, reference> iterator;
             typedef AugmentedTreapMapIterator<const AugmentedTreapMap<K,V, Node>, const_reference> const_iterator;
 
 
-            AugmentedTreapMap() :
-                m_root(nullptr) {}
+            /**
+             * @brief Constructs an empty treap.
+             * @param _pooled If true, the nodes of the treap are allocated in a TreapPool owned by the
+             *                treap (and the treaps split from it) instead of one by one on the heap.
+             * @param _seed Seed of the node priorities. Treaps built with the same seed and the same operations
+             *              have the same shape.
+             */
+            explicit AugmentedTreapMap(bool _pooled = false,
+                                       TreapPriority::priority_type _seed = TreapPriority::DEFAULT_SEED) :
+                m_root(nullptr),
+                m_pool(_pooled ? new pool_type() : nullptr),
+                m_priorities(_seed) {}
+
+            virtual ~AugmentedTreapMap() { clear(); }
 
             AugmentedTreapMap(const AugmentedTreapMap&) = delete;
             AugmentedTreapMap& operator=(const AugmentedTreapMap&) = delete;
@@ -72,6 +90,15 @@ namespace KLib
              */
             virtual void insert(const_key _key, const_reference _value, const_weight _weight);
 
+            /**
+             * @brief Inserts the elements (element_type) of [_first, _last), which must be sorted by key.
+             *
+             * If the treap is empty, it is built at once in O(n). Otherwise, the elements are inserted one by one.
+             * Throws std::invalid_argument if the range is not sorted.
+             */
+            template<typename ForwardIt>
+            void insertSorted(ForwardIt _first, ForwardIt _last);
+
             /**
              * @brief Removes the element with key _key and value _value
              *
@@ -109,7 +136,12 @@ namespace KLib
              *
              * Complexity: O(n)
              */
-            virtual void clear()    { TreapUtil<K,V,Node>::doClear(&m_root); }
+            virtual void clear();
+
+            /**
+             * @brief Pool in which the nodes are allocated, nullptr if they are allocated on the heap.
+             */
+            const pool_type* pool() const { return m_pool.get(); }
 
             /**
              * @brief Number of elements
@@ -142,7 +174,8 @@ namespace KLib
 
             /**
              * @brief Merges two treaps
-             * @param _other The treap to merge with this treap. MUST have all keys > than all keys in this treap.
+             * @param _other The treap to merge with this treap. MUST have all keys > than all keys in this treap,
+             *               and use the same pool (see split()).
              *
              * @return True if successfull, false if other treap keys are smaller or equal to current treap.
              *
@@ -249,11 +282,18 @@ namespace KLib
 
         protected:
             Node* m_root;
+            std::shared_ptr<pool_type> m_pool;
+            TreapPriority m_priorities;
     };
 
     template<typename K, typename V, typename S>
     class AugmentedTreapMap1 : public AugmentedTreapMap<K, V, AugmentedTreapNode<K,V,S> >
-    {};
+    {
+        public:
+            explicit AugmentedTreapMap1(bool _pooled = false,
+                                        TreapPriority::priority_type _seed = TreapPriority::DEFAULT_SEED) :
+                AugmentedTreapMap<K, V, AugmentedTreapNode<K,V,S> >(_pooled, _seed) {}
+    };
 
     /* ####################################################################### */
     /* Iterator */
@@ -459,10 +499,56 @@ namespace KLib
     void AugmentedTreapMap<K,V, Node>::insert(const_key _key, const_reference _value, const_weight _weight)
     {
         //Construct the node
-        Node* newNode = new Node(_key, _value, _weight);
+        Node* newNode = Node::create(m_pool.get(), _key, _value, _weight, m_priorities.next());
         TreapUtil<K,V,Node>::doInsert(newNode, &m_root);
     }
 
+    template<typename K, typename V, typename Node>
+    template<typename ForwardIt>
+    void AugmentedTreapMap<K,V, Node>::insertSorted(ForwardIt _first, ForwardIt _last)
+    {
+        typedef typename std::iterator_traits<ForwardIt>::value_type element;
+
+        if (!std::is_sorted(_first, _last, [] (const element& _a, const element& _b) { return _a.key < _b.key; }))
+        {
+            throw std::invalid_argument("AugmentedTreapMap insertSorted (): range not sorted");
+        }
+
+        if (!m_root)
+        {
+            m_root = TreapUtil<K,V,Node>::doBuild(_first, _last, m_pool.get(), m_priorities);
+        }
+        else
+        {
+            for (; _first != _last; ++_first)
+            {
+                insert(_first->key, _first->value, _first->weight);
+            }
+        }
+    }
+
+    template<typename K, typename V, typename Node>
+    void AugmentedTreapMap<K,V, Node>::clear()
+    {
+        if (m_pool && m_pool.use_count() == 1
+            && std::is_trivially_destructible<K>::value
+            && std::is_trivially_destructible<V>::value
+            && std::is_trivially_destructible<typename Node::weight_type>::value)
+        {
+            //Nothing to destroy: free all the nodes at once.
+            m_root = nullptr;
+            m_pool->releaseAll();
+            return;
+        }
+
+        TreapUtil<K,V,Node>::doClear(&m_root);
+
+        if (m_pool && m_pool.use_count() == 1)
+        {
+            m_pool->releaseAll();
+        }
+    }
+
     template<typename K, typename V, typename Node>
     bool AugmentedTreapMap<K,V, Node>::remove(iterator i)
     {
@@ -561,8 +647,9 @@ namespace KLib
     template<typename K, typename V, typename Node>
     AugmentedTreapMap<K,V, Node>* AugmentedTreapMap<K,V, Node>::split(const_key _key)
     {
-        AugmentedTreapMap<K,V, Node>* oth = new AugmentedTreapMap<K,V, Node>();
+        AugmentedTreapMap<K,V, Node>* oth = new AugmentedTreapMap<K,V, Node>(false, m_priorities.next());
         oth->m_root = TreapUtil<K,V,Node>::doSplit(_key, &m_root);
+        oth->m_pool = m_pool;
         return oth;
     }
 
@@ -577,6 +664,11 @@ namespace KLib
     template<typename K, typename V, typename Node>
     bool AugmentedTreapMap<K,V, Node>::merge(AugmentedTreapMap<K,V, Node>& _other)
     {
+        if (m_pool != _other.m_pool)
+        {
+            return false;
+        }
+
         return TreapUtil<K,V,Node>::doMerge(&m_root, &(_other.m_root));
     }
 
@@ -1,9 +1,26 @@
 #include "balances.h"
 #include "../model/pricemanager.h"
 #include "../model/currency.h"
+#include <QReadWriteLock>
 
 namespace KLib
 {
+    namespace
+    {
+        struct CurrencyRegistry
+        {
+            QReadWriteLock lock;
+            QHash<QString, int> ids;
+            QVector<QString> names;
+        };
+
+        CurrencyRegistry& registry()
+        {
+            static CurrencyRegistry r;
+            return r;
+        }
+    }
+
     Amount convert(const QString& _cur, const Amount& _a)
     {
         if (CurrencyManager::instance()->has(_cur))
@@ -16,11 +33,50 @@ namespace KLib
         }
     }
 
+    int Balances::currencyId(const QString& _cur)
+    {
+        int id = knownCurrencyId(_cur);
+
+        if (id != -1)
+        {
+            return id;
+        }
+
+        CurrencyRegistry& r = registry();
+        QWriteLocker locker(&r.lock);
+
+        //Another thread may have added it in the meantime
+        id = r.ids.value(_cur, -1);
+
+        if (id == -1)
+        {
+            id = r.names.size();
+            r.names.append(_cur);
+            r.ids.insert(_cur, id);
+        }
+
+        return id;
+    }
+
+    int Balances::knownCurrencyId(const QString& _cur)
+    {
+        CurrencyRegistry& r = registry();
+        QReadLocker locker(&r.lock);
+        return r.ids.value(_cur, -1);
+    }
+
+    QString Balances::currencyName(int _id)
+    {
+        CurrencyRegistry& r = registry();
+        QReadLocker locker(&r.lock);
+        return r.names.value(_id);
+    }
+
     Amount Balances::inCurrency(const QString& _currency, const QDate& _date) const
     {
         Amount total;
 
-        for (auto i = bal.begin(); i != bal.end(); ++i)
+        for (auto i = begin(); i != end(); ++i)
         {
             total += i.value() * PriceManager::instance()->rate(i.key(), _currency, _date);
         }
@@ -28,16 +84,17 @@ namespace KLib
         return total;
     }
 
-    Balances::Balances(const QString& _cur, const Amount& _a)
+    Balances::Balances(const QString& _cur, const Amount& _a) :
+        m_count(1)
     {
-        bal.insert(_cur, convert(_cur, _a));
+        m_inline[0] = Entry(currencyId(_cur), convert(_cur, _a));
     }
 
     Balances& Balances::operator+=(const Balances& _other)
     {
-        for (auto i = _other.bal.begin(); i != _other.bal.end(); ++i)
+        for (int i = 0; i < _other.m_count; ++i)
         {
-            add(i.key(), i.value());
+            add(_other.entry(i).currency, _other.entry(i).amount, false);
         }
 
         return *this;
@@ -45,9 +102,9 @@ namespace KLib
 
     Balances& Balances::operator-=(const Balances& _other)
     {
-        for (auto i = _other.bal.begin(); i != _other.bal.end(); ++i)
+        for (int i = 0; i < _other.m_count; ++i)
         {
-            add(i.key(), -i.value());
+            add(_other.entry(i).currency, _other.entry(i).amount, true);
         }
 
         return *this;
@@ -55,29 +112,60 @@ namespace KLib
 
     void Balances::add(const QString& _cur, const Amount& _a)
     {
-        if (!bal.contains(_cur))
+        int id = currencyId(_cur);
+        add(id, find(id) == -1 ? convert(_cur, _a) : _a, false);
+    }
+
+    void Balances::add(int _currency, const Amount& _a, bool _negate)
+    {
+        int pos = find(_currency);
+
+        if (pos != -1)
         {
-            bal.insert(_cur, convert(_cur, _a));
+            if (_negate)
+            {
+                entry(pos).amount -= _a;
+            }
+            else
+            {
+                entry(pos).amount += _a;
+            }
+
+            return;
+        }
+
+        Entry e(_currency, _negate ? -_a : _a);
+
+        if (m_count < INLINE_SIZE)
+        {
+            m_inline[m_count] = e;
         }
         else
         {
-            bal[_cur] += _a; //convert(_cur, _a);
+            m_overflow.append(e);
         }
+
+        ++m_count;
+    }
+
+    Amount Balances::value(const QString& _cur) const
+    {
+        int pos = find(knownCurrencyId(_cur));
+        return pos == -1 ? Amount() : entry(pos).amount;
     }
 
     bool Balances::operator==(const Balances& _other) const
     {
-        for (auto i = _other.bal.begin(); i != _other.bal.end(); ++i)
+        if (m_count != _other.m_count)
         {
-            if (!bal.contains(i.key()) || bal.value(i.key()) != i.value())
-            {
-                return false;
-            }
+            return false;
         }
 
-        for (auto i = bal.begin(); i != bal.end(); ++i)
+        for (int i = 0; i < _other.m_count; ++i)
         {
-            if (!_other.bal.contains(i.key()))
+            int pos = find(_other.entry(i).currency);
+
+            if (pos == -1 || entry(pos).amount != _other.entry(i).amount)
             {
                 return false;
             }
@@ -86,4 +174,3 @@ namespace KLib
         return true;
     }
 }
-
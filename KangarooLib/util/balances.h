@@ -4,13 +4,54 @@
 #include "../amount.h"
 #include <QHash>
 #include <QDate>
+#include <QVector>
 
 namespace KLib
 {
+    /**
+     * @brief Amounts per currency (or per security, with the empty currency).
+     *
+     * Currencies are interned as integer ids (see currencyId()), and the first INLINE_SIZE currencies are stored
+     * inline: for the common single-currency case, copying, adding and subtracting balances is arithmetic only,
+     * and does not allocate. Additional currencies are stored in a QVector.
+     */
     class Balances
     {
+            struct Entry
+            {
+                Entry() : currency(-1) {}
+                Entry(int _currency, const Amount& _amount) : currency(_currency), amount(_amount) {}
+
+                int currency;
+                Amount amount;
+            };
+
         public:
-            Balances() {}
+            /**
+             * @brief Iterates over the currencies and their amounts, like a QHash<QString, Amount>::const_iterator
+             */
+            class const_iterator
+            {
+                public:
+                    const_iterator(const Balances* _balances, int _pos) : m_balances(_balances), m_pos(_pos) {}
+
+                    QString         key() const         { return Balances::currencyName(currencyId()); }
+                    int             currencyId() const  { return m_balances->entry(m_pos).currency; }
+                    const Amount&   value() const       { return m_balances->entry(m_pos).amount; }
+                    const Amount&   operator*() const   { return value(); }
+
+                    const_iterator& operator++()        { ++m_pos; return *this; }
+                    const_iterator  operator++(int)     { const_iterator i = *this; ++m_pos; return i; }
+
+                    bool operator==(const const_iterator& _other) const { return m_pos == _other.m_pos; }
+                    bool operator!=(const const_iterator& _other) const { return m_pos != _other.m_pos; }
+
+                private:
+                    const Balances* m_balances;
+                    int m_pos;
+            };
+
+            Balances() : m_count(0) {}
 
             Balances(const QString& _cur, const Amount& _a);
 
@@ -19,7 +60,7 @@ namespace KLib
 
             bool operator<(const Amount& _other) const
             {
-                for (auto a : bal)
+                for (auto a : *this)
                 {
                     if (a >= _other)
                         return false;
@@ -46,19 +87,62 @@ namespace KLib
 
             void    add(const QString& _cur, const Amount& _a);
 
-            const Amount operator[](const QString& _cur) const           { return bal[_cur]; }
-            Amount  value(const QString& _cur) const                { return bal.value(_cur); }
+            const Amount operator[](const QString& _cur) const           { return value(_cur); }
+            Amount  value(const QString& _cur) const;
 
             bool    operator==(const Balances& _other) const;
-            int     count() const                                   { return bal.count(); }
-            bool    isEmpty() const                                 { return bal.isEmpty(); }
-            bool    contains(const QString& _cur) const             { return bal.contains(_cur); }
+            int     count() const                                   { return m_count; }
+            bool    isEmpty() const                                 { return !m_count; }
+            bool    contains(const QString& _cur) const             { return find(knownCurrencyId(_cur)) != -1; }
+
+            const_iterator begin() const    { return const_iterator(this, 0); }
+            const_iterator end() const      { return const_iterator(this, m_count); }
+
+            /**
+             * @brief Interned id of _cur. Ids are shared by all the balances and never released.
+             */
+            static int      currencyId(const QString& _cur);
+            static QString  currencyName(int _id);
 
-            QHash<QString, Amount>::const_iterator begin() const    { return bal.begin(); }
-            QHash<QString, Amount>::const_iterator end() const      { return bal.end(); }
+            static const int INLINE_SIZE = 2;
 
         private:
-            QHash<QString, Amount> bal;
+            /**
+             * @brief Id of _cur if it has been interned, -1 otherwise
+             */
+            static int knownCurrencyId(const QString& _cur);
+
+            const Entry& entry(int _pos) const { return _pos < INLINE_SIZE ? m_inline[_pos]
+                                                                           : m_overflow[_pos - INLINE_SIZE]; }
+            Entry& entry(int _pos) { return _pos < INLINE_SIZE ? m_inline[_pos]
+                                                               : m_overflow[_pos - INLINE_SIZE]; }
+
+            /**
+             * @brief Position of _currency, -1 if there is none
+             */
+            int find(int _currency) const
+            {
+                if (_currency == -1)
+                    return -1;
+
+                for (int i = 0; i < m_count; ++i)
+                {
+                    if (entry(i).currency == _currency)
+                        return i;
+                }
+
+                return -1;
+            }
+
+            /**
+             * @brief Adds _a as is: the caller converts it to the precision of the currency if it is new (see
+             *        add(const QString&, const Amount&)). Entries copied from other balances already are.
+             */
+            void add(int _currency, const Amount& _a, bool _negate);
+
+            Entry m_inline[INLINE_SIZE];
+            QVector<Entry> m_overflow;
+            int m_count;
     };
 }
 
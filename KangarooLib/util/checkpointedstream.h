@@ -0,0 +1,217 @@
+/*
+ * Checkpointed Stream - Ordered events with cached intermediate states
+ * Copyright (C) 2015 Lucas Rioux-Maldague
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CHECKPOINTEDSTREAM_H
+#define CHECKPOINTEDSTREAM_H
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace KLib
+{
+    /**
+     * @brief Events ordered by key, whose state after a key is obtained by applying the events in order to an
+     * empty state.
+     *
+     * The states after some of the keys are kept as checkpoints, so that a state is computed from the closest
+     * checkpoint before it instead of from the first event. The checkpoints are taken during the queries, and
+     * a new one is taken once the number of events applied since the previous one reaches the size of the state
+     * (and at least minInterval()): copying the states costs O(1) per event, and the checkpoints take O(n) space.
+     * A change of the events drops the checkpoints at or after its key.
+     *
+     * The queries update the checkpoints: a stream must not be read from several threads at once.
+     *
+     * S must be default-constructible to the empty state, copyable, and have size(). Events with the same key
+     * are applied in the order of insertion.
+     */
+    template<typename K, typename E, typename S>
+    class CheckpointedStream
+    {
+        public:
+            typedef std::multimap<K, E> map_type;
+            typedef typename map_type::const_iterator const_iterator;
+            typedef std::function<void(S&, const E&)> fn_apply;
+            typedef std::function<void(S&)> fn_compact;
+
+            static const int DEFAULT_MIN_INTERVAL = 64;
+
+            /**
+             * @param _apply Applies an event to a state.
+             * @param _compact If set, called on the states before they are kept as checkpoints (for example to
+             * remove the entries that are empty).
+             */
+            explicit CheckpointedStream(const fn_apply& _apply,
+                                        const fn_compact& _compact = fn_compact(),
+                                        int _minInterval = DEFAULT_MIN_INTERVAL) :
+                m_apply(_apply),
+                m_compact(_compact),
+                m_minInterval(std::max(1, _minInterval))
+            {
+            }
+
+            int  size() const               { return int(m_events.size()); }
+            bool isEmpty() const            { return m_events.empty(); }
+            int  checkpointCount() const    { return int(m_checkpoints.size()); }
+            int  minInterval() const        { return m_minInterval; }
+
+            const_iterator begin() const    { return m_events.begin(); }
+            const_iterator end() const      { return m_events.end(); }
+
+            void insert(const K& _key, const E& _event)
+            {
+                invalidateFrom(_key);
+                m_events.insert(std::make_pair(_key, _event));
+            }
+
+            /**
+             * @brief Removes _event at _key. Returns false if it is not there.
+             */
+            bool remove(const K& _key, const E& _event)
+            {
+                auto range = m_events.equal_range(_key);
+
+                for (auto i = range.first; i != range.second; ++i)
+                {
+                    if (i->second == _event)
+                    {
+                        invalidateFrom(_key);
+                        m_events.erase(i);
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            void clear()
+            {
+                m_events.clear();
+                m_checkpoints.clear();
+            }
+
+            /**
+             * @brief Drops the checkpoints at or after _key. Must be called when an event at _key is modified.
+             */
+            void invalidateFrom(const K& _key)
+            {
+                auto i = std::lower_bound(m_checkpoints.begin(), m_checkpoints.end(), _key,
+                                          [] (const Checkpoint& _c, const K& _k) { return _c.key < _k; });
+                m_checkpoints.erase(i, m_checkpoints.end());
+            }
+
+            /**
+             * @brief State after the events whose key is <= _through.
+             */
+            S stateThrough(const K& _through) const
+            {
+                return stateThrough(_through, nullptr, [] (const E&) { return false; });
+            }
+
+            /**
+             * @brief State after the events whose key is <= _through, without the events for which _skip returns
+             * true.
+             * @param _skipFrom If not null, no event before this key is skipped, which allows to start from the
+             * checkpoints before it.
+             */
+            template<typename Skip>
+            S stateThrough(const K& _through, const K* _skipFrom, const Skip& _skip) const
+            {
+                //Last checkpoint at or before _through, and before _skipFrom
+                auto cp = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), _through,
+                                           [] (const K& _k, const Checkpoint& _c) { return _k < _c.key; });
+
+                if (_skipFrom)
+                {
+                    auto bound = std::lower_bound(m_checkpoints.begin(), m_checkpoints.end(), *_skipFrom,
+                                                  [] (const Checkpoint& _c, const K& _k) { return _c.key < _k; });
+                    cp = std::min(cp, bound);
+                }
+
+                const bool fromLast = cp == m_checkpoints.end();
+                S state;
+                const_iterator i = m_events.begin();
+
+                if (cp != m_checkpoints.begin())
+                {
+                    --cp;
+                    state = cp->state;
+                    i = m_events.upper_bound(cp->key);
+                }
+
+                //New checkpoints are only appended after the last one, and before any skipped event.
+                bool extend = fromLast;
+                int applied = 0;
+
+                for (; i != m_events.end() && !(_through < i->first); ++i)
+                {
+                    if (_skip(i->second))
+                    {
+                        extend = false;
+                        continue;
+                    }
+
+                    m_apply(state, i->second);
+                    ++applied;
+
+                    const_iterator next = std::next(i);
+
+                    if (extend
+                        && applied >= std::max(m_minInterval, int(state.size()))
+                        && (next == m_events.end() || i->first < next->first))
+                    {
+                        if (m_compact)
+                            m_compact(state);
+
+                        m_checkpoints.push_back(Checkpoint{i->first, state});
+                        applied = 0;
+                    }
+                }
+
+                return state;
+            }
+
+        private:
+            struct Checkpoint
+            {
+                K key;      ///< The state is after all the events at or before this key.
+                S state;
+            };
+
+            map_type m_events;
+            mutable std::vector<Checkpoint> m_checkpoints;
+
+            fn_apply m_apply;
+            fn_compact m_compact;
+            int m_minInterval;
+    };
+}
+
+#endif // CHECKPOINTEDSTREAM_H
@@ -32,8 +32,14 @@
 
 // #include "augmentedtreapmap.h"
 #include "treaputil.h"
+#include <algorithm>
+#include <iterator>
 #include <list>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace KLib
 {
@@ -325,17 +331,53 @@ namespace KLib
             typedef V         value_type;
             typedef K         key_type;
             typedef R         ratio_type;
+            typedef TreapPool<Node> pool_type;
+            typedef TreapElement<K, V, weight> element_type;
 
             using iterator = FragmentedTreapMapIterator<FragmentedTreapMap<K,V, R, Node>, reference>;
             using const_iterator = FragmentedTreapMapIterator<const FragmentedTreapMap<K,V, R, Node>, const_reference>;
 
 
-            FragmentedTreapMap()
+            /**
+             * @brief Constructs an empty map.
+             * @param _pooled If true, the nodes of all the fragments are allocated in a TreapPool owned by the
+             *                map instead of one by one on the heap. The whole map is then freed at once.
+             * @param _seed Seed of the node priorities. Maps built with the same seed and the same operations
+             *              have the same shape.
+             */
+            explicit FragmentedTreapMap(bool _pooled = false,
+                                        TreapPriority::priority_type _seed = TreapPriority::DEFAULT_SEED) :
+                m_pool(_pooled ? new pool_type() : nullptr),
+                m_priorities(_seed)
             {
                 m_nodes.push_front(new fnode());
             }
 
+            ~FragmentedTreapMap()
+            {
+                clear();
+                delete m_nodes.front();
+            }
+
+            FragmentedTreapMap(const FragmentedTreapMap&) = delete;
+            FragmentedTreapMap& operator=(const FragmentedTreapMap&) = delete;
+
+            /**
+             * @brief Pool in which the nodes are allocated, nullptr if they are allocated on the heap.
+             */
+            const pool_type* pool() const { return m_pool.get(); }
+
             void insert(const_key _key, const_reference _value, const_weight _weight);
+
+            /**
+             * @brief Inserts the elements (element_type) of [_first, _last), which must be sorted by key.
+             *
+             * If the map is empty, it is built at once in O(n). Otherwise, the elements are inserted one by one.
+             * Throws std::invalid_argument if the range is not sorted.
+             */
+            template<typename ForwardIt>
+            void insertSorted(ForwardIt _first, ForwardIt _last);
+
             bool remove(const_key _key, const_reference _value);
 
             bool remove(iterator i);
@@ -351,6 +393,21 @@ namespace KLib
             bool joinFragmentsAt(const_key _key);
             int fragmentCount() const { return m_nodes.size(); }
 
+            /**
+             * @brief Start and ratio of each fragment after the first, in order.
+             */
+            std::vector<std::pair<K, R>> fragments() const
+            {
+                std::vector<std::pair<K, R>> result;
+
+                for (auto i = std::next(m_nodes.begin()); i != m_nodes.end(); ++i)
+                {
+                    result.emplace_back((*i)->start, (*i)->ratio);
+                }
+
+                return result;
+            }
+
             void    clear();
             int     isEmpty() const;
             int     count() const;
@@ -427,6 +484,8 @@ namespace KLib
             void checkAndClean(Node* root);
 
             std::list<fnode*> m_nodes;
+            std::unique_ptr<pool_type> m_pool;
+            TreapPriority m_priorities;
 
             iterator unconstIter(const_iterator ci) const;
 
@@ -435,7 +494,12 @@ namespace KLib
 
     template<typename K, typename V, typename R, typename S>
     class FragmentedTreapMap1 : public FragmentedTreapMap<K, V, R, AugmentedTreapNode<K,V,S> >
-    {};
+    {
+        public:
+            explicit FragmentedTreapMap1(bool _pooled = false,
+                                         TreapPriority::priority_type _seed = TreapPriority::DEFAULT_SEED) :
+                FragmentedTreapMap<K, V, R, AugmentedTreapNode<K,V,S> >(_pooled, _seed) {}
+    };
 
     //DESIGN CONCERNS
 
@@ -502,10 +566,34 @@ namespace KLib
     void FragmentedTreapMap<K,V, R, Node>::insert(const_key _key, const_reference _value, const_weight _weight)
     {
         //Construct the node
-        Node* newNode = new Node(_key, _value, _weight);
+        Node* newNode = Node::create(m_pool.get(), _key, _value, _weight, m_priorities.next());
         TreapUtil<K,V,Node>::doInsert(newNode, rootForKey(_key));
     }
 
+    template<typename K, typename V, typename R, typename Node>
+    template<typename ForwardIt>
+    void FragmentedTreapMap<K,V, R, Node>::insertSorted(ForwardIt _first, ForwardIt _last)
+    {
+        typedef typename std::iterator_traits<ForwardIt>::value_type element;
+
+        if (!std::is_sorted(_first, _last, [] (const element& _a, const element& _b) { return _a.key < _b.key; }))
+        {
+            throw std::invalid_argument("FragmentedTreapMap insertSorted (): range not sorted");
+        }
+
+        if (m_nodes.size() == 1 && !m_nodes.front()->root)
+        {
+            m_nodes.front()->root = TreapUtil<K,V,Node>::doBuild(_first, _last, m_pool.get(), m_priorities);
+        }
+        else
+        {
+            for (; _first != _last; ++_first)
+            {
+                insert(_first->key, _first->value, _first->weight);
+            }
+        }
+    }
+
     template<typename K, typename V, typename R, typename Node>
     bool FragmentedTreapMap<K,V, R, Node>::remove(iterator i)
     {
@@ -664,16 +752,34 @@ namespace KLib
     template<typename K, typename V, typename R, typename Node>
     void FragmentedTreapMap<K,V, R, Node>::clear()
     {
+        //If there is nothing to destroy in the nodes, the pool frees them all at once.
+        const bool release = m_pool
+                             && std::is_trivially_destructible<K>::value
+                             && std::is_trivially_destructible<V>::value
+                             && std::is_trivially_destructible<typename Node::weight_type>::value;
+
         //Remove all fractions except first
         while (m_nodes.back() != m_nodes.front())
         {
-            TreapUtil<K,V,Node>::doClear(&(m_nodes.back()->root)); //Will delete the root
+            if (release)
+                m_nodes.back()->root = nullptr;
+            else
+                TreapUtil<K,V,Node>::doClear(&(m_nodes.back()->root)); //Will delete the root
+
             delete m_nodes.back();
             m_nodes.pop_back();
         }
 
         //Clear the first fraction
-        TreapUtil<K,V,Node>::doClear(&(m_nodes.front()->root));
+        if (release)
+            m_nodes.front()->root = nullptr;
+        else
+            TreapUtil<K,V,Node>::doClear(&(m_nodes.front()->root));
+
+        if (m_pool)
+        {
+            m_pool->releaseAll();
+        }
     }
 
     template<typename K, typename V, typename R, typename Node>
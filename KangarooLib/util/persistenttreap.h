@@ -0,0 +1,345 @@
+/*
+ * Persistent Treap - Immutable sorted map of weights with prefix sums, updated by path copying
+ * Copyright (C) 2015 Lucas Rioux-Maldague
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PERSISTENTTREAP_H
+#define PERSISTENTTREAP_H
+
+#include "treaputil.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace KLib
+{
+    /**
+     * @brief Sorted map from keys to weights, whose copies are snapshots.
+     *
+     * The nodes are immutable and shared between the copies of a treap: a change copies the O(log n) nodes
+     * on the path to the changed key (path copying), and the copies made before it keep seeing the previous
+     * version. Copying a treap is O(1), and versions can be read from any thread while a newer one is
+     * modified, as long as each copy is only modified by one thread.
+     *
+     * Each node keeps the sum of the weights of its subtree: the sum of the weights before a key is
+     * O(log n) expected. S must be default-constructible to its zero and have operator+.
+     */
+    template<typename K, typename S>
+    class PersistentTreap
+    {
+            struct Node;
+            typedef std::shared_ptr<const Node> NodePtr;
+
+            struct Node
+            {
+                Node(const K& _key, const S& _weight, TreapPriority::priority_type _p,
+                     const NodePtr& _left, const NodePtr& _right) :
+                    key(_key),
+                    weight(_weight),
+                    sum(_weight),
+                    size(1),
+                    p(_p),
+                    left(_left),
+                    right(_right)
+                {
+                    complete();
+                }
+
+                void complete()
+                {
+                    sum = left ? left->sum + weight : weight;
+                    size = 1 + sizeOf(left) + sizeOf(right);
+
+                    if (right)
+                        sum = sum + right->sum;
+                }
+
+                K key;
+                S weight;
+                S sum;
+                int size;
+                TreapPriority::priority_type p;
+
+                NodePtr left;
+                NodePtr right;
+            };
+
+        public:
+            typedef std::pair<K, S> element_type;
+
+            explicit PersistentTreap(TreapPriority::priority_type _seed = TreapPriority::DEFAULT_SEED) :
+                m_priorities(_seed) {}
+
+            /**
+             * @brief Builds a treap from elements sorted by key, without duplicates, in O(n).
+             */
+            template<typename ForwardIt>
+            static PersistentTreap fromSorted(ForwardIt _first, ForwardIt _last,
+                                              TreapPriority::priority_type _seed = TreapPriority::DEFAULT_SEED);
+
+            int  size() const       { return sizeOf(m_root); }
+            bool isEmpty() const    { return !m_root; }
+
+            S sum() const           { return m_root ? m_root->sum : S(); }
+
+            /**
+             * @brief Sets the weight of _key, inserting it if it is not in the treap.
+             */
+            void insert(const K& _key, const S& _weight)
+            {
+                m_root = doInsert(m_root, _key, _weight, m_priorities.next());
+            }
+
+            /**
+             * @brief Removes _key and returns true if it was in the treap. Its weight is put in _weight if not null.
+             */
+            bool take(const K& _key, S* _weight = nullptr)
+            {
+                bool removed = false;
+                m_root = doRemove(m_root, _key, removed, _weight);
+                return removed;
+            }
+
+            bool remove(const K& _key) { return take(_key); }
+
+            bool contains(const K& _key) const { return find(_key); }
+
+            S value(const K& _key, const S& _default = S()) const
+            {
+                const Node* n = find(_key);
+                return n ? n->weight : _default;
+            }
+
+            /**
+             * @brief Sum of the weights of the keys < _key
+             */
+            S sumBefore(const K& _key) const
+            {
+                S s = S();
+
+                for (const Node* n = m_root.get(); n;)
+                {
+                    if (n->key < _key)
+                    {
+                        s = n->left ? s + n->left->sum + n->weight : s + n->weight;
+                        n = n->right.get();
+                    }
+                    else
+                    {
+                        n = n->left.get();
+                    }
+                }
+
+                return s;
+            }
+
+            /**
+             * @brief Greatest key <= _key. Returns false if there is none.
+             */
+            bool floor(const K& _key, K* _found = nullptr, S* _weight = nullptr) const
+            {
+                const Node* best = nullptr;
+
+                for (const Node* n = m_root.get(); n;)
+                {
+                    if (_key < n->key)
+                    {
+                        n = n->left.get();
+                    }
+                    else
+                    {
+                        best = n;
+                        n = n->right.get();
+                    }
+                }
+
+                if (best && _found)     *_found = best->key;
+                if (best && _weight)    *_weight = best->weight;
+
+                return best;
+            }
+
+            /**
+             * @brief Calls _f(key, weight) for each element, in order of keys.
+             */
+            void forEach(const std::function<void(const K&, const S&)>& _f) const { visit(m_root.get(), _f); }
+
+            /**
+             * @brief If both treaps are the same version (or copies of it)
+             */
+            bool sharesRoot(const PersistentTreap& _other) const { return m_root == _other.m_root; }
+
+        private:
+            static int sizeOf(const NodePtr& _n) { return _n ? _n->size : 0; }
+
+            const Node* find(const K& _key) const
+            {
+                for (const Node* n = m_root.get(); n;)
+                {
+                    if (_key < n->key)
+                        n = n->left.get();
+                    else if (n->key < _key)
+                        n = n->right.get();
+                    else
+                        return n;
+                }
+
+                return nullptr;
+            }
+
+            static NodePtr make(const Node& _n, const NodePtr& _left, const NodePtr& _right)
+            {
+                return std::make_shared<const Node>(_n.key, _n.weight, _n.p, _left, _right);
+            }
+
+            static NodePtr doInsert(const NodePtr& _n, const K& _key, const S& _weight,
+                                    TreapPriority::priority_type _p)
+            {
+                if (!_n)
+                    return std::make_shared<const Node>(_key, _weight, _p, nullptr, nullptr);
+
+                if (_key < _n->key)
+                {
+                    NodePtr l = doInsert(_n->left, _key, _weight, _p);
+
+                    //Rotate right if the new node must be above _n
+                    return l->p < _n->p ? make(*l, l->left, make(*_n, l->right, _n->right))
+                                        : make(*_n, l, _n->right);
+                }
+                else if (_n->key < _key)
+                {
+                    NodePtr r = doInsert(_n->right, _key, _weight, _p);
+
+                    return r->p < _n->p ? make(*r, make(*_n, _n->left, r->left), r->right)
+                                        : make(*_n, _n->left, r);
+                }
+                else
+                {
+                    return std::make_shared<const Node>(_n->key, _weight, _n->p, _n->left, _n->right);
+                }
+            }
+
+            static NodePtr doRemove(const NodePtr& _n, const K& _key, bool& _removed, S* _weight)
+            {
+                if (!_n)
+                    return _n;
+
+                if (_key < _n->key)
+                {
+                    NodePtr l = doRemove(_n->left, _key, _removed, _weight);
+                    return _removed ? make(*_n, l, _n->right) : _n;
+                }
+                else if (_n->key < _key)
+                {
+                    NodePtr r = doRemove(_n->right, _key, _removed, _weight);
+                    return _removed ? make(*_n, _n->left, r) : _n;
+                }
+
+                _removed = true;
+
+                if (_weight)
+                    *_weight = _n->weight;
+
+                return merge(_n->left, _n->right);
+            }
+
+            /**
+             * @brief Merges two treaps, all the keys of _a being before the keys of _b.
+             */
+            static NodePtr merge(const NodePtr& _a, const NodePtr& _b)
+            {
+                if (!_a)
+                    return _b;
+                else if (!_b)
+                    return _a;
+                else if (_a->p < _b->p)
+                    return make(*_a, _a->left, merge(_a->right, _b));
+                else
+                    return make(*_b, merge(_a, _b->left), _b->right);
+            }
+
+            static void visit(const Node* _n, const std::function<void(const K&, const S&)>& _f)
+            {
+                if (!_n)
+                    return;
+
+                visit(_n->left.get(), _f);
+                _f(_n->key, _n->weight);
+                visit(_n->right.get(), _f);
+            }
+
+            TreapPriority m_priorities;
+            NodePtr m_root;
+    };
+
+    template<typename K, typename S>
+    template<typename ForwardIt>
+    PersistentTreap<K, S> PersistentTreap<K, S>::fromSorted(ForwardIt _first, ForwardIt _last,
+                                                            TreapPriority::priority_type _seed)
+    {
+        //Same construction as TreapUtil::doBuild(), on the right spine of the treap. The nodes are only
+        //modified before they are shared.
+        typedef std::shared_ptr<Node> MutablePtr;
+
+        PersistentTreap t(_seed);
+        std::vector<MutablePtr> spine;
+
+        for (; _first != _last; ++_first)
+        {
+            MutablePtr u = std::make_shared<Node>(_first->first, _first->second, t.m_priorities.next(),
+                                                  nullptr, nullptr);
+            MutablePtr last;
+
+            while (!spine.empty() && spine.back()->p > u->p)
+            {
+                last = spine.back();
+                spine.pop_back();
+                last->complete();
+            }
+
+            u->left = last;
+
+            if (!spine.empty())
+                spine.back()->right = u;
+
+            spine.push_back(u);
+        }
+
+        if (!spine.empty())
+            t.m_root = spine.front();
+
+        while (!spine.empty())
+        {
+            spine.back()->complete();
+            spine.pop_back();
+        }
+
+        return t;
+    }
+}
+
+#endif // PERSISTENTTREAP_H
@@ -0,0 +1,140 @@
+#include "priceseries.h"
+#include <algorithm>
+
+namespace KLib
+{
+    void PriceSeries::reserve(int _size)
+    {
+        m_days.reserve(_size);
+        m_values.reserve(_size);
+    }
+
+    void PriceSeries::clear()
+    {
+        m_days.clear();
+        m_values.clear();
+    }
+
+    void PriceSeries::set(const QDate& _date, double _value)
+    {
+        const day_type day = _date.toJulianDay();
+
+        if (m_days.isEmpty() || day > m_days.last())
+        {
+            m_days.append(day);
+            m_values.append(_value);
+            return;
+        }
+
+        int pos = floorFromEnd(day);
+
+        if (pos != -1 && m_days[pos] == day)
+        {
+            m_values[pos] = _value;
+        }
+        else
+        {
+            m_days.insert(pos + 1, day);
+            m_values.insert(pos + 1, _value);
+        }
+    }
+
+    bool PriceSeries::remove(const QDate& _date)
+    {
+        const day_type day = _date.toJulianDay();
+        int pos = floorFromEnd(day);
+
+        if (pos == -1 || m_days[pos] != day)
+            return false;
+
+        m_days.remove(pos);
+        m_values.remove(pos);
+        return true;
+    }
+
+    bool PriceSeries::contains(const QDate& _date) const
+    {
+        const day_type day = _date.toJulianDay();
+        int pos = floorFromEnd(day);
+        return pos != -1 && m_days[pos] == day;
+    }
+
+    double PriceSeries::on(const QDate& _date) const
+    {
+        int pos = floorFromEnd(_date.toJulianDay());
+        return pos == -1 ? 0 : m_values[pos];
+    }
+
+    QVector<double> PriceSeries::on(const QVector<QDate>& _dates) const
+    {
+        QVector<double> values(_dates.size());
+
+        int pos = -1;
+        day_type previous = 0;
+
+        for (int i = 0; i < _dates.size(); ++i)
+        {
+            const day_type day = _dates[i].toJulianDay();
+
+            //Continue from the previous position while the dates are increasing
+            pos = i > 0 && day >= previous ? floorFrom(pos, day)
+                                           : floorFromEnd(day);
+            values[i] = pos == -1 ? 0 : m_values[pos];
+            previous = day;
+        }
+
+        return values;
+    }
+
+    PriceSeries::View PriceSeries::between(const QDate& _from, const QDate& _to) const
+    {
+        int first = _from.isValid() ? floorFromEnd(_from.toJulianDay() - 1) + 1 : 0;
+        int end = _to.isValid() ? floorFromEnd(_to.toJulianDay()) + 1 : count();
+
+        if (end <= first)
+            return View();
+
+        return View(m_days.constData() + first, m_values.constData() + first, end - first);
+    }
+
+    int PriceSeries::floorFrom(int _start, day_type _day) const
+    {
+        const day_type* days = m_days.constData();
+        const int n = m_days.size();
+
+        //Find [lo, hi) such that days[lo] <= _day < days[hi]
+        int lo = _start;
+        int step = 1;
+        int hi = lo + step;
+
+        while (hi < n && days[hi] <= _day)
+        {
+            lo = hi;
+            step *= 2;
+            hi = lo + step;
+        }
+
+        hi = std::min(hi, n);
+        return std::upper_bound(days + lo + 1, days + hi, _day) - days - 1;
+    }
+
+    int PriceSeries::floorFromEnd(day_type _day) const
+    {
+        const day_type* days = m_days.constData();
+        const int n = m_days.size();
+
+        int hi = n;
+        int lo = n - 1;
+        int step = 1;
+
+        while (lo >= 0 && days[lo] > _day)
+        {
+            hi = lo;
+            step *= 2;
+            lo = hi - step;
+        }
+
+        lo = std::max(lo, -1);
+        return std::upper_bound(days + lo + 1, days + hi, _day) - days - 1;
+    }
+}
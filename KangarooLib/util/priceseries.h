@@ -0,0 +1,102 @@
+#ifndef PRICESERIES_H
+#define PRICESERIES_H
+
+#include <QDate>
+#include <QVector>
+
+namespace KLib
+{
+    /**
+     * @brief Prices by date, sorted by date and stored as two parallel arrays (day numbers and values).
+     *
+     * Price histories are append-mostly: appending a price after the last date is amortized O(1). "As of"
+     * lookups gallop from the end of the series (or from the previous position in batched lookups), so
+     * recent dates are found in a few comparisons.
+     */
+    class PriceSeries
+    {
+        public:
+            typedef qint32 day_type;
+
+            /**
+             * @brief Zero-copy view of a range of the series. Invalidated by any modification of the series.
+             */
+            class View
+            {
+                public:
+                    View() : m_days(nullptr), m_values(nullptr), m_size(0) {}
+                    View(const day_type* _days, const double* _values, int _size) :
+                        m_days(_days), m_values(_values), m_size(_size) {}
+
+                    int     size() const                { return m_size; }
+                    bool    isEmpty() const             { return !m_size; }
+
+                    QDate   dateAt(int _i) const        { return QDate::fromJulianDay(m_days[_i]); }
+                    double  valueAt(int _i) const       { return m_values[_i]; }
+
+                    const day_type* days() const        { return m_days; }
+                    const double*   values() const      { return m_values; }
+
+                private:
+                    const day_type* m_days;
+                    const double* m_values;
+                    int m_size;
+            };
+
+            int     count() const               { return m_days.size(); }
+            bool    isEmpty() const             { return m_days.isEmpty(); }
+
+            void    reserve(int _size);
+            void    clear();
+
+            /**
+             * @brief Sets the price on _date, replacing the existing one if any.
+             */
+            void    set(const QDate& _date, double _value);
+
+            /**
+             * @brief Removes the price on _date. Returns false if there is none.
+             */
+            bool    remove(const QDate& _date);
+
+            bool    contains(const QDate& _date) const;
+
+            /**
+             * @brief Price as of _date (the last one on or before _date), 0 if there is none
+             */
+            double  on(const QDate& _date) const;
+
+            /**
+             * @brief Prices as of each of _dates. Sorted dates are looked up in a single pass over the series.
+             */
+            QVector<double> on(const QVector<QDate>& _dates) const;
+
+            double  last() const                { return m_values.isEmpty() ? 0 : m_values.last(); }
+            QDate   lastDate() const            { return m_days.isEmpty() ? QDate()
+                                                                          : QDate::fromJulianDay(m_days.last()); }
+
+            /**
+             * @brief Prices from _from to _to, inclusively. An invalid date does not bound the range.
+             */
+            View    between(const QDate& _from, const QDate& _to) const;
+            View    all() const                 { return View(m_days.constData(), m_values.constData(), count()); }
+
+        private:
+            /**
+             * @brief Position of the last price on or before _day, -1 if there is none.
+             *
+             * Gallops from _start, which must be -1 or a position on or before _day.
+             */
+            int floorFrom(int _start, day_type _day) const;
+
+            /**
+             * @brief Same as floorFrom(), galloping backwards from the end of the series.
+             */
+            int floorFromEnd(day_type _day) const;
+
+            QVector<day_type> m_days;
+            QVector<double> m_values;
+    };
+}
+
+#endif // PRICESERIES_H
@@ -0,0 +1,352 @@
+/*
+ * Running Sum Tree - Sequence of weights with order statistics and prefix sums
+ * Copyright (C) 2015 Lucas Rioux-Maldague
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUNNINGSUMTREE_H
+#define RUNNINGSUMTREE_H
+
+#include "treappool.h"
+#include "treaputil.h"
+#include <new>
+#include <stdexcept>
+
+namespace KLib
+{
+    /**
+     * @brief Sequence of weights, in which elements are addressed by position or by a stable handle.
+     *
+     * This is a treap ordered by position (an implicit treap) with parent pointers, where each node keeps the
+     * size and the sum of the weights of its subtree. Inserting, removing, moving or reweighting an element,
+     * the position of an element and the sum of the weights up to an element are all O(log n) expected.
+     *
+     * Nodes are handles: they stay valid, and keep their element, until the element is removed.
+     *
+     * S must be default-constructible to its zero and have operator+.
+     */
+    template<typename S>
+    class RunningSumTree
+    {
+        public:
+            class Node
+            {
+                public:
+                    const S& weight() const { return m_weight; }
+
+                private:
+                    Node(const S& _weight, TreapPriority::priority_type _p) :
+                        m_weight(_weight),
+                        m_sum(_weight),
+                        m_size(1),
+                        m_p(_p),
+                        m_left(nullptr),
+                        m_right(nullptr),
+                        m_parent(nullptr) {}
+
+                    S m_weight;
+                    S m_sum;
+                    int m_size;
+                    TreapPriority::priority_type m_p;
+
+                    Node* m_left;
+                    Node* m_right;
+                    Node* m_parent;
+
+                    friend class RunningSumTree;
+            };
+
+            explicit RunningSumTree(TreapPriority::priority_type _seed = TreapPriority::DEFAULT_SEED) :
+                m_priorities(_seed),
+                m_root(nullptr) {}
+
+            ~RunningSumTree() { clear(); }
+
+            RunningSumTree(const RunningSumTree&) = delete;
+            RunningSumTree& operator=(const RunningSumTree&) = delete;
+
+            int  size() const       { return sizeOf(m_root); }
+            bool isEmpty() const    { return !m_root; }
+
+            S sum() const           { return m_root ? m_root->m_sum : S(); }
+
+            /**
+             * @brief Inserts an element with _weight at _pos (0 <= _pos <= size()) and returns its node.
+             */
+            Node* insert(int _pos, const S& _weight)
+            {
+                Node* n = new (m_pool.allocate()) Node(_weight, m_priorities.next());
+                link(n, _pos);
+                return n;
+            }
+
+            void remove(Node* _node)
+            {
+                unlink(_node);
+                _node->~Node();
+                m_pool.free(_node);
+            }
+
+            /**
+             * @brief Moves the element of _node to _pos, the position it will have after the move.
+             */
+            void move(Node* _node, int _pos)
+            {
+                unlink(_node);
+                link(_node, _pos);
+            }
+
+            void setWeight(Node* _node, const S& _weight)
+            {
+                _node->m_weight = _weight;
+                updatePath(_node);
+            }
+
+            /**
+             * @brief Position of the element of _node
+             */
+            int positionOf(const Node* _node) const
+            {
+                int pos = sizeOf(_node->m_left);
+
+                for (const Node* n = _node; n->m_parent; n = n->m_parent)
+                {
+                    if (n == n->m_parent->m_right)
+                        pos += sizeOf(n->m_parent->m_left) + 1;
+                }
+
+                return pos;
+            }
+
+            /**
+             * @brief Sum of the weights up to the element of _node, inclusively
+             */
+            S sumTo(const Node* _node) const
+            {
+                S s = _node->m_left ? _node->m_left->m_sum + _node->m_weight : _node->m_weight;
+
+                for (const Node* n = _node; n->m_parent; n = n->m_parent)
+                {
+                    if (n == n->m_parent->m_right)
+                    {
+                        const Node* p = n->m_parent;
+                        s = (p->m_left ? p->m_left->m_sum + p->m_weight : p->m_weight) + s;
+                    }
+                }
+
+                return s;
+            }
+
+            Node* at(int _pos) const
+            {
+                if (_pos < 0 || _pos >= size())
+                    throw std::out_of_range("RunningSumTree::at");
+
+                Node* n = m_root;
+
+                for (;;)
+                {
+                    const int left = sizeOf(n->m_left);
+
+                    if (_pos < left)
+                    {
+                        n = n->m_left;
+                    }
+                    else if (_pos == left)
+                    {
+                        return n;
+                    }
+                    else
+                    {
+                        _pos -= left + 1;
+                        n = n->m_right;
+                    }
+                }
+            }
+
+            void clear()
+            {
+                destroy(m_root);
+                m_root = nullptr;
+                m_pool.releaseAll();
+            }
+
+        private:
+            static int sizeOf(const Node* _n) { return _n ? _n->m_size : 0; }
+
+            static void update(Node* _n)
+            {
+                _n->m_size = 1 + sizeOf(_n->m_left) + sizeOf(_n->m_right);
+
+                if (_n->m_left && _n->m_right)
+                    _n->m_sum = _n->m_left->m_sum + _n->m_weight + _n->m_right->m_sum;
+                else if (_n->m_left)
+                    _n->m_sum = _n->m_left->m_sum + _n->m_weight;
+                else if (_n->m_right)
+                    _n->m_sum = _n->m_weight + _n->m_right->m_sum;
+                else
+                    _n->m_sum = _n->m_weight;
+            }
+
+            static void updatePath(Node* _n)
+            {
+                for (; _n; _n = _n->m_parent)
+                {
+                    update(_n);
+                }
+            }
+
+            void replaceChild(Node* _parent, Node* _old, Node* _new)
+            {
+                if (!_parent)
+                    m_root = _new;
+                else if (_parent->m_left == _old)
+                    _parent->m_left = _new;
+                else
+                    _parent->m_right = _new;
+
+                if (_new)
+                    _new->m_parent = _parent;
+            }
+
+            /**
+             * @brief Rotates _n above its parent. The sums above them do not change.
+             */
+            void rotateUp(Node* _n)
+            {
+                Node* p = _n->m_parent;
+                replaceChild(p->m_parent, p, _n);
+
+                if (_n == p->m_left)
+                {
+                    p->m_left = _n->m_right;
+                    if (p->m_left) p->m_left->m_parent = p;
+                    _n->m_right = p;
+                }
+                else
+                {
+                    p->m_right = _n->m_left;
+                    if (p->m_right) p->m_right->m_parent = p;
+                    _n->m_left = p;
+                }
+
+                p->m_parent = _n;
+                update(p);
+                update(_n);
+            }
+
+            /**
+             * @brief Inserts the detached node _n as a leaf at _pos, then restores the heap order by rotations.
+             */
+            void link(Node* _n, int _pos)
+            {
+                if (_pos < 0 || _pos > size())
+                    throw std::out_of_range("RunningSumTree::link");
+
+                _n->m_left = _n->m_right = _n->m_parent = nullptr;
+                update(_n);
+
+                if (!m_root)
+                {
+                    m_root = _n;
+                    return;
+                }
+
+                Node* cur = m_root;
+
+                for (;;)
+                {
+                    const int left = sizeOf(cur->m_left);
+
+                    if (_pos <= left)
+                    {
+                        if (!cur->m_left)
+                        {
+                            cur->m_left = _n;
+                            break;
+                        }
+
+                        cur = cur->m_left;
+                    }
+                    else
+                    {
+                        _pos -= left + 1;
+
+                        if (!cur->m_right)
+                        {
+                            cur->m_right = _n;
+                            break;
+                        }
+
+                        cur = cur->m_right;
+                    }
+                }
+
+                _n->m_parent = cur;
+                updatePath(cur);
+
+                while (_n->m_parent && _n->m_p < _n->m_parent->m_p)
+                {
+                    rotateUp(_n);
+                }
+            }
+
+            /**
+             * @brief Rotates _n down to a leaf and detaches it.
+             */
+            void unlink(Node* _n)
+            {
+                while (_n->m_left || _n->m_right)
+                {
+                    if (!_n->m_right || (_n->m_left && _n->m_left->m_p < _n->m_right->m_p))
+                        rotateUp(_n->m_left);
+                    else
+                        rotateUp(_n->m_right);
+                }
+
+                Node* parent = _n->m_parent;
+                replaceChild(parent, _n, nullptr);
+                updatePath(parent);
+                _n->m_parent = nullptr;
+            }
+
+            static void destroy(Node* _n)
+            {
+                if (!_n)
+                    return;
+
+                destroy(_n->m_left);
+                destroy(_n->m_right);
+                _n->~Node();
+            }
+
+            SlabPool<Node> m_pool;
+            TreapPriority m_priorities;
+            Node* m_root;
+    };
+}
+
+#endif // RUNNINGSUMTREE_H
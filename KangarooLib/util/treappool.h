@@ -0,0 +1,204 @@
+/*
+ * Treap Pool - Slab allocator for the nodes of AugmentedTreapMap and FragmentedTreapMap
+ * Copyright (C) 2015 Lucas Rioux-Maldague
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TREAPPOOL_H
+#define TREAPPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace KLib
+{
+    /**
+     * @brief Allocates objects of type T from large blocks.
+     *
+     * Objects are carved contiguously from the blocks, in allocation order. Freed objects are kept in
+     * a free list and reused by the next allocations. The blocks themselves are only freed by releaseAll()
+     * or by the destructor.
+     *
+     * Does not construct nor destroy the objects.
+     */
+    template<typename T>
+    class SlabPool
+    {
+            union Slot
+            {
+                Slot* next;
+                alignas(T) char storage[sizeof(T)];
+            };
+
+        public:
+            SlabPool() :
+                m_free(nullptr),
+                m_current(nullptr),
+                m_remaining(0),
+                m_nextBlockSize(MIN_BLOCK_SIZE),
+                m_allocated(0) {}
+
+            ~SlabPool() { releaseAll(); }
+
+            SlabPool(const SlabPool&) = delete;
+            SlabPool& operator=(const SlabPool&) = delete;
+
+            void* allocate()
+            {
+                ++m_allocated;
+
+                if (m_free)
+                {
+                    Slot* s = m_free;
+                    m_free = s->next;
+                    return s;
+                }
+
+                if (!m_remaining)
+                {
+                    m_current = static_cast<Slot*>(::operator new(m_nextBlockSize * sizeof(Slot)));
+                    m_blocks.push_back(m_current);
+                    m_remaining = m_nextBlockSize;
+
+                    //Blocks grow geometrically, so that large treaps use few blocks
+                    m_nextBlockSize = std::min(2 * m_nextBlockSize, MAX_BLOCK_SIZE);
+                }
+
+                --m_remaining;
+                return m_current++;
+            }
+
+            void free(void* _p)
+            {
+                Slot* s = static_cast<Slot*>(_p);
+                s->next = m_free;
+                m_free = s;
+                --m_allocated;
+            }
+
+            /**
+             * @brief Frees all the blocks at once. The objects must have been destroyed, or must be
+             * trivially destructible.
+             */
+            void releaseAll()
+            {
+                for (Slot* b : m_blocks)
+                {
+                    ::operator delete(b);
+                }
+
+                m_blocks.clear();
+                m_free = nullptr;
+                m_current = nullptr;
+                m_remaining = 0;
+                m_nextBlockSize = MIN_BLOCK_SIZE;
+                m_allocated = 0;
+            }
+
+            /**
+             * @brief Number of objects currently allocated
+             */
+            std::size_t allocated() const { return m_allocated; }
+
+            /**
+             * @brief Bytes reserved by the blocks
+             */
+            std::size_t capacity() const
+            {
+                std::size_t total = 0;
+                std::size_t size = MIN_BLOCK_SIZE;
+
+                for (std::size_t i = 0; i < m_blocks.size(); ++i)
+                {
+                    total += size * sizeof(Slot);
+                    size = std::min(2 * size, MAX_BLOCK_SIZE);
+                }
+
+                return total;
+            }
+
+            static const std::size_t MIN_BLOCK_SIZE = 32;
+            static const std::size_t MAX_BLOCK_SIZE = 4096;
+
+        private:
+            std::vector<Slot*> m_blocks;
+            Slot* m_free;
+            Slot* m_current;
+            std::size_t m_remaining;
+            std::size_t m_nextBlockSize;
+            std::size_t m_allocated;
+    };
+
+    template<typename T> const std::size_t SlabPool<T>::MIN_BLOCK_SIZE;
+    template<typename T> const std::size_t SlabPool<T>::MAX_BLOCK_SIZE;
+
+    /**
+     * @brief Owns the tree nodes and the value nodes of one treap map (see AugmentedTreapNode).
+     *
+     * A map that uses a pool allocates all its nodes in it: the nodes of a map are close to each other in
+     * memory, and destroying the map frees a few blocks instead of every node.
+     *
+     * A pool can be shared by the maps split from a map; it must outlive all the nodes allocated in it.
+     */
+    template<typename Node>
+    class TreapPool
+    {
+        public:
+            typedef typename Node::Node ValueNode;
+
+            void* allocateNode()            { return m_nodes.allocate(); }
+            void  freeNode(void* _p)        { m_nodes.free(_p); }
+
+            void* allocateValue()           { return m_values.allocate(); }
+            void  freeValue(void* _p)       { m_values.free(_p); }
+
+            /**
+             * @brief Frees all the nodes at once. See SlabPool::releaseAll().
+             */
+            void releaseAll()
+            {
+                m_nodes.releaseAll();
+                m_values.releaseAll();
+            }
+
+            /**
+             * @brief Bytes reserved by the pool
+             */
+            std::size_t capacity() const { return m_nodes.capacity() + m_values.capacity(); }
+
+            std::size_t nodeCount() const  { return m_nodes.allocated(); }
+            std::size_t valueCount() const { return m_values.allocated(); }
+
+        private:
+            SlabPool<Node> m_nodes;
+            SlabPool<ValueNode> m_values;
+    };
+
+}
+
+#endif // TREAPPOOL_H
@@ -30,9 +30,11 @@
 #ifndef TREAPUTIL_H
 #define TREAPUTIL_H
 
-#include <cstdlib>
+#include <cstdint>
 #include <utility>
+#include <vector>
 #include <assert.h>
+#include "treappool.h"
 
 namespace KLib
 {
@@ -50,6 +52,47 @@ namespace KLib
 
     }
 
+    /**
+     * @brief Generates the heap priorities of the nodes of one treap map (xorshift32).
+     *
+     * Each map owns its generator, so maps can be built concurrently and the shape of a treap only
+     * depends on the seed and on the operations done on it. The generator never returns TOP, which is
+     * used to move a node to the root.
+     */
+    class TreapPriority
+    {
+        public:
+            typedef std::uint32_t priority_type;
+
+            explicit TreapPriority(priority_type _seed = DEFAULT_SEED) :
+                m_state(_seed ? _seed : DEFAULT_SEED) {}
+
+            priority_type next()
+            {
+                m_state ^= m_state << 13;
+                m_state ^= m_state >> 17;
+                m_state ^= m_state << 5;
+                return m_state;
+            }
+
+            static const priority_type TOP = 0;
+            static const priority_type DEFAULT_SEED = 2463534242u;
+
+        private:
+            priority_type m_state;
+    };
+
+    /**
+     * @brief Element of the sorted ranges used to build a treap at once (see TreapUtil::doBuild()).
+     */
+    template<typename K, typename V, typename S>
+    struct TreapElement
+    {
+        K key;
+        V value;
+        S weight;
+    };
+
     template<typename K, typename V, typename S>
     struct AugmentedTreapNode
     {
@@ -74,13 +117,17 @@ namespace KLib
         };
 
         typedef S weight_type;
+        typedef TreapPriority::priority_type priority_type;
+        typedef TreapPool<AugmentedTreapNode<K,V,S> > pool_type;
 
-        AugmentedTreapNode(const K& _key) :
+        AugmentedTreapNode(const K& _key, pool_type* _pool = nullptr) :
             key(_key),
             first(nullptr),
             last(nullptr),
             sum(AugmentedTreapSum::makeEmpty<S>()),
             count(0),
+            p(TreapPriority::TOP),
+            pool(_pool),
             parent(nullptr),
             left(nullptr),
             right(nullptr)
@@ -88,17 +135,20 @@ namespace KLib
 
         }
 
-        AugmentedTreapNode(const K& _key, const V& _value, const S& _weight) :
+        AugmentedTreapNode(const K& _key, const V& _value, const S& _weight, priority_type _p,
+                           pool_type* _pool = nullptr) :
             key(_key),
-            first(new Node(_value, _weight)),
-            last(first),
+            first(nullptr),
+            last(nullptr),
             sum(_weight),
             count(1),
-            p(rand()),
+            p(_p),
+            pool(_pool),
             parent(nullptr),
             left(nullptr),
             right(nullptr)
         {
+            first = last = newValue(_value, _weight);
         }
 
         ~AugmentedTreapNode()
@@ -110,7 +160,52 @@ namespace KLib
             {
                 cur = next;
                 next = cur->next;
-                delete cur;
+                deleteValue(cur);
+            }
+        }
+
+        /**
+         * @brief Allocates a node in _pool, or on the heap if _pool is null.
+         */
+        template<typename... Args>
+        static AugmentedTreapNode* create(pool_type* _pool, Args&&... _args)
+        {
+            return _pool ? new (_pool->allocateNode()) AugmentedTreapNode(std::forward<Args>(_args)..., _pool)
+                         : new AugmentedTreapNode(std::forward<Args>(_args)...);
+        }
+
+        /**
+         * @brief Deletes a node created by create().
+         */
+        static void destroy(AugmentedTreapNode* _node)
+        {
+            if (pool_type* pool = _node->pool)
+            {
+                _node->~AugmentedTreapNode();
+                pool->freeNode(_node);
+            }
+            else
+            {
+                delete _node;
+            }
+        }
+
+        Node* newValue(const V& _value, const S& _weight, Node* _next = nullptr)
+        {
+            return pool ? new (pool->allocateValue()) Node(_value, _weight, _next)
+                        : new Node(_value, _weight, _next);
+        }
+
+        void deleteValue(Node* _value)
+        {
+            if (pool)
+            {
+                _value->~Node();
+                pool->freeValue(_value);
+            }
+            else
+            {
+                delete _value;
             }
         }
 
@@ -173,7 +268,7 @@ namespace KLib
 
         void add(const V& _value, const S& _weight)
         {
-            first = new Node(_value, _weight, first); //This takes care of the previous and next pointers.
+            first = newValue(_value, _weight, first); //This takes care of the previous and next pointers.
             sum += _weight;
 
             if (!last)
@@ -198,7 +293,7 @@ namespace KLib
 
             first = temp->next;
             first->previous = nullptr;
-            delete temp;
+            deleteValue(temp);
 
             --count;
         }
@@ -239,7 +334,7 @@ namespace KLib
 
                 --count;
 
-                delete cur;
+                deleteValue(cur);
                 return true;
             }
             else
@@ -281,7 +376,9 @@ namespace KLib
         Node* last;
         S sum;
         int count;
-        int p;
+        priority_type p;        ///< Heap priority, the root has the lowest
+
+        pool_type* pool;        ///< Pool in which the node and its values are allocated, if any
 
         AugmentedTreapNode<K,V,S>* parent;
         AugmentedTreapNode<K,V,S>* left;
@@ -318,6 +415,10 @@ namespace KLib
 
         static void doClear(Node** root);
 
+        template<typename ForwardIt>
+        static Node* doBuild(ForwardIt _first, ForwardIt _last, typename Node::pool_type* _pool,
+                             TreapPriority& _priorities);
+
         static weight_type leftSum(const_key _to, bool inclusive, Node* root);
         static weight_type leftSum(Node* cur, typename Node::Node* _sub, bool inclusive, Node* root);
         static weight_type rightSum(const_key _from, bool inclusive, Node* root);
@@ -489,7 +590,7 @@ namespace KLib
 
             if (next == u->parent)
             {
-                delete u;
+                Node::destroy(u);
             }
 
             u = next;
@@ -498,6 +599,79 @@ namespace KLib
         *root = nullptr;
     }
 
+    /**
+     * Builds a treap from the TreapElement's in [_first, _last), sorted by key, and returns its root. O(n).
+     *
+     * Elements with the same key share a node, in the order insert() would have given them. The nodes are
+     * linked as a Cartesian tree of their priorities with a stack holding the right spine of the treap: a node
+     * is complete when it leaves the stack, so the sums and counts are computed at that moment.
+     */
+    template<typename K, typename V, typename Node>
+    template<typename ForwardIt>
+    Node* TreapUtil<K,V, Node>::doBuild(ForwardIt _first, ForwardIt _last, typename Node::pool_type* _pool,
+                                        TreapPriority& _priorities)
+    {
+        std::vector<Node*> spine;
+
+        auto complete = [] (Node* u) {
+            if (u->left)
+            {
+                u->sum += u->left->sum;
+                u->count += u->left->count;
+            }
+
+            if (u->right)
+            {
+                u->sum += u->right->sum;
+                u->count += u->right->count;
+            }
+        };
+
+        while (_first != _last)
+        {
+            Node* u = Node::create(_pool, _first->key, _first->value, _first->weight, _priorities.next());
+
+            for (++_first; _first != _last && _first->key == u->key; ++_first)
+            {
+                u->add(_first->value, _first->weight);
+            }
+
+            //Nodes with a higher priority than u become its left subtree
+            Node* last = nullptr;
+
+            while (!spine.empty() && spine.back()->p > u->p)
+            {
+                last = spine.back();
+                spine.pop_back();
+                complete(last);
+            }
+
+            if (last)
+            {
+                u->left = last;
+                last->parent = u;
+            }
+
+            if (!spine.empty())
+            {
+                spine.back()->right = u;
+                u->parent = spine.back();
+            }
+
+            spine.push_back(u);
+        }
+
+        Node* root = spine.empty() ? nullptr : spine.front();
+
+        while (!spine.empty())
+        {
+            complete(spine.back());
+            spine.pop_back();
+        }
+
+        return root;
+    }
+
     /**
      * Splits in two parts: Treap with keys < than x, and treap with keys >= x.
      */
@@ -510,7 +684,8 @@ namespace KLib
         if (u)
         {
             //Change priority to lowest
-            u->p = -1;
+            const typename Node::priority_type priority = u->p;
+            u->p = TreapPriority::TOP;
 
             //Bubble it up to the top!
             bubbleUp(u, root);
@@ -540,7 +715,7 @@ namespace KLib
             u->parent = u->left = u->right = nullptr;
 
             //Get back standard priority for u
-            u->p = rand();
+            u->p = priority;
 
             //Insert it back in the new treap
             doInsert(u, &otherRoot);
@@ -572,8 +747,8 @@ namespace KLib
         }
 
         //Create new root with any value, put two treaps as subchilds
-        Node* newRoot = new Node(x);
-        newRoot->p = -1;
+        Node* newRoot = Node::create((*root)->pool, x);
+        newRoot->p = TreapPriority::TOP;
         newRoot->left = *root;
         newRoot->right = *otherRoot;
         newRoot->left->parent = newRoot;
@@ -818,7 +993,7 @@ namespace KLib
                     n = n->next;
                 }
 
-                delete u;
+                Node::destroy(u);
                 u = nullptr;
             }
 
@@ -851,7 +1026,7 @@ namespace KLib
             w = u->sum - u->sumLeft() - u->sumRight();
             p = u->parent;
             splice(u, root);
-            delete u;
+            Node::destroy(u);
         }
 
         while (p)
@@ -30,6 +30,10 @@
 #ifndef AUGMENTEDTREAPMAP_H
 #define AUGMENTEDTREAPMAP_H
 
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
 #include "util/treap/treap-util.h"
 
 template <class K, class V, class S>
@@ -57,6 +61,7 @@ class AugmentedTreapMap {
   using const_key = const K&;
   using weight = typename Node::weight_type;
   using const_weight = const weight&;
+  using element_type = TreapElement<K, V, S>;
 
   using iterator = AugmentedTreapMapIterator<AugmentedTreapMap<K, V, S>>;
 
@@ -73,6 +78,19 @@ class AugmentedTreapMap {
   virtual void Insert(const_key _key, const_reference _value,
                       const_weight _weight);
 
+  /**
+   * @brief Inserts the elements (element_type) of [_first, _last), which must
+   * be sorted by key.
+   *
+   * If the treap is empty, it is built at once. Otherwise, the elements are
+   * inserted one by one. Throws std::invalid_argument if the range is not
+   * sorted.
+   *
+   * Complexity: O(n) if the treap is empty, E[O(nlogn)] otherwise
+   */
+  template <class ForwardIt>
+  void InsertSorted(ForwardIt _first, ForwardIt _last);
+
   /**
    * @brief Removes the element with key _key and value _value
    *
@@ -454,6 +472,29 @@ void AugmentedTreapMap<K, V, S>::Insert(const_key _key, const_reference _value,
   TreapUtil<Node>::doInsert(newNode, &m_root);
 }
 
+template <class K, class V, class S>
+template <class ForwardIt>
+void AugmentedTreapMap<K, V, S>::InsertSorted(ForwardIt _first,
+                                              ForwardIt _last) {
+  using element = typename std::iterator_traits<ForwardIt>::value_type;
+
+  if (!std::is_sorted(_first, _last,
+                      [](const element& _a, const element& _b) {
+                        return _a.key < _b.key;
+                      })) {
+    throw std::invalid_argument(
+        "AugmentedTreapMap InsertSorted (): range not sorted");
+  }
+
+  if (!m_root) {
+    m_root = TreapUtil<Node>::doBuild(_first, _last);
+  } else {
+    for (; _first != _last; ++_first) {
+      Insert(_first->key, _first->value, _first->weight);
+    }
+  }
+}
+
 template <class K, class V, class S>
 bool AugmentedTreapMap<K, V, S>::Remove(iterator i) {
   if (i == end()) return false;
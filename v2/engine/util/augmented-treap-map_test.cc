@@ -0,0 +1,104 @@
+#include "util/augmented-treap-map.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace kangaroo {
+namespace {
+
+using Map = AugmentedTreapMap<int, int, int64_t>;
+
+std::vector<Map::element_type> SortedElements(int count) {
+  std::mt19937 gen(42);
+  std::vector<Map::element_type> elements;
+
+  for (int i = 0; i < count; ++i) {
+    elements.push_back({static_cast<int>(gen() % (count / 3 + 1)), i,
+                        static_cast<int64_t>(gen() % 100)});
+  }
+
+  std::stable_sort(
+      elements.begin(), elements.end(),
+      [](const Map::element_type& a, const Map::element_type& b) {
+        return a.key < b.key;
+      });
+  return elements;
+}
+
+std::vector<std::pair<int, int>> Contents(const Map& map) {
+  std::vector<std::pair<int, int>> contents;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    contents.push_back({it.key(), it.value()});
+  }
+  return contents;
+}
+
+TEST(AugmentedTreapMap, InsertSortedEmptyRange) {
+  std::vector<Map::element_type> elements;
+  Map map;
+  map.InsertSorted(elements.begin(), elements.end());
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.size(), 0);
+}
+
+TEST(AugmentedTreapMap, InsertSortedMatchesInsert) {
+  std::vector<Map::element_type> elements = SortedElements(1000);
+
+  Map inserted;
+  for (const auto& e : elements) {
+    inserted.Insert(e.key, e.value, e.weight);
+  }
+
+  Map built;
+  built.InsertSorted(elements.begin(), elements.end());
+
+  EXPECT_EQ(built.size(), inserted.size());
+  EXPECT_EQ(built.Weight(), inserted.Weight());
+  EXPECT_EQ(Contents(built), Contents(inserted));
+
+  for (int key = -1; key <= elements.back().key + 1; ++key) {
+    EXPECT_EQ(built.WeightTo(key), inserted.WeightTo(key));
+    EXPECT_EQ(built.WeightBefore(key), inserted.WeightBefore(key));
+    EXPECT_EQ(built.WeightFrom(key), inserted.WeightFrom(key));
+  }
+}
+
+TEST(AugmentedTreapMap, InsertSortedThenModify) {
+  std::vector<Map::element_type> elements = SortedElements(100);
+
+  Map built;
+  built.InsertSorted(elements.begin(), elements.end());
+
+  ASSERT_TRUE(built.Remove(elements[50].key, elements[50].value));
+  built.Insert(-5, -1, 7);
+
+  EXPECT_EQ(built.size(), 100);
+  EXPECT_EQ(built.first_key(), -5);
+  EXPECT_EQ(built.WeightTo(-5), 7);
+}
+
+TEST(AugmentedTreapMap, InsertSortedIntoNonEmptyMap) {
+  std::vector<Map::element_type> elements = SortedElements(100);
+
+  Map map;
+  map.Insert(10, -1, 1);
+  map.InsertSorted(elements.begin(), elements.end());
+
+  EXPECT_EQ(map.size(), 101);
+  EXPECT_TRUE(map.Contains(10, -1));
+}
+
+TEST(AugmentedTreapMap, InsertSortedUnsortedRange) {
+  std::vector<Map::element_type> elements = {{2, 0, 1}, {1, 1, 1}};
+  Map map;
+  EXPECT_THROW(map.InsertSorted(elements.begin(), elements.end()),
+               std::invalid_argument);
+  EXPECT_TRUE(map.empty());
+}
+
+}  // namespace
+}  // namespace kangaroo
@@ -33,6 +33,7 @@
 #include <assert.h>
 
 #include <utility>
+#include <vector>
 
 namespace kangaroo {
 namespace AugmentedTreapWeight {
@@ -48,6 +49,15 @@ W makeEmpty() {
 
 }  // namespace AugmentedTreapWeight
 
+// Element of the sorted ranges used to build a treap at once (see
+// TreapUtil::doBuild()).
+template <class K, class V, class W>
+struct TreapElement {
+  K key;
+  V value;
+  W weight;
+};
+
 template <class K, class V, class W>
 struct AugmentedTreapNode {
   using key_type = K;
@@ -275,6 +285,9 @@ struct TreapUtil {
 
   static void doClear(Node** root);
 
+  template <class ForwardIt>
+  static Node* doBuild(ForwardIt _first, ForwardIt _last);
+
   static weight_type leftWeight(const_key _to, bool inclusive, Node* root);
   static weight_type leftWeight(Node* cur, subnode_type* _sub, bool inclusive,
                                 Node* root);
@@ -416,6 +429,71 @@ void TreapUtil<Node>::doClear(Node** root) {
   *root = nullptr;
 }
 
+/**
+ * Builds a treap from the TreapElement's in [_first, _last), sorted by key, and
+ * returns its root. O(n).
+ *
+ * Elements with the same key share a node, in the order doInsert() would have
+ * given them. The nodes are linked as a Cartesian tree of their priorities with
+ * a stack holding the right spine of the treap: a node is complete when it
+ * leaves the stack, so the weights and counts are computed at that moment.
+ */
+template <class Node>
+template <class ForwardIt>
+Node* TreapUtil<Node>::doBuild(ForwardIt _first, ForwardIt _last) {
+  std::vector<Node*> spine;
+
+  auto complete = [](Node* u) {
+    if (u->left) {
+      u->weight += u->left->weight;
+      u->count += u->left->count;
+    }
+
+    if (u->right) {
+      u->weight += u->right->weight;
+      u->count += u->right->count;
+    }
+  };
+
+  while (_first != _last) {
+    Node* u = new Node(_first->key, _first->value, _first->weight);
+
+    for (++_first; _first != _last && _first->key == u->key; ++_first) {
+      u->add(_first->value, _first->weight);
+    }
+
+    // Nodes with a higher priority than u become its left subtree
+    Node* last = nullptr;
+
+    while (!spine.empty() && spine.back()->p > u->p) {
+      last = spine.back();
+      spine.pop_back();
+      complete(last);
+    }
+
+    if (last) {
+      u->left = last;
+      last->parent = u;
+    }
+
+    if (!spine.empty()) {
+      spine.back()->right = u;
+      u->parent = spine.back();
+    }
+
+    spine.push_back(u);
+  }
+
+  Node* root = spine.empty() ? nullptr : spine.front();
+
+  while (!spine.empty()) {
+    complete(spine.back());
+    spine.pop_back();
+  }
+
+  return root;
+}
+
 /**
  * Splits in two parts: Treap with keys < than x, and treap with keys >= x.
  */